@@ -0,0 +1,421 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// Atlas.c
+//
+//    Benchmark for the texture atlas.  Sprites of random sizes are drawn
+//    into an offscreen target at their own size, once with a texture and a
+//    draw call per sprite and once from atlas pages with one bind and one
+//    draw call per page, and both results must be identical.  The sprites
+//    are then drawn at a quarter of their size from an atlas with mipmaps,
+//    where every pixel must still come from its own sprite, and, for
+//    comparison, from an atlas without gutters whose pages are mipmapped
+//    with glGenerateMipmap.
+//
+//    Usage: BM_Atlas [sprites] [frames]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esUtil.h"
+
+#define MAX_SPRITES     256
+#define MAX_PAGES       8
+#define PAGE_SIZE       512
+
+// Sprites are laid out on a grid of cells of the largest sprite size
+#define MAX_SPRITE_SIZE 64
+#define GRID_SIZE       16
+#define TARGET_SIZE     ( GRID_SIZE * MAX_SPRITE_SIZE )
+
+// Minification of the mipmap check
+#define MIN_SCALE       4
+
+typedef struct
+{
+   int            width;
+   int            height;
+   unsigned char *pixels;
+   GLuint         texture;
+   ESAtlasRegion  region;
+   ESAtlasRegion  mipRegion;
+   ESAtlasRegion  naiveRegion;
+} Sprite;
+
+typedef struct
+{
+   GLuint   programObject;
+   GLint    scaleLoc;
+   GLint    samplerLoc;
+
+   GLuint   framebuffer;
+   GLuint   target;
+
+   Sprite   sprites[MAX_SPRITES];
+   int      numSprites;
+
+   // Interleaved position and texture coordinates, six vertices per sprite
+   GLfloat *vertices;
+} BenchData;
+
+///
+// Fill a sprite with a pattern in red and its number in green and blue
+//
+static void MakeSprite ( Sprite *sprite, int index, unsigned int *seed )
+{
+   int x, y;
+
+   *seed = *seed * 1103515245 + 12345;
+   sprite->width = 8 + ( *seed >> 16 ) % ( MAX_SPRITE_SIZE - 7 );
+   *seed = *seed * 1103515245 + 12345;
+   sprite->height = 8 + ( *seed >> 16 ) % ( MAX_SPRITE_SIZE - 7 );
+   sprite->pixels = malloc ( sprite->width * sprite->height * 4 );
+
+   for ( y = 0; y < sprite->height; y++ )
+   {
+      for ( x = 0; x < sprite->width; x++ )
+      {
+         unsigned char *p = sprite->pixels + ( y * sprite->width + x ) * 4;
+
+         p[0] = (unsigned char) ( x * 7 + y * 13 + index * 29 );
+         p[1] = (unsigned char) ( 32 + 64 * ( ( index >> 6 ) & 3 ) );
+         p[2] = (unsigned char) ( 2 + 4 * ( ( index * 37 ) & 63 ) );
+         p[3] = 255;
+      }
+   }
+}
+
+///
+// Write the two triangles of a sprite drawn at its grid cell, scaled down by scale
+//
+static void WriteQuad ( GLfloat *v, int index, const Sprite *sprite, int scale, const ESAtlasRegion *region )
+{
+   static const GLfloat corners[12] = { 0, 0,  1, 0,  1, 1,  0, 0,  1, 1,  0, 1 };
+   GLfloat x = (GLfloat) ( index % GRID_SIZE ) * MAX_SPRITE_SIZE / scale;
+   GLfloat y = (GLfloat) ( index / GRID_SIZE ) * MAX_SPRITE_SIZE / scale;
+   GLfloat texCoords[12];
+   int i;
+
+   if ( region != NULL )
+      esAtlasRemapTexCoords ( region, corners, texCoords, 6 );
+   else
+      memcpy ( texCoords, corners, sizeof ( corners ) );
+
+   for ( i = 0; i < 6; i++ )
+   {
+      v[i * 4 + 0] = x + corners[i * 2] * sprite->width / scale;
+      v[i * 4 + 1] = y + corners[i * 2 + 1] * sprite->height / scale;
+      v[i * 4 + 2] = texCoords[i * 2];
+      v[i * 4 + 3] = texCoords[i * 2 + 1];
+   }
+}
+
+///
+// Draw all sprites, with a texture each or from the given atlas regions.  Sprites are written
+// page by page so that each page takes one draw call.  Returns the draw calls made.
+//
+static int DrawSprites ( BenchData *data, int scale, int atlas )
+{
+   GLfloat *v = data->vertices;
+   int first[MAX_PAGES + 1] = { 0 };
+   GLuint pageTexture[MAX_PAGES] = { 0 };
+   int draws = 0, page, i;
+
+   if ( atlas == 0 )
+   {
+      for ( i = 0; i < data->numSprites; i++ )
+         WriteQuad ( v + i * 24, i, &data->sprites[i], scale, NULL );
+   }
+   else
+   {
+      int count = 0;
+
+      for ( page = 0; page < MAX_PAGES; page++ )
+      {
+         first[page] = count;
+         for ( i = 0; i < data->numSprites; i++ )
+         {
+            const Sprite *sprite = &data->sprites[i];
+            const ESAtlasRegion *region = atlas == 1 ? &sprite->region :
+                                          atlas == 2 ? &sprite->mipRegion : &sprite->naiveRegion;
+
+            if ( region->page == page )
+            {
+               WriteQuad ( v + count++ * 24, i, sprite, scale, region );
+               pageTexture[page] = region->texture;
+            }
+         }
+      }
+      first[MAX_PAGES] = count;
+   }
+
+   glBindFramebuffer ( GL_FRAMEBUFFER, data->framebuffer );
+   glViewport ( 0, 0, TARGET_SIZE, TARGET_SIZE );
+   glClearColor ( 0.0f, 0.0f, 0.0f, 0.0f );
+   glClear ( GL_COLOR_BUFFER_BIT );
+
+   esStateUseProgram ( data->programObject );
+   glUniform1f ( data->scaleLoc, 2.0f / TARGET_SIZE );
+   glUniform1i ( data->samplerLoc, 0 );
+   glVertexAttribPointer ( 0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof ( GLfloat ), v );
+   glVertexAttribPointer ( 1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof ( GLfloat ), v + 2 );
+   glEnableVertexAttribArray ( 0 );
+   glEnableVertexAttribArray ( 1 );
+
+   if ( atlas == 0 )
+   {
+      for ( i = 0; i < data->numSprites; i++, draws++ )
+      {
+         esStateBindTexture ( GL_TEXTURE_2D, data->sprites[i].texture );
+         glDrawArrays ( GL_TRIANGLES, i * 6, 6 );
+      }
+   }
+   else
+   {
+      for ( page = 0; page < MAX_PAGES; page++ )
+      {
+         if ( first[page + 1] > first[page] )
+         {
+            esStateBindTexture ( GL_TEXTURE_2D, pageTexture[page] );
+            glDrawArrays ( GL_TRIANGLES, first[page] * 6, ( first[page + 1] - first[page] ) * 6 );
+            draws++;
+         }
+      }
+   }
+   return draws;
+}
+
+///
+// Milliseconds per frame of drawing all sprites
+//
+static double TimeFrames ( BenchData *data, int atlas, int frames, int *draws )
+{
+   double t;
+   int i;
+
+   DrawSprites ( data, 1, atlas );
+   glFinish ( );
+
+   t = esGetTime ( );
+   for ( i = 0; i < frames; i++ )
+      *draws = DrawSprites ( data, 1, atlas );
+   glFinish ( );
+   return ( esGetTime ( ) - t ) * 1000.0 / frames;
+}
+
+///
+// Count the sprites drawn scaled down with a pixel whose number is not their own.  Only pixels
+// whose centers lie inside the quad of a sprite are checked.
+//
+static int CountBleeding ( BenchData *data, int atlas, unsigned char *pixels )
+{
+   int size = TARGET_SIZE / MIN_SCALE;
+   int bleeding = 0, i, x, y;
+
+   DrawSprites ( data, MIN_SCALE, atlas );
+   glReadPixels ( 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels );
+
+   for ( i = 0; i < data->numSprites; i++ )
+   {
+      const Sprite *sprite = &data->sprites[i];
+      int x0 = ( i % GRID_SIZE ) * MAX_SPRITE_SIZE / MIN_SCALE;
+      int y0 = ( i / GRID_SIZE ) * MAX_SPRITE_SIZE / MIN_SCALE;
+      int wrong = 0;
+
+      for ( y = y0; y < y0 + sprite->height / MIN_SCALE; y++ )
+      {
+         for ( x = x0; x < x0 + sprite->width / MIN_SCALE; x++ )
+         {
+            const unsigned char *p = pixels + ( y * size + x ) * 4;
+
+            wrong |= abs ( p[1] - sprite->pixels[1] ) > 1 || abs ( p[2] - sprite->pixels[2] ) > 1;
+         }
+      }
+      bleeding += wrong;
+   }
+   return bleeding;
+}
+
+///
+// Print how full the pages of an atlas are
+//
+static void PrintAtlas ( const char *name, ESAtlas *atlas )
+{
+   ESAtlasStats stats;
+
+   esGetAtlasStats ( atlas, &stats );
+   printf ( "%-28s %d pages, images %.1f%% of the texels, cells %.1f%%, %.0f KB uploaded\n", name,
+            stats.numPages, 100.0 * stats.imageTexels / stats.pageTexels,
+            100.0 * stats.usedTexels / stats.pageTexels, stats.uploadedBytes / 1024.0 );
+}
+
+int main ( int argc, char *argv[] )
+{
+   ESContext esContext;
+   static BenchData data;
+   int numSprites = argc > 1 ? atoi ( argv[1] ) : MAX_SPRITES;
+   int frames = argc > 2 ? atoi ( argv[2] ) : 200;
+   GLbyte vShaderStr[] =
+      "uniform float u_scale;                                 \n"
+      "attribute vec2 a_position;                             \n"
+      "attribute vec2 a_texCoord;                             \n"
+      "varying vec2 v_texCoord;                               \n"
+      "void main()                                            \n"
+      "{                                                      \n"
+      "   gl_Position = vec4 ( a_position * u_scale - 1.0,    \n"
+      "                        0.0, 1.0 );                    \n"
+      "   v_texCoord = a_texCoord;                            \n"
+      "}                                                      \n";
+   GLbyte fShaderStr[] =
+      "precision mediump float;                               \n"
+      "varying vec2 v_texCoord;                               \n"
+      "uniform sampler2D s_texture;                           \n"
+      "void main()                                            \n"
+      "{                                                      \n"
+      "  gl_FragColor = texture2D( s_texture, v_texCoord );   \n"
+      "}                                                      \n";
+   unsigned char *separate, *atlased;
+   ESAtlas *atlas, *mipAtlas, *naiveAtlas;
+   double separateTime, atlasTime;
+   int separateDraws = 0, atlasDraws = 0, mipBleeding, naiveBleeding;
+   unsigned int seed = 1;
+   GLboolean passed = GL_TRUE;
+   int i;
+
+   if ( numSprites < 1 || numSprites > MAX_SPRITES || frames < 1 )
+   {
+      printf ( "Usage: %s [sprites (1..%d)] [frames]\n", argv[0], MAX_SPRITES );
+      return 1;
+   }
+
+   esInitContext ( &esContext );
+   if ( !esCreateWindow ( &esContext, "Atlas Benchmark", 320, 240, ES_WINDOW_RGB ) )
+   {
+      esLogMessage ( "Unable to create the rendering context\n" );
+      return 1;
+   }
+
+   data.programObject = esLoadProgram ( (char *) vShaderStr, (char *) fShaderStr );
+   if ( data.programObject == 0 )
+      return 1;
+   glBindAttribLocation ( data.programObject, 0, "a_position" );
+   glBindAttribLocation ( data.programObject, 1, "a_texCoord" );
+   glLinkProgram ( data.programObject );
+   data.scaleLoc = glGetUniformLocation ( data.programObject, "u_scale" );
+   data.samplerLoc = glGetUniformLocation ( data.programObject, "s_texture" );
+
+   glGenTextures ( 1, &data.target );
+   glBindTexture ( GL_TEXTURE_2D, data.target );
+   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGBA, TARGET_SIZE, TARGET_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glGenFramebuffers ( 1, &data.framebuffer );
+   glBindFramebuffer ( GL_FRAMEBUFFER, data.framebuffer );
+   glFramebufferTexture2D ( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, data.target, 0 );
+   if ( glCheckFramebufferStatus ( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+      return 1;
+
+   // Gutters of one texel for linear filtering, a mipmapped atlas that keeps sprites apart
+   // down to level 3, and one without gutters mipmapped as a whole
+   atlas = esAtlasCreate ( PAGE_SIZE, GL_RGBA, 1, 1, MAX_PAGES );
+   mipAtlas = esAtlasCreate ( PAGE_SIZE, GL_RGBA, 0, 4, MAX_PAGES );
+   naiveAtlas = esAtlasCreate ( PAGE_SIZE, GL_RGBA, 0, 1, MAX_PAGES );
+   if ( atlas == NULL || mipAtlas == NULL || naiveAtlas == NULL )
+      return 1;
+
+   data.numSprites = numSprites;
+   data.vertices = malloc ( numSprites * 24 * sizeof ( GLfloat ) );
+   for ( i = 0; i < numSprites; i++ )
+   {
+      Sprite *sprite = &data.sprites[i];
+
+      MakeSprite ( sprite, i, &seed );
+      glGenTextures ( 1, &sprite->texture );
+      glBindTexture ( GL_TEXTURE_2D, sprite->texture );
+      glPixelStorei ( GL_UNPACK_ALIGNMENT, 1 );
+      glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGBA, sprite->width, sprite->height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                     sprite->pixels );
+      glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+      glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+      glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+      glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+
+      if ( !esAtlasAdd ( atlas, sprite->width, sprite->height, GL_RGBA, sprite->pixels, &sprite->region ) ||
+           !esAtlasAdd ( mipAtlas, sprite->width, sprite->height, GL_RGBA, sprite->pixels, &sprite->mipRegion ) ||
+           !esAtlasAdd ( naiveAtlas, sprite->width, sprite->height, GL_RGBA, sprite->pixels,
+                         &sprite->naiveRegion ) )
+         return 1;
+   }
+   esStateInvalidate ( );
+
+   for ( i = 0; i < MAX_PAGES; i++ )
+   {
+      ESAtlasRegion *region = NULL;
+      int j;
+
+      for ( j = 0; j < numSprites && region == NULL; j++ )
+         if ( data.sprites[j].naiveRegion.page == i )
+            region = &data.sprites[j].naiveRegion;
+      if ( region == NULL )
+         break;
+      esStateBindTexture ( GL_TEXTURE_2D, region->texture );
+      glGenerateMipmap ( GL_TEXTURE_2D );
+      glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+   }
+
+   printf ( "%d sprites from 8x8 to %dx%d, %dx%d pages\n", numSprites, MAX_SPRITE_SIZE, MAX_SPRITE_SIZE,
+            PAGE_SIZE, PAGE_SIZE );
+   PrintAtlas ( "atlas, 1 texel gutter", atlas );
+   PrintAtlas ( "atlas, mipmaps to level 3", mipAtlas );
+   PrintAtlas ( "atlas, no gutter", naiveAtlas );
+
+   separate = malloc ( TARGET_SIZE * TARGET_SIZE * 4 );
+   atlased = malloc ( TARGET_SIZE * TARGET_SIZE * 4 );
+
+   DrawSprites ( &data, 1, 0 );
+   glReadPixels ( 0, 0, TARGET_SIZE, TARGET_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, separate );
+   DrawSprites ( &data, 1, 1 );
+   glReadPixels ( 0, 0, TARGET_SIZE, TARGET_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, atlased );
+   if ( memcmp ( separate, atlased, TARGET_SIZE * TARGET_SIZE * 4 ) != 0 )
+   {
+      printf ( "sprites drawn from the atlas differ from their own textures\n" );
+      passed = GL_FALSE;
+   }
+
+   separateTime = TimeFrames ( &data, 0, frames, &separateDraws );
+   atlasTime = TimeFrames ( &data, 1, frames, &atlasDraws );
+   printf ( "%-28s %8s %8s\n", "", "draws", "ms" );
+   printf ( "%-28s %8d %8.3f\n", "texture per sprite", separateDraws, separateTime );
+   printf ( "%-28s %8d %8.3f\n", "atlas", atlasDraws, atlasTime );
+
+   mipBleeding = CountBleeding ( &data, 2, atlased );
+   naiveBleeding = CountBleeding ( &data, 3, atlased );
+   printf ( "sprites bleeding at 1/%d size: mipmapped atlas %d, no gutter %d\n", MIN_SCALE,
+            mipBleeding, naiveBleeding );
+   if ( mipBleeding != 0 )
+      passed = GL_FALSE;
+
+   esAtlasDestroy ( atlas );
+   esAtlasDestroy ( mipAtlas );
+   esAtlasDestroy ( naiveAtlas );
+   for ( i = 0; i < numSprites; i++ )
+   {
+      glDeleteTextures ( 1, &data.sprites[i].texture );
+      free ( data.sprites[i].pixels );
+   }
+   glDeleteFramebuffers ( 1, &data.framebuffer );
+   glDeleteTextures ( 1, &data.target );
+   esStateInvalidate ( );
+   free ( data.vertices );
+   free ( separate );
+   free ( atlased );
+
+   printf ( "%s\n", passed ? "atlas sprites match their own textures and do not bleed" : "FAILED" );
+   return passed ? 0 : 1;
+}
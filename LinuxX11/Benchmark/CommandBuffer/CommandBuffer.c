@@ -0,0 +1,324 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// CommandBuffer.c
+//
+//    Benchmark for recorded command buffers.  Every frame draws a large
+//    number of objects that each need a matrix and a color computed before
+//    they can be drawn.  The frame is first prepared and issued directly on
+//    the GL thread, then prepared by 1..N worker threads recording into their
+//    own command buffers that the GL thread replays in order.
+//
+//    Usage: BM_CommandBuffer [numObjects] [framesPerRun]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "esUtil.h"
+
+#define MAX_THREADS  16
+
+typedef struct
+{
+   // Handle to a program object
+   GLuint programObject;
+
+   // Attribute locations
+   GLint  positionLoc;
+
+   // Uniform locations
+   GLint  mvpLoc;
+   GLint  colorLoc;
+
+   // Quad vertex buffer
+   GLuint vertexBuffer;
+
+   // Scene
+   int       numObjects;
+   float     time;
+   ESMatrix  viewProj;
+
+} UserData;
+
+typedef struct
+{
+   UserData        *userData;
+   ESCommandBuffer  cmdBuffer;
+   int              first;
+   int              count;
+   pthread_t        thread;
+} Worker;
+
+static pthread_barrier_t startBarrier;
+static pthread_barrier_t doneBarrier;
+static volatile int      quit;
+
+///
+// Compute the matrix and color of one object
+//
+static void PrepareObject ( UserData *userData, int i, ESMatrix *mvp, GLfloat color[4] )
+{
+   ESMatrix model;
+   float    phase = (float) i * 0.37f;
+   int      grid = (int) sqrtf ( (float) userData->numObjects ) + 1;
+
+   esMatrixLoadIdentity ( &model );
+   esTranslate ( &model, ( (float) ( i % grid ) / grid ) * 2.0f - 1.0f,
+                         ( (float) ( i / grid ) / grid ) * 2.0f - 1.0f, 0.0f );
+   esRotate ( &model, userData->time * 90.0f + phase * 57.0f, 0.0f, 0.0f, 1.0f );
+   esScale ( &model, 1.0f / grid, 1.0f / grid, 1.0f );
+   esMatrixMultiply ( mvp, &model, &userData->viewProj );
+
+   color[0] = 0.5f + 0.5f * sinf ( phase + userData->time );
+   color[1] = 0.5f + 0.5f * sinf ( phase * 1.3f + userData->time );
+   color[2] = 0.5f + 0.5f * sinf ( phase * 1.7f + userData->time );
+   color[3] = 1.0f;
+}
+
+///
+// Prepare and draw every object directly on the GL thread
+//
+static void DrawDirect ( UserData *userData )
+{
+   int i;
+
+   for ( i = 0; i < userData->numObjects; i++ )
+   {
+      ESMatrix mvp;
+      GLfloat  color[4];
+
+      PrepareObject ( userData, i, &mvp, color );
+      glUniformMatrix4fv ( userData->mvpLoc, 1, GL_FALSE, &mvp.m[0][0] );
+      glUniform4fv ( userData->colorLoc, 1, color );
+      glDrawArrays ( GL_TRIANGLE_STRIP, 0, 4 );
+   }
+}
+
+///
+// Record the objects of one worker's slice into its command buffer
+//
+static void RecordSlice ( Worker *worker )
+{
+   UserData *userData = worker->userData;
+   int i;
+
+   esCmdBufferReset ( &worker->cmdBuffer );
+   for ( i = worker->first; i < worker->first + worker->count; i++ )
+   {
+      ESMatrix mvp;
+      GLfloat  color[4];
+
+      PrepareObject ( userData, i, &mvp, color );
+      esCmdUniformMatrix4fv ( &worker->cmdBuffer, userData->mvpLoc, 1, &mvp.m[0][0] );
+      esCmdUniformfv ( &worker->cmdBuffer, userData->colorLoc, 4, 1, color );
+      esCmdDrawArrays ( &worker->cmdBuffer, GL_TRIANGLE_STRIP, 0, 4 );
+   }
+}
+
+static void *WorkerMain ( void *arg )
+{
+   Worker *worker = arg;
+
+   for ( ;; )
+   {
+      pthread_barrier_wait ( &startBarrier );
+      if ( quit )
+         break;
+      RecordSlice ( worker );
+      pthread_barrier_wait ( &doneBarrier );
+   }
+   return NULL;
+}
+
+///
+// Initialize the shader, program object and vertex buffer
+//
+int Init ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   GLbyte vShaderStr[] =
+      "uniform mat4 u_mvpMatrix;                   \n"
+      "attribute vec4 a_position;                  \n"
+      "void main()                                 \n"
+      "{                                           \n"
+      "   gl_Position = u_mvpMatrix * a_position;  \n"
+      "}                                           \n";
+
+   GLbyte fShaderStr[] =
+      "precision mediump float;                    \n"
+      "uniform vec4 u_color;                       \n"
+      "void main()                                 \n"
+      "{                                           \n"
+      "  gl_FragColor = u_color;                   \n"
+      "}                                           \n";
+
+   GLfloat quad[] = { -0.5f, -0.5f, 0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f };
+
+   userData->programObject = esLoadProgram ( (char *) vShaderStr, (char *) fShaderStr );
+   if ( userData->programObject == 0 )
+      return FALSE;
+
+   userData->positionLoc = glGetAttribLocation ( userData->programObject, "a_position" );
+   userData->mvpLoc = glGetUniformLocation ( userData->programObject, "u_mvpMatrix" );
+   userData->colorLoc = glGetUniformLocation ( userData->programObject, "u_color" );
+
+   glGenBuffers ( 1, &userData->vertexBuffer );
+   glBindBuffer ( GL_ARRAY_BUFFER, userData->vertexBuffer );
+   glBufferData ( GL_ARRAY_BUFFER, sizeof ( quad ), quad, GL_STATIC_DRAW );
+
+   esMatrixLoadIdentity ( &userData->viewProj );
+   esOrtho ( &userData->viewProj, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f );
+
+   glViewport ( 0, 0, esContext->width, esContext->height );
+   glClearColor ( 0.0f, 0.0f, 0.0f, 0.0f );
+   glUseProgram ( userData->programObject );
+   glVertexAttribPointer ( userData->positionLoc, 2, GL_FLOAT, GL_FALSE, 0, 0 );
+   glEnableVertexAttribArray ( userData->positionLoc );
+
+   return TRUE;
+}
+
+///
+// Run one configuration and print its timings.  numThreads == 0 draws directly.
+//
+static void RunBenchmark ( ESContext *esContext, Worker *workers, int numThreads, int numFrames )
+{
+   UserData *userData = esContext->userData;
+   ESCommandBuffer *buffers[MAX_THREADS];
+   double prepareTime = 0.0;
+   double replayTime = 0.0;
+   double start = esGetTime ( );
+   size_t bytes = 0;
+   int frame;
+   int i;
+
+   for ( i = 0; i < numThreads; i++ )
+      buffers[i] = &workers[i].cmdBuffer;
+
+   for ( frame = 0; frame < numFrames; frame++ )
+   {
+      double t0, t1, t2;
+
+      userData->time = frame / 60.0f;
+      glClear ( GL_COLOR_BUFFER_BIT );
+
+      t0 = esGetTime ( );
+      if ( numThreads == 0 )
+      {
+         DrawDirect ( userData );
+         t1 = t2 = esGetTime ( );
+      }
+      else
+      {
+         pthread_barrier_wait ( &startBarrier );
+         pthread_barrier_wait ( &doneBarrier );
+         t1 = esGetTime ( );
+         esCmdBufferReplayList ( buffers, numThreads );
+         t2 = esGetTime ( );
+
+         bytes = 0;
+         for ( i = 0; i < numThreads; i++ )
+            bytes += workers[i].cmdBuffer.size;
+      }
+
+      eglSwapBuffers ( esContext->eglDisplay, esContext->eglSurface );
+      glFinish ( );
+
+      prepareTime += t1 - t0;
+      replayTime += t2 - t1;
+   }
+
+   printf ( "%-8s %7d %12.3f %12.3f %12.3f %10.1f\n",
+            numThreads == 0 ? "direct" : "", numThreads,
+            prepareTime * 1000.0 / numFrames, replayTime * 1000.0 / numFrames,
+            ( esGetTime ( ) - start ) * 1000.0 / numFrames, bytes / 1024.0 );
+}
+
+///
+// Start numThreads workers, each owning an equal slice of the objects
+//
+static void StartWorkers ( UserData *userData, Worker *workers, int numThreads )
+{
+   int i;
+
+   quit = 0;
+   pthread_barrier_init ( &startBarrier, NULL, numThreads + 1 );
+   pthread_barrier_init ( &doneBarrier, NULL, numThreads + 1 );
+
+   for ( i = 0; i < numThreads; i++ )
+   {
+      workers[i].userData = userData;
+      workers[i].first = userData->numObjects * i / numThreads;
+      workers[i].count = userData->numObjects * ( i + 1 ) / numThreads - workers[i].first;
+      esCmdBufferInit ( &workers[i].cmdBuffer, 0 );
+      pthread_create ( &workers[i].thread, NULL, WorkerMain, &workers[i] );
+   }
+}
+
+static void StopWorkers ( Worker *workers, int numThreads )
+{
+   int i;
+
+   quit = 1;
+   pthread_barrier_wait ( &startBarrier );
+   for ( i = 0; i < numThreads; i++ )
+   {
+      pthread_join ( workers[i].thread, NULL );
+      esCmdBufferFree ( &workers[i].cmdBuffer );
+   }
+   pthread_barrier_destroy ( &startBarrier );
+   pthread_barrier_destroy ( &doneBarrier );
+}
+
+int main ( int argc, char *argv[] )
+{
+   ESContext esContext;
+   UserData  userData;
+   Worker    workers[MAX_THREADS];
+   int       numFrames = 100;
+   int       maxThreads = (int) sysconf ( _SC_NPROCESSORS_ONLN );
+   int       numThreads;
+
+   esInitContext ( &esContext );
+   esContext.userData = &userData;
+
+   userData.numObjects = argc > 1 ? atoi ( argv[1] ) : 20000;
+   if ( argc > 2 )
+      numFrames = atoi ( argv[2] );
+   if ( maxThreads > MAX_THREADS )
+      maxThreads = MAX_THREADS;
+
+   if ( !esCreateWindow ( &esContext, "Command Buffer Benchmark", 320, 240, ES_WINDOW_RGB ) )
+   {
+      esLogMessage ( "Unable to create the rendering context\n" );
+      return 1;
+   }
+
+   if ( !Init ( &esContext ) )
+      return 1;
+
+   printf ( "%d objects, %d frames per run, times in ms per frame\n", userData.numObjects, numFrames );
+   printf ( "%-8s %7s %12s %12s %12s %10s\n", "mode", "threads", "prepare", "replay", "frame", "cmd KB" );
+
+   RunBenchmark ( &esContext, workers, 0, numFrames );
+
+   for ( numThreads = 1; numThreads <= maxThreads; numThreads *= 2 )
+   {
+      StartWorkers ( &userData, workers, numThreads );
+      RunBenchmark ( &esContext, workers, numThreads, numFrames );
+      StopWorkers ( workers, numThreads );
+   }
+
+   glDeleteBuffers ( 1, &userData.vertexBuffer );
+   glDeleteProgram ( userData.programObject );
+   return 0;
+}
@@ -0,0 +1,511 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// DDS.c
+//
+//    Checks and times esLoadDDS and esDecodeBCn.  DDS files of every
+//    supported 2D format are written with a full mip chain of synthetic
+//    data and loaded, then the base level is drawn and read back and
+//    compared with a straightforward one-pixel-at-a-time decoder, which
+//    also checks esDecodeBCn, including blocks cut by the image edge.  The
+//    decode times of both decoders are reported next to copying the
+//    decoded size with memcpy.  A cube map and volumes are loaded as well,
+//    and any DDS files given on the command line.  Exits with 1 if an
+//    image does not load or decode correctly.
+//
+//    Usage: BM_DDS [size] [iterations] [file.dds ...]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "esUtil.h"
+#include <GLES2/gl2ext.h>
+
+typedef struct
+{
+   const char    *name;
+
+   // S3TC format, or 0 with the bits and channel masks of an uncompressed format
+   GLenum         compressed;
+   int            bits;
+   unsigned int   masks[4];
+   GLboolean      luminance;
+} ImageKind;
+
+static const ImageKind kinds[] =
+{
+   { "DXT1",           GL_COMPRESSED_RGB_S3TC_DXT1_EXT,    0, { 0, 0, 0, 0 }, GL_FALSE },
+   { "DXT1 alpha",     GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,   0, { 0, 0, 0, 0 }, GL_FALSE },
+   { "DXT3",           GL_COMPRESSED_RGBA_S3TC_DXT3_ANGLE, 0, { 0, 0, 0, 0 }, GL_FALSE },
+   { "DXT5",           GL_COMPRESSED_RGBA_S3TC_DXT5_ANGLE, 0, { 0, 0, 0, 0 }, GL_FALSE },
+   { "A8R8G8B8",       0, 32, { 0xFF0000, 0xFF00, 0xFF, 0xFF000000 }, GL_FALSE },
+   { "A8B8G8R8",       0, 32, { 0xFF, 0xFF00, 0xFF0000, 0xFF000000 }, GL_FALSE },
+   { "X8R8G8B8",       0, 32, { 0xFF0000, 0xFF00, 0xFF, 0 }, GL_FALSE },
+   { "R8G8B8",         0, 24, { 0xFF0000, 0xFF00, 0xFF, 0 }, GL_FALSE },
+   { "R5G6B5",         0, 16, { 0xF800, 0x7E0, 0x1F, 0 }, GL_FALSE },
+   { "A4R4G4B4",       0, 16, { 0xF00, 0xF0, 0xF, 0xF000 }, GL_FALSE },
+   { "L8",             0,  8, { 0xFF, 0, 0, 0 }, GL_TRUE },
+};
+
+typedef struct
+{
+   GLuint programObject;
+   GLint  samplerLoc;
+} Renderer;
+
+///
+// Pseudo-random bytes, any bit pattern is a valid S3TC block
+//
+static void FillRandom ( unsigned char *data, size_t size, unsigned int seed )
+{
+   size_t i;
+
+   for ( i = 0; i < size; i++ )
+   {
+      seed = seed * 1664525u + 1013904223u;
+      data[i] = (unsigned char) ( seed >> 24 );
+   }
+}
+
+///
+// Bytes of a level of the given kind
+//
+static size_t LevelBytes ( const ImageKind *kind, int width, int height )
+{
+   if ( kind->compressed != 0 )
+      return (size_t) ( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) *
+             ( kind->compressed == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || kind->compressed == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? 8 : 16 );
+   return (size_t) width * height * ( kind->bits / 8 );
+}
+
+///
+// Write a DDS file with the given faces and levels of pseudo-random data, returning the base level
+//
+static unsigned char *WriteDDS ( const char *fileName, const ImageKind *kind, int width, int height, int depth,
+                                 int faces, int levels )
+{
+   unsigned int header[32] = { 0 };
+   unsigned char *base = NULL;
+   FILE *f = fopen ( fileName, "wb" );
+   int face, level;
+
+   if ( f == NULL )
+      return NULL;
+
+   header[0] = 0x20534444;                        // "DDS "
+   header[1] = 124;
+   header[2] = 0x1007 | 0x20000 | ( depth > 1 ? 0x800000 : 0 );
+   header[3] = height;
+   header[4] = width;
+   header[6] = depth;
+   header[7] = levels;
+   header[19] = 32;
+   if ( kind->compressed != 0 )
+   {
+      header[20] = 0x4 | ( kind->compressed == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? 0x1 : 0 );
+      header[21] = kind->compressed == GL_COMPRESSED_RGBA_S3TC_DXT5_ANGLE ? 0x35545844 :
+                   kind->compressed == GL_COMPRESSED_RGBA_S3TC_DXT3_ANGLE ? 0x33545844 : 0x31545844;
+   }
+   else
+   {
+      header[20] = ( kind->luminance ? 0x20000 : 0x40 ) | ( kind->masks[3] != 0 ? 0x1 : 0 );
+      header[22] = kind->bits;
+      memcpy ( &header[23], kind->masks, sizeof ( kind->masks ) );
+   }
+   header[27] = 0x1000 | ( levels > 1 ? 0x400008 : 0 );
+   header[28] = faces == 6 ? 0xFE00 : depth > 1 ? 0x200000 : 0;
+   fwrite ( header, 4, 32, f );
+
+   for ( face = 0; face < faces; face++ )
+   {
+      for ( level = 0; level < levels; level++ )
+      {
+         int w = width >> level ? width >> level : 1;
+         int h = height >> level ? height >> level : 1;
+         int d = depth >> level ? depth >> level : 1;
+         size_t bytes = LevelBytes ( kind, w, h ) * d;
+         unsigned char *data = malloc ( bytes );
+
+         FillRandom ( data, bytes, face * 131 + level * 7 + 1 );
+         fwrite ( data, 1, bytes, f );
+         if ( face == 0 && level == 0 )
+            base = data;
+         else
+            free ( data );
+      }
+   }
+
+   if ( fclose ( f ) != 0 )
+   {
+      free ( base );
+      return NULL;
+   }
+   return base;
+}
+
+///
+// Decode one pixel of an S3TC image the way the formats are specified
+//
+static void ReferenceBCn ( GLenum format, const unsigned char *data, int width, int x, int y, unsigned char rgba[4] )
+{
+   GLboolean dxt1 = format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+   const unsigned char *block = data + ( ( y / 4 ) * ( ( width + 3 ) / 4 ) + x / 4 ) * ( dxt1 ? 8 : 16 );
+   const unsigned char *color = dxt1 ? block : block + 8;
+   int p = ( y % 4 ) * 4 + x % 4;
+   int c0 = color[0] | ( color[1] << 8 ), c1 = color[2] | ( color[3] << 8 );
+   int code = ( color[4 + p / 4] >> ( ( p % 4 ) * 2 ) ) & 3;
+   int e0[3], e1[3], c;
+
+   e0[0] = ( ( c0 >> 11 ) << 3 ) | ( c0 >> 13 );
+   e0[1] = ( ( ( c0 >> 5 ) & 63 ) << 2 ) | ( ( c0 >> 9 ) & 3 );
+   e0[2] = ( ( c0 & 31 ) << 3 ) | ( ( c0 >> 2 ) & 7 );
+   e1[0] = ( ( c1 >> 11 ) << 3 ) | ( c1 >> 13 );
+   e1[1] = ( ( ( c1 >> 5 ) & 63 ) << 2 ) | ( ( c1 >> 9 ) & 3 );
+   e1[2] = ( ( c1 & 31 ) << 3 ) | ( ( c1 >> 2 ) & 7 );
+
+   rgba[3] = 255;
+   for ( c = 0; c < 3; c++ )
+   {
+      if ( code == 0 )
+         rgba[c] = e0[c];
+      else if ( code == 1 )
+         rgba[c] = e1[c];
+      else if ( !dxt1 || c0 > c1 )
+         rgba[c] = code == 2 ? ( 2 * e0[c] + e1[c] ) / 3 : ( e0[c] + 2 * e1[c] ) / 3;
+      else if ( code == 2 )
+         rgba[c] = ( e0[c] + e1[c] ) / 2;
+      else
+      {
+         rgba[c] = 0;
+         rgba[3] = format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? 0 : 255;
+      }
+   }
+
+   if ( format == GL_COMPRESSED_RGBA_S3TC_DXT3_ANGLE )
+   {
+      int a = ( block[p / 2] >> ( ( p % 2 ) * 4 ) ) & 15;
+      rgba[3] = a * 17;
+   }
+   else if ( format == GL_COMPRESSED_RGBA_S3TC_DXT5_ANGLE )
+   {
+      int a0 = block[0], a1 = block[1];
+      int bit = p * 3;
+      int index = ( ( block[2 + bit / 8] | ( bit / 8 < 5 ? block[3 + bit / 8] << 8 : 0 ) ) >> ( bit % 8 ) ) & 7;
+
+      if ( index == 0 )
+         rgba[3] = a0;
+      else if ( index == 1 )
+         rgba[3] = a1;
+      else if ( a0 > a1 )
+         rgba[3] = ( a0 * ( 8 - index ) + a1 * ( index - 1 ) ) / 7;
+      else if ( index < 6 )
+         rgba[3] = ( a0 * ( 6 - index ) + a1 * ( index - 1 ) ) / 5;
+      else
+         rgba[3] = index == 6 ? 0 : 255;
+   }
+}
+
+///
+// Expected RGBA of one pixel of the base level
+//
+static void ReferencePixel ( const ImageKind *kind, const unsigned char *data, int width, int x, int y, unsigned char rgba[4] )
+{
+   unsigned int pixel = 0;
+   int c;
+
+   if ( kind->compressed != 0 )
+   {
+      ReferenceBCn ( kind->compressed, data, width, x, y, rgba );
+      return;
+   }
+
+   memcpy ( &pixel, data + ( (size_t) y * width + x ) * ( kind->bits / 8 ), kind->bits / 8 );
+   for ( c = 0; c < 4; c++ )
+   {
+      unsigned int mask = kind->luminance && c < 3 ? kind->masks[0] : kind->masks[c];
+      int shift = 0;
+
+      if ( mask == 0 )
+      {
+         rgba[c] = c == 3 ? 255 : 0;
+         continue;
+      }
+      while ( ( ( mask >> shift ) & 1 ) == 0 )
+         shift++;
+      rgba[c] = (unsigned char) ( ( ( pixel & mask ) >> shift ) * 255.0 / ( mask >> shift ) + 0.5 );
+   }
+}
+
+///
+// Draw the base level of a 2D texture over the window and compare it with the reference
+//
+static GLboolean VerifyTexture ( Renderer *renderer, GLuint texture, const ImageKind *kind,
+                                 const unsigned char *data, int size )
+{
+   GLfloat vVertices[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+   unsigned char *pixels = malloc ( (size_t) size * size * 4 );
+   unsigned char expected[4];
+   // S3TC leaves the precision of interpolated colors and alphas to the implementation,
+   // llvmpipe is up to 2 off, and widening channels to 8 bits may round either way
+   int tolerance = kind->compressed != 0 ? 2 : 1;
+   GLboolean ok = GL_TRUE;
+   int x, y, c;
+
+   glViewport ( 0, 0, size, size );
+   glUseProgram ( renderer->programObject );
+   glBindTexture ( GL_TEXTURE_2D, texture );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+   glUniform1i ( renderer->samplerLoc, 0 );
+   glVertexAttribPointer ( 0, 2, GL_FLOAT, GL_FALSE, 0, vVertices );
+   glEnableVertexAttribArray ( 0 );
+   glDrawArrays ( GL_TRIANGLE_STRIP, 0, 4 );
+   glReadPixels ( 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels );
+
+   // Row 0 of the texture is at the bottom of the window
+   for ( y = 0; y < size && ok; y++ )
+   {
+      for ( x = 0; x < size && ok; x++ )
+      {
+         ReferencePixel ( kind, data, size, x, y, expected );
+         for ( c = 0; c < 4; c++ )
+         {
+            if ( abs ( pixels[( y * size + x ) * 4 + c] - expected[c] ) > tolerance )
+            {
+               printf ( "%s: pixel %d,%d is %d,%d,%d,%d, expected %d,%d,%d,%d\n", kind->name, x, y,
+                        pixels[( y * size + x ) * 4], pixels[( y * size + x ) * 4 + 1], pixels[( y * size + x ) * 4 + 2],
+                        pixels[( y * size + x ) * 4 + 3], expected[0], expected[1], expected[2], expected[3] );
+               ok = GL_FALSE;
+               break;
+            }
+         }
+      }
+   }
+
+   free ( pixels );
+   return ok;
+}
+
+///
+// Compare esDecodeBCn with the reference, width may cut the last column of blocks
+//
+static GLboolean VerifyDecode ( const ImageKind *kind, const unsigned char *data, int blocksWidth, int width, int height,
+                                const unsigned char *rgba )
+{
+   unsigned char expected[4];
+   int x, y;
+
+   for ( y = 0; y < height; y++ )
+   {
+      for ( x = 0; x < width; x++ )
+      {
+         ReferenceBCn ( kind->compressed, data, blocksWidth, x, y, expected );
+         if ( memcmp ( expected, rgba + ( (size_t) y * width + x ) * 4, 4 ) != 0 )
+         {
+            printf ( "%s: esDecodeBCn pixel %d,%d of %dx%d differs\n", kind->name, x, y, width, height );
+            return GL_FALSE;
+         }
+      }
+   }
+
+   return GL_TRUE;
+}
+
+///
+// Load a DDS file, reporting what it became
+//
+static GLboolean LoadAndReport ( const char *name, const char *fileName, GLenum expectedTarget, int iterations )
+{
+   double loadTime = 1e9, t;
+   GLenum target = 0;
+   int width = 0, height = 0, depth = 0, i;
+   GLuint texture = 0;
+
+   for ( i = 0; i < iterations; i++ )
+   {
+      glDeleteTextures ( 1, &texture );
+      t = esGetTime ( );
+      texture = esLoadDDS ( fileName, &target, &width, &height, &depth );
+      glFinish ( );
+      t = esGetTime ( ) - t;
+      loadTime = t < loadTime ? t : loadTime;
+      if ( texture == 0 )
+         break;
+   }
+
+   printf ( "%-22s %4dx%dx%d %-13s %10.3f ms\n", name, width, height, depth,
+            target == GL_TEXTURE_CUBE_MAP ? "cube map" : target == GL_TEXTURE_3D_OES ? "3D" : "2D", loadTime * 1000.0 );
+   glDeleteTextures ( 1, &texture );
+
+   if ( texture == 0 || ( expectedTarget != 0 && target != expectedTarget ) )
+   {
+      printf ( "%-22s FAILED\n", name );
+      return GL_FALSE;
+   }
+   return GL_TRUE;
+}
+
+int main ( int argc, char *argv[] )
+{
+   ESContext esContext;
+   Renderer renderer;
+   int size = argc > 1 ? atoi ( argv[1] ) : 512;
+   int iterations = argc > 2 ? atoi ( argv[2] ) : 10;
+   char fileName[] = "/tmp/BM_DDS_XXXXXX";
+   const char vShaderStr[] =
+      "attribute vec4 a_position;                  \n"
+      "varying vec2 v_texCoord;                    \n"
+      "void main()                                 \n"
+      "{                                           \n"
+      "   gl_Position = a_position;                \n"
+      "   v_texCoord = a_position.xy * 0.5 + 0.5;  \n"
+      "}                                           \n";
+   const char fShaderStr[] =
+      "precision mediump float;                            \n"
+      "varying vec2 v_texCoord;                            \n"
+      "uniform sampler2D s_texture;                        \n"
+      "void main()                                         \n"
+      "{                                                   \n"
+      "  gl_FragColor = texture2D ( s_texture, v_texCoord );\n"
+      "}                                                   \n";
+   static const ImageKind cubeKind = { "DXT1 cube map", GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 0, { 0, 0, 0, 0 }, GL_FALSE };
+   static const ImageKind volumeKind = { "L8 volume", 0, 8, { 0xFF, 0, 0, 0 }, GL_TRUE };
+   static const ImageKind dxtVolumeKind = { "DXT5 volume", GL_COMPRESSED_RGBA_S3TC_DXT5_ANGLE, 0, { 0, 0, 0, 0 }, GL_FALSE };
+   GLboolean passed = GL_TRUE;
+   unsigned int k;
+   int levels, fd, i;
+
+   if ( size < 8 || size > 4096 || ( size & ( size - 1 ) ) != 0 || iterations < 1 )
+   {
+      printf ( "Usage: %s [size (power of two, 8..4096)] [iterations] [file.dds ...]\n", argv[0] );
+      return 1;
+   }
+
+   esInitContext ( &esContext );
+   if ( !esCreateWindow ( &esContext, "DDS Benchmark", size, size, ES_WINDOW_RGB | ES_WINDOW_ALPHA ) )
+   {
+      printf ( "Unable to create the rendering context\n" );
+      return 1;
+   }
+
+   renderer.programObject = esLoadProgram ( vShaderStr, fShaderStr );
+   if ( renderer.programObject == 0 )
+      return 1;
+   glBindAttribLocation ( renderer.programObject, 0, "a_position" );
+   glLinkProgram ( renderer.programObject );
+   renderer.samplerLoc = glGetUniformLocation ( renderer.programObject, "s_texture" );
+
+   fd = mkstemp ( fileName );
+   if ( fd < 0 )
+      return 1;
+   close ( fd );
+
+   for ( levels = 1; size >> levels; levels++ );
+
+   printf ( "%dx%d images with %d levels, best of %d\n", size, size, levels, iterations );
+   printf ( "%-22s %10s %12s %12s %10s\n", "", "load ms", "per-pixel ms", "decode ms", "copy ms" );
+
+   for ( k = 0; k < sizeof ( kinds ) / sizeof ( kinds[0] ); k++ )
+   {
+      const ImageKind *kind = &kinds[k];
+      double loadTime = 1e9, referenceTime = 1e9, decodeTime = 1e9, copyTime = 1e9, t;
+      unsigned char *data = WriteDDS ( fileName, kind, size, size, 1, 1, levels );
+      unsigned char *rgba = malloc ( (size_t) size * size * 4 );
+      unsigned char *copy = malloc ( (size_t) size * size * 4 );
+      GLuint texture = 0;
+      GLenum target;
+      int x, y;
+
+      if ( data == NULL )
+      {
+         passed = GL_FALSE;
+         break;
+      }
+
+      for ( i = 0; i < iterations; i++ )
+      {
+         glDeleteTextures ( 1, &texture );
+         t = esGetTime ( );
+         texture = esLoadDDS ( fileName, &target, NULL, NULL, NULL );
+         glFinish ( );
+         t = esGetTime ( ) - t;
+         loadTime = t < loadTime ? t : loadTime;
+         if ( texture == 0 )
+            break;
+      }
+
+      if ( texture == 0 || target != GL_TEXTURE_2D || !VerifyTexture ( &renderer, texture, kind, data, size ) )
+      {
+         printf ( "%-22s FAILED\n", kind->name );
+         passed = GL_FALSE;
+      }
+      glDeleteTextures ( 1, &texture );
+
+      if ( kind->compressed != 0 )
+      {
+         for ( i = 0; i < iterations; i++ )
+         {
+            t = esGetTime ( );
+            for ( y = 0; y < size; y++ )
+               for ( x = 0; x < size; x++ )
+                  ReferenceBCn ( kind->compressed, data, size, x, y, rgba + ( (size_t) y * size + x ) * 4 );
+            t = esGetTime ( ) - t;
+            referenceTime = t < referenceTime ? t : referenceTime;
+
+            t = esGetTime ( );
+            esDecodeBCn ( kind->compressed, data, size, size, rgba );
+            t = esGetTime ( ) - t;
+            decodeTime = t < decodeTime ? t : decodeTime;
+
+            t = esGetTime ( );
+            memcpy ( copy, data, LevelBytes ( kind, size, size ) );
+            memcpy ( copy, rgba, (size_t) size * size * 4 );
+            t = esGetTime ( ) - t;
+            copyTime = t < copyTime ? t : copyTime;
+         }
+
+         if ( !VerifyDecode ( kind, data, size, size, size, rgba ) )
+            passed = GL_FALSE;
+
+         // Two columns and rows short, so the last blocks are cut
+         esDecodeBCn ( kind->compressed, data, size - 2, size - 2, rgba );
+         if ( !VerifyDecode ( kind, data, size, size - 2, size - 2, rgba ) )
+            passed = GL_FALSE;
+
+         printf ( "%-22s %10.3f %12.3f %12.3f %10.3f\n", kind->name, loadTime * 1000.0,
+                  referenceTime * 1000.0, decodeTime * 1000.0, copyTime * 1000.0 );
+      }
+      else
+      {
+         printf ( "%-22s %10.3f\n", kind->name, loadTime * 1000.0 );
+      }
+
+      free ( data );
+      free ( rgba );
+      free ( copy );
+   }
+
+   printf ( "\n" );
+   free ( WriteDDS ( fileName, &cubeKind, size / 2, size / 2, 1, 6, levels - 1 ) );
+   passed &= LoadAndReport ( cubeKind.name, fileName, GL_TEXTURE_CUBE_MAP, iterations );
+   free ( WriteDDS ( fileName, &volumeKind, 64, 64, 64, 1, 7 ) );
+   passed &= LoadAndReport ( volumeKind.name, fileName, GL_TEXTURE_3D_OES, iterations );
+   free ( WriteDDS ( fileName, &dxtVolumeKind, 32, 32, 32, 1, 1 ) );
+   passed &= LoadAndReport ( dxtVolumeKind.name, fileName, GL_TEXTURE_3D_OES, iterations );
+   unlink ( fileName );
+
+   for ( i = 3; i < argc; i++ )
+      passed &= LoadAndReport ( argv[i], argv[i], 0, iterations );
+
+   glDeleteProgram ( renderer.programObject );
+   printf ( "%s\n", passed ? "all images loaded correctly" : "LOAD ERRORS" );
+   return passed ? 0 : 1;
+}
@@ -0,0 +1,184 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// DynamicResolution.c
+//
+//    Convergence check for dynamic resolution.  Every frame covers the window
+//    with a fragment shader that loops a fixed number of times, so the frame
+//    time is proportional to the number of pixels drawn.  The frame time at
+//    full resolution is measured first, then the main loop runs with a budget
+//    of a fraction of it and the benchmark reports whether the render scale
+//    settled with the frame time on budget.  Exits with 1 if it did not.
+//
+//    Usage: BM_DynamicResolution [budgetFraction] [frames] [shaderIterations]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "esUtil.h"
+
+#define MAX_FRAMES   ES_FRAME_HISTORY
+
+typedef struct
+{
+   // Handle to a program object
+   GLuint programObject;
+
+   // Uniform locations
+   GLint  timeLoc;
+
+   // Render scale of each frame
+   float  scales[MAX_FRAMES];
+   int    numFrames;
+
+} UserData;
+
+///
+// Initialize the shader and program object
+//
+int Init ( ESContext *esContext, int iterations )
+{
+   UserData *userData = esContext->userData;
+   char fShaderStr[1024];
+   const char vShaderStr[] =
+      "attribute vec4 a_position;                  \n"
+      "varying vec2 v_texCoord;                    \n"
+      "void main()                                 \n"
+      "{                                           \n"
+      "   gl_Position = a_position;                \n"
+      "   v_texCoord = a_position.xy;              \n"
+      "}                                           \n";
+
+   // GLSL ES loops need a constant bound
+   snprintf ( fShaderStr, sizeof ( fShaderStr ),
+      "precision mediump float;                                  \n"
+      "varying vec2 v_texCoord;                                  \n"
+      "uniform float u_time;                                     \n"
+      "void main()                                               \n"
+      "{                                                         \n"
+      "  vec2 p = v_texCoord;                                    \n"
+      "  for ( int i = 0; i < %d; i++ )                          \n"
+      "     p = vec2 ( sin ( p.y * 1.7 + u_time ), cos ( p.x * 1.3 ) ); \n"
+      "  gl_FragColor = vec4 ( p * 0.5 + 0.5, 0.5, 1.0 );        \n"
+      "}                                                         \n", iterations );
+
+   userData->programObject = esLoadProgram ( vShaderStr, fShaderStr );
+   if ( userData->programObject == 0 )
+      return FALSE;
+
+   glBindAttribLocation ( userData->programObject, 0, "a_position" );
+   glLinkProgram ( userData->programObject );
+   userData->timeLoc = glGetUniformLocation ( userData->programObject, "u_time" );
+
+   glClearColor ( 0.0f, 0.0f, 0.0f, 0.0f );
+   return TRUE;
+}
+
+///
+// Draw the load, recording the render scale of the frame
+//
+void Draw ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   GLfloat vVertices[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+
+   if ( userData->numFrames < MAX_FRAMES )
+      userData->scales[userData->numFrames++] = esGetRenderScale ( esContext, NULL, NULL );
+
+   glViewport ( 0, 0, esContext->width, esContext->height );
+   glClear ( GL_COLOR_BUFFER_BIT );
+   glUseProgram ( userData->programObject );
+   glUniform1f ( userData->timeLoc, userData->numFrames / 60.0f );
+   glVertexAttribPointer ( 0, 2, GL_FLOAT, GL_FALSE, 0, vVertices );
+   glEnableVertexAttribArray ( 0 );
+   glDrawArrays ( GL_TRIANGLE_STRIP, 0, 4 );
+}
+
+int main ( int argc, char *argv[] )
+{
+   ESContext esContext;
+   UserData  userData;
+   ESFrameStats stats;
+   float budgetFraction = argc > 1 ? (float) atof ( argv[1] ) : 0.5f;
+   int numFrames = argc > 2 ? atoi ( argv[2] ) : 240;
+   int iterations = argc > 3 ? atoi ( argv[3] ) : 16;
+   float fullTime, budget, frameMean, scaleMean, scaleDev, scaleMin, scaleMax;
+   const ESFrameHistory *history = &esContext.frameHistory;
+   int first, count, i;
+   GLboolean converged;
+
+   if ( budgetFraction <= 0.0f || numFrames < 20 || numFrames > MAX_FRAMES || iterations < 1 )
+   {
+      esLogMessage ( "Usage: %s [budgetFraction] [frames (20..%d)] [shaderIterations]\n", argv[0], MAX_FRAMES );
+      return 1;
+   }
+
+   esInitContext ( &esContext );
+   esContext.userData = &userData;
+
+   if ( !esCreateWindow ( &esContext, "Dynamic Resolution Benchmark", 640, 480, ES_WINDOW_RGB ) )
+   {
+      esLogMessage ( "Unable to create the rendering context\n" );
+      return 1;
+   }
+
+   if ( !Init ( &esContext, iterations ) )
+      return 1;
+
+   esRegisterDrawFunc ( &esContext, Draw );
+
+   // Frame time at full resolution
+   userData.numFrames = 0;
+   esContext.maxFrames = 20;
+   esMainLoop ( &esContext );
+   esGetFrameStats ( &esContext, &stats );
+   fullTime = stats.frame.p50;
+   budget = fullTime * budgetFraction;
+
+   // Let the controller find the scale for the budget
+   esResetFrameStats ( &esContext );
+   userData.numFrames = 0;
+   esContext.maxFrames = numFrames;
+   if ( !esEnableDynamicResolution ( &esContext, budget, 0.25f, 1.0f ) )
+      return 1;
+   esMainLoop ( &esContext );
+
+   printf ( "%dx%d full resolution %.2f ms, budget %.2f ms\n", esContext.width, esContext.height, fullTime, budget );
+   printf ( "%6s %8s %8s\n", "frame", "scale", "ms" );
+   for ( i = 0; i < userData.numFrames; i += 10 )
+      printf ( "%6d %8.3f %8.2f\n", i, userData.scales[i], history->frames[i % ES_FRAME_HISTORY].frame );
+
+   // Judge the last quarter of the run
+   count = userData.numFrames / 4;
+   first = userData.numFrames - count;
+   frameMean = scaleMean = scaleDev = 0.0f;
+   scaleMin = scaleMax = userData.scales[first];
+   for ( i = first; i < userData.numFrames; i++ )
+   {
+      frameMean += history->frames[i % ES_FRAME_HISTORY].frame / count;
+      scaleMean += userData.scales[i] / count;
+      scaleMin = userData.scales[i] < scaleMin ? userData.scales[i] : scaleMin;
+      scaleMax = userData.scales[i] > scaleMax ? userData.scales[i] : scaleMax;
+   }
+   for ( i = first; i < userData.numFrames; i++ )
+      scaleDev += ( userData.scales[i] - scaleMean ) * ( userData.scales[i] - scaleMean ) / count;
+   scaleDev = sqrtf ( scaleDev );
+
+   // The scale may also end up pinned at a limit of its range when the budget is out of reach
+   converged = scaleDev <= 0.04f &&
+               ( fabsf ( frameMean - budget ) <= 0.15f * budget ||
+                 ( scaleMin <= 0.25f && frameMean > budget ) || ( scaleMax >= 1.0f && frameMean < budget ) );
+
+   printf ( "last %d frames: %.2f ms mean, scale %.3f +- %.3f (%.3f..%.3f) -> %s\n",
+            count, frameMean, scaleMean, scaleDev, scaleMin, scaleMax, converged ? "converged" : "NOT converged" );
+
+   glDeleteProgram ( userData.programObject );
+   return converged ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// FixedTimestep.c
+//
+//    Checks esSetFixedTimestep.  The update callback counts the steps run
+//    before every frame, and the draw callback checks that there were no more
+//    than maxStepsPerFrame, that every step was the fixed step and that the
+//    interpolation alpha is in [0,1).
+//
+//    The first run feeds a repeating pattern of frame times through
+//    fixedDeltaTime, so that it is reproducible.  In its first half every
+//    frame time is below the cap and the simulated time must keep up with
+//    the frame times exactly; in its second half some frames take far longer
+//    than the cap allows.  The second run uses the real frame times, with a
+//    stall in some of the frames.  Exits with 1 if any check failed.
+//
+//    Usage: BM_FixedTimestep [frames] [stepsPerSecond] [maxStepsPerFrame]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include "esUtil.h"
+
+// Every this many frames the second half of a run has a stall, as long as this many caps
+#define STALL_INTERVAL  25
+#define STALL_CAPS      3.0f
+
+#define MAX_STEPS       16
+
+typedef struct
+{
+   // Steps run since the last frame was drawn and the step they were given
+   int          steps;
+   int          badStep;
+
+   // Frame time fed to the main loop for the current frame, 0 in real time
+   float        deltaTime;
+   GLboolean    realTime;
+
+   // Checks made by the draw callback
+   int          frames;
+   int          histogram[MAX_STEPS + 1];
+   int          overCap;
+   int          badAlpha;
+   float        maxAlpha;
+   double       simulatedTime;
+   double       frameTime;
+   double       drift;
+} UserData;
+
+///
+// Frame time of the given frame of the reproducible run
+//
+float PatternDelta ( ESContext *esContext, int frame )
+{
+   // Fractions of the cap: with less than a step carried over, none of them runs into it
+   static const float pattern[] = { 0.25f, 0.06f, 0.5f, 0.01f, 0.97f, 0.33f };
+   float cap = esContext->maxStepsPerFrame * esContext->fixedTimestep;
+
+   if ( frame >= (int) esContext->maxFrames / 2 && frame % STALL_INTERVAL == 0 )
+      return STALL_CAPS * cap;
+   return pattern[frame % ( sizeof ( pattern ) / sizeof ( pattern[0] ) )] * cap;
+}
+
+///
+// Count the steps of the coming frame
+//
+void Update ( ESContext *esContext, float deltaTime )
+{
+   UserData *userData = esContext->userData;
+
+   if ( deltaTime != esContext->fixedTimestep )
+      userData->badStep++;
+   userData->steps++;
+}
+
+///
+// Check the steps that ran before this frame and set up the time of the next
+//
+void Draw ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   float alpha = esContext->interpolationAlpha;
+   int steps = userData->steps;
+
+   userData->histogram[steps < MAX_STEPS ? steps : MAX_STEPS]++;
+   if ( steps > esContext->maxStepsPerFrame )
+      userData->overCap++;
+   if ( alpha < 0.0f || alpha >= 1.0f )
+      userData->badAlpha++;
+   userData->maxAlpha = alpha > userData->maxAlpha ? alpha : userData->maxAlpha;
+   userData->steps = 0;
+
+   // Until the first stall no simulation time may be dropped
+   userData->simulatedTime += steps * (double) esContext->fixedTimestep;
+   userData->frameTime += userData->deltaTime;
+   if ( !userData->realTime && userData->frames < (int) esContext->maxFrames / 2 )
+      userData->drift = fabs ( userData->simulatedTime + alpha * esContext->fixedTimestep - userData->frameTime );
+
+   glClear ( GL_COLOR_BUFFER_BIT );
+
+   userData->frames++;
+   if ( userData->realTime )
+   {
+      if ( userData->frames >= (int) esContext->maxFrames / 2 && userData->frames % STALL_INTERVAL == 0 )
+         usleep ( (useconds_t) ( STALL_CAPS * esContext->maxStepsPerFrame * esContext->fixedTimestep * 1e6f ) );
+   }
+   else
+   {
+      userData->deltaTime = PatternDelta ( esContext, userData->frames );
+      esContext->fixedDeltaTime = userData->deltaTime;
+   }
+}
+
+///
+// Run the main loop once and print the number of frames by steps run
+//
+GLboolean Run ( ESContext *esContext, const char *name, int frames, GLboolean realTime )
+{
+   UserData *userData = esContext->userData;
+   int maxSteps = esContext->maxStepsPerFrame;
+   GLboolean passed;
+   int i;
+
+   userData->steps = userData->badStep = 0;
+   userData->frames = userData->overCap = userData->badAlpha = 0;
+   userData->maxAlpha = 0.0f;
+   userData->simulatedTime = userData->frameTime = userData->drift = 0.0;
+   for ( i = 0; i <= MAX_STEPS; i++ )
+      userData->histogram[i] = 0;
+
+   userData->realTime = realTime;
+   esContext->maxFrames = frames;
+   userData->deltaTime = realTime ? 0.0f : PatternDelta ( esContext, 0 );
+   esContext->fixedDeltaTime = userData->deltaTime;
+   esMainLoop ( esContext );
+   esContext->fixedDeltaTime = 0.0f;
+
+   passed = userData->overCap == 0 && userData->badAlpha == 0 && userData->badStep == 0 &&
+            userData->drift < 1e-3;
+
+   printf ( "%-9s", name );
+   for ( i = 0; i <= maxSteps; i++ )
+      printf ( " %5d", userData->histogram[i] );
+   printf ( " %6d %6d   %.3f", userData->overCap, userData->badStep, userData->maxAlpha );
+   if ( !realTime )
+      printf ( "   %.2e", userData->drift );
+   printf ( "\n" );
+
+   return passed;
+}
+
+int main ( int argc, char *argv[] )
+{
+   ESContext esContext;
+   UserData  userData = { 0 };
+   int numFrames = argc > 1 ? atoi ( argv[1] ) : 200;
+   float rate = argc > 2 ? (float) atof ( argv[2] ) : 120.0f;
+   int maxSteps = argc > 3 ? atoi ( argv[3] ) : 4;
+   GLboolean passed;
+   int i;
+
+   if ( numFrames < 2 * STALL_INTERVAL || rate <= 0.0f || maxSteps < 1 || maxSteps >= MAX_STEPS )
+   {
+      esLogMessage ( "Usage: %s [frames (%d..)] [stepsPerSecond] [maxStepsPerFrame (1..%d)]\n",
+                     argv[0], 2 * STALL_INTERVAL, MAX_STEPS - 1 );
+      return 1;
+   }
+
+   esInitContext ( &esContext );
+   esContext.userData = &userData;
+
+   if ( !esCreateWindow ( &esContext, "Fixed Timestep Benchmark", 320, 240, ES_WINDOW_RGB ) )
+   {
+      esLogMessage ( "Unable to create the rendering context\n" );
+      return 1;
+   }
+
+   glClearColor ( 0.0f, 0.0f, 0.0f, 0.0f );
+   esRegisterDrawFunc ( &esContext, Draw );
+   esRegisterUpdateFunc ( &esContext, Update );
+   esSetFixedTimestep ( &esContext, rate, maxSteps );
+
+   printf ( "%.0f steps per second, at most %d per frame\n", rate, maxSteps );
+   printf ( "%-9s", "steps" );
+   for ( i = 0; i <= maxSteps; i++ )
+      printf ( " %5d", i );
+   printf ( " %6s %6s   %5s   %s\n", "over", "dt", "alpha", "drift" );
+
+   passed = Run ( &esContext, "pattern", numFrames, GL_FALSE );
+   passed = Run ( &esContext, "realtime", numFrames, GL_TRUE ) && passed;
+
+   printf ( "steps within the cap, alpha in [0,1), no time lost below the cap -> %s\n",
+            passed ? "passed" : "FAILED" );
+   return passed ? 0 : 1;
+}
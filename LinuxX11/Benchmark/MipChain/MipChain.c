@@ -0,0 +1,218 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// MipChain.c
+//
+//    Benchmark for esGenerateMipChain.  Every format is filtered from noise
+//    images of even and odd sizes and compared level by level with the float
+//    box filter the MipMap2D example used, which allocates each level and
+//    stops once a side reaches one texel; the chain must match it byte for
+//    byte and give the same levels with one thread and with several.  The
+//    time of both on a square image is then printed.
+//
+//    Usage: BM_MipChain [size] [iterations] [threads]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esUtil.h"
+
+typedef struct
+{
+   const char *name;
+   GLenum      format;
+   int         bpp;
+} Format;
+
+static const Format formats[] =
+{
+   { "GL_LUMINANCE",       GL_LUMINANCE,       1 },
+   { "GL_LUMINANCE_ALPHA", GL_LUMINANCE_ALPHA, 2 },
+   { "GL_RGB",             GL_RGB,             3 },
+   { "GL_RGBA",            GL_RGBA,            4 },
+};
+
+// Sizes checked against the reference, odd ones drop their last row or column
+static const int sizes[][2] = { { 256, 256 }, { 1000, 600 }, { 333, 77 }, { 64, 2 }, { 3, 3 } };
+
+///
+// GenMipMap2D of the MipMap2D example for bpp bytes per pixel
+//
+static unsigned char *ReferenceLevel ( const unsigned char *src, int srcWidth, int srcHeight, int bpp,
+                                       int *dstWidth, int *dstHeight )
+{
+   unsigned char *dst;
+   int x, y, c, sample;
+
+   *dstWidth = srcWidth / 2 > 0 ? srcWidth / 2 : 1;
+   *dstHeight = srcHeight / 2 > 0 ? srcHeight / 2 : 1;
+   dst = malloc ( (size_t) *dstWidth * *dstHeight * bpp );
+
+   for ( y = 0; y < *dstHeight; y++ )
+   {
+      for ( x = 0; x < *dstWidth; x++ )
+      {
+         int srcIndex[4];
+
+         srcIndex[0] = ( ( ( y * 2 ) * srcWidth ) + ( x * 2 ) ) * bpp;
+         srcIndex[1] = ( ( ( y * 2 ) * srcWidth ) + ( x * 2 + 1 ) ) * bpp;
+         srcIndex[2] = ( ( ( ( y * 2 ) + 1 ) * srcWidth ) + ( x * 2 ) ) * bpp;
+         srcIndex[3] = ( ( ( ( y * 2 ) + 1 ) * srcWidth ) + ( x * 2 + 1 ) ) * bpp;
+
+         for ( c = 0; c < bpp; c++ )
+         {
+            float sum = 0.0f;
+
+            for ( sample = 0; sample < 4; sample++ )
+               sum += src[srcIndex[sample] + c];
+            dst[( y * *dstWidth + x ) * bpp + c] = (unsigned char) ( sum / 4.0 );
+         }
+      }
+   }
+
+   return dst;
+}
+
+///
+// Noise image, the extreme values included
+//
+static unsigned char *MakeImage ( int width, int height, int bpp, unsigned int seed )
+{
+   size_t bytes = (size_t) width * height * bpp, i;
+   unsigned char *pixels = malloc ( bytes );
+
+   for ( i = 0; i < bytes; i++ )
+   {
+      seed = seed * 1103515245 + 12345;
+      pixels[i] = ( seed >> 16 ) & 0x100 ? 255 * ( ( seed >> 12 ) & 1 ) : (unsigned char) ( seed >> 20 );
+   }
+   return pixels;
+}
+
+///
+// Compare a chain with the reference levels and with the chain built by numThreads threads
+//
+static GLboolean Check ( const Format *format, int width, int height, int numThreads )
+{
+   unsigned char *pixels = MakeImage ( width, height, format->bpp, width * 31 + height );
+   unsigned char *level = pixels;
+   ESMipChain chain, threaded;
+   GLboolean passed = GL_TRUE;
+   int levelWidth = width, levelHeight = height, i;
+
+   if ( !esGenerateMipChain ( pixels, width, height, format->format, 1, &chain ) ||
+        !esGenerateMipChain ( pixels, width, height, format->format, numThreads, &threaded ) )
+   {
+      free ( pixels );
+      return GL_FALSE;
+   }
+
+   if ( chain.size != threaded.size || memcmp ( chain.data, threaded.data, chain.size ) != 0 )
+   {
+      printf ( "%s %dx%d: %d threads give different levels\n", format->name, width, height, numThreads );
+      passed = GL_FALSE;
+   }
+
+   for ( i = 1; levelWidth > 1 && levelHeight > 1; i++ )
+   {
+      unsigned char *next = ReferenceLevel ( level, levelWidth, levelHeight, format->bpp, &levelWidth, &levelHeight );
+
+      if ( level != pixels )
+         free ( level );
+      level = next;
+
+      if ( chain.width[i] != levelWidth || chain.height[i] != levelHeight ||
+           memcmp ( esMipChainLevel ( &chain, i ), level, (size_t) levelWidth * levelHeight * format->bpp ) != 0 )
+      {
+         printf ( "%s %dx%d: level %d differs from the reference\n", format->name, width, height, i );
+         passed = GL_FALSE;
+         break;
+      }
+   }
+
+   if ( chain.width[chain.numLevels - 1] != 1 || chain.height[chain.numLevels - 1] != 1 )
+      passed = GL_FALSE;
+
+   if ( level != pixels )
+      free ( level );
+   free ( pixels );
+   esFreeMipChain ( &chain );
+   esFreeMipChain ( &threaded );
+   return passed;
+}
+
+int main ( int argc, char *argv[] )
+{
+   int size = argc > 1 ? atoi ( argv[1] ) : 2048;
+   int iterations = argc > 2 ? atoi ( argv[2] ) : 5;
+   int numThreads = argc > 3 ? atoi ( argv[3] ) : 4;
+   GLboolean passed = GL_TRUE;
+   unsigned int f, s;
+   int i;
+
+   if ( size < 2 || size > 16384 || iterations < 1 || numThreads < 1 )
+   {
+      printf ( "Usage: %s [size] [iterations] [threads]\n", argv[0] );
+      return 1;
+   }
+
+   for ( f = 0; f < sizeof ( formats ) / sizeof ( formats[0] ); f++ )
+      for ( s = 0; s < sizeof ( sizes ) / sizeof ( sizes[0] ); s++ )
+         passed &= Check ( &formats[f], sizes[s][0], sizes[s][1], numThreads );
+
+   printf ( "%dx%d images, best of %d, ms\n", size, size, iterations );
+   printf ( "%-20s %10s %10s %10s\n", "", "reference", "1 thread", "threads" );
+
+   for ( f = 0; f < sizeof ( formats ) / sizeof ( formats[0] ); f++ )
+   {
+      const Format *format = &formats[f];
+      unsigned char *pixels = MakeImage ( size, size, format->bpp, 1 );
+      double best[3] = { 1e9, 1e9, 1e9 }, t;
+
+      for ( i = 0; i < iterations; i++ )
+      {
+         unsigned char *level = pixels;
+         int width = size, height = size;
+         ESMipChain chain;
+
+         t = esGetTime ( );
+         while ( width > 1 && height > 1 )
+         {
+            unsigned char *next = ReferenceLevel ( level, width, height, format->bpp, &width, &height );
+
+            if ( level != pixels )
+               free ( level );
+            level = next;
+         }
+         if ( level != pixels )
+            free ( level );
+         t = esGetTime ( ) - t;
+         best[0] = t < best[0] ? t : best[0];
+
+         t = esGetTime ( );
+         passed &= esGenerateMipChain ( pixels, size, size, format->format, 1, &chain );
+         t = esGetTime ( ) - t;
+         best[1] = t < best[1] ? t : best[1];
+         esFreeMipChain ( &chain );
+
+         t = esGetTime ( );
+         passed &= esGenerateMipChain ( pixels, size, size, format->format, numThreads, &chain );
+         t = esGetTime ( ) - t;
+         best[2] = t < best[2] ? t : best[2];
+         esFreeMipChain ( &chain );
+      }
+
+      printf ( "%-20s %10.2f %10.2f %10.2f\n", format->name, best[0] * 1000.0, best[1] * 1000.0, best[2] * 1000.0 );
+      free ( pixels );
+   }
+
+   printf ( "%s\n", passed ? "all chains match the reference filter" : "FAILED" );
+   return passed ? 0 : 1;
+}
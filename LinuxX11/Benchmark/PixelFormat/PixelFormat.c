@@ -0,0 +1,424 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// PixelFormat.c
+//
+//    Benchmark for esConvertPixels.  RGB and RGBA noise images of widths
+//    that leave a tail for the SIMD kernels are converted to every format,
+//    without dithering and with ordered dithering, and compared byte for
+//    byte with a plain division by 255.  A gradient is then converted to
+//    RGB565 with each dithering and the averages of 8x8 blocks, expanded
+//    back to 8 bits, are compared with the source: dithering must keep them
+//    closer than rounding does.  Every format is loaded with
+//    esTexImage2DConverted, drawn into an RGBA target and read back against
+//    the expanded reference, and the time of the conversion is printed.
+//
+//    Usage: BM_PixelFormat [size] [iterations]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esUtil.h"
+
+// Size of the images loaded into textures, odd so that rows need unpack alignment 1
+#define CHECK_WIDTH     253
+#define CHECK_HEIGHT    61
+
+// Block size of the gradient check
+#define BLOCK_SIZE      8
+
+typedef struct
+{
+   const char *name;
+   GLenum      format;
+   int         bytes;
+
+   // Largest red, green, blue and alpha values and their shifts in a packed short, 0 for luminance
+   int         max[4];
+   int         shift[4];
+} Format;
+
+static const Format formats[] =
+{
+   { "GL_RGB565",          GL_RGB565,          2, { 31, 63, 31, 0 },  { 11, 5, 0, 0 } },
+   { "GL_RGBA4",           GL_RGBA4,           2, { 15, 15, 15, 15 }, { 12, 8, 4, 0 } },
+   { "GL_RGB5_A1",         GL_RGB5_A1,         2, { 31, 31, 31, 1 },  { 11, 6, 1, 0 } },
+   { "GL_LUMINANCE",       GL_LUMINANCE,       1, { 0, 0, 0, 0 },     { 0, 0, 0, 0 } },
+   { "GL_LUMINANCE_ALPHA", GL_LUMINANCE_ALPHA, 2, { 0, 0, 0, 0 },     { 0, 0, 0, 0 } },
+};
+
+static const char *ditherNames[] = { "none", "ordered", "Floyd-Steinberg" };
+
+static const int bayer[4][4] = { { 0, 8, 2, 10 }, { 12, 4, 14, 6 }, { 3, 11, 1, 9 }, { 15, 7, 13, 5 } };
+
+// Widths checked against the reference, each with some height
+static const int widths[] = { 1, 3, 7, 8, 9, 15, 16, 17, 64, 251 };
+
+///
+// Plain conversion of one pixel, dither ES_DITHER_NONE or ES_DITHER_ORDERED
+//
+static void ReferencePixel ( const Format *format, const unsigned char *src, int srcBytes, int x, int y,
+                             int dither, unsigned char *dst )
+{
+   int threshold = dither == ES_DITHER_ORDERED ? ( bayer[y & 3][x & 3] * 2 + 1 ) * 255 / 32 : 127;
+   int a = srcBytes == 4 ? src[3] : 255;
+   unsigned short packed = 0;
+   int c;
+
+   if ( format->max[0] == 0 )
+   {
+      dst[0] = (unsigned char) ( ( 77 * src[0] + 150 * src[1] + 29 * src[2] + 128 ) / 256 );
+      if ( format->bytes == 2 )
+         dst[1] = (unsigned char) a;
+      return;
+   }
+
+   for ( c = 0; c < 4; c++ )
+   {
+      int v = c < 3 ? src[c] : a;
+
+      packed |= ( ( v * format->max[c] + ( c < 3 ? threshold : 127 ) ) / 255 ) << format->shift[c];
+   }
+   memcpy ( dst, &packed, 2 );
+}
+
+///
+// Expand a converted pixel to the RGBA GL reads back
+//
+static void Expand ( const Format *format, const unsigned char *pixel, unsigned char rgba[4] )
+{
+   unsigned short packed;
+   int c;
+
+   if ( format->max[0] == 0 )
+   {
+      rgba[0] = rgba[1] = rgba[2] = pixel[0];
+      rgba[3] = format->bytes == 2 ? pixel[1] : 255;
+      return;
+   }
+
+   memcpy ( &packed, pixel, 2 );
+   for ( c = 0; c < 4; c++ )
+   {
+      int max = format->max[c];
+
+      rgba[c] = max == 0 ? 255 : (unsigned char) ( ( ( packed >> format->shift[c] & max ) * 255 + max / 2 ) / max );
+   }
+}
+
+///
+// Channel sweep: every run of 256 pixels holds each value of every channel, so all the
+// rounding boundaries of the 4, 5 and 6-bit formats are crossed.  Each channel steps
+// with its own odd stride and the strides shift every 256 pixels, so that neighbouring
+// pixels, SIMD lanes and rows see different combinations of channel values.
+//
+static unsigned char *MakeImage ( int width, int height, int bytes, unsigned int offset )
+{
+   static const unsigned int strides[4] = { 1, 7, 45, 101 };
+   size_t count = (size_t) width * height, i;
+   unsigned char *pixels = malloc ( count * bytes );
+   int c;
+
+   for ( i = 0; i < count; i++ )
+   {
+      size_t p = i + offset;
+
+      for ( c = 0; c < bytes; c++ )
+         pixels[i * bytes + c] = (unsigned char) ( p * strides[c] + ( p >> 8 ) * ( 2 * c + 1 ) * 29 );
+   }
+   return pixels;
+}
+
+///
+// Compare esConvertPixels with the reference for one source format and size
+//
+static GLboolean Check ( const Format *format, int srcBytes, int width, int height, int dither )
+{
+   unsigned char *pixels = MakeImage ( width, height, srcBytes, width * 31 + height );
+   unsigned char *converted = malloc ( (size_t) width * height * format->bytes );
+   unsigned char expected[2];
+   GLboolean passed = GL_TRUE;
+   int x, y;
+
+   if ( !esConvertPixels ( pixels, width, height, srcBytes == 4 ? GL_RGBA : GL_RGB, format->format, dither,
+                           converted, NULL, NULL ) )
+      passed = GL_FALSE;
+
+   for ( y = 0; y < height && passed; y++ )
+   {
+      for ( x = 0; x < width && passed; x++ )
+      {
+         size_t i = (size_t) y * width + x;
+
+         ReferencePixel ( format, pixels + i * srcBytes, srcBytes, x, y, dither, expected );
+         if ( memcmp ( converted + i * format->bytes, expected, format->bytes ) != 0 )
+         {
+            printf ( "%s from %s %dx%d, dither %s: pixel %d,%d differs from the reference\n", format->name,
+                     srcBytes == 4 ? "RGBA" : "RGB", width, height, ditherNames[dither], x, y );
+            passed = GL_FALSE;
+         }
+      }
+   }
+
+   free ( pixels );
+   free ( converted );
+   return passed;
+}
+
+///
+// Largest difference between the averages of blocks of a gradient and of its RGB565 conversion
+//
+static double BlockError ( int dither )
+{
+   int width = 32 * BLOCK_SIZE, height = 8 * BLOCK_SIZE, x, y, bx, by, c;
+   unsigned char *pixels = malloc ( width * height * 3 );
+   unsigned short *converted = malloc ( width * height * 2 );
+   double worst = 0.0;
+
+   // Red rises slowly along x, green along y and blue is constant between two levels
+   for ( y = 0; y < height; y++ )
+   {
+      for ( x = 0; x < width; x++ )
+      {
+         pixels[( y * width + x ) * 3 + 0] = (unsigned char) ( 64 + x / 8 );
+         pixels[( y * width + x ) * 3 + 1] = (unsigned char) ( 100 + y / 4 );
+         pixels[( y * width + x ) * 3 + 2] = 133;
+      }
+   }
+   esConvertPixels ( pixels, width, height, GL_RGB, GL_RGB565, dither, converted, NULL, NULL );
+
+   for ( by = 0; by < height; by += BLOCK_SIZE )
+   {
+      for ( bx = 0; bx < width; bx += BLOCK_SIZE )
+      {
+         for ( c = 0; c < 3; c++ )
+         {
+            double source = 0.0, result = 0.0, error;
+
+            for ( y = by; y < by + BLOCK_SIZE; y++ )
+            {
+               for ( x = bx; x < bx + BLOCK_SIZE; x++ )
+               {
+                  unsigned char rgba[4];
+
+                  Expand ( &formats[0], (unsigned char *) &converted[y * width + x], rgba );
+                  source += pixels[( y * width + x ) * 3 + c];
+                  result += rgba[c];
+               }
+            }
+            error = ( result - source ) / ( BLOCK_SIZE * BLOCK_SIZE );
+            error = error < 0.0 ? -error : error;
+            worst = error > worst ? error : worst;
+         }
+      }
+   }
+
+   free ( pixels );
+   free ( converted );
+   return worst;
+}
+
+///
+// Load an image with esTexImage2DConverted, draw it and compare what GL reads back
+//
+static GLboolean CheckUpload ( const Format *format, GLuint programObject, const unsigned char *pixels,
+                               unsigned char *readback )
+{
+   static const GLfloat vertices[] = { -1.0f, -1.0f, 0.0f, 0.0f,   1.0f, -1.0f, 1.0f, 0.0f,
+                                       -1.0f,  1.0f, 0.0f, 1.0f,   1.0f,  1.0f, 1.0f, 1.0f };
+   unsigned char *converted = malloc ( CHECK_WIDTH * CHECK_HEIGHT * format->bytes );
+   GLboolean passed = GL_TRUE;
+   GLuint texture;
+   GLint alignment;
+   int i, c;
+
+   glGenTextures ( 1, &texture );
+   glBindTexture ( GL_TEXTURE_2D, texture );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, 4 );
+   if ( !esTexImage2DConverted ( GL_TEXTURE_2D, 0, CHECK_WIDTH, CHECK_HEIGHT, GL_RGBA, pixels, format->format,
+                                 ES_DITHER_ORDERED ) )
+      passed = GL_FALSE;
+   glGetIntegerv ( GL_UNPACK_ALIGNMENT, &alignment );
+   if ( alignment != 4 )
+   {
+      printf ( "%s: unpack alignment %d was not restored\n", format->name, alignment );
+      passed = GL_FALSE;
+   }
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+
+   glUseProgram ( programObject );
+   glVertexAttribPointer ( 0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof ( GLfloat ), vertices );
+   glVertexAttribPointer ( 1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof ( GLfloat ), vertices + 2 );
+   glEnableVertexAttribArray ( 0 );
+   glEnableVertexAttribArray ( 1 );
+   glDrawArrays ( GL_TRIANGLE_STRIP, 0, 4 );
+   glReadPixels ( 0, 0, CHECK_WIDTH, CHECK_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, readback );
+   glDeleteTextures ( 1, &texture );
+
+   esConvertPixels ( pixels, CHECK_WIDTH, CHECK_HEIGHT, GL_RGBA, format->format, ES_DITHER_ORDERED, converted,
+                     NULL, NULL );
+   for ( i = 0; i < CHECK_WIDTH * CHECK_HEIGHT && passed; i++ )
+   {
+      unsigned char expected[4];
+
+      Expand ( format, converted + i * format->bytes, expected );
+      for ( c = 0; c < 4; c++ )
+      {
+         if ( abs ( readback[i * 4 + c] - expected[c] ) > 1 )
+         {
+            printf ( "%s: texel %d,%d reads back as %d instead of %d\n", format->name, i % CHECK_WIDTH,
+                     i / CHECK_WIDTH, readback[i * 4 + c], expected[c] );
+            passed = GL_FALSE;
+            break;
+         }
+      }
+   }
+
+   free ( converted );
+   return passed;
+}
+
+int main ( int argc, char *argv[] )
+{
+   int size = argc > 1 ? atoi ( argv[1] ) : 1024;
+   int iterations = argc > 2 ? atoi ( argv[2] ) : 5;
+   ESContext esContext;
+   GLbyte vShaderStr[] =
+      "attribute vec2 a_position;                             \n"
+      "attribute vec2 a_texCoord;                             \n"
+      "varying vec2 v_texCoord;                               \n"
+      "void main()                                            \n"
+      "{                                                      \n"
+      "   gl_Position = vec4 ( a_position, 0.0, 1.0 );        \n"
+      "   v_texCoord = a_texCoord;                            \n"
+      "}                                                      \n";
+   GLbyte fShaderStr[] =
+      "precision mediump float;                               \n"
+      "varying vec2 v_texCoord;                               \n"
+      "uniform sampler2D s_texture;                           \n"
+      "void main()                                            \n"
+      "{                                                      \n"
+      "  gl_FragColor = texture2D( s_texture, v_texCoord );   \n"
+      "}                                                      \n";
+   GLboolean passed = GL_TRUE;
+   double blockError[3];
+   unsigned char *pixels, *readback;
+   GLuint programObject, framebuffer, target;
+   unsigned int f, w;
+   int srcBytes, dither, i;
+
+   if ( size < 1 || size > 8192 || iterations < 1 )
+   {
+      printf ( "Usage: %s [size] [iterations]\n", argv[0] );
+      return 1;
+   }
+
+   for ( f = 0; f < sizeof ( formats ) / sizeof ( formats[0] ); f++ )
+      for ( srcBytes = 3; srcBytes <= 4; srcBytes++ )
+         for ( dither = ES_DITHER_NONE; dither <= ES_DITHER_ORDERED; dither++ )
+            for ( w = 0; w < sizeof ( widths ) / sizeof ( widths[0] ); w++ )
+               passed &= Check ( &formats[f], srcBytes, widths[w], 1 + widths[w] % 13, dither );
+
+   printf ( "RGB565 gradient, largest error of %dx%d block averages\n", BLOCK_SIZE, BLOCK_SIZE );
+   for ( dither = ES_DITHER_NONE; dither <= ES_DITHER_FLOYD_STEINBERG; dither++ )
+   {
+      blockError[dither] = BlockError ( dither );
+      printf ( "%-20s %8.3f\n", ditherNames[dither], blockError[dither] );
+   }
+   if ( blockError[ES_DITHER_ORDERED] >= blockError[ES_DITHER_NONE] ||
+        blockError[ES_DITHER_FLOYD_STEINBERG] >= blockError[ES_DITHER_NONE] )
+   {
+      printf ( "dithering does not keep the block averages\n" );
+      passed = GL_FALSE;
+   }
+
+   esInitContext ( &esContext );
+   if ( !esCreateWindow ( &esContext, "Pixel Format Benchmark", 320, 240, ES_WINDOW_RGB ) )
+   {
+      esLogMessage ( "Unable to create the rendering context\n" );
+      return 1;
+   }
+
+   programObject = esLoadProgram ( (char *) vShaderStr, (char *) fShaderStr );
+   if ( programObject == 0 )
+      return 1;
+   glBindAttribLocation ( programObject, 0, "a_position" );
+   glBindAttribLocation ( programObject, 1, "a_texCoord" );
+   glLinkProgram ( programObject );
+
+   glGenTextures ( 1, &target );
+   glBindTexture ( GL_TEXTURE_2D, target );
+   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGBA, CHECK_WIDTH, CHECK_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glGenFramebuffers ( 1, &framebuffer );
+   glBindFramebuffer ( GL_FRAMEBUFFER, framebuffer );
+   glFramebufferTexture2D ( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0 );
+   if ( glCheckFramebufferStatus ( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+      return 1;
+   glViewport ( 0, 0, CHECK_WIDTH, CHECK_HEIGHT );
+
+   pixels = MakeImage ( CHECK_WIDTH, CHECK_HEIGHT, 4, 7 );
+   readback = malloc ( CHECK_WIDTH * CHECK_HEIGHT * 4 );
+   for ( f = 0; f < sizeof ( formats ) / sizeof ( formats[0] ); f++ )
+      passed &= CheckUpload ( &formats[f], programObject, pixels, readback );
+   free ( pixels );
+   free ( readback );
+
+   glDeleteFramebuffers ( 1, &framebuffer );
+   glDeleteTextures ( 1, &target );
+   glDeleteProgram ( programObject );
+   esStateInvalidate ( );
+
+   printf ( "%dx%d images, best of %d, ms\n", size, size, iterations );
+   printf ( "%-20s %-6s %10s %10s %10s %10s\n", "", "source", "reference", "none", "ordered", "F-S" );
+   for ( f = 0; f < sizeof ( formats ) / sizeof ( formats[0] ); f++ )
+   {
+      const Format *format = &formats[f];
+      unsigned char *converted = malloc ( (size_t) size * size * format->bytes );
+
+      for ( srcBytes = 3; srcBytes <= 4; srcBytes++ )
+      {
+         double best[4] = { 1e9, 1e9, 1e9, 1e9 }, t;
+
+         pixels = MakeImage ( size, size, srcBytes, 1 );
+         for ( i = 0; i < iterations; i++ )
+         {
+            size_t p, count = (size_t) size * size;
+
+            t = esGetTime ( );
+            for ( p = 0; p < count; p++ )
+               ReferencePixel ( format, pixels + p * srcBytes, srcBytes, (int) ( p % size ), (int) ( p / size ),
+                                ES_DITHER_NONE, converted + p * format->bytes );
+            t = esGetTime ( ) - t;
+            best[0] = t < best[0] ? t : best[0];
+
+            for ( dither = ES_DITHER_NONE; dither <= ES_DITHER_FLOYD_STEINBERG; dither++ )
+            {
+               t = esGetTime ( );
+               passed &= esConvertPixels ( pixels, size, size, srcBytes == 4 ? GL_RGBA : GL_RGB, format->format,
+                                           dither, converted, NULL, NULL );
+               t = esGetTime ( ) - t;
+               best[dither + 1] = t < best[dither + 1] ? t : best[dither + 1];
+            }
+         }
+
+         printf ( "%-20s %-6s %10.2f %10.2f %10.2f %10.2f\n", format->name, srcBytes == 4 ? "RGBA" : "RGB",
+                  best[0] * 1000.0, best[1] * 1000.0, best[2] * 1000.0, best[3] * 1000.0 );
+         free ( pixels );
+      }
+      free ( converted );
+   }
+
+   printf ( "%s\n", passed ? "all conversions match the reference and load into GL" : "FAILED" );
+   return passed ? 0 : 1;
+}
@@ -0,0 +1,419 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// PostProcess.c
+//
+//    Benchmark for the render target pool.  Every frame renders a scene
+//    into an offscreen color and depth target and runs a bloom chain over
+//    it: a bright pass and separable blurs at half resolution, a downsample
+//    and more blurs at quarter resolution, and a composite of all three into
+//    the window.  The chain is run once with every pass holding its targets
+//    until the end of the frame, as if each pass allocated its own, and once
+//    releasing each target after the last pass that reads it, so the pool
+//    can hand it to a later pass.
+//
+//    Usage: BM_PostProcess [width height] [framesPerRun] [blurIterations]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include "esUtil.h"
+
+#define MAX_FRAME_TARGETS  64
+
+typedef struct
+{
+   // Program objects
+   GLuint sceneProgram;
+   GLuint brightProgram;
+   GLuint blurProgram;
+   GLuint compositeProgram;
+
+   // Uniform locations
+   GLint  mvpLoc;
+   GLint  brightSamplerLoc;
+   GLint  blurSamplerLoc;
+   GLint  blurOffsetLoc;
+   GLint  sceneSamplerLoc;
+   GLint  halfSamplerLoc;
+   GLint  quarterSamplerLoc;
+
+   // Cube and full screen quad
+   GLuint cubeBuffers[3];
+   int    numIndices;
+   GLuint quadBuffer;
+
+   // Size of the offscreen scene
+   int    width;
+   int    height;
+   int    blurIterations;
+
+   // Targets acquired this frame, only used when passes hold their targets
+   ESRenderTarget *frameTargets[MAX_FRAME_TARGETS];
+   int    numFrameTargets;
+   int    holdTargets;
+
+} UserData;
+
+///
+// Acquire a target, remembering it when passes hold their targets until the end of the frame
+//
+static ESRenderTarget *Acquire ( UserData *userData, ESRenderTargetPool *pool, int width, int height, GLenum format )
+{
+   ESRenderTarget *target = esRenderTargetAcquire ( pool, width, height, format );
+
+   if ( userData->holdTargets && target != NULL && userData->numFrameTargets < MAX_FRAME_TARGETS )
+      userData->frameTargets[userData->numFrameTargets++] = target;
+   return target;
+}
+
+///
+// Release a target after its last use, unless passes hold their targets
+//
+static void Release ( UserData *userData, ESRenderTargetPool *pool, ESRenderTarget *target )
+{
+   if ( !userData->holdTargets )
+      esRenderTargetRelease ( pool, target );
+}
+
+///
+// Draw the full screen quad with the current program
+//
+static void DrawQuad ( UserData *userData )
+{
+   glBindBuffer ( GL_ARRAY_BUFFER, userData->quadBuffer );
+   glVertexAttribPointer ( 0, 2, GL_FLOAT, GL_FALSE, 0, 0 );
+   glEnableVertexAttribArray ( 0 );
+   glDrawArrays ( GL_TRIANGLE_STRIP, 0, 4 );
+}
+
+///
+// Draw source into target with the blur program, offset is one texel along the blur direction
+//
+static void Blur ( UserData *userData, ESRenderTargetPool *pool, ESRenderTarget *source, ESRenderTarget *target,
+                   float dx, float dy )
+{
+   esRenderTargetBind ( pool, target, NULL );
+   glUseProgram ( userData->blurProgram );
+   glActiveTexture ( GL_TEXTURE0 );
+   glBindTexture ( GL_TEXTURE_2D, source->texture );
+   glUniform1i ( userData->blurSamplerLoc, 0 );
+   glUniform2f ( userData->blurOffsetLoc, dx / source->width, dy / source->height );
+   DrawQuad ( userData );
+}
+
+///
+// Blur source iterations times, releasing it.  Returns the blurred target.
+//
+static ESRenderTarget *BlurChain ( UserData *userData, ESRenderTargetPool *pool, ESRenderTarget *source )
+{
+   int i;
+
+   for ( i = 0; i < userData->blurIterations; i++ )
+   {
+      ESRenderTarget *temp = Acquire ( userData, pool, source->width, source->height, GL_RGBA );
+
+      Blur ( userData, pool, source, temp, 1.0f, 0.0f );
+      Release ( userData, pool, source );
+
+      source = Acquire ( userData, pool, temp->width, temp->height, GL_RGBA );
+      Blur ( userData, pool, temp, source, 0.0f, 1.0f );
+      Release ( userData, pool, temp );
+   }
+   return source;
+}
+
+///
+// Render one frame of the effect
+//
+static void DrawFrame ( ESContext *esContext, ESRenderTargetPool *pool, float time )
+{
+   UserData *userData = esContext->userData;
+   int halfWidth = userData->width / 2, halfHeight = userData->height / 2;
+   ESRenderTarget *scene, *depth, *half, *quarter;
+   ESMatrix perspective, modelview, mvpMatrix;
+   GLint framebuffer;
+   int i;
+
+   // The window may itself be a framebuffer object, as it is when running headless
+   glGetIntegerv ( GL_FRAMEBUFFER_BINDING, &framebuffer );
+   userData->numFrameTargets = 0;
+
+   // Scene
+   scene = Acquire ( userData, pool, userData->width, userData->height, GL_RGBA );
+   depth = Acquire ( userData, pool, userData->width, userData->height, GL_DEPTH_COMPONENT16 );
+   esRenderTargetBind ( pool, scene, depth );
+   glClear ( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+   glEnable ( GL_DEPTH_TEST );
+
+   esMatrixLoadIdentity ( &perspective );
+   esPerspective ( &perspective, 60.0f, (GLfloat) userData->width / userData->height, 1.0f, 20.0f );
+   esMatrixLoadIdentity ( &modelview );
+   esTranslate ( &modelview, 0.0f, 0.0f, -3.0f );
+   esRotate ( &modelview, time * 40.0f, 1.0f, 0.0f, 1.0f );
+   esMatrixMultiply ( &mvpMatrix, &modelview, &perspective );
+
+   glUseProgram ( userData->sceneProgram );
+   glUniformMatrix4fv ( userData->mvpLoc, 1, GL_FALSE, (GLfloat *) &mvpMatrix.m[0][0] );
+   glBindBuffer ( GL_ARRAY_BUFFER, userData->cubeBuffers[0] );
+   glVertexAttribPointer ( 0, 3, GL_FLOAT, GL_FALSE, 0, 0 );
+   glEnableVertexAttribArray ( 0 );
+   glBindBuffer ( GL_ARRAY_BUFFER, userData->cubeBuffers[1] );
+   glVertexAttribPointer ( 1, 3, GL_FLOAT, GL_FALSE, 0, 0 );
+   glEnableVertexAttribArray ( 1 );
+   glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, userData->cubeBuffers[2] );
+   glDrawElements ( GL_TRIANGLES, userData->numIndices, GL_UNSIGNED_INT, 0 );
+   glDisableVertexAttribArray ( 1 );
+   glDisable ( GL_DEPTH_TEST );
+   Release ( userData, pool, depth );
+
+   // Bright pass and blur at half resolution
+   half = Acquire ( userData, pool, halfWidth, halfHeight, GL_RGBA );
+   esRenderTargetBind ( pool, half, NULL );
+   glUseProgram ( userData->brightProgram );
+   glActiveTexture ( GL_TEXTURE0 );
+   glBindTexture ( GL_TEXTURE_2D, scene->texture );
+   glUniform1i ( userData->brightSamplerLoc, 0 );
+   DrawQuad ( userData );
+   half = BlurChain ( userData, pool, half );
+
+   // Downsample and blur at quarter resolution
+   quarter = Acquire ( userData, pool, halfWidth / 2, halfHeight / 2, GL_RGBA );
+   Blur ( userData, pool, half, quarter, 0.0f, 0.0f );
+   quarter = BlurChain ( userData, pool, quarter );
+
+   // Composite into the window
+   glBindFramebuffer ( GL_FRAMEBUFFER, framebuffer );
+   esStateViewport ( 0, 0, esContext->width, esContext->height );
+   glUseProgram ( userData->compositeProgram );
+   glActiveTexture ( GL_TEXTURE0 );
+   glBindTexture ( GL_TEXTURE_2D, scene->texture );
+   glActiveTexture ( GL_TEXTURE1 );
+   glBindTexture ( GL_TEXTURE_2D, half->texture );
+   glActiveTexture ( GL_TEXTURE2 );
+   glBindTexture ( GL_TEXTURE_2D, quarter->texture );
+   glUniform1i ( userData->sceneSamplerLoc, 0 );
+   glUniform1i ( userData->halfSamplerLoc, 1 );
+   glUniform1i ( userData->quarterSamplerLoc, 2 );
+   DrawQuad ( userData );
+   glActiveTexture ( GL_TEXTURE0 );
+
+   Release ( userData, pool, scene );
+   Release ( userData, pool, half );
+   Release ( userData, pool, quarter );
+
+   for ( i = 0; i < userData->numFrameTargets; i++ )
+      esRenderTargetRelease ( pool, userData->frameTargets[i] );
+
+   esRenderTargetPoolEndFrame ( pool );
+}
+
+///
+// Initialize the programs and the geometry
+//
+int Init ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   GLbyte vSceneStr[] =
+      "uniform mat4 u_mvpMatrix;                   \n"
+      "attribute vec4 a_position;                  \n"
+      "attribute vec3 a_normal;                    \n"
+      "varying vec3 v_color;                       \n"
+      "void main()                                 \n"
+      "{                                           \n"
+      "   gl_Position = u_mvpMatrix * a_position;  \n"
+      "   v_color = abs ( a_normal ) * 1.5;        \n"
+      "}                                           \n";
+
+   GLbyte fSceneStr[] =
+      "precision mediump float;                    \n"
+      "varying vec3 v_color;                       \n"
+      "void main()                                 \n"
+      "{                                           \n"
+      "  gl_FragColor = vec4 ( v_color, 1.0 );     \n"
+      "}                                           \n";
+
+   GLbyte vQuadStr[] =
+      "attribute vec4 a_position;                  \n"
+      "varying vec2 v_texCoord;                    \n"
+      "void main()                                 \n"
+      "{                                           \n"
+      "   gl_Position = a_position;                \n"
+      "   v_texCoord = a_position.xy * 0.5 + 0.5;  \n"
+      "}                                           \n";
+
+   GLbyte fBrightStr[] =
+      "precision mediump float;                                   \n"
+      "varying vec2 v_texCoord;                                   \n"
+      "uniform sampler2D s_texture;                               \n"
+      "void main()                                                \n"
+      "{                                                          \n"
+      "  vec4 color = texture2D ( s_texture, v_texCoord );        \n"
+      "  gl_FragColor = max ( color - 0.6, 0.0 ) * 2.5;           \n"
+      "}                                                          \n";
+
+   GLbyte fBlurStr[] =
+      "precision mediump float;                                             \n"
+      "varying vec2 v_texCoord;                                             \n"
+      "uniform sampler2D s_texture;                                         \n"
+      "uniform vec2 u_offset;                                               \n"
+      "void main()                                                          \n"
+      "{                                                                    \n"
+      "  gl_FragColor = texture2D ( s_texture, v_texCoord ) * 0.375         \n"
+      "     + texture2D ( s_texture, v_texCoord - u_offset ) * 0.25         \n"
+      "     + texture2D ( s_texture, v_texCoord + u_offset ) * 0.25         \n"
+      "     + texture2D ( s_texture, v_texCoord - 2.0 * u_offset ) * 0.0625 \n"
+      "     + texture2D ( s_texture, v_texCoord + 2.0 * u_offset ) * 0.0625;\n"
+      "}                                                                    \n";
+
+   GLbyte fCompositeStr[] =
+      "precision mediump float;                                   \n"
+      "varying vec2 v_texCoord;                                   \n"
+      "uniform sampler2D s_scene;                                 \n"
+      "uniform sampler2D s_half;                                  \n"
+      "uniform sampler2D s_quarter;                               \n"
+      "void main()                                                \n"
+      "{                                                          \n"
+      "  gl_FragColor = texture2D ( s_scene, v_texCoord )         \n"
+      "     + texture2D ( s_half, v_texCoord ) * 0.6              \n"
+      "     + texture2D ( s_quarter, v_texCoord ) * 0.4;          \n"
+      "}                                                          \n";
+
+   GLfloat quad[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+   GLfloat *vertices, *normals;
+   GLuint *indices;
+
+   userData->sceneProgram = esLoadProgram ( (char *) vSceneStr, (char *) fSceneStr );
+   userData->brightProgram = esLoadProgram ( (char *) vQuadStr, (char *) fBrightStr );
+   userData->blurProgram = esLoadProgram ( (char *) vQuadStr, (char *) fBlurStr );
+   userData->compositeProgram = esLoadProgram ( (char *) vQuadStr, (char *) fCompositeStr );
+   if ( userData->sceneProgram == 0 || userData->brightProgram == 0 ||
+        userData->blurProgram == 0 || userData->compositeProgram == 0 )
+      return FALSE;
+
+   // Every program reads the position from attribute 0, esLoadProgram has already linked
+   // them so the scene program is relinked with its normal at 1
+   glBindAttribLocation ( userData->sceneProgram, 0, "a_position" );
+   glBindAttribLocation ( userData->sceneProgram, 1, "a_normal" );
+   glLinkProgram ( userData->sceneProgram );
+   glBindAttribLocation ( userData->brightProgram, 0, "a_position" );
+   glLinkProgram ( userData->brightProgram );
+   glBindAttribLocation ( userData->blurProgram, 0, "a_position" );
+   glLinkProgram ( userData->blurProgram );
+   glBindAttribLocation ( userData->compositeProgram, 0, "a_position" );
+   glLinkProgram ( userData->compositeProgram );
+
+   userData->mvpLoc = glGetUniformLocation ( userData->sceneProgram, "u_mvpMatrix" );
+   userData->brightSamplerLoc = glGetUniformLocation ( userData->brightProgram, "s_texture" );
+   userData->blurSamplerLoc = glGetUniformLocation ( userData->blurProgram, "s_texture" );
+   userData->blurOffsetLoc = glGetUniformLocation ( userData->blurProgram, "u_offset" );
+   userData->sceneSamplerLoc = glGetUniformLocation ( userData->compositeProgram, "s_scene" );
+   userData->halfSamplerLoc = glGetUniformLocation ( userData->compositeProgram, "s_half" );
+   userData->quarterSamplerLoc = glGetUniformLocation ( userData->compositeProgram, "s_quarter" );
+
+   userData->numIndices = esGenCube ( 1.0f, &vertices, &normals, NULL, &indices );
+   glGenBuffers ( 3, userData->cubeBuffers );
+   glBindBuffer ( GL_ARRAY_BUFFER, userData->cubeBuffers[0] );
+   glBufferData ( GL_ARRAY_BUFFER, 24 * 3 * sizeof ( GLfloat ), vertices, GL_STATIC_DRAW );
+   glBindBuffer ( GL_ARRAY_BUFFER, userData->cubeBuffers[1] );
+   glBufferData ( GL_ARRAY_BUFFER, 24 * 3 * sizeof ( GLfloat ), normals, GL_STATIC_DRAW );
+   glBindBuffer ( GL_ELEMENT_ARRAY_BUFFER, userData->cubeBuffers[2] );
+   glBufferData ( GL_ELEMENT_ARRAY_BUFFER, userData->numIndices * sizeof ( GLuint ), indices, GL_STATIC_DRAW );
+   free ( vertices );
+   free ( normals );
+   free ( indices );
+
+   glGenBuffers ( 1, &userData->quadBuffer );
+   glBindBuffer ( GL_ARRAY_BUFFER, userData->quadBuffer );
+   glBufferData ( GL_ARRAY_BUFFER, sizeof ( quad ), quad, GL_STATIC_DRAW );
+
+   glClearColor ( 0.0f, 0.0f, 0.0f, 0.0f );
+   return TRUE;
+}
+
+///
+// Run the chain numFrames times with a new pool and print the memory it used
+//
+static void RunBenchmark ( ESContext *esContext, int holdTargets, int numFrames )
+{
+   UserData *userData = esContext->userData;
+   ESRenderTargetPool *pool = esRenderTargetPoolCreate ( );
+   ESRenderTargetPoolStats poolStats;
+   double start = esGetTime ( );
+   int frame;
+
+   userData->holdTargets = holdTargets;
+
+   for ( frame = 0; frame < numFrames; frame++ )
+   {
+      DrawFrame ( esContext, pool, frame / 60.0f );
+      eglSwapBuffers ( esContext->eglDisplay, esContext->eglSurface );
+   }
+   glFinish ( );
+
+   esGetRenderTargetPoolStats ( pool, &poolStats );
+   printf ( "%-9s %8u %8u %12.2f %12.2f %10.3f\n",
+            holdTargets ? "per-pass" : "pooled", poolStats.frameAcquires, poolStats.numTargets,
+            poolStats.frameAcquiredBytes / ( 1024.0 * 1024.0 ), poolStats.peakBytes / ( 1024.0 * 1024.0 ),
+            ( esGetTime ( ) - start ) * 1000.0 / numFrames );
+
+   esRenderTargetPoolDestroy ( pool );
+}
+
+int main ( int argc, char *argv[] )
+{
+   ESContext esContext;
+   UserData  userData;
+   int       numFrames = 100;
+
+   esInitContext ( &esContext );
+   esContext.userData = &userData;
+
+   userData.width = 1280;
+   userData.height = 720;
+   userData.blurIterations = 2;
+   if ( argc > 2 )
+   {
+      userData.width = atoi ( argv[1] );
+      userData.height = atoi ( argv[2] );
+   }
+   if ( argc > 3 )
+      numFrames = atoi ( argv[3] );
+   if ( argc > 4 )
+      userData.blurIterations = atoi ( argv[4] );
+   if ( userData.width < 4 || userData.height < 4 || numFrames < 1 )
+   {
+      esLogMessage ( "Usage: %s [width height] [framesPerRun] [blurIterations]\n", argv[0] );
+      return 1;
+   }
+
+   if ( !esCreateWindow ( &esContext, "Post Process Benchmark", 320, 240, ES_WINDOW_RGB ) )
+   {
+      esLogMessage ( "Unable to create the rendering context\n" );
+      return 1;
+   }
+
+   if ( !Init ( &esContext ) )
+      return 1;
+
+   printf ( "%dx%d, %d blur iterations, %d frames per run\n",
+            userData.width, userData.height, userData.blurIterations, numFrames );
+   printf ( "%-9s %8s %8s %12s %12s %10s\n", "mode", "acquires", "targets", "acquired MB", "peak MB", "ms/frame" );
+
+   RunBenchmark ( &esContext, 1, numFrames );
+   RunBenchmark ( &esContext, 0, numFrames );
+
+   glDeleteBuffers ( 3, userData.cubeBuffers );
+   glDeleteBuffers ( 1, &userData.quadBuffer );
+   glDeleteProgram ( userData.sceneProgram );
+   glDeleteProgram ( userData.brightProgram );
+   glDeleteProgram ( userData.blurProgram );
+   glDeleteProgram ( userData.compositeProgram );
+   return 0;
+}
@@ -0,0 +1,405 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// Runner.c
+//
+//    Runs the chapter samples one after another under identical conditions
+//    and collects their frame time statistics into one JSON report.  Each
+//    sample is started headless in its own directory with ES_FRAMES,
+//    ES_FIXED_DELTA and ES_RESOLUTION set, and writes its statistics through
+//    ES_STATS_FILE when its main loop returns.  The frame statistics cover
+//    the last 512 frames of a run (ES_FRAME_HISTORY), so the default frame
+//    count leaves the first frames, which compile shaders and warm caches,
+//    out of the report.
+//
+//    The compare mode runs Welch's t-test on the mean frame time of every
+//    sample in two reports and reports the significant changes.  Frame times
+//    within a run are not independent, so treat the p-values as a filter for
+//    noise rather than an exact probability.
+//
+//    Usage: run from the LinuxX11 directory
+//       BM_Runner [-f frames] [-d deltaTime] [-r WxH] [-o report.json] [sample ...]
+//       BM_Runner compare base.json new.json [-a alpha] [-t threshold%]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define MAX_SAMPLES  64
+
+typedef struct
+{
+   char     name[64];
+   unsigned int numFrames;
+   unsigned int stutters;
+   float    avg, stddev, p50, p95, p99, max;
+} SampleStats;
+
+static const char *defaultSamples[] =
+{
+   "Chapter_2/Hello_Triangle/CH02_HelloTriangle",
+   "Chapter_8/Simple_VertexShader/CH08_SimpleVertexShader",
+   "Chapter_9/Simple_Texture2D/CH09_SimpleTexture2D",
+   "Chapter_9/MipMap2D/CH09_MipMap2D",
+   "Chapter_9/Simple_TextureCubemap/CH09_TextureCubemap",
+   "Chapter_9/TextureWrap/CH09_TextureWrap",
+   "Chapter_10/MultiTexture/CH10_MultiTexture",
+   "Chapter_11/Multisample/CH11_Multisample",
+   "Chapter_11/Stencil_Test/CH11_Stencil_Test",
+   "Chapter_13/ParticleSystem/CH13_ParticleSystem",
+};
+
+///
+// Run one sample and read back the statistics it wrote
+//
+static int RunSample ( const char *path, int numFrames, const char *deltaTime, const char *resolution,
+                       SampleStats *stats )
+{
+   char statsFile[] = "/tmp/bm_runner_XXXXXX";
+   char frames[16];
+   char dir[512];
+   char buffer[4096];
+   const char *slash = strrchr ( path, '/' );
+   const char *frame, *counts;
+   size_t len;
+   FILE *file;
+   int status;
+   int fd;
+   pid_t pid;
+
+   fd = mkstemp ( statsFile );
+   if ( fd < 0 )
+      return 0;
+   close ( fd );
+
+   snprintf ( frames, sizeof ( frames ), "%d", numFrames );
+   snprintf ( dir, sizeof ( dir ), "%.*s", slash ? (int) ( slash - path ) : 1, slash ? path : "." );
+   snprintf ( stats->name, sizeof ( stats->name ), "%s", slash ? slash + 1 : path );
+
+   pid = fork ( );
+   if ( pid == 0 )
+   {
+      // Samples load their textures relative to their own directory
+      if ( chdir ( dir ) != 0 )
+         _exit ( 127 );
+
+      fd = open ( "/dev/null", O_WRONLY );
+      if ( fd >= 0 )
+         dup2 ( fd, STDOUT_FILENO );
+
+      setenv ( "ES_HEADLESS", "1", 1 );
+      setenv ( "ES_FRAMES", frames, 1 );
+      setenv ( "ES_FIXED_DELTA", deltaTime, 1 );
+      setenv ( "ES_RESOLUTION", resolution, 1 );
+      setenv ( "ES_STATS_FILE", statsFile, 1 );
+      execl ( slash ? slash + 1 : path, stats->name, (char *) NULL );
+      _exit ( 127 );
+   }
+
+   if ( pid < 0 || waitpid ( pid, &status, 0 ) < 0 || !WIFEXITED ( status ) || WEXITSTATUS ( status ) != 0 )
+   {
+      fprintf ( stderr, "%s: did not run to completion\n", path );
+      unlink ( statsFile );
+      return 0;
+   }
+
+   file = fopen ( statsFile, "r" );
+   len = file ? fread ( buffer, 1, sizeof ( buffer ) - 1, file ) : 0;
+   buffer[len] = '\0';
+   if ( file )
+      fclose ( file );
+   unlink ( statsFile );
+
+   frame = strstr ( buffer, "\"frame\":" );
+   counts = strstr ( buffer, "\"numFrames\":" );
+   if ( frame == NULL || counts == NULL ||
+        sscanf ( counts, "\"numFrames\": %u,\n  \"stutters\": %u",
+                 &stats->numFrames, &stats->stutters ) != 2 ||
+        sscanf ( frame, "\"frame\": {\"avg\":%f,\"stddev\":%f,\"p50\":%f,\"p95\":%f,\"p99\":%f,\"max\":%f}",
+                 &stats->avg, &stats->stddev, &stats->p50, &stats->p95, &stats->p99, &stats->max ) != 6 )
+   {
+      fprintf ( stderr, "%s: no frame statistics written\n", path );
+      return 0;
+   }
+
+   return 1;
+}
+
+///
+// Write the report, one sample per line
+//
+static void WriteReport ( FILE *file, int numFrames, const char *deltaTime, const char *resolution,
+                          const SampleStats *stats, int numStats )
+{
+   int i;
+
+   fprintf ( file, "{\n  \"frames\": %d,\n  \"deltaTime\": %s,\n  \"resolution\": \"%s\",\n  \"samples\": [\n",
+             numFrames, deltaTime, resolution );
+   for ( i = 0; i < numStats; i++ )
+   {
+      fprintf ( file, "    {\"name\":\"%s\",\"numFrames\":%u,\"avg\":%.4f,\"stddev\":%.4f,\"p50\":%.4f,"
+                      "\"p95\":%.4f,\"p99\":%.4f,\"max\":%.4f,\"stutters\":%u}%s\n",
+                stats[i].name, stats[i].numFrames, stats[i].avg, stats[i].stddev, stats[i].p50,
+                stats[i].p95, stats[i].p99, stats[i].max, stats[i].stutters, i + 1 < numStats ? "," : "" );
+   }
+   fprintf ( file, "  ]\n}\n" );
+}
+
+///
+// Read a report written by WriteReport
+//
+static int ReadReport ( const char *fileName, SampleStats *stats )
+{
+   FILE *file = fopen ( fileName, "r" );
+   char line[1024];
+   int numStats = 0;
+
+   if ( file == NULL )
+   {
+      fprintf ( stderr, "Unable to open %s\n", fileName );
+      return -1;
+   }
+
+   while ( numStats < MAX_SAMPLES && fgets ( line, sizeof ( line ), file ) )
+   {
+      SampleStats *s = &stats[numStats];
+
+      if ( sscanf ( line, " {\"name\":\"%63[^\"]\",\"numFrames\":%u,\"avg\":%f,\"stddev\":%f,\"p50\":%f,"
+                          "\"p95\":%f,\"p99\":%f,\"max\":%f,\"stutters\":%u",
+                    s->name, &s->numFrames, &s->avg, &s->stddev, &s->p50, &s->p95, &s->p99, &s->max,
+                    &s->stutters ) == 9 )
+         numStats++;
+   }
+
+   fclose ( file );
+   return numStats;
+}
+
+///
+// Continued fraction for the regularized incomplete beta function
+//
+static double BetaContinuedFraction ( double a, double b, double x )
+{
+   const double tiny = 1e-300;
+   double c = 1.0;
+   double d = 1.0 - ( a + b ) * x / ( a + 1.0 );
+   double h;
+   int m;
+
+   if ( fabs ( d ) < tiny )
+      d = tiny;
+   d = 1.0 / d;
+   h = d;
+
+   for ( m = 1; m <= 300; m++ )
+   {
+      double m2 = 2.0 * m;
+      double aa = m * ( b - m ) * x / ( ( a + m2 - 1.0 ) * ( a + m2 ) );
+      double delta;
+
+      d = 1.0 + aa * d;
+      c = 1.0 + aa / c;
+      if ( fabs ( d ) < tiny )
+         d = tiny;
+      if ( fabs ( c ) < tiny )
+         c = tiny;
+      d = 1.0 / d;
+      h *= d * c;
+
+      aa = -( a + m ) * ( a + b + m ) * x / ( ( a + m2 ) * ( a + m2 + 1.0 ) );
+      d = 1.0 + aa * d;
+      c = 1.0 + aa / c;
+      if ( fabs ( d ) < tiny )
+         d = tiny;
+      if ( fabs ( c ) < tiny )
+         c = tiny;
+      d = 1.0 / d;
+      delta = d * c;
+      h *= delta;
+
+      if ( fabs ( delta - 1.0 ) < 1e-12 )
+         break;
+   }
+   return h;
+}
+
+static double IncompleteBeta ( double a, double b, double x )
+{
+   double front;
+
+   if ( x <= 0.0 )
+      return 0.0;
+   if ( x >= 1.0 )
+      return 1.0;
+
+   front = exp ( lgamma ( a + b ) - lgamma ( a ) - lgamma ( b ) + a * log ( x ) + b * log ( 1.0 - x ) );
+   if ( x < ( a + 1.0 ) / ( a + b + 2.0 ) )
+      return front * BetaContinuedFraction ( a, b, x ) / a;
+   return 1.0 - front * BetaContinuedFraction ( b, a, 1.0 - x ) / b;
+}
+
+///
+// Two-sided p-value of Welch's t-test for a difference of the mean frame times
+//
+static double WelchTest ( const SampleStats *a, const SampleStats *b )
+{
+   double va = (double) a->stddev * a->stddev / a->numFrames;
+   double vb = (double) b->stddev * b->stddev / b->numFrames;
+   double t, df;
+
+   if ( a->numFrames < 2 || b->numFrames < 2 )
+      return 1.0;
+   if ( va + vb == 0.0 )
+      return a->avg == b->avg ? 1.0 : 0.0;
+
+   t = ( b->avg - a->avg ) / sqrt ( va + vb );
+   df = ( va + vb ) * ( va + vb ) /
+        ( va * va / ( a->numFrames - 1 ) + vb * vb / ( b->numFrames - 1 ) );
+
+   return IncompleteBeta ( df / 2.0, 0.5, df / ( df + t * t ) );
+}
+
+///
+// Compare two reports, returns the number of significant regressions
+//
+static int Compare ( int argc, char *argv[] )
+{
+   SampleStats base[MAX_SAMPLES], current[MAX_SAMPLES];
+   double alpha = 0.01;
+   double threshold = 2.0;
+   int numBase, numCurrent;
+   int regressions = 0;
+   int i, j;
+
+   for ( i = 4; i + 1 < argc; i += 2 )
+   {
+      if ( strcmp ( argv[i], "-a" ) == 0 )
+         alpha = atof ( argv[i + 1] );
+      else if ( strcmp ( argv[i], "-t" ) == 0 )
+         threshold = atof ( argv[i + 1] );
+   }
+
+   numBase = ReadReport ( argv[2], base );
+   numCurrent = ReadReport ( argv[3], current );
+   if ( numBase < 0 || numCurrent < 0 )
+      return -1;
+
+   printf ( "%-28s %10s %10s %8s %10s\n", "sample", "base ms", "new ms", "change", "p" );
+   for ( i = 0; i < numCurrent; i++ )
+   {
+      const SampleStats *b = NULL;
+      double change, p;
+      const char *verdict = "";
+
+      for ( j = 0; j < numBase; j++ )
+      {
+         if ( strcmp ( base[j].name, current[i].name ) == 0 )
+            b = &base[j];
+      }
+      if ( b == NULL )
+      {
+         printf ( "%-28s %10s %10.3f\n", current[i].name, "-", current[i].avg );
+         continue;
+      }
+
+      change = b->avg > 0.0f ? ( current[i].avg - b->avg ) * 100.0 / b->avg : 0.0;
+      p = WelchTest ( b, &current[i] );
+
+      // Only report changes that are both significant and large enough to matter
+      if ( p < alpha && change > threshold )
+      {
+         verdict = "REGRESSION";
+         regressions++;
+      }
+      else if ( p < alpha && change < -threshold )
+      {
+         verdict = "improved";
+      }
+
+      printf ( "%-28s %10.3f %10.3f %+7.1f%% %10.2g %s\n",
+               current[i].name, b->avg, current[i].avg, change, p, verdict );
+   }
+
+   printf ( "%d significant regression(s) (alpha=%g, threshold=%g%%)\n", regressions, alpha, threshold );
+   return regressions;
+}
+
+int main ( int argc, char *argv[] )
+{
+   SampleStats stats[MAX_SAMPLES];
+   const char *samples[MAX_SAMPLES];
+   const char *deltaTime = "0.016667";
+   const char *resolution = "320x240";
+   const char *output = "benchmark.json";
+   int numFrames = 600;
+   int numSamples = 0;
+   int numStats = 0;
+   FILE *file;
+   int i;
+
+   if ( argc >= 4 && strcmp ( argv[1], "compare" ) == 0 )
+   {
+      int regressions = Compare ( argc, argv );
+      return regressions != 0 ? 1 : 0;
+   }
+
+   for ( i = 1; i < argc; i++ )
+   {
+      if ( strcmp ( argv[i], "-f" ) == 0 && i + 1 < argc )
+         numFrames = atoi ( argv[++i] );
+      else if ( strcmp ( argv[i], "-d" ) == 0 && i + 1 < argc )
+         deltaTime = argv[++i];
+      else if ( strcmp ( argv[i], "-r" ) == 0 && i + 1 < argc )
+         resolution = argv[++i];
+      else if ( strcmp ( argv[i], "-o" ) == 0 && i + 1 < argc )
+         output = argv[++i];
+      else if ( argv[i][0] == '-' )
+      {
+         fprintf ( stderr, "Usage: %s [-f frames] [-d deltaTime] [-r WxH] [-o report.json] [sample ...]\n"
+                           "       %s compare base.json new.json [-a alpha] [-t threshold%%]\n", argv[0], argv[0] );
+         return 1;
+      }
+      else if ( numSamples < MAX_SAMPLES )
+         samples[numSamples++] = argv[i];
+   }
+
+   if ( numSamples == 0 )
+   {
+      for ( i = 0; i < (int) ( sizeof ( defaultSamples ) / sizeof ( defaultSamples[0] ) ); i++ )
+         samples[numSamples++] = defaultSamples[i];
+   }
+
+   printf ( "%-28s %8s %8s %8s %8s %8s\n", "sample", "avg ms", "p50", "p95", "p99", "max" );
+   for ( i = 0; i < numSamples; i++ )
+   {
+      SampleStats *s = &stats[numStats];
+
+      if ( !RunSample ( samples[i], numFrames, deltaTime, resolution, s ) )
+         continue;
+      printf ( "%-28s %8.3f %8.3f %8.3f %8.3f %8.3f\n", s->name, s->avg, s->p50, s->p95, s->p99, s->max );
+      numStats++;
+   }
+
+   file = fopen ( output, "w" );
+   if ( file == NULL )
+   {
+      fprintf ( stderr, "Unable to write %s\n", output );
+      return 1;
+   }
+   WriteReport ( file, numFrames, deltaTime, resolution, stats, numStats );
+   fclose ( file );
+   printf ( "Report written to %s\n", output );
+
+   return numStats == numSamples ? 0 : 1;
+}
@@ -0,0 +1,402 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// TGA.c
+//
+//    Checks and times esLoadTGAEx and esMapTGA.  Synthetic images of every
+//    supported kind are written to temporary files, decoded and compared
+//    pixel by pixel with a straightforward one-pixel-at-a-time decoder.  The
+//    decode times are reported next to the time of reading the file and
+//    copying the decoded size with memcpy, which is the floor for any
+//    loader, and the peak memory of both ways of loading.  Exits with 1 if
+//    an image does not decode correctly.
+//
+//    Usage: BM_TGA [size] [iterations]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <malloc.h>
+#include "esUtil.h"
+
+typedef struct
+{
+   const char    *name;
+   unsigned char  type;
+   unsigned char  bits;
+   GLboolean      topOrigin;
+} ImageKind;
+
+static const ImageKind kinds[] =
+{
+   { "24-bit",            2,  24, GL_FALSE },
+   { "32-bit top origin", 2,  32, GL_TRUE  },
+   { "8-bit gray top origin", 3, 8, GL_TRUE },
+   { "24-bit RLE",        10, 24, GL_FALSE },
+   { "32-bit RLE",        10, 32, GL_TRUE  },
+   { "8-bit gray RLE",    11, 8,  GL_FALSE },
+   { "8-bit color-mapped", 1, 8,  GL_FALSE },
+};
+
+///
+// Pixel value of the synthetic image, runs of equal pixels mixed with noise
+//
+static void SourcePixel ( int x, int y, int bytes, unsigned char *pixel )
+{
+   unsigned int seed = ( x / 7 ) * 2654435761u ^ y * 40503u;
+   int i;
+
+   if ( ( x / 64 + y ) & 1 )
+      seed ^= x * 97u;
+   for ( i = 0; i < bytes; i++ )
+      pixel[i] = (unsigned char) ( seed >> ( i * 7 ) );
+}
+
+///
+// Write a TGA file of the given kind, run-length encoding rows when asked
+//
+static GLboolean WriteTGA ( const char *fileName, const ImageKind *kind, int size )
+{
+   unsigned char header[18] = { 0 };
+   unsigned char pixel[4], next[4];
+   int bytes = kind->bits / 8;
+   FILE *f = fopen ( fileName, "wb" );
+   int x, y, i;
+
+   if ( f == NULL )
+      return GL_FALSE;
+
+   header[2] = kind->type;
+   header[12] = size & 0xff;
+   header[13] = size >> 8;
+   header[14] = size & 0xff;
+   header[15] = size >> 8;
+   header[16] = kind->bits;
+   header[17] = kind->topOrigin ? 0x20 : 0;
+   if ( kind->type == 1 )
+   {
+      header[1] = 1;
+      header[6] = 1;    // 256 entries
+      header[7] = 24;
+   }
+   fwrite ( header, 1, sizeof ( header ), f );
+
+   if ( kind->type == 1 )
+   {
+      for ( i = 0; i < 256; i++ )
+      {
+         pixel[0] = i;
+         pixel[1] = 255 - i;
+         pixel[2] = i * 3;
+         fwrite ( pixel, 1, 3, f );
+      }
+   }
+
+   for ( y = 0; y < size; y++ )
+   {
+      for ( x = 0; x < size; )
+      {
+         int count = 1;
+
+         SourcePixel ( x, y, bytes, pixel );
+         if ( kind->type < 8 )
+         {
+            fwrite ( pixel, 1, bytes, f );
+            x++;
+            continue;
+         }
+
+         // Runs of equal pixels become run packets, the rest one raw packet each
+         while ( x + count < size && count < 128 )
+         {
+            SourcePixel ( x + count, y, bytes, next );
+            if ( memcmp ( pixel, next, bytes ) != 0 )
+               break;
+            count++;
+         }
+
+         if ( count > 1 )
+         {
+            fputc ( 0x80 | ( count - 1 ), f );
+            fwrite ( pixel, 1, bytes, f );
+            x += count;
+            continue;
+         }
+
+         // Raw packet up to the next run, which may start at its last pixel
+         while ( x + count < size && count < 128 )
+         {
+            SourcePixel ( x + count - 1, y, bytes, pixel );
+            SourcePixel ( x + count, y, bytes, next );
+            if ( memcmp ( pixel, next, bytes ) == 0 )
+               break;
+            count++;
+         }
+         fputc ( count - 1, f );
+         for ( i = 0; i < count; i++ )
+         {
+            SourcePixel ( x + i, y, bytes, pixel );
+            fwrite ( pixel, 1, bytes, f );
+         }
+         x += count;
+      }
+   }
+
+   return fclose ( f ) == 0 ? GL_TRUE : GL_FALSE;
+}
+
+///
+// Compare the decoded image with the expected pixels, top row first
+//
+static GLboolean Verify ( const ImageKind *kind, int size, const unsigned char *pixels, GLenum format )
+{
+   int bytes = kind->bits / 8;
+   int outBytes = kind->type == 1 ? 3 : bytes;
+   GLenum expectedFormat = outBytes == 1 ? GL_LUMINANCE : outBytes == 3 ? GL_RGB : GL_RGBA;
+   unsigned char pixel[4], expected[4];
+   int x, y, fileRow;
+
+   if ( format != expectedFormat )
+      return GL_FALSE;
+
+   for ( y = 0; y < size; y++ )
+   {
+      fileRow = kind->topOrigin ? y : size - 1 - y;
+      for ( x = 0; x < size; x++ )
+      {
+         SourcePixel ( x, fileRow, bytes, pixel );
+         if ( kind->type == 1 )
+         {
+            expected[0] = pixel[0] * 3;
+            expected[1] = 255 - pixel[0];
+            expected[2] = pixel[0];
+         }
+         else
+         {
+            memcpy ( expected, pixel, bytes );
+            if ( bytes > 1 )
+            {
+               expected[0] = pixel[2];
+               expected[2] = pixel[0];
+            }
+         }
+
+         if ( memcmp ( expected, pixels + ( y * size + x ) * outBytes, outBytes ) != 0 )
+         {
+            printf ( "%s: pixel %d,%d differs\n", kind->name, x, y );
+            return GL_FALSE;
+         }
+      }
+   }
+
+   return GL_TRUE;
+}
+
+///
+// Read a field of /proc/self/status in KB
+//
+static long StatusKB ( const char *field )
+{
+   char line[256];
+   long value = 0;
+   FILE *f = fopen ( "/proc/self/status", "r" );
+
+   if ( f == NULL )
+      return 0;
+   while ( fgets ( line, sizeof ( line ), f ) != NULL )
+      if ( strncmp ( line, field, strlen ( field ) ) == 0 )
+         value = atol ( line + strlen ( field ) + 1 );
+   fclose ( f );
+   return value;
+}
+
+///
+// Growth of the peak resident set while loading the image in one of the two ways and
+// reading every pixel, as an upload would, in KB
+//
+static long PeakGrowth ( const char *fileName, GLboolean map )
+{
+   volatile unsigned int sum = 0;
+   const unsigned char *pixels;
+   unsigned char *buffer = NULL;
+   long before;
+   ESImage image;
+   GLenum format;
+   size_t bytes, i;
+   int width, height;
+   FILE *f = fopen ( "/proc/self/clear_refs", "w" );
+
+   // Writing 5 resets the peak to the current size
+   if ( f == NULL )
+      return 0;
+   fputs ( "5", f );
+   fclose ( f );
+   before = StatusKB ( "VmRSS" );
+
+   if ( map )
+   {
+      if ( !esMapTGA ( fileName, &image ) )
+         return 0;
+      pixels = image.pixels;
+      format = image.format;
+      width = image.width;
+      height = image.height;
+   }
+   else
+   {
+      pixels = buffer = (unsigned char *) esLoadTGAEx ( fileName, &width, &height, &format );
+      if ( pixels == NULL )
+         return 0;
+   }
+
+   bytes = (size_t) width * height * ( format == GL_LUMINANCE ? 1 : format == GL_RGB ? 3 : 4 );
+   for ( i = 0; i < bytes; i += 64 )
+      sum += pixels[i];
+
+   if ( map )
+      esFreeImage ( &image );
+   else
+      free ( buffer );
+
+   return StatusKB ( "VmHWM" ) - before;
+}
+
+int main ( int argc, char *argv[] )
+{
+   int size = argc > 1 ? atoi ( argv[1] ) : 1024;
+   int iterations = argc > 2 ? atoi ( argv[2] ) : 20;
+   char fileName[] = "/tmp/BM_TGA_XXXXXX";
+   GLboolean passed = GL_TRUE;
+   unsigned int k;
+   int fd, i;
+
+   if ( size < 1 || size > 65535 || iterations < 1 )
+   {
+      printf ( "Usage: %s [size] [iterations]\n", argv[0] );
+      return 1;
+   }
+
+   // A fixed threshold keeps every image in its own mapping, otherwise glibc raises it after
+   // the first large free and later buffers reuse heap pages that are already resident
+   mallopt ( M_MMAP_THRESHOLD, 128 * 1024 );
+
+   fd = mkstemp ( fileName );
+   if ( fd < 0 )
+      return 1;
+   close ( fd );
+
+   printf ( "%dx%d images, best of %d.  Peak RSS growth while loading and reading the pixels in KB.\n",
+            size, size, iterations );
+   printf ( "%-22s %8s %10s %10s %10s %9s %9s %7s\n", "", "file KB", "decode ms", "map ms", "copy ms",
+            "load RSS", "map RSS", "mapped" );
+
+   for ( k = 0; k < sizeof ( kinds ) / sizeof ( kinds[0] ); k++ )
+   {
+      const ImageKind *kind = &kinds[k];
+      double decodeTime = 1e9, mapTime = 1e9, copyTime = 1e9, t;
+      unsigned char *pixels = NULL;
+      GLenum format = 0;
+      size_t imageBytes = 0;
+      long fileSize;
+      int width, height;
+      ESImage image;
+      FILE *f;
+
+      if ( !WriteTGA ( fileName, kind, size ) )
+      {
+         passed = GL_FALSE;
+         break;
+      }
+
+      for ( i = 0; i < iterations; i++ )
+      {
+         free ( pixels );
+         t = esGetTime ( );
+         pixels = (unsigned char *) esLoadTGAEx ( fileName, &width, &height, &format );
+         t = esGetTime ( ) - t;
+         decodeTime = t < decodeTime ? t : decodeTime;
+         if ( pixels == NULL )
+            break;
+      }
+
+      if ( pixels == NULL || width != size || height != size || !Verify ( kind, size, pixels, format ) )
+      {
+         printf ( "%-22s FAILED\n", kind->name );
+         passed = GL_FALSE;
+         free ( pixels );
+         continue;
+      }
+      free ( pixels );
+
+      // The mapping is private, so converting it in place must not change the file
+      for ( i = 0; i < iterations; i++ )
+      {
+         t = esGetTime ( );
+         if ( !esMapTGA ( fileName, &image ) )
+            break;
+         t = esGetTime ( ) - t;
+         mapTime = t < mapTime ? t : mapTime;
+
+         if ( image.width != size || image.height != size || !Verify ( kind, size, image.pixels, image.format ) )
+            break;
+         if ( i < iterations - 1 )
+            esFreeImage ( &image );
+      }
+
+      if ( i < iterations )
+      {
+         printf ( "%-22s esMapTGA FAILED\n", kind->name );
+         passed = GL_FALSE;
+         continue;
+      }
+
+      // Reading the file and writing the output once is what any loader has to do
+      imageBytes = (size_t) size * size * ( format == GL_LUMINANCE ? 1 : format == GL_RGB ? 3 : 4 );
+      f = fopen ( fileName, "rb" );
+      if ( f == NULL || fseek ( f, 0, SEEK_END ) != 0 || ( fileSize = ftell ( f ) ) <= 0 )
+      {
+         printf ( "%-22s cannot read %s\n", kind->name, fileName );
+         passed = GL_FALSE;
+         if ( f != NULL )
+            fclose ( f );
+         esFreeImage ( &image );
+         continue;
+      }
+      fclose ( f );
+      for ( i = 0; i < iterations; i++ )
+      {
+         unsigned char *data, *copy;
+
+         t = esGetTime ( );
+         data = malloc ( fileSize );
+         copy = malloc ( imageBytes );
+         f = fopen ( fileName, "rb" );
+         if ( f == NULL || fread ( data, 1, fileSize, f ) != (size_t) fileSize )
+            passed = GL_FALSE;
+         if ( f != NULL )
+            fclose ( f );
+         memcpy ( copy, data, imageBytes < (size_t) fileSize ? imageBytes : (size_t) fileSize );
+         free ( data );
+         t = esGetTime ( ) - t;
+         copyTime = t < copyTime ? t : copyTime;
+         free ( copy );
+      }
+
+      printf ( "%-22s %8ld %10.3f %10.3f %10.3f %9ld %9ld %7s\n", kind->name, fileSize / 1024,
+               decodeTime * 1000.0, mapTime * 1000.0, copyTime * 1000.0,
+               PeakGrowth ( fileName, GL_FALSE ), PeakGrowth ( fileName, GL_TRUE ), image.mapped ? "yes" : "no" );
+      esFreeImage ( &image );
+   }
+
+   unlink ( fileName );
+   printf ( "%s\n", passed ? "all images decoded correctly" : "DECODE ERRORS" );
+   return passed ? 0 : 1;
+}
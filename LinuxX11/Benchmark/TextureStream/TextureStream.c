@@ -0,0 +1,527 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// TextureStream.c
+//
+//    Frame time check for esStreamTexture.  Synthetic 32-bit TGA images and
+//    an ETC1 KTX file with a full mip chain are written to temporary files.
+//    The main loop first runs with a textured quad only, for the baseline
+//    frame time, then loads one image per frame with esMapTGA and
+//    glTexImage2D, then streams all of them in while drawing.  Frames are
+//    paced at 60 Hz like a swap with vsync would, which is when the stream
+//    workers get to run on a machine with a single core, and the time spent
+//    waiting is taken out of the frame times reported for the three runs.
+//    Every streamed texture is then drawn next to the synchronously loaded
+//    one and compared pixel by pixel.  Exits with 1 if a streamed texture
+//    differs, if the median streaming frame takes over 1 ms longer than the
+//    median baseline frame or if, of the frames taking over 2 ms longer, the
+//    streaming run has more than the baseline run plus a quarter of its
+//    frames.  Such frames show up in all three runs on a busy machine with
+//    a single core, the workers decoding in the background only add to them.  The storage of a level is allocated in one frame, so
+//    the images default to 512x512; a 1024x1024 RGBA level takes about 3 ms
+//    to allocate with llvmpipe.
+//
+//    Usage: BM_TextureStream [size] [images] [budgetKB]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "esUtil.h"
+#include <GLES2/gl2ext.h>
+
+#define MAX_IMAGES      16
+#define MAX_FRAMES      ES_FRAME_HISTORY
+
+// Frame period of the pacing
+#define FRAME_PERIOD    ( 1.0 / 60.0 )
+
+// Extra frame time the median streaming frame may take over the baseline one
+#define MAX_COST_MS     1.0f
+
+// Extra frame time over the baseline median counted as a hitch, and the
+// share of the streaming frames, in percent, allowed to hitch on top of the
+// baseline hitches
+#define MAX_HITCH_MS    2.0f
+#define MAX_HITCH_SHARE 25
+
+typedef struct
+{
+   // Handle to a program object
+   GLuint programObject;
+
+   // Files to load, the last one is the KTX file
+   char   fileNames[MAX_IMAGES + 1][64];
+   int    numFiles;
+
+   // Textures loaded synchronously and streamed in
+   GLuint syncTex[MAX_IMAGES + 1];
+   GLuint streamTex[MAX_IMAGES + 1];
+
+   // Small texture drawn every frame, so the draw costs the same in every phase
+   GLuint drawTex;
+
+   // 0 baseline, 1 synchronous loads, 2 streaming
+   int    phase;
+   int    frame;
+   int    delivered;
+   int    doneFrame;
+
+   // Next 60 Hz tick and the time each frame waited for its tick, in milliseconds
+   double nextTick;
+   float  waited[MAX_FRAMES];
+
+} UserData;
+
+typedef struct
+{
+   // Frame times without the pacing, sorted
+   float  work[MAX_FRAMES];
+   int    frames;
+   float  p50;
+   float  p99;
+   float  max;
+} PhaseStats;
+
+///
+// Pixel value of the synthetic images
+//
+static void SourcePixel ( int image, int x, int y, unsigned char *pixel )
+{
+   unsigned int seed = ( x * 2654435761u ) ^ ( y * 40503u ) ^ ( image * 0x9E3779B9u );
+
+   pixel[0] = (unsigned char) ( x + image * 32 );
+   pixel[1] = (unsigned char) y;
+   pixel[2] = (unsigned char) ( seed >> 13 );
+   pixel[3] = (unsigned char) ( seed >> 24 );
+}
+
+///
+// Write a 32-bit top origin TGA file
+//
+static GLboolean WriteTGA ( const char *fileName, int image, int size )
+{
+   unsigned char header[18] = { 0 };
+   unsigned char *row = malloc ( size * 4 );
+   FILE *f = fopen ( fileName, "wb" );
+   int x, y;
+
+   if ( f == NULL || row == NULL )
+   {
+      free ( row );
+      if ( f != NULL )
+         fclose ( f );
+      return GL_FALSE;
+   }
+
+   header[2] = 2;
+   header[12] = size & 0xff;
+   header[13] = size >> 8;
+   header[14] = size & 0xff;
+   header[15] = size >> 8;
+   header[16] = 32;
+   header[17] = 0x20;
+   fwrite ( header, 1, sizeof ( header ), f );
+
+   for ( y = 0; y < size; y++ )
+   {
+      for ( x = 0; x < size; x++ )
+      {
+         unsigned char pixel[4];
+
+         // TGA stores BGRA
+         SourcePixel ( image, x, y, pixel );
+         row[x * 4 + 0] = pixel[2];
+         row[x * 4 + 1] = pixel[1];
+         row[x * 4 + 2] = pixel[0];
+         row[x * 4 + 3] = pixel[3];
+      }
+      fwrite ( row, 1, size * 4, f );
+   }
+
+   free ( row );
+   return fclose ( f ) == 0 ? GL_TRUE : GL_FALSE;
+}
+
+///
+// Write an ETC1 KTX file with every mip level, halving the image with a box filter
+//
+static GLboolean WriteKTX ( const char *fileName, int image, int size )
+{
+   static const unsigned char identifier[12] =
+   {
+      0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+   };
+   GLuint header[13] = { 0x04030201, 0, 1, 0, GL_ETC1_RGB8_OES, GL_RGB, 0, 0, 0, 0, 1, 0, 0 };
+   unsigned char *rgb = malloc ( (size_t) size * size * 3 );
+   unsigned char *blocks = malloc ( (size_t) ( size + 3 ) / 4 * ( ( size + 3 ) / 4 ) * 8 );
+   FILE *f = fopen ( fileName, "wb" );
+   int levels = 1, level, x, y, c;
+
+   if ( f == NULL || rgb == NULL || blocks == NULL )
+   {
+      free ( rgb );
+      free ( blocks );
+      if ( f != NULL )
+         fclose ( f );
+      return GL_FALSE;
+   }
+
+   while ( ( size >> levels ) > 0 )
+      levels++;
+   header[6] = header[7] = size;
+   header[11] = levels;
+   fwrite ( identifier, 1, sizeof ( identifier ), f );
+   fwrite ( header, 4, 13, f );
+
+   for ( y = 0; y < size; y++ )
+   {
+      for ( x = 0; x < size; x++ )
+      {
+         unsigned char pixel[4];
+
+         SourcePixel ( image, x, y, pixel );
+         memcpy ( rgb + ( y * size + x ) * 3, pixel, 3 );
+      }
+   }
+
+   for ( level = 0; level < levels; level++ )
+   {
+      int width = size >> level;
+      GLuint imageSize = ( width + 3 ) / 4 * ( ( width + 3 ) / 4 ) * 8;
+
+      esEncodeETC1 ( rgb, width, width, 0, blocks );
+      fwrite ( &imageSize, 4, 1, f );
+      fwrite ( blocks, 1, imageSize, f );
+
+      // The next level, in place
+      for ( y = 0; y < width / 2; y++ )
+         for ( x = 0; x < width / 2; x++ )
+            for ( c = 0; c < 3; c++ )
+               rgb[( y * ( width / 2 ) + x ) * 3 + c] =
+                  ( rgb[( 2 * y * width + 2 * x ) * 3 + c] + rgb[( 2 * y * width + 2 * x + 1 ) * 3 + c] +
+                    rgb[( ( 2 * y + 1 ) * width + 2 * x ) * 3 + c] +
+                    rgb[( ( 2 * y + 1 ) * width + 2 * x + 1 ) * 3 + c] + 2 ) / 4;
+   }
+
+   free ( rgb );
+   free ( blocks );
+   return fclose ( f ) == 0 ? GL_TRUE : GL_FALSE;
+}
+
+///
+// Load an image the way the samples did before streaming, on the render thread
+//
+static GLuint LoadSync ( const char *fileName )
+{
+   ESImage image;
+   GLuint texId;
+
+   if ( strstr ( fileName, ".ktx" ) != NULL )
+      return esLoadKTX ( fileName, NULL, NULL, NULL );
+
+   if ( !esMapTGA ( fileName, &image ) )
+      return 0;
+
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, 1 );
+   glGenTextures ( 1, &texId );
+   esStateBindTexture ( GL_TEXTURE_2D, texId );
+   glTexImage2D ( GL_TEXTURE_2D, 0, image.format, image.width, image.height, 0, image.format, GL_UNSIGNED_BYTE,
+                  image.pixels );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, 4 );
+   esFreeImage ( &image );
+   return texId;
+}
+
+///
+// Called on the render thread once a texture has streamed in
+//
+void TextureLoaded ( ESContext *esContext, GLuint texId, void *data )
+{
+   UserData *userData = esContext->userData;
+
+   *(GLuint *) data = texId;
+   userData->delivered++;
+}
+
+///
+// Initialize the shader and program object
+//
+int Init ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   unsigned char pixels[64 * 64 * 4];
+   int i;
+   const char vShaderStr[] =
+      "attribute vec4 a_position;                  \n"
+      "varying vec2 v_texCoord;                    \n"
+      "void main()                                 \n"
+      "{                                           \n"
+      "   gl_Position = a_position;                \n"
+      "   v_texCoord = a_position.xy * 0.5 + 0.5;  \n"
+      "}                                           \n";
+   const char fShaderStr[] =
+      "precision mediump float;                            \n"
+      "varying vec2 v_texCoord;                            \n"
+      "uniform sampler2D s_texture;                        \n"
+      "void main()                                         \n"
+      "{                                                   \n"
+      "  gl_FragColor = texture2D( s_texture, v_texCoord ); \n"
+      "}                                                   \n";
+
+   userData->programObject = esLoadProgram ( vShaderStr, fShaderStr );
+   if ( userData->programObject == 0 )
+      return FALSE;
+
+   glBindAttribLocation ( userData->programObject, 0, "a_position" );
+   glLinkProgram ( userData->programObject );
+
+   for ( i = 0; i < 64 * 64; i++ )
+      SourcePixel ( 0, i % 64, i / 64, pixels + i * 4 );
+   glGenTextures ( 1, &userData->drawTex );
+   esStateBindTexture ( GL_TEXTURE_2D, userData->drawTex );
+   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGBA, 64, 64, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+
+   glClearColor ( 0.0f, 0.0f, 0.0f, 0.0f );
+   return TRUE;
+}
+
+///
+// Draw the current texture over the window, loading or streaming as the phase requires
+//
+void Draw ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   GLfloat vVertices[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+   double now = esGetTime ( );
+
+   if ( userData->nextTick > now )
+   {
+      usleep ( (useconds_t) ( ( userData->nextTick - now ) * 1e6 ) );
+      userData->waited[userData->frame % MAX_FRAMES] = (float) ( ( esGetTime ( ) - now ) * 1000.0 );
+      userData->nextTick += FRAME_PERIOD;
+   }
+   else
+   {
+      userData->waited[userData->frame % MAX_FRAMES] = 0.0f;
+      userData->nextTick = now + FRAME_PERIOD;
+   }
+
+   if ( userData->phase == 1 && userData->frame < userData->numFiles )
+      userData->syncTex[userData->frame] = LoadSync ( userData->fileNames[userData->frame] );
+
+   // Keep drawing a few frames after the last texture, then end the main loop
+   if ( userData->phase == 2 && userData->delivered == userData->numFiles )
+   {
+      if ( userData->doneFrame == 0 )
+         userData->doneFrame = userData->frame;
+      else if ( userData->frame - userData->doneFrame >= 10 )
+         esContext->maxFrames = 1;
+   }
+   userData->frame++;
+
+   glViewport ( 0, 0, esContext->width, esContext->height );
+   glClear ( GL_COLOR_BUFFER_BIT );
+   esStateUseProgram ( userData->programObject );
+   esStateBindTexture ( GL_TEXTURE_2D, userData->drawTex );
+   glVertexAttribPointer ( 0, 2, GL_FLOAT, GL_FALSE, 0, vVertices );
+   glEnableVertexAttribArray ( 0 );
+   glDrawArrays ( GL_TRIANGLE_STRIP, 0, 4 );
+}
+
+///
+// Draw the base level of a texture into a framebuffer of its size with nearest
+// filtering and read it back
+//
+static void ReadTexture ( UserData *userData, GLuint texId, int size, unsigned char *pixels )
+{
+   GLfloat vVertices[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+   GLuint target, framebuffer;
+   GLint previous;
+
+   glGetIntegerv ( GL_FRAMEBUFFER_BINDING, &previous );
+   glGenTextures ( 1, &target );
+   esStateBindTexture ( GL_TEXTURE_2D, target );
+   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+   glGenFramebuffers ( 1, &framebuffer );
+   glBindFramebuffer ( GL_FRAMEBUFFER, framebuffer );
+   glFramebufferTexture2D ( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0 );
+
+   esStateBindTexture ( GL_TEXTURE_2D, texId );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+
+   glViewport ( 0, 0, size, size );
+   esStateUseProgram ( userData->programObject );
+   glVertexAttribPointer ( 0, 2, GL_FLOAT, GL_FALSE, 0, vVertices );
+   glEnableVertexAttribArray ( 0 );
+   glDrawArrays ( GL_TRIANGLE_STRIP, 0, 4 );
+   glReadPixels ( 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels );
+
+   glBindFramebuffer ( GL_FRAMEBUFFER, previous );
+   glDeleteFramebuffers ( 1, &framebuffer );
+   glDeleteTextures ( 1, &target );
+   esStateInvalidate ( );
+}
+
+///
+// Sort helper for the frame times
+//
+static int CompareFloat ( const void *a, const void *b )
+{
+   float fa = *(const float *) a, fb = *(const float *) b;
+
+   return fa < fb ? -1 : fa > fb;
+}
+
+///
+// Number of frames of a phase that took longer than limit
+//
+static int CountOver ( const PhaseStats *stats, float limit )
+{
+   int count = 0, i;
+
+   for ( i = 0; i < stats->frames; i++ )
+      count += stats->work[i] > limit;
+   return count;
+}
+
+///
+// Run the main loop for one phase and print its frame times without the
+// pacing.  The first frame starts the loop and is left out.
+//
+static void RunPhase ( ESContext *esContext, int phase, int maxFrames, const char *name, PhaseStats *stats )
+{
+   UserData *userData = esContext->userData;
+   const ESFrameHistory *history = &esContext->frameHistory;
+   float *work = stats->work;
+   unsigned int i;
+
+   userData->phase = phase;
+   userData->frame = 0;
+   userData->nextTick = 0.0;
+   esResetFrameStats ( esContext );
+   esContext->maxFrames = maxFrames;
+   esMainLoop ( esContext );
+
+   stats->frames = 0;
+   for ( i = 1; i < history->count; i++ )
+      work[stats->frames++] = history->frames[i].frame - userData->waited[i];
+   qsort ( work, stats->frames, sizeof ( float ), CompareFloat );
+   stats->p50 = work[stats->frames / 2];
+   stats->p99 = work[stats->frames * 99 / 100];
+   stats->max = work[stats->frames - 1];
+
+   printf ( "%-26s %7d %8.2f %8.2f %8.2f\n", name, stats->frames, stats->p50, stats->p99, stats->max );
+}
+
+int main ( int argc, char *argv[] )
+{
+   ESContext esContext;
+   UserData  userData;
+   static PhaseStats baseline, sync, stream;
+   int size = argc > 1 ? atoi ( argv[1] ) : 512;
+   int images = argc > 2 ? atoi ( argv[2] ) : MAX_IMAGES;
+   int budgetKB = argc > 3 ? atoi ( argv[3] ) : 0;
+   unsigned char *expected, *actual;
+   GLboolean passed = GL_TRUE;
+   float limit;
+   int hitches;
+   int i;
+
+   if ( size < 4 || size > 4096 || images < 1 || images > MAX_IMAGES || budgetKB < 0 )
+   {
+      printf ( "Usage: %s [size] [images (1..%d)] [budgetKB]\n", argv[0], MAX_IMAGES );
+      return 1;
+   }
+
+   memset ( &userData, 0, sizeof ( userData ) );
+   for ( i = 0; i <= images; i++ )
+   {
+      snprintf ( userData.fileNames[i], sizeof ( userData.fileNames[i] ), "/tmp/BM_TextureStream_%d.%s",
+                 (int) getpid ( ) * 32 + i, i < images ? "tga" : "ktx" );
+      if ( !( i < images ? WriteTGA ( userData.fileNames[i], i, size ) :
+                           WriteKTX ( userData.fileNames[i], i, size ) ) )
+         return 1;
+   }
+   userData.numFiles = images + 1;
+
+   esInitContext ( &esContext );
+   esContext.userData = &userData;
+
+   if ( !esCreateWindow ( &esContext, "Texture Stream Benchmark", 320, 240, ES_WINDOW_RGB ) )
+   {
+      esLogMessage ( "Unable to create the rendering context\n" );
+      return 1;
+   }
+
+   if ( !Init ( &esContext ) )
+      return 1;
+
+   esRegisterDrawFunc ( &esContext, Draw );
+
+   printf ( "%d %dx%d RGBA images and a %dx%d ETC1 KTX file\n", images, size, size, size, size );
+   printf ( "%-26s %7s %8s %8s %8s\n", "frame ms", "frames", "p50", "p99", "max" );
+
+   RunPhase ( &esContext, 0, 60, "baseline", &baseline );
+
+   RunPhase ( &esContext, 1, userData.numFiles + 10, "glTexImage2D per frame", &sync );
+
+   esTextureStreamConfig ( &esContext, 0, budgetKB * 1024 );
+   for ( i = 0; i < userData.numFiles; i++ )
+      if ( esStreamTexture ( &esContext, userData.fileNames[i], TextureLoaded, &userData.streamTex[i] ) == 0 )
+         return 1;
+   RunPhase ( &esContext, 2, MAX_FRAMES, "esStreamTexture", &stream );
+
+   limit = baseline.p50 + MAX_HITCH_MS;
+   hitches = CountOver ( &stream, limit );
+   printf ( "streamed in %d frames.  Frames over %.2f ms: baseline %d, glTexImage2D %d, esStreamTexture %d\n",
+            userData.doneFrame, limit, CountOver ( &baseline, limit ), CountOver ( &sync, limit ), hitches );
+   if ( userData.delivered != userData.numFiles || stream.p50 > baseline.p50 + MAX_COST_MS ||
+        hitches > CountOver ( &baseline, limit ) + stream.frames * MAX_HITCH_SHARE / 100 )
+      passed = GL_FALSE;
+
+   // Both ways of loading must give the same textures
+   expected = malloc ( (size_t) size * size * 4 );
+   actual = malloc ( (size_t) size * size * 4 );
+   for ( i = 0; i < userData.numFiles && expected != NULL && actual != NULL; i++ )
+   {
+      if ( userData.syncTex[i] == 0 || userData.streamTex[i] == 0 )
+      {
+         printf ( "%s: not loaded\n", userData.fileNames[i] );
+         passed = GL_FALSE;
+         continue;
+      }
+
+      ReadTexture ( &userData, userData.syncTex[i], size, expected );
+      ReadTexture ( &userData, userData.streamTex[i], size, actual );
+      if ( memcmp ( expected, actual, (size_t) size * size * 4 ) != 0 )
+      {
+         printf ( "%s: streamed texture differs\n", userData.fileNames[i] );
+         passed = GL_FALSE;
+      }
+   }
+   free ( expected );
+   free ( actual );
+
+   for ( i = 0; i < userData.numFiles; i++ )
+   {
+      glDeleteTextures ( 1, &userData.syncTex[i] );
+      glDeleteTextures ( 1, &userData.streamTex[i] );
+      unlink ( userData.fileNames[i] );
+   }
+   glDeleteTextures ( 1, &userData.drawTex );
+   glDeleteProgram ( userData.programObject );
+
+   printf ( "%s\n", passed ? "all textures streamed correctly within the frame time limits" : "FAILED" );
+   return passed ? 0 : 1;
+}
@@ -0,0 +1,230 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ThreadedUpdate.c
+//
+//    Consistency check for esRegisterThreadedUpdateFunc.  Every update numbers
+//    its snapshot and fills it in two halves with a sleep in between, and every
+//    draw checks that the snapshot it is handed is complete and not older than
+//    the one before.
+//
+//    The first run uses a variable step.  For its first half the update is slow
+//    and the draw fast, then the other way round, so wake-ups that piled up
+//    during the slow updates would show up as a burst of updates within one
+//    frame afterwards.  The second run ticks at a fixed rate and also checks
+//    the step passed to the update and the interpolation alpha.  Exits with 1
+//    if any check failed.
+//
+//    Usage: BM_ThreadedUpdate [frames] [slowMs]
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include "esUtil.h"
+
+#define PAYLOAD_WORDS   256
+#define FIXED_RATE      120.0f
+#define FIXED_MAX_STEPS 4
+
+// Most updates that can publish between two frames when wake-ups are coalesced:
+// the one in flight, the one woken by the frame and one pending from before
+#define MAX_UPDATES_PER_FRAME 3
+
+typedef struct
+{
+   unsigned int seq;
+   double       time;
+   float        deltaTime;
+   unsigned int payload[PAYLOAD_WORDS];
+} Snapshot;
+
+typedef struct
+{
+   // Written by the update thread only
+   unsigned int seq;
+
+   // Time the update and the draw sleep, in microseconds
+   atomic_int   updateSleep;
+   int          drawSleep;
+
+   // Checks made by the draw callback
+   int          frames;
+   unsigned int firstSeq;
+   unsigned int lastSeq;
+   double       lastTime;
+   unsigned int maxAdvance;
+   int          outOfOrder;
+   int          torn;
+   int          badStep;
+   int          badAlpha;
+   float        minAlpha;
+   float        maxAlpha;
+} UserData;
+
+///
+// Fill in the snapshot, half of it before the sleep and half after
+//
+void Update ( ESContext *esContext, float deltaTime, void *snapshot )
+{
+   UserData *userData = esContext->userData;
+   Snapshot *s = snapshot;
+   int sleep = atomic_load ( &userData->updateSleep );
+   int i;
+
+   s->seq = ++userData->seq;
+   s->time = esGetTime ( );
+   s->deltaTime = deltaTime;
+
+   for ( i = 0; i < PAYLOAD_WORDS / 2; i++ )
+      s->payload[i] = s->seq;
+   if ( sleep > 0 )
+      usleep ( sleep );
+   for ( ; i < PAYLOAD_WORDS; i++ )
+      s->payload[i] = s->seq;
+}
+
+///
+// Check the snapshot handed to this frame
+//
+void Draw ( ESContext *esContext )
+{
+   UserData *userData = esContext->userData;
+   const Snapshot *s = esGetFrameSnapshot ( esContext );
+   int i;
+
+   for ( i = 0; i < PAYLOAD_WORDS; i++ )
+   {
+      if ( s->payload[i] != s->seq )
+      {
+         userData->torn++;
+         break;
+      }
+   }
+
+   if ( userData->frames == 0 )
+   {
+      userData->firstSeq = s->seq;
+   }
+   else
+   {
+      if ( s->seq < userData->lastSeq || s->time < userData->lastTime )
+         userData->outOfOrder++;
+      else if ( s->seq - userData->lastSeq > userData->maxAdvance )
+         userData->maxAdvance = s->seq - userData->lastSeq;
+   }
+   userData->lastSeq = s->seq;
+   userData->lastTime = s->time;
+
+   // The snapshot made by esMainLoop before the thread starts has no step
+   if ( esContext->fixedTimestep > 0.0f )
+   {
+      float alpha = esContext->interpolationAlpha;
+
+      if ( s->seq != userData->firstSeq && s->deltaTime != esContext->fixedTimestep )
+         userData->badStep++;
+      if ( alpha < 0.0f || alpha > 1.0f )
+         userData->badAlpha++;
+      userData->minAlpha = alpha < userData->minAlpha ? alpha : userData->minAlpha;
+      userData->maxAlpha = alpha > userData->maxAlpha ? alpha : userData->maxAlpha;
+   }
+
+   glClear ( GL_COLOR_BUFFER_BIT );
+
+   // Halfway through the variable step run the draw takes over the sleep of the update
+   userData->frames++;
+   if ( esContext->fixedTimestep == 0.0f && userData->frames == (int) esContext->maxFrames / 2 )
+      userData->drawSleep = atomic_exchange ( &userData->updateSleep, 0 );
+   if ( userData->drawSleep > 0 )
+      usleep ( userData->drawSleep );
+}
+
+///
+// Run the main loop once and print what the draw callback saw
+//
+GLboolean Run ( ESContext *esContext, const char *name, int frames, int updateSleep, int drawSleep )
+{
+   UserData *userData = esContext->userData;
+   unsigned int updates;
+   double start, elapsed;
+   GLboolean passed;
+
+   userData->frames = 0;
+   userData->lastSeq = 0;
+   userData->lastTime = 0.0;
+   userData->maxAdvance = 0;
+   userData->outOfOrder = userData->torn = userData->badStep = userData->badAlpha = 0;
+   userData->minAlpha = 1.0f;
+   userData->maxAlpha = 0.0f;
+   userData->drawSleep = drawSleep;
+   atomic_store ( &userData->updateSleep, updateSleep );
+   esContext->maxFrames = frames;
+
+   start = esGetTime ( );
+   esMainLoop ( esContext );
+   elapsed = esGetTime ( ) - start;
+   updates = userData->lastSeq - userData->firstSeq;
+
+   passed = userData->torn == 0 && userData->outOfOrder == 0 && userData->badStep == 0 &&
+            userData->badAlpha == 0 && userData->maxAdvance <= MAX_UPDATES_PER_FRAME;
+
+   printf ( "%-8s %6d %8u %8.1f %8u %6d %6d %6d", name, userData->frames, updates,
+            updates / elapsed, userData->maxAdvance, userData->torn, userData->outOfOrder, userData->badStep );
+   if ( esContext->fixedTimestep > 0.0f )
+      printf ( "   %.3f..%.3f", userData->minAlpha, userData->maxAlpha );
+   printf ( "\n" );
+
+   return passed;
+}
+
+int main ( int argc, char *argv[] )
+{
+   ESContext esContext;
+   UserData  userData = { 0 };
+   int numFrames = argc > 1 ? atoi ( argv[1] ) : 200;
+   int slowMs = argc > 2 ? atoi ( argv[2] ) : 10;
+   GLboolean passed;
+
+   if ( numFrames < 10 || slowMs < 1 )
+   {
+      esLogMessage ( "Usage: %s [frames (10..)] [slowMs (1..)]\n", argv[0] );
+      return 1;
+   }
+
+   esInitContext ( &esContext );
+   esContext.userData = &userData;
+
+   if ( !esCreateWindow ( &esContext, "Threaded Update Benchmark", 320, 240, ES_WINDOW_RGB ) )
+   {
+      esLogMessage ( "Unable to create the rendering context\n" );
+      return 1;
+   }
+
+   glClearColor ( 0.0f, 0.0f, 0.0f, 0.0f );
+   esRegisterDrawFunc ( &esContext, Draw );
+   if ( !esRegisterThreadedUpdateFunc ( &esContext, sizeof ( Snapshot ), Update ) )
+      return 1;
+
+   printf ( "%-8s %6s %8s %8s %8s %6s %6s %6s   %s\n", "step", "frames", "updates", "per s",
+            "max/frm", "torn", "order", "dt", "alpha" );
+
+   // Slow updates with fast draws, then the reverse from the middle of the run
+   passed = Run ( &esContext, "variable", numFrames, slowMs * 1000, 0 );
+
+   // Fixed rate, drawn at about the same rate so that the alpha sweeps its range
+   esSetFixedTimestep ( &esContext, FIXED_RATE, FIXED_MAX_STEPS );
+   passed = Run ( &esContext, "fixed", numFrames, 0, (int) ( 1e6f / FIXED_RATE * 0.7f ) ) && passed;
+
+   esRegisterThreadedUpdateFunc ( &esContext, 0, NULL );
+
+   printf ( "at most %d updates between frames, snapshots complete and in order -> %s\n",
+            MAX_UPDATES_PER_FRAME, passed ? "passed" : "FAILED" );
+   return passed ? 0 : 1;
+}
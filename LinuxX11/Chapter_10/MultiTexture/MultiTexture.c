@@ -37,33 +37,34 @@ typedef struct
 
 
 ///
-// Load texture from disk
+// Called on the render thread once the program has been linked by the loader thread
 //
-GLuint LoadTexture ( char *fileName )
+void ProgramLoaded ( ESContext *esContext, GLuint programObject, void *data )
 {
-   int width,
-       height;
-   char *buffer = esLoadTGA ( fileName, &width, &height );
-   GLuint texId;
-
-   if ( buffer == NULL )
-   {
-      esLogMessage ( "Error loading (%s) image.\n", fileName );
-      return 0;
-   }
+   UserData *userData = esContext->userData;
 
-   glGenTextures ( 1, &texId );
-   glBindTexture ( GL_TEXTURE_2D, texId );
+   (void) data;
+   if ( programObject == 0 )
+      return;
 
-   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, buffer );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+   userData->programObject = programObject;
 
-   free ( buffer );
+   // Get the attribute locations
+   userData->positionLoc = glGetAttribLocation ( userData->programObject, "a_position" );
+   userData->texCoordLoc = glGetAttribLocation ( userData->programObject, "a_texCoord" );
+   
+   // Get the sampler location
+   userData->baseMapLoc = glGetUniformLocation ( userData->programObject, "s_baseMap" );
+   userData->lightMapLoc = glGetUniformLocation ( userData->programObject, "s_lightMap" );
+}
 
-   return texId;
+///
+// Called on the render thread once a texture has been uploaded by the loader thread
+//
+void TextureLoaded ( ESContext *esContext, GLuint texId, void *data )
+{
+   (void) esContext;
+   *(GLuint *) data = texId;
 }
 
 
@@ -99,22 +100,14 @@ int Init ( ESContext *esContext )
       "  gl_FragColor = baseColor * (lightColor + 0.25);   \n"
       "}                                                   \n";
 
-   // Load the shaders and get a linked program object
-   userData->programObject = esLoadProgram ( vShaderStr, fShaderStr );
-
-   // Get the attribute locations
-   userData->positionLoc = glGetAttribLocation ( userData->programObject, "a_position" );
-   userData->texCoordLoc = glGetAttribLocation ( userData->programObject, "a_texCoord" );
-   
-   // Get the sampler location
-   userData->baseMapLoc = glGetUniformLocation ( userData->programObject, "s_baseMap" );
-   userData->lightMapLoc = glGetUniformLocation ( userData->programObject, "s_lightMap" );
-
-   // Load the textures
-   userData->baseMapTexId = LoadTexture ( "basemap.tga" );
-   userData->lightMapTexId = LoadTexture ( "lightmap.tga" );
-
-   if ( userData->baseMapTexId == 0 || userData->lightMapTexId == 0 )
+   // Compile the program and load the textures on the loader thread, the
+   // quad is drawn once all of them have arrived
+   userData->programObject = 0;
+   userData->baseMapTexId = 0;
+   userData->lightMapTexId = 0;
+   if ( !esLoadProgramAsync ( esContext, (char *) vShaderStr, (char *) fShaderStr, ProgramLoaded, NULL ) ||
+        !esLoadTextureAsync ( esContext, "basemap.tga", TextureLoaded, &userData->baseMapTexId ) ||
+        !esLoadTextureAsync ( esContext, "lightmap.tga", TextureLoaded, &userData->lightMapTexId ) )
       return FALSE;
 
    glClearColor ( 0.0f, 0.0f, 0.0f, 0.0f );
@@ -144,6 +137,12 @@ void Draw ( ESContext *esContext )
    // Clear the color buffer
    glClear ( GL_COLOR_BUFFER_BIT );
 
+   if ( userData->programObject == 0 || userData->baseMapTexId == 0 || userData->lightMapTexId == 0 )
+   {
+      eglSwapBuffers ( esContext->eglDisplay, esContext->eglSurface );
+      return;
+   }
+
    // Use the program object
    glUseProgram ( userData->programObject );
 
@@ -134,20 +134,23 @@ void Draw ( ESContext *esContext )
    };
 
    // Set the viewport
-   glViewport ( 0, 0, esContext->width, esContext->height );
+   esStateViewport ( 0, 0, esContext->width, esContext->height );
    
    // Clear the color, depth, and stencil buffers.  At this
-   //   point, the stencil buffer will be 0x1 for all pixels
+   //   point, the stencil buffer will be 0x1 for all pixels.
+   //   The stencil write mask also applies to clears, so re-enable
+   //   writes that the previous frame turned off.
+   esStateStencilMask ( 0xff );
    glClear ( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT );
 
    // Use the program object
-   glUseProgram ( userData->programObject );
+   esStateUseProgram ( userData->programObject );
 
    // Load the vertex position
    glVertexAttribPointer ( userData->positionLoc, 3, GL_FLOAT, 
                            GL_FALSE, 0, vVertices );
   
-   glEnableVertexAttribArray ( userData->positionLoc );
+   esStateEnableVertexAttribArray ( userData->positionLoc );
 
    // Test 0:
    //
@@ -162,8 +165,8 @@ void Draw ( ESContext *esContext )
    //   The value in the stencil buffer for these pixels will
    //   be 0x7.
    //
-   glStencilFunc( GL_LESS, 0x7, 0x3 );
-   glStencilOp( GL_REPLACE, GL_DECR, GL_DECR );
+   esStateStencilFunc( GL_LESS, 0x7, 0x3 );
+   esStateStencilOp( GL_REPLACE, GL_DECR, GL_DECR );
    glDrawElements( GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, indices[0] );
  
    // Test 1:
@@ -178,8 +181,8 @@ void Draw ( ESContext *esContext )
    //    but where the geometry fails the depth test.  The
    //    stencil values for these pixels will be 0x0.
    //
-   glStencilFunc( GL_GREATER, 0x3, 0x3 );
-   glStencilOp( GL_KEEP, GL_DECR, GL_KEEP );
+   esStateStencilFunc( GL_GREATER, 0x3, 0x3 );
+   esStateStencilOp( GL_KEEP, GL_DECR, GL_KEEP );
    glDrawElements( GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, indices[1] );
 
    // Test 2:
@@ -194,8 +197,8 @@ void Draw ( ESContext *esContext )
    //
    //   The stencil values for these pixels will be 0x2.
    //
-   glStencilFunc( GL_EQUAL, 0x1, 0x3 );
-   glStencilOp( GL_KEEP, GL_INCR, GL_INCR );
+   esStateStencilFunc( GL_EQUAL, 0x1, 0x3 );
+   esStateStencilOp( GL_KEEP, GL_INCR, GL_INCR );
    glDrawElements( GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, indices[2] );
 
    // Test 3:
@@ -211,8 +214,8 @@ void Draw ( ESContext *esContext )
    //   (with the 0x1 being from the stencil clear value),
    //   where 's' is the number of bits in the stencil buffer
    //
-   glStencilFunc( GL_EQUAL, 0x2, 0x1 );
-   glStencilOp( GL_INVERT, GL_KEEP, GL_KEEP );
+   esStateStencilFunc( GL_EQUAL, 0x2, 0x1 );
+   esStateStencilOp( GL_INVERT, GL_KEEP, GL_KEEP );
    glDrawElements( GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, indices[3] );
    
    // Since we don't know at compile time how many stecil bits are present,
@@ -227,16 +230,14 @@ void Draw ( ESContext *esContext )
    //   occur.  We diable writing to the stencil buffer so we
    //   can test against them without modifying the values we
    //   generated.
-   glStencilMask( 0x0 );
+   esStateStencilMask( 0x0 );
    
    for ( i = 0; i < NumTests; ++i )
    {
-      glStencilFunc( GL_EQUAL, stencilValues[i], 0xff );
+      esStateStencilFunc( GL_EQUAL, stencilValues[i], 0xff );
       glUniform4fv( userData->colorLoc, 1, colors[i] );
       glDrawElements( GL_TRIANGLES, 6, GL_UNSIGNED_BYTE, indices[4] );
    }
-
-   eglSwapBuffers ( esContext->eglDisplay, esContext->eglSurface );
 }
 
 ///
@@ -266,6 +267,9 @@ int main ( int argc, char *argv[] )
       return 0;
 
    esRegisterDrawFunc ( &esContext, Draw );
+
+   // The scene never changes, only redraw when the window needs repainting
+   esSetRenderMode ( &esContext, ES_RENDER_ON_DEMAND );
    
    esMainLoop ( &esContext );
 
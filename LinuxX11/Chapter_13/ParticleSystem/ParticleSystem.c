@@ -36,8 +36,9 @@ typedef struct
    GLint centerPositionLoc;
    GLint samplerLoc;
 
-   // Texture handle
+   // Texture handle, the stream placeholder until smoke.ktx has arrived
    GLuint textureId;
+   GLuint placeholderId;
 
    // Particle vertex data
    float particleData[ NUM_PARTICLES * PARTICLE_SIZE ];
@@ -48,33 +49,22 @@ typedef struct
 } UserData;
 
 ///
-// Load texture from disk
+// Called on the render thread once the texture has streamed in, an ETC1 KTX
+// file made from smoke.tga with TL_ETC1Encode that takes a sixth of the
+// memory of the RGB image
 //
-GLuint LoadTexture ( char *fileName )
+void TextureLoaded ( ESContext *esContext, GLuint texId, void *data )
 {
-   int width,
-       height;
-   char *buffer = esLoadTGA ( fileName, &width, &height );
-   GLuint texId;
+   UserData *userData = data;
 
-   if ( buffer == NULL )
+   (void) esContext;
+   if ( texId == 0 )
    {
-      esLogMessage ( "Error loading (%s) image.\n", fileName );
-      return 0;
+      esLogMessage ( "Error loading (smoke.ktx) image.\n" );
+      return;
    }
 
-   glGenTextures ( 1, &texId );
-   glBindTexture ( GL_TEXTURE_2D, texId );
-
-   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, buffer );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
-   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
-
-   free ( buffer );
-
-   return texId;
+   userData->textureId = texId;
 }
 
 
@@ -85,6 +75,7 @@ int Init ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
    int i;
+   ES_TRACE_ZONE("Init");
    
    GLbyte vShaderStr[] =
       "uniform float u_time;		                           \n"
@@ -162,8 +153,10 @@ int Init ( ESContext *esContext )
    // Initialize time to cause reset on first update
    userData->time = 1.0f;
 
-   userData->textureId = LoadTexture ( "smoke.tga" );
-   if ( userData->textureId <= 0 )
+   // The particles are drawn with the placeholder while the texture streams in
+   userData->textureId = esStreamTexture ( esContext, "smoke.ktx", TextureLoaded, userData );
+   userData->placeholderId = userData->textureId;
+   if ( userData->textureId == 0 )
    {
       return FALSE;
    }
@@ -215,13 +208,13 @@ void Draw ( ESContext *esContext )
    UserData *userData = esContext->userData;
       
    // Set the viewport
-   glViewport ( 0, 0, esContext->width, esContext->height );
+   esStateViewport ( 0, 0, esContext->width, esContext->height );
    
    // Clear the color buffer
    glClear ( GL_COLOR_BUFFER_BIT );
 
    // Use the program object
-   glUseProgram ( userData->programObject );
+   esStateUseProgram ( userData->programObject );
 
    // Load the vertex attributes
    glVertexAttribPointer ( userData->lifetimeLoc, 1, GL_FLOAT, 
@@ -237,17 +230,16 @@ void Draw ( ESContext *esContext )
                            &userData->particleData[4] );
 
    
-   glEnableVertexAttribArray ( userData->lifetimeLoc );
-   glEnableVertexAttribArray ( userData->endPositionLoc );
-   glEnableVertexAttribArray ( userData->startPositionLoc );
+   esStateEnableVertexAttribArray ( userData->lifetimeLoc );
+   esStateEnableVertexAttribArray ( userData->endPositionLoc );
+   esStateEnableVertexAttribArray ( userData->startPositionLoc );
    // Blend particles
-   glEnable ( GL_BLEND );
-   glBlendFunc ( GL_SRC_ALPHA, GL_ONE );
+   esStateEnable ( GL_BLEND );
+   esStateBlendFunc ( GL_SRC_ALPHA, GL_ONE );
 
    // Bind the texture
-   glActiveTexture ( GL_TEXTURE0 );
-   glBindTexture ( GL_TEXTURE_2D, userData->textureId );
-   glEnable ( GL_TEXTURE_2D );
+   esStateActiveTexture ( GL_TEXTURE0 );
+   esStateBindTexture ( GL_TEXTURE_2D, userData->textureId );
 
    // Set the sampler texture unit to 0
    glUniform1i ( userData->samplerLoc, 0 );
@@ -264,8 +256,9 @@ void ShutDown ( ESContext *esContext )
 {
    UserData *userData = esContext->userData;
 
-   // Delete texture object
-   glDeleteTextures ( 1, &userData->textureId );
+   // Delete texture object, the placeholder belongs to the texture stream
+   if ( userData->textureId != userData->placeholderId )
+      glDeleteTextures ( 1, &userData->textureId );
 
    // Delete program object
    glDeleteProgram ( userData->programObject );
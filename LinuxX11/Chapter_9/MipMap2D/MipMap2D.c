@@ -37,71 +37,6 @@ typedef struct
 } UserData;
 
 
-///
-//  From an RGB8 source image, generate the next level mipmap
-//
-GLboolean GenMipMap2D( GLubyte *src, GLubyte **dst, int srcWidth, int srcHeight, int *dstWidth, int *dstHeight )
-{
-   int x,
-       y;
-   int texelSize = 3;
-
-   *dstWidth = srcWidth / 2;
-   if ( *dstWidth <= 0 )
-      *dstWidth = 1;
-
-   *dstHeight = srcHeight / 2;
-   if ( *dstHeight <= 0 )
-      *dstHeight = 1;
-
-   *dst = malloc ( sizeof(GLubyte) * texelSize * (*dstWidth) * (*dstHeight) );
-   if ( *dst == NULL )
-      return GL_FALSE;
-
-   for ( y = 0; y < *dstHeight; y++ )
-   {
-      for( x = 0; x < *dstWidth; x++ )
-      {
-         int srcIndex[4];
-         float r = 0.0f,
-               g = 0.0f,
-               b = 0.0f;
-         int sample;
-
-         // Compute the offsets for 2x2 grid of pixels in previous
-         // image to perform box filter
-         srcIndex[0] = 
-            (((y * 2) * srcWidth) + (x * 2)) * texelSize;
-         srcIndex[1] = 
-            (((y * 2) * srcWidth) + (x * 2 + 1)) * texelSize; 
-         srcIndex[2] = 
-            ((((y * 2) + 1) * srcWidth) + (x * 2)) * texelSize;
-         srcIndex[3] = 
-            ((((y * 2) + 1) * srcWidth) + (x * 2 + 1)) * texelSize;
-
-         // Sum all pixels
-         for ( sample = 0; sample < 4; sample++ )
-         {
-            r += src[srcIndex[sample]];
-            g += src[srcIndex[sample] + 1];
-            b += src[srcIndex[sample] + 2];
-         }
-
-         // Average results
-         r /= 4.0;
-         g /= 4.0;
-         b /= 4.0;
-
-         // Store resulting pixels
-         (*dst)[ ( y * (*dstWidth) + x ) * texelSize ] = (GLubyte)( r );
-         (*dst)[ ( y * (*dstWidth) + x ) * texelSize + 1] = (GLubyte)( g );
-         (*dst)[ ( y * (*dstWidth) + x ) * texelSize + 2] = (GLubyte)( b );
-      }
-   }
-
-   return GL_TRUE;
-}
-
 ///
 //  Generate an RGB8 checkerboard image
 //
@@ -150,53 +85,38 @@ GLuint CreateMipMappedTexture2D( )
           height = 256;
    int    level;
    GLubyte *pixels;
-   GLubyte *prevImage;
-   GLubyte *newImage;
+   ESMipChain chain;
       
    pixels = GenCheckImage( width, height, 8 );
    if ( pixels == NULL )
       return 0;
 
+   // Generate the mipmap levels down to 1x1 with a 2x2 box filter
+   if ( !esGenerateMipChain ( pixels, width, height, GL_RGB, 0, &chain ) )
+   {
+      free ( pixels );
+      return 0;
+   }
+
    // Generate a texture object
    glGenTextures ( 1, &textureId );
 
    // Bind the texture object
    glBindTexture ( GL_TEXTURE_2D, textureId );
 
-   // Load mipmap level 0
-   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGB, width, height, 
-                  0, GL_RGB, GL_UNSIGNED_BYTE, pixels );
-   
-   level = 1;
-   prevImage = &pixels[0];
-   
-   while ( width > 1 && height > 1 )
-   {
-      int newWidth,
-          newHeight;
-
-      // Generate the next mipmap level
-      GenMipMap2D( prevImage, &newImage, width, height, 
-                   &newWidth, &newHeight );
+   // The rows of the small levels are not multiples of 4 bytes
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, 1 );
 
-      // Load the mipmap level
-      glTexImage2D( GL_TEXTURE_2D, level, GL_RGB, 
-                    newWidth, newHeight, 0, GL_RGB,
-                    GL_UNSIGNED_BYTE, newImage );
-
-      // Free the previous image
-      free ( prevImage );
-
-      // Set the previous image for the next iteration
-      prevImage = newImage;
-      level++;
-
-      // Half the width and height
-      width = newWidth;
-      height = newHeight;
+   // Load mipmap level 0 and all the levels generated from it
+   for ( level = 0; level < chain.numLevels; level++ )
+   {
+      glTexImage2D ( GL_TEXTURE_2D, level, GL_RGB, 
+                     chain.width[level], chain.height[level], 0, GL_RGB,
+                     GL_UNSIGNED_BYTE, esMipChainLevel ( &chain, level ) );
    }
 
-   free ( newImage );
+   esFreeMipChain ( &chain );
+   free ( pixels );
 
    // Set the filtering mode
    glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST );
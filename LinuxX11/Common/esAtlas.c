@@ -0,0 +1,595 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESAtlas.c
+//
+//    Texture atlas builder.  Small images are packed into square pages of
+//    fixed size so that sprites sharing a page are drawn with one texture
+//    bind and one draw call.  The storage of a page, all of its mip levels
+//    included, is allocated once when the page is created; images are then
+//    placed one at a time with the MaxRects algorithm (best short side fit)
+//    and uploaded with glTexSubImage2D, so nothing already placed moves.
+//
+//    Every image is surrounded by a gutter repeating its edge texels, which
+//    makes linear filtering at its border behave like GL_CLAMP_TO_EDGE.
+//    With mipmaps, the cells holding an image and its gutter are aligned to
+//    2^(mipLevels - 1) texels: down to level mipLevels - 1 each cell then
+//    shrinks to a whole number of texels of its own, and its levels are
+//    box filtered on the CPU from the cell alone.  The smaller levels, which
+//    GL still needs for the page to be complete, are rebuilt from a copy of
+//    the last of those levels kept for each page.
+//
+
+///
+//  Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include "esUtil.h"
+#include <GLES2/gl2ext.h>
+
+///
+// Defines
+//
+
+// Smallest page size accepted
+#define ES_ATLAS_MIN_PAGE_SIZE   16
+
+///
+// Types
+//
+
+// Rectangle of a page, in units of the cell alignment
+typedef struct
+{
+   int x;
+   int y;
+   int width;
+   int height;
+} ESAtlasRect;
+
+typedef struct
+{
+   GLuint         texture;
+
+   // Free rectangles of the page, which may overlap
+   ESAtlasRect   *free;
+   int            numFree;
+   int            maxFree;
+
+   // Copy of level cleanLevels - 1, NULL unless the page has smaller levels
+   unsigned char *tail;
+} ESAtlasPage;
+
+struct _esatlas
+{
+   GLenum         format;
+   int            bytesPerPixel;
+   GLsizei        pageSize;
+   GLint          gutter;
+
+   // Cells are aligned to this many texels, 2^(cleanLevels - 1)
+   GLint          alignment;
+
+   // Levels of a page, and the first ones of them where images do not mix
+   int            numLevels;
+   int            cleanLevels;
+
+   ESAtlasPage   *pages;
+   int            maxPages;
+
+   // Cell and its mip levels being uploaded
+   unsigned char *cell;
+   unsigned char *level;
+
+   ESAtlasStats   stats;
+};
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// BytesPerPixel()
+//
+//    Returns the size of a pixel of an atlas format with GL_UNSIGNED_BYTE
+//    channels, 0 if the format is not supported
+//
+static int BytesPerPixel ( GLenum format )
+{
+   switch ( format )
+   {
+      case GL_RGBA:
+      case GL_BGRA_EXT:
+         return 4;
+      case GL_RGB:
+         return 3;
+      case GL_LUMINANCE_ALPHA:
+         return 2;
+      case GL_LUMINANCE:
+      case GL_ALPHA:
+         return 1;
+   }
+   return 0;
+}
+
+///
+// AddFree()
+//
+static GLboolean AddFree ( ESAtlasPage *page, int x, int y, int width, int height )
+{
+   if ( page->numFree == page->maxFree )
+   {
+      int maxFree = page->maxFree > 0 ? page->maxFree * 2 : 32;
+      ESAtlasRect *free = realloc ( page->free, maxFree * sizeof ( ESAtlasRect ) );
+
+      if ( free == NULL )
+         return GL_FALSE;
+      page->free = free;
+      page->maxFree = maxFree;
+   }
+
+   page->free[page->numFree].x = x;
+   page->free[page->numFree].y = y;
+   page->free[page->numFree].width = width;
+   page->free[page->numFree].height = height;
+   page->numFree++;
+   return GL_TRUE;
+}
+
+///
+// FindPosition()
+//
+//    Finds the free rectangle where a cell leaves the shortest side over,
+//    breaking ties on the longer side.  Returns GL_FALSE if it fits nowhere.
+//
+static GLboolean FindPosition ( const ESAtlasPage *page, int width, int height,
+                                int *x, int *y, int *shortSide, int *longSide )
+{
+   GLboolean found = GL_FALSE;
+   int i;
+
+   for ( i = 0; i < page->numFree; i++ )
+   {
+      const ESAtlasRect *rect = &page->free[i];
+      int overX = rect->width - width;
+      int overY = rect->height - height;
+      int shortOver, longOver;
+
+      if ( overX < 0 || overY < 0 )
+         continue;
+
+      shortOver = overX < overY ? overX : overY;
+      longOver = overX < overY ? overY : overX;
+      if ( !found || shortOver < *shortSide || ( shortOver == *shortSide && longOver < *longSide ) )
+      {
+         *x = rect->x;
+         *y = rect->y;
+         *shortSide = shortOver;
+         *longSide = longOver;
+         found = GL_TRUE;
+      }
+   }
+   return found;
+}
+
+///
+// Contains()
+//
+static GLboolean Contains ( const ESAtlasRect *outer, const ESAtlasRect *inner )
+{
+   return inner->x >= outer->x && inner->y >= outer->y &&
+          inner->x + inner->width <= outer->x + outer->width &&
+          inner->y + inner->height <= outer->y + outer->height;
+}
+
+///
+// PlaceCell()
+//
+//    Takes a cell out of the free rectangles of a page.  Every free rectangle
+//    it overlaps is replaced by the up to four largest rectangles left around
+//    the cell, and rectangles inside others are dropped.
+//
+static GLboolean PlaceCell ( ESAtlasPage *page, int x, int y, int width, int height )
+{
+   int numFree = page->numFree;
+   int i, j;
+
+   for ( i = 0; i < numFree; i++ )
+   {
+      ESAtlasRect rect = page->free[i];
+
+      if ( x >= rect.x + rect.width || x + width <= rect.x ||
+           y >= rect.y + rect.height || y + height <= rect.y )
+         continue;
+
+      if ( ( x > rect.x && !AddFree ( page, rect.x, rect.y, x - rect.x, rect.height ) ) ||
+           ( x + width < rect.x + rect.width &&
+             !AddFree ( page, x + width, rect.y, rect.x + rect.width - x - width, rect.height ) ) ||
+           ( y > rect.y && !AddFree ( page, rect.x, rect.y, rect.width, y - rect.y ) ) ||
+           ( y + height < rect.y + rect.height &&
+             !AddFree ( page, rect.x, y + height, rect.width, rect.y + rect.height - y - height ) ) )
+         return GL_FALSE;
+
+      // Split, dropped below
+      page->free[i].width = 0;
+   }
+
+   for ( i = 0; i < page->numFree; i++ )
+   {
+      for ( j = 0; page->free[i].width > 0 && j < page->numFree; j++ )
+      {
+         // Of two equal rectangles the first one stays
+         if ( j != i && page->free[j].width > 0 && Contains ( &page->free[j], &page->free[i] ) &&
+              ( j < i || !Contains ( &page->free[i], &page->free[j] ) ) )
+            page->free[i].width = 0;
+      }
+   }
+
+   for ( i = 0, j = 0; i < page->numFree; i++ )
+   {
+      if ( page->free[i].width > 0 )
+         page->free[j++] = page->free[i];
+   }
+   page->numFree = j;
+   return GL_TRUE;
+}
+
+///
+// BuildCell()
+//
+//    Copies an image into the middle of a cell and fills the rest of the
+//    cell with its nearest edge texels
+//
+static void BuildCell ( const ESAtlas *atlas, const unsigned char *pixels, int width, int height,
+                        int cellWidth, int cellHeight )
+{
+   int bpp = atlas->bytesPerPixel;
+   int right = cellWidth - atlas->gutter - width;
+   int x, y;
+
+   for ( y = 0; y < cellHeight; y++ )
+   {
+      int row = y < atlas->gutter ? 0 : y - atlas->gutter < height ? y - atlas->gutter : height - 1;
+      const unsigned char *src = pixels + (size_t) row * width * bpp;
+      unsigned char *dst = atlas->cell + (size_t) y * cellWidth * bpp;
+
+      for ( x = 0; x < atlas->gutter; x++ )
+         memcpy ( dst + x * bpp, src, bpp );
+      memcpy ( dst + atlas->gutter * bpp, src, (size_t) width * bpp );
+      for ( x = 0; x < right; x++ )
+         memcpy ( dst + ( atlas->gutter + width + x ) * bpp, src + ( width - 1 ) * bpp, bpp );
+   }
+}
+
+///
+// Downsample()
+//
+//    Box filters an image to half its size, rounding to nearest.  A side of
+//    one texel stays one texel.
+//
+static void Downsample ( const unsigned char *src, int width, int height, int bpp, unsigned char *dst )
+{
+   int dstWidth = width > 1 ? width / 2 : 1;
+   int dstHeight = height > 1 ? height / 2 : 1;
+   int stepX = width > 1 ? bpp : 0;
+   size_t stepY = height > 1 ? (size_t) width * bpp : 0;
+   int x, y, c;
+
+   for ( y = 0; y < dstHeight; y++ )
+   {
+      const unsigned char *row = src + (size_t) y * 2 * width * bpp;
+
+      for ( x = 0; x < dstWidth; x++ )
+      {
+         const unsigned char *p = row + x * 2 * bpp;
+
+         for ( c = 0; c < bpp; c++ )
+            *dst++ = (unsigned char) ( ( p[c] + p[c + stepX] + p[c + stepY] + p[c + stepY + stepX] + 2 ) >> 2 );
+      }
+   }
+}
+
+///
+// CreatePage()
+//
+//    Allocates the texture of a new page with all its levels
+//
+static GLboolean CreatePage ( ESAtlas *atlas )
+{
+   ESAtlasPage *page = &atlas->pages[atlas->stats.numPages];
+   int units = atlas->pageSize / atlas->alignment;
+   GLint binding;
+   int level;
+
+   memset ( page, 0, sizeof ( ESAtlasPage ) );
+   if ( !AddFree ( page, 0, 0, units, units ) )
+      return GL_FALSE;
+
+   // Level cleanLevels - 1 has one texel per alignment unit
+   if ( atlas->cleanLevels < atlas->numLevels )
+   {
+      page->tail = calloc ( (size_t) units * units, atlas->bytesPerPixel );
+      if ( page->tail == NULL )
+      {
+         free ( page->free );
+         return GL_FALSE;
+      }
+   }
+
+   glGetIntegerv ( GL_TEXTURE_BINDING_2D, &binding );
+   glGenTextures ( 1, &page->texture );
+   glBindTexture ( GL_TEXTURE_2D, page->texture );
+   for ( level = 0; level < atlas->numLevels; level++ )
+   {
+      GLsizei size = atlas->pageSize >> level;
+
+      glTexImage2D ( GL_TEXTURE_2D, level, atlas->format, size, size, 0, atlas->format, GL_UNSIGNED_BYTE, NULL );
+   }
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                     atlas->numLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+   glBindTexture ( GL_TEXTURE_2D, binding );
+
+   atlas->stats.numPages++;
+   atlas->stats.pageTexels += (unsigned long) atlas->pageSize * atlas->pageSize;
+   return GL_TRUE;
+}
+
+///
+// UploadCell()
+//
+//    Uploads the cell in atlas->cell to its place in a page and every level
+//    of it down to the last clean one, then rebuilds the smaller levels
+//
+static void UploadCell ( ESAtlas *atlas, ESAtlasPage *page, int x, int y, int cellWidth, int cellHeight )
+{
+   int bpp = atlas->bytesPerPixel;
+   unsigned char *src = atlas->cell, *dst = atlas->level;
+   GLint binding, alignment;
+   int level, row;
+
+   glGetIntegerv ( GL_TEXTURE_BINDING_2D, &binding );
+   glGetIntegerv ( GL_UNPACK_ALIGNMENT, &alignment );
+   glBindTexture ( GL_TEXTURE_2D, page->texture );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, 1 );
+
+   for ( level = 0; ; level++ )
+   {
+      unsigned char *swap;
+
+      glTexSubImage2D ( GL_TEXTURE_2D, level, x, y, cellWidth, cellHeight, atlas->format, GL_UNSIGNED_BYTE, src );
+      atlas->stats.uploadedBytes += (size_t) cellWidth * cellHeight * bpp;
+      if ( level + 1 == atlas->cleanLevels )
+         break;
+
+      Downsample ( src, cellWidth, cellHeight, bpp, dst );
+      x /= 2;
+      y /= 2;
+      cellWidth /= 2;
+      cellHeight /= 2;
+      swap = src;
+      src = dst;
+      dst = swap;
+   }
+
+   if ( page->tail != NULL )
+   {
+      GLsizei size = atlas->pageSize >> level;
+
+      for ( row = 0; row < cellHeight; row++ )
+         memcpy ( page->tail + ( (size_t) ( y + row ) * size + x ) * bpp,
+                  src + (size_t) row * cellWidth * bpp, (size_t) cellWidth * bpp );
+
+      // Levels where images mix are small, a quarter of the tail at most
+      src = page->tail;
+      dst = atlas->level;
+      for ( level++; level < atlas->numLevels; level++ )
+      {
+         Downsample ( src, size, size, bpp, dst );
+         size = size > 1 ? size / 2 : 1;
+         glTexSubImage2D ( GL_TEXTURE_2D, level, 0, 0, size, size, atlas->format, GL_UNSIGNED_BYTE, dst );
+         atlas->stats.uploadedBytes += (size_t) size * size * bpp;
+         src = dst;
+         dst = dst == atlas->level ? atlas->cell : atlas->level;
+      }
+   }
+
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, alignment );
+   glBindTexture ( GL_TEXTURE_2D, binding );
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esAtlasCreate()
+//
+ESAtlas* ESUTIL_API esAtlasCreate ( GLsizei pageSize, GLenum format, GLint padding, GLint mipLevels, int maxPages )
+{
+   ESAtlas *atlas;
+   GLint maxSize;
+   size_t cellBytes;
+
+   glGetIntegerv ( GL_MAX_TEXTURE_SIZE, &maxSize );
+   if ( pageSize < ES_ATLAS_MIN_PAGE_SIZE || pageSize > maxSize || ( pageSize & ( pageSize - 1 ) ) != 0 ||
+        BytesPerPixel ( format ) == 0 || padding < 0 || maxPages < 1 )
+   {
+      esLog ( ES_LOG_ERROR, "esAtlasCreate: unsupported page size %d or format 0x%04x\n", pageSize, format );
+      return NULL;
+   }
+
+   atlas = calloc ( 1, sizeof ( ESAtlas ) );
+   if ( atlas == NULL )
+      return NULL;
+
+   atlas->format = format;
+   atlas->bytesPerPixel = BytesPerPixel ( format );
+   atlas->pageSize = pageSize;
+   atlas->maxPages = maxPages;
+
+   atlas->numLevels = 1;
+   if ( mipLevels > 1 )
+   {
+      while ( ( pageSize >> atlas->numLevels ) > 0 )
+         atlas->numLevels++;
+   }
+   atlas->cleanLevels = mipLevels < 1 ? 1 : mipLevels < atlas->numLevels ? mipLevels : atlas->numLevels;
+   atlas->alignment = 1 << ( atlas->cleanLevels - 1 );
+
+   // The last clean level needs a gutter texel of its own for linear filtering
+   atlas->gutter = padding;
+   if ( atlas->cleanLevels > 1 && atlas->gutter < atlas->alignment )
+      atlas->gutter = atlas->alignment;
+
+   cellBytes = (size_t) pageSize * pageSize * atlas->bytesPerPixel;
+   atlas->pages = calloc ( maxPages, sizeof ( ESAtlasPage ) );
+   atlas->cell = malloc ( cellBytes );
+   atlas->level = malloc ( cellBytes / 4 );
+   if ( atlas->pages == NULL || atlas->cell == NULL || atlas->level == NULL || !CreatePage ( atlas ) )
+   {
+      esAtlasDestroy ( atlas );
+      return NULL;
+   }
+
+   esLog ( ES_LOG_INFO, "esAtlasCreate: %dx%d pages, %d levels (%d clean), %d texel gutter\n",
+           pageSize, pageSize, atlas->numLevels, atlas->cleanLevels, atlas->gutter );
+   return atlas;
+}
+
+///
+//  esAtlasDestroy()
+//
+void ESUTIL_API esAtlasDestroy ( ESAtlas *atlas )
+{
+   int i;
+
+   if ( atlas == NULL )
+      return;
+
+   for ( i = 0; i < atlas->stats.numPages; i++ )
+   {
+      glDeleteTextures ( 1, &atlas->pages[i].texture );
+      free ( atlas->pages[i].free );
+      free ( atlas->pages[i].tail );
+   }
+   esStateInvalidate ( );
+
+   free ( atlas->pages );
+   free ( atlas->cell );
+   free ( atlas->level );
+   free ( atlas );
+}
+
+///
+//  esAtlasAdd()
+//
+GLboolean ESUTIL_API esAtlasAdd ( ESAtlas *atlas, GLsizei width, GLsizei height, GLenum format,
+                                  const void *pixels, ESAtlasRegion *region )
+{
+   int cellWidth = ( width + 2 * atlas->gutter + atlas->alignment - 1 ) & ~( atlas->alignment - 1 );
+   int cellHeight = ( height + 2 * atlas->gutter + atlas->alignment - 1 ) & ~( atlas->alignment - 1 );
+   int best = -1, bestX = 0, bestY = 0, bestShort = 0, bestLong = 0;
+   int i;
+
+   if ( format != atlas->format || width <= 0 || height <= 0 || cellWidth > atlas->pageSize ||
+        cellHeight > atlas->pageSize )
+   {
+      esLog ( ES_LOG_ERROR, "esAtlasAdd: %dx%d image of format 0x%04x does not fit the atlas\n",
+              width, height, format );
+      return GL_FALSE;
+   }
+
+   for ( i = 0; i < atlas->stats.numPages; i++ )
+   {
+      int x = 0, y = 0, shortSide = 0, longSide = 0;
+
+      if ( FindPosition ( &atlas->pages[i], cellWidth / atlas->alignment, cellHeight / atlas->alignment,
+                          &x, &y, &shortSide, &longSide ) &&
+           ( best < 0 || shortSide < bestShort || ( shortSide == bestShort && longSide < bestLong ) ) )
+      {
+         best = i;
+         bestX = x;
+         bestY = y;
+         bestShort = shortSide;
+         bestLong = longSide;
+      }
+   }
+
+   if ( best < 0 )
+   {
+      if ( atlas->stats.numPages == atlas->maxPages )
+      {
+         esLog ( ES_LOG_ERROR, "esAtlasAdd: all %d pages are full\n", atlas->maxPages );
+         return GL_FALSE;
+      }
+      if ( !CreatePage ( atlas ) )
+         return GL_FALSE;
+      best = atlas->stats.numPages - 1;
+      bestX = 0;
+      bestY = 0;
+   }
+
+   if ( !PlaceCell ( &atlas->pages[best], bestX, bestY, cellWidth / atlas->alignment,
+                     cellHeight / atlas->alignment ) )
+      return GL_FALSE;
+
+   BuildCell ( atlas, pixels, width, height, cellWidth, cellHeight );
+   UploadCell ( atlas, &atlas->pages[best], bestX * atlas->alignment, bestY * atlas->alignment,
+                cellWidth, cellHeight );
+
+   region->texture = atlas->pages[best].texture;
+   region->page = best;
+   region->x = bestX * atlas->alignment + atlas->gutter;
+   region->y = bestY * atlas->alignment + atlas->gutter;
+   region->width = width;
+   region->height = height;
+   region->u0 = (GLfloat) region->x / atlas->pageSize;
+   region->v0 = (GLfloat) region->y / atlas->pageSize;
+   region->u1 = (GLfloat) ( region->x + width ) / atlas->pageSize;
+   region->v1 = (GLfloat) ( region->y + height ) / atlas->pageSize;
+
+   atlas->stats.numRegions++;
+   atlas->stats.imageTexels += (unsigned long) width * height;
+   atlas->stats.usedTexels += (unsigned long) cellWidth * cellHeight;
+   return GL_TRUE;
+}
+
+///
+//  esAtlasRemapTexCoords()
+//
+void ESUTIL_API esAtlasRemapTexCoords ( const ESAtlasRegion *region, const GLfloat *texCoords,
+                                        GLfloat *remapped, int count )
+{
+   GLfloat scaleU = region->u1 - region->u0;
+   GLfloat scaleV = region->v1 - region->v0;
+   int i;
+
+   for ( i = 0; i < count; i++ )
+   {
+      remapped[i * 2] = region->u0 + texCoords[i * 2] * scaleU;
+      remapped[i * 2 + 1] = region->v0 + texCoords[i * 2 + 1] * scaleV;
+   }
+}
+
+///
+//  esGetAtlasStats()
+//
+void ESUTIL_API esGetAtlasStats ( ESAtlas *atlas, ESAtlasStats *atlasStats )
+{
+   *atlasStats = atlas->stats;
+}
@@ -0,0 +1,585 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESCapture.c
+//
+//    Frame capture that does not stall the pipeline.  Every frame is copied
+//    into one of latency + 1 slots and read back latency frames later, when
+//    the GPU has long finished with it.  With NV_pixel_buffer_object and
+//    EXT_map_buffer_range the copy is an asynchronous glReadPixels into a
+//    pixel pack buffer that is mapped later; without them the frame is copied
+//    into a texture with glCopyTexSubImage2D and read back through a
+//    framebuffer object.  The pixels then go to a worker thread that writes
+//    them out as TGA files or into a shared memory ring (ESCaptureShmHeader)
+//    for an external encoder.  If the worker falls behind, the render
+//    thread waits for a free job instead of dropping the frame, so that a
+//    capture is always complete; how often and how long it waited is
+//    reported when the capture stops.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <GLES2/gl2ext.h>
+
+///
+// Defines
+//
+
+// Frames of captured pixels queued for the worker
+#define ES_CAPTURE_QUEUE      4
+
+#define ES_MAX_CAPTURE_LATENCY 8
+
+///
+// Types
+//
+typedef struct
+{
+   GLuint         pbo;
+   GLuint         texture;
+   GLuint         fbo;
+   unsigned int   frameNumber;
+   GLboolean      pending;
+} ESCaptureSlot;
+
+typedef struct
+{
+   unsigned char *pixels;
+   unsigned int   frameNumber;
+} ESCaptureJob;
+
+typedef struct _escapture
+{
+   int            mode;
+   char           target[256];
+
+   // File names of ES_CAPTURE_TGA are prefix, the frame number and suffix
+   char           prefix[256];
+   char           suffix[256];
+   int            numberWidth;
+   GLboolean      zeroPad;
+   int            width, height;
+   size_t         frameSize;
+
+   ESCaptureSlot  slots[ES_MAX_CAPTURE_LATENCY + 1];
+   int            numSlots;
+   int            current;
+   unsigned int   frameNumber;
+   GLboolean      usePbo;
+   GLenum         copyFormat;
+
+   PFNGLMAPBUFFERRANGEEXTPROC mapBufferRange;
+   PFNGLUNMAPBUFFEROESPROC    unmapBuffer;
+
+   // Single-producer single-consumer queue of frames for the worker
+   ESCaptureJob   jobs[ES_CAPTURE_QUEUE];
+   atomic_uint    jobHead;
+   atomic_uint    jobTail;
+   sem_t          jobSem;
+   sem_t          freeSem;
+   atomic_int     running;
+   pthread_t      worker;
+
+   // Shared memory output
+   ESCaptureShmHeader *shm;
+   size_t         shmSize;
+
+   unsigned int   captured;
+   unsigned int   dropped;
+
+   // Frames for which the render thread waited for the worker, and for how long
+   unsigned int   stalls;
+   double         stallTime;
+} ESCapture;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// WriteTGA()
+//
+//    Writes RGBA pixels, bottom row first as read back from GL, as a 24-bit
+//    TGA with the default bottom-left origin
+//
+static GLboolean WriteTGA ( const char *fileName, const unsigned char *pixels, int width, int height )
+{
+   unsigned char header[18];
+   unsigned char *row;
+   FILE *file;
+   int x, y;
+
+   file = fopen ( fileName, "wb" );
+   if ( file == NULL )
+      return GL_FALSE;
+
+   memset ( header, 0, sizeof ( header ) );
+   header[2] = 2;   // Uncompressed true-color
+   header[12] = width & 0xFF;
+   header[13] = ( width >> 8 ) & 0xFF;
+   header[14] = height & 0xFF;
+   header[15] = ( height >> 8 ) & 0xFF;
+   header[16] = 24;
+   fwrite ( header, 1, sizeof ( header ), file );
+
+   row = malloc ( width * 3 );
+   for ( y = 0; row != NULL && y < height; y++ )
+   {
+      const unsigned char *src = pixels + (size_t) y * width * 4;
+
+      for ( x = 0; x < width; x++ )
+      {
+         row[x * 3 + 0] = src[x * 4 + 2];
+         row[x * 3 + 1] = src[x * 4 + 1];
+         row[x * 3 + 2] = src[x * 4 + 0];
+      }
+      fwrite ( row, 1, width * 3, file );
+   }
+
+   free ( row );
+   fclose ( file );
+   return row != NULL;
+}
+
+///
+// SplitPattern()
+//
+//    Splits a file name pattern around its one %u or %d, which may carry a
+//    0 flag and a width.  Fails on any other conversion, since the pattern
+//    comes from the environment and is never used as a format string.
+//
+static GLboolean SplitPattern ( ESCapture *capture, const char *pattern )
+{
+   const char *conversion = strchr ( pattern, '%' );
+   const char *p;
+
+   if ( conversion == NULL || (size_t) ( conversion - pattern ) >= sizeof ( capture->prefix ) )
+      return GL_FALSE;
+
+   p = conversion + 1;
+   capture->zeroPad = *p == '0';
+   capture->numberWidth = 0;
+   while ( *p >= '0' && *p <= '9' && capture->numberWidth < 100 )
+      capture->numberWidth = capture->numberWidth * 10 + *p++ - '0';
+   if ( ( *p != 'u' && *p != 'd' ) || strchr ( p, '%' ) != NULL || strlen ( p + 1 ) >= sizeof ( capture->suffix ) )
+      return GL_FALSE;
+
+   memcpy ( capture->prefix, pattern, conversion - pattern );
+   capture->prefix[conversion - pattern] = '\0';
+   strcpy ( capture->suffix, p + 1 );
+   return GL_TRUE;
+}
+
+///
+// WriteFrame()
+//
+//    Runs on the worker thread
+//
+static void WriteFrame ( ESCapture *capture, const ESCaptureJob *job )
+{
+   if ( capture->mode == ES_CAPTURE_SHM )
+   {
+      ESCaptureShmHeader *shm = capture->shm;
+      unsigned long long count = shm->frameCount;
+      unsigned char *slot = (unsigned char *) shm + shm->dataOffset + ( count % shm->numSlots ) * shm->slotSize;
+
+      memcpy ( slot, job->pixels, capture->frameSize );
+      shm->frameNumbers[count % shm->numSlots] = job->frameNumber;
+      __atomic_store_n ( &shm->frameCount, count + 1, __ATOMIC_RELEASE );
+   }
+   else
+   {
+      char fileName[512];
+
+      snprintf ( fileName, sizeof ( fileName ), capture->zeroPad ? "%s%0*u%s" : "%s%*u%s", capture->prefix,
+                 capture->numberWidth, job->frameNumber, capture->suffix );
+      if ( !WriteTGA ( fileName, job->pixels, capture->width, capture->height ) )
+         esLog ( ES_LOG_ERROR, "esCapture: unable to write %s\n", fileName );
+   }
+}
+
+static void *WorkerMain ( void *arg )
+{
+   ESCapture *capture = arg;
+
+   for ( ;; )
+   {
+      unsigned int tail;
+
+      sem_wait ( &capture->jobSem );
+      tail = atomic_load_explicit ( &capture->jobTail, memory_order_relaxed );
+      if ( tail == atomic_load_explicit ( &capture->jobHead, memory_order_acquire ) )
+      {
+         // Woken up with nothing queued, only done to stop the worker
+         if ( !atomic_load ( &capture->running ) )
+            break;
+         continue;
+      }
+
+      WriteFrame ( capture, &capture->jobs[tail % ES_CAPTURE_QUEUE] );
+      atomic_store_explicit ( &capture->jobTail, tail + 1, memory_order_release );
+      sem_post ( &capture->freeSem );
+   }
+   return NULL;
+}
+
+///
+// AcquireJob()
+//
+//    Returns the next free job, waiting for the worker if it is behind
+//
+static ESCaptureJob *AcquireJob ( ESCapture *capture )
+{
+   unsigned int head = atomic_load_explicit ( &capture->jobHead, memory_order_relaxed );
+
+   if ( sem_trywait ( &capture->freeSem ) != 0 )
+   {
+      double start = esGetTime ( );
+
+      while ( sem_wait ( &capture->freeSem ) != 0 )
+         continue;
+      capture->stalls++;
+      capture->stallTime += esGetTime ( ) - start;
+   }
+   return &capture->jobs[head % ES_CAPTURE_QUEUE];
+}
+
+///
+// ReleaseJob()
+//
+//    Gives back a job that could not be filled
+//
+static void ReleaseJob ( ESCapture *capture )
+{
+   capture->dropped++;
+   sem_post ( &capture->freeSem );
+}
+
+static void SubmitJob ( ESCapture *capture )
+{
+   atomic_fetch_add_explicit ( &capture->jobHead, 1, memory_order_release );
+   sem_post ( &capture->jobSem );
+}
+
+///
+// ReadBack()
+//
+//    Reads back a slot captured latency frames ago and queues it
+//
+static void ReadBack ( ESCapture *capture, ESCaptureSlot *slot )
+{
+   ESCaptureJob *job;
+
+   if ( !slot->pending )
+      return;
+   slot->pending = GL_FALSE;
+
+   job = AcquireJob ( capture );
+   job->frameNumber = slot->frameNumber;
+
+   if ( capture->usePbo )
+   {
+      void *data;
+
+      glBindBuffer ( GL_PIXEL_PACK_BUFFER_NV, slot->pbo );
+      data = capture->mapBufferRange ( GL_PIXEL_PACK_BUFFER_NV, 0, capture->frameSize, GL_MAP_READ_BIT_EXT );
+      if ( data == NULL )
+      {
+         glBindBuffer ( GL_PIXEL_PACK_BUFFER_NV, 0 );
+         ReleaseJob ( capture );
+         return;
+      }
+      memcpy ( job->pixels, data, capture->frameSize );
+      capture->unmapBuffer ( GL_PIXEL_PACK_BUFFER_NV );
+      glBindBuffer ( GL_PIXEL_PACK_BUFFER_NV, 0 );
+   }
+   else
+   {
+      GLint framebuffer;
+
+      glGetIntegerv ( GL_FRAMEBUFFER_BINDING, &framebuffer );
+      glBindFramebuffer ( GL_FRAMEBUFFER, slot->fbo );
+      glReadPixels ( 0, 0, capture->width, capture->height, GL_RGBA, GL_UNSIGNED_BYTE, job->pixels );
+      glBindFramebuffer ( GL_FRAMEBUFFER, framebuffer );
+   }
+
+   capture->captured++;
+   SubmitJob ( capture );
+}
+
+///
+// CreateShm()
+//
+static GLboolean CreateShm ( ESCapture *capture, int numSlots )
+{
+   size_t dataOffset = ( sizeof ( ESCaptureShmHeader ) + 4095 ) & ~(size_t) 4095;
+   int fd;
+
+   capture->shmSize = dataOffset + capture->frameSize * numSlots;
+
+   fd = shm_open ( capture->target, O_CREAT | O_RDWR | O_TRUNC, 0600 );
+   if ( fd < 0 )
+      return GL_FALSE;
+   if ( ftruncate ( fd, capture->shmSize ) != 0 )
+   {
+      close ( fd );
+      return GL_FALSE;
+   }
+
+   capture->shm = mmap ( NULL, capture->shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+   close ( fd );
+   if ( capture->shm == MAP_FAILED )
+   {
+      capture->shm = NULL;
+      return GL_FALSE;
+   }
+
+   capture->shm->magic = ES_CAPTURE_SHM_MAGIC;
+   capture->shm->width = capture->width;
+   capture->shm->height = capture->height;
+   capture->shm->numSlots = numSlots;
+   capture->shm->slotSize = (unsigned int) capture->frameSize;
+   capture->shm->dataOffset = (unsigned int) dataOffset;
+   capture->shm->frameCount = 0;
+   return GL_TRUE;
+}
+
+///
+// DestroyCapture()
+//
+static void DestroyCapture ( ESCapture *capture )
+{
+   int i;
+
+   for ( i = 0; i < capture->numSlots; i++ )
+   {
+      glDeleteBuffers ( 1, &capture->slots[i].pbo );
+      glDeleteTextures ( 1, &capture->slots[i].texture );
+      glDeleteFramebuffers ( 1, &capture->slots[i].fbo );
+   }
+   for ( i = 0; i < ES_CAPTURE_QUEUE; i++ )
+      free ( capture->jobs[i].pixels );
+   if ( capture->shm != NULL )
+      munmap ( capture->shm, capture->shmSize );
+   free ( capture );
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esCaptureStart()
+//
+GLboolean ESUTIL_API esCaptureStart ( ESContext *esContext, int mode, const char *target, int latency )
+{
+   const char *extensions = (const char *) glGetString ( GL_EXTENSIONS );
+   ESCapture *capture;
+   GLint framebuffer, texture, alphaBits;
+   int i;
+
+   if ( esContext->capture != NULL || target == NULL )
+      return GL_FALSE;
+   if ( latency < 1 )
+      latency = 1;
+   if ( latency > ES_MAX_CAPTURE_LATENCY )
+      latency = ES_MAX_CAPTURE_LATENCY;
+
+   capture = calloc ( 1, sizeof ( ESCapture ) );
+   if ( capture == NULL )
+      return GL_FALSE;
+
+   capture->mode = mode;
+   snprintf ( capture->target, sizeof ( capture->target ), "%s", target );
+   if ( mode == ES_CAPTURE_TGA && !SplitPattern ( capture, target ) )
+   {
+      esLog ( ES_LOG_ERROR, "esCaptureStart: %s needs exactly one %%u for the frame number\n", target );
+      free ( capture );
+      return GL_FALSE;
+   }
+   capture->width = esContext->width;
+   capture->height = esContext->height;
+   capture->frameSize = (size_t) capture->width * capture->height * 4;
+   capture->numSlots = latency + 1;
+
+   for ( i = 0; i < ES_CAPTURE_QUEUE; i++ )
+   {
+      capture->jobs[i].pixels = malloc ( capture->frameSize );
+      if ( capture->jobs[i].pixels == NULL )
+      {
+         DestroyCapture ( capture );
+         return GL_FALSE;
+      }
+   }
+
+   if ( mode == ES_CAPTURE_SHM && !CreateShm ( capture, capture->numSlots + ES_CAPTURE_QUEUE ) )
+   {
+      esLog ( ES_LOG_ERROR, "esCaptureStart: unable to create shared memory %s\n", target );
+      DestroyCapture ( capture );
+      return GL_FALSE;
+   }
+
+   if ( extensions != NULL && strstr ( extensions, "GL_NV_pixel_buffer_object" ) != NULL &&
+        strstr ( extensions, "GL_EXT_map_buffer_range" ) != NULL )
+   {
+      capture->mapBufferRange = (PFNGLMAPBUFFERRANGEEXTPROC) eglGetProcAddress ( "glMapBufferRangeEXT" );
+      capture->unmapBuffer = (PFNGLUNMAPBUFFEROESPROC) eglGetProcAddress ( "glUnmapBufferOES" );
+      capture->usePbo = capture->mapBufferRange != NULL && capture->unmapBuffer != NULL;
+   }
+
+   if ( capture->usePbo )
+   {
+      for ( i = 0; i < capture->numSlots; i++ )
+      {
+         glGenBuffers ( 1, &capture->slots[i].pbo );
+         glBindBuffer ( GL_PIXEL_PACK_BUFFER_NV, capture->slots[i].pbo );
+         glBufferData ( GL_PIXEL_PACK_BUFFER_NV, capture->frameSize, NULL, GL_STREAM_DRAW );
+      }
+      glBindBuffer ( GL_PIXEL_PACK_BUFFER_NV, 0 );
+   }
+   else
+   {
+      // glCopyTexSubImage2D cannot add an alpha channel the framebuffer does not have
+      glGetIntegerv ( GL_ALPHA_BITS, &alphaBits );
+      capture->copyFormat = alphaBits > 0 ? GL_RGBA : GL_RGB;
+
+      glGetIntegerv ( GL_FRAMEBUFFER_BINDING, &framebuffer );
+      glGetIntegerv ( GL_TEXTURE_BINDING_2D, &texture );
+      for ( i = 0; i < capture->numSlots; i++ )
+      {
+         ESCaptureSlot *slot = &capture->slots[i];
+
+         glGenTextures ( 1, &slot->texture );
+         glBindTexture ( GL_TEXTURE_2D, slot->texture );
+         glTexImage2D ( GL_TEXTURE_2D, 0, capture->copyFormat, capture->width, capture->height, 0,
+                        capture->copyFormat, GL_UNSIGNED_BYTE, NULL );
+         glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+         glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+
+         glGenFramebuffers ( 1, &slot->fbo );
+         glBindFramebuffer ( GL_FRAMEBUFFER, slot->fbo );
+         glFramebufferTexture2D ( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, slot->texture, 0 );
+         if ( glCheckFramebufferStatus ( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+         {
+            glBindFramebuffer ( GL_FRAMEBUFFER, framebuffer );
+            glBindTexture ( GL_TEXTURE_2D, texture );
+            esLog ( ES_LOG_ERROR, "esCaptureStart: capture framebuffer incomplete\n" );
+            DestroyCapture ( capture );
+            return GL_FALSE;
+         }
+      }
+      glBindFramebuffer ( GL_FRAMEBUFFER, framebuffer );
+      glBindTexture ( GL_TEXTURE_2D, texture );
+   }
+
+   sem_init ( &capture->jobSem, 0, 0 );
+   sem_init ( &capture->freeSem, 0, ES_CAPTURE_QUEUE );
+   atomic_store ( &capture->running, 1 );
+   if ( pthread_create ( &capture->worker, NULL, WorkerMain, capture ) != 0 )
+   {
+      sem_destroy ( &capture->jobSem );
+      sem_destroy ( &capture->freeSem );
+      DestroyCapture ( capture );
+      return GL_FALSE;
+   }
+
+   esLog ( ES_LOG_INFO, "esCapture: capturing %dx%d to %s, read back %d frame(s) late through %s\n",
+           capture->width, capture->height, target, latency,
+           capture->usePbo ? "pixel buffer objects" : "texture copies" );
+
+   esContext->capture = capture;
+   return GL_TRUE;
+}
+
+///
+//  esCaptureFrame()
+//
+void ESUTIL_API esCaptureFrame ( ESContext *esContext )
+{
+   ESCapture *capture = esContext->capture;
+   ESCaptureSlot *slot;
+
+   if ( capture == NULL )
+      return;
+
+   // The slot about to be reused holds the oldest frame in flight
+   slot = &capture->slots[capture->current];
+   ReadBack ( capture, slot );
+
+   if ( capture->usePbo )
+   {
+      glBindBuffer ( GL_PIXEL_PACK_BUFFER_NV, slot->pbo );
+      glReadPixels ( 0, 0, capture->width, capture->height, GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+      glBindBuffer ( GL_PIXEL_PACK_BUFFER_NV, 0 );
+   }
+   else
+   {
+      GLint texture;
+
+      glGetIntegerv ( GL_TEXTURE_BINDING_2D, &texture );
+      glBindTexture ( GL_TEXTURE_2D, slot->texture );
+      glCopyTexSubImage2D ( GL_TEXTURE_2D, 0, 0, 0, 0, 0, capture->width, capture->height );
+      glBindTexture ( GL_TEXTURE_2D, texture );
+   }
+
+   slot->frameNumber = capture->frameNumber++;
+   slot->pending = GL_TRUE;
+   capture->current = ( capture->current + 1 ) % capture->numSlots;
+}
+
+///
+//  esCaptureStop()
+//
+void ESUTIL_API esCaptureStop ( ESContext *esContext )
+{
+   ESCapture *capture = esContext->capture;
+   int i;
+
+   if ( capture == NULL )
+      return;
+
+   // Read back the frames still in flight, oldest first
+   for ( i = 0; i < capture->numSlots; i++ )
+   {
+      ReadBack ( capture, &capture->slots[capture->current] );
+      capture->current = ( capture->current + 1 ) % capture->numSlots;
+   }
+
+   // The worker drains the queue before it sees the stop request
+   atomic_store ( &capture->running, 0 );
+   sem_post ( &capture->jobSem );
+   pthread_join ( capture->worker, NULL );
+   sem_destroy ( &capture->jobSem );
+   sem_destroy ( &capture->freeSem );
+
+   esLog ( ES_LOG_INFO, "esCapture: %u frame(s) captured, waited %.1f ms for the writer in %u of them\n",
+           capture->captured, capture->stallTime * 1000.0, capture->stalls );
+   if ( capture->dropped != 0 )
+      esLog ( ES_LOG_WARNING, "esCapture: %u frame(s) dropped, the pixel buffer could not be mapped\n",
+              capture->dropped );
+
+   DestroyCapture ( capture );
+   esContext->capture = NULL;
+}
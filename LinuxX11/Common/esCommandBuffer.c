@@ -0,0 +1,490 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESCommandBuffer.c
+//
+//    Recorded GL command buffers.  Recording makes no GL calls, so any thread
+//    can fill in its own buffer; the thread that owns the EGL context then
+//    replays the buffers in order.  State commands are replayed through the
+//    esState* cache, which keeps it in step with GL and drops the state that
+//    consecutive buffers set to the same value.
+//
+//    Every command is a 32-bit header word (opcode in the low 8 bits, total
+//    length in words in the upper 24) followed by its arguments as 32-bit
+//    words.  Pointers take two words.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+///
+// Defines
+//
+#define CMD_HEADER(op, words)   ( (uint32_t) (op) | ( (uint32_t) (words) << 8 ) )
+#define CMD_OPCODE(header)      ( (header) & 0xFF )
+#define CMD_WORDS(header)       ( (header) >> 8 )
+
+enum
+{
+   CMD_USE_PROGRAM = 1,
+   CMD_BIND_TEXTURE,
+   CMD_BIND_BUFFER,
+   CMD_ENABLE,
+   CMD_DISABLE,
+   CMD_BLEND_FUNC,
+   CMD_DEPTH_FUNC,
+   CMD_DEPTH_MASK,
+   CMD_STENCIL_FUNC,
+   CMD_STENCIL_OP,
+   CMD_STENCIL_MASK,
+   CMD_VIEWPORT,
+   CMD_CLEAR_COLOR,
+   CMD_CLEAR,
+   CMD_UNIFORM_1I,
+   CMD_UNIFORM_1F,
+   CMD_UNIFORM_FV,
+   CMD_UNIFORM_MATRIX_4FV,
+   CMD_VERTEX_ATTRIB_POINTER,
+   CMD_ENABLE_VERTEX_ATTRIB_ARRAY,
+   CMD_DISABLE_VERTEX_ATTRIB_ARRAY,
+   CMD_DRAW_ARRAYS,
+   CMD_DRAW_ELEMENTS
+};
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// Reserve()
+//
+//    Makes room for a command of the given number of words and writes its
+//    header.  Returns a pointer to the argument words, or NULL if the buffer
+//    could not grow (the command is then dropped and the buffer flagged).
+//
+static uint32_t *Reserve ( ESCommandBuffer *cmdBuffer, int op, size_t words )
+{
+   uint32_t *cmd;
+   size_t needed = cmdBuffer->size + ( 1 + words ) * sizeof ( uint32_t );
+
+   if ( needed > cmdBuffer->capacity )
+   {
+      size_t capacity = cmdBuffer->capacity ? cmdBuffer->capacity * 2 : 4096;
+      unsigned char *data;
+
+      while ( capacity < needed )
+         capacity *= 2;
+
+      data = realloc ( cmdBuffer->data, capacity );
+      if ( data == NULL )
+      {
+         cmdBuffer->overflow = GL_TRUE;
+         return NULL;
+      }
+      cmdBuffer->data = data;
+      cmdBuffer->capacity = capacity;
+   }
+
+   cmd = (uint32_t *) ( cmdBuffer->data + cmdBuffer->size );
+   cmd[0] = CMD_HEADER ( op, 1 + words );
+   cmdBuffer->size = needed;
+   cmdBuffer->numCommands++;
+   return cmd + 1;
+}
+
+static void Record1 ( ESCommandBuffer *cmdBuffer, int op, uint32_t a )
+{
+   uint32_t *args = Reserve ( cmdBuffer, op, 1 );
+   if ( args != NULL )
+      args[0] = a;
+}
+
+static void Record2 ( ESCommandBuffer *cmdBuffer, int op, uint32_t a, uint32_t b )
+{
+   uint32_t *args = Reserve ( cmdBuffer, op, 2 );
+   if ( args != NULL )
+   {
+      args[0] = a;
+      args[1] = b;
+   }
+}
+
+static void Record3 ( ESCommandBuffer *cmdBuffer, int op, uint32_t a, uint32_t b, uint32_t c )
+{
+   uint32_t *args = Reserve ( cmdBuffer, op, 3 );
+   if ( args != NULL )
+   {
+      args[0] = a;
+      args[1] = b;
+      args[2] = c;
+   }
+}
+
+static void Record4 ( ESCommandBuffer *cmdBuffer, int op, uint32_t a, uint32_t b, uint32_t c, uint32_t d )
+{
+   uint32_t *args = Reserve ( cmdBuffer, op, 4 );
+   if ( args != NULL )
+   {
+      args[0] = a;
+      args[1] = b;
+      args[2] = c;
+      args[3] = d;
+   }
+}
+
+static uint32_t FloatBits ( GLfloat f )
+{
+   uint32_t bits;
+   memcpy ( &bits, &f, sizeof ( bits ) );
+   return bits;
+}
+
+static GLfloat BitsFloat ( uint32_t bits )
+{
+   GLfloat f;
+   memcpy ( &f, &bits, sizeof ( f ) );
+   return f;
+}
+
+static void StorePointer ( uint32_t *args, const void *ptr )
+{
+   uint64_t value = (uint64_t) (uintptr_t) ptr;
+   args[0] = (uint32_t) value;
+   args[1] = (uint32_t) ( value >> 32 );
+}
+
+static const void *LoadPointer ( const uint32_t *args )
+{
+   uint64_t value = (uint64_t) args[0] | ( (uint64_t) args[1] << 32 );
+   return (const void *) (uintptr_t) value;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esCmdBufferInit()
+//
+void ESUTIL_API esCmdBufferInit ( ESCommandBuffer *cmdBuffer, size_t initialCapacity )
+{
+   memset ( cmdBuffer, 0, sizeof ( ESCommandBuffer ) );
+   if ( initialCapacity > 0 )
+   {
+      cmdBuffer->data = malloc ( initialCapacity );
+      if ( cmdBuffer->data != NULL )
+         cmdBuffer->capacity = initialCapacity;
+   }
+}
+
+///
+//  esCmdBufferReset()
+//
+void ESUTIL_API esCmdBufferReset ( ESCommandBuffer *cmdBuffer )
+{
+   cmdBuffer->size = 0;
+   cmdBuffer->numCommands = 0;
+   cmdBuffer->overflow = GL_FALSE;
+}
+
+///
+//  esCmdBufferFree()
+//
+void ESUTIL_API esCmdBufferFree ( ESCommandBuffer *cmdBuffer )
+{
+   free ( cmdBuffer->data );
+   memset ( cmdBuffer, 0, sizeof ( ESCommandBuffer ) );
+}
+
+void ESUTIL_API esCmdUseProgram ( ESCommandBuffer *cmdBuffer, GLuint program )
+{
+   Record1 ( cmdBuffer, CMD_USE_PROGRAM, program );
+}
+
+void ESUTIL_API esCmdBindTexture ( ESCommandBuffer *cmdBuffer, GLenum unit, GLenum target, GLuint texture )
+{
+   Record3 ( cmdBuffer, CMD_BIND_TEXTURE, unit, target, texture );
+}
+
+void ESUTIL_API esCmdBindBuffer ( ESCommandBuffer *cmdBuffer, GLenum target, GLuint buffer )
+{
+   Record2 ( cmdBuffer, CMD_BIND_BUFFER, target, buffer );
+}
+
+void ESUTIL_API esCmdEnable ( ESCommandBuffer *cmdBuffer, GLenum cap )
+{
+   Record1 ( cmdBuffer, CMD_ENABLE, cap );
+}
+
+void ESUTIL_API esCmdDisable ( ESCommandBuffer *cmdBuffer, GLenum cap )
+{
+   Record1 ( cmdBuffer, CMD_DISABLE, cap );
+}
+
+void ESUTIL_API esCmdBlendFunc ( ESCommandBuffer *cmdBuffer, GLenum sfactor, GLenum dfactor )
+{
+   Record2 ( cmdBuffer, CMD_BLEND_FUNC, sfactor, dfactor );
+}
+
+void ESUTIL_API esCmdDepthFunc ( ESCommandBuffer *cmdBuffer, GLenum func )
+{
+   Record1 ( cmdBuffer, CMD_DEPTH_FUNC, func );
+}
+
+void ESUTIL_API esCmdDepthMask ( ESCommandBuffer *cmdBuffer, GLboolean flag )
+{
+   Record1 ( cmdBuffer, CMD_DEPTH_MASK, flag );
+}
+
+void ESUTIL_API esCmdStencilFunc ( ESCommandBuffer *cmdBuffer, GLenum func, GLint ref, GLuint mask )
+{
+   Record3 ( cmdBuffer, CMD_STENCIL_FUNC, func, (uint32_t) ref, mask );
+}
+
+void ESUTIL_API esCmdStencilOp ( ESCommandBuffer *cmdBuffer, GLenum fail, GLenum zfail, GLenum zpass )
+{
+   Record3 ( cmdBuffer, CMD_STENCIL_OP, fail, zfail, zpass );
+}
+
+void ESUTIL_API esCmdStencilMask ( ESCommandBuffer *cmdBuffer, GLuint mask )
+{
+   Record1 ( cmdBuffer, CMD_STENCIL_MASK, mask );
+}
+
+void ESUTIL_API esCmdViewport ( ESCommandBuffer *cmdBuffer, GLint x, GLint y, GLsizei width, GLsizei height )
+{
+   Record4 ( cmdBuffer, CMD_VIEWPORT, (uint32_t) x, (uint32_t) y, (uint32_t) width, (uint32_t) height );
+}
+
+void ESUTIL_API esCmdClearColor ( ESCommandBuffer *cmdBuffer, GLfloat r, GLfloat g, GLfloat b, GLfloat a )
+{
+   Record4 ( cmdBuffer, CMD_CLEAR_COLOR, FloatBits ( r ), FloatBits ( g ), FloatBits ( b ), FloatBits ( a ) );
+}
+
+void ESUTIL_API esCmdClear ( ESCommandBuffer *cmdBuffer, GLbitfield mask )
+{
+   Record1 ( cmdBuffer, CMD_CLEAR, mask );
+}
+
+void ESUTIL_API esCmdUniform1i ( ESCommandBuffer *cmdBuffer, GLint location, GLint x )
+{
+   Record2 ( cmdBuffer, CMD_UNIFORM_1I, (uint32_t) location, (uint32_t) x );
+}
+
+void ESUTIL_API esCmdUniform1f ( ESCommandBuffer *cmdBuffer, GLint location, GLfloat x )
+{
+   Record2 ( cmdBuffer, CMD_UNIFORM_1F, (uint32_t) location, FloatBits ( x ) );
+}
+
+///
+//  esCmdUniformfv()
+//
+//    The values are copied into the buffer, so v may be reused right away
+//
+void ESUTIL_API esCmdUniformfv ( ESCommandBuffer *cmdBuffer, GLint location, GLint components,
+                                 GLsizei count, const GLfloat *v )
+{
+   size_t numFloats = (size_t) components * count;
+   uint32_t *args = Reserve ( cmdBuffer, CMD_UNIFORM_FV, 3 + numFloats );
+
+   if ( args != NULL )
+   {
+      args[0] = (uint32_t) location;
+      args[1] = (uint32_t) components;
+      args[2] = (uint32_t) count;
+      memcpy ( &args[3], v, numFloats * sizeof ( GLfloat ) );
+   }
+}
+
+void ESUTIL_API esCmdUniformMatrix4fv ( ESCommandBuffer *cmdBuffer, GLint location, GLsizei count, const GLfloat *value )
+{
+   size_t numFloats = (size_t) 16 * count;
+   uint32_t *args = Reserve ( cmdBuffer, CMD_UNIFORM_MATRIX_4FV, 2 + numFloats );
+
+   if ( args != NULL )
+   {
+      args[0] = (uint32_t) location;
+      args[1] = (uint32_t) count;
+      memcpy ( &args[2], value, numFloats * sizeof ( GLfloat ) );
+   }
+}
+
+///
+//  esCmdVertexAttribPointer()
+//
+//    ptr is recorded as is: either an offset into the buffer bound at replay
+//    time, or client memory that must stay valid until the buffer is replayed
+//
+void ESUTIL_API esCmdVertexAttribPointer ( ESCommandBuffer *cmdBuffer, GLuint index, GLint size, GLenum type,
+                                           GLboolean normalized, GLsizei stride, const void *ptr )
+{
+   uint32_t *args = Reserve ( cmdBuffer, CMD_VERTEX_ATTRIB_POINTER, 7 );
+
+   if ( args != NULL )
+   {
+      args[0] = index;
+      args[1] = (uint32_t) size;
+      args[2] = type;
+      args[3] = normalized;
+      args[4] = (uint32_t) stride;
+      StorePointer ( &args[5], ptr );
+   }
+}
+
+void ESUTIL_API esCmdEnableVertexAttribArray ( ESCommandBuffer *cmdBuffer, GLuint index )
+{
+   Record1 ( cmdBuffer, CMD_ENABLE_VERTEX_ATTRIB_ARRAY, index );
+}
+
+void ESUTIL_API esCmdDisableVertexAttribArray ( ESCommandBuffer *cmdBuffer, GLuint index )
+{
+   Record1 ( cmdBuffer, CMD_DISABLE_VERTEX_ATTRIB_ARRAY, index );
+}
+
+void ESUTIL_API esCmdDrawArrays ( ESCommandBuffer *cmdBuffer, GLenum mode, GLint first, GLsizei count )
+{
+   Record3 ( cmdBuffer, CMD_DRAW_ARRAYS, mode, (uint32_t) first, (uint32_t) count );
+}
+
+void ESUTIL_API esCmdDrawElements ( ESCommandBuffer *cmdBuffer, GLenum mode, GLsizei count, GLenum type,
+                                    const void *indices )
+{
+   uint32_t *args = Reserve ( cmdBuffer, CMD_DRAW_ELEMENTS, 5 );
+
+   if ( args != NULL )
+   {
+      args[0] = mode;
+      args[1] = (uint32_t) count;
+      args[2] = type;
+      StorePointer ( &args[3], indices );
+   }
+}
+
+///
+//  esCmdBufferReplay()
+//
+//    Must be called on the thread that owns the GL context
+//
+void ESUTIL_API esCmdBufferReplay ( const ESCommandBuffer *cmdBuffer )
+{
+   const uint32_t *cmd = (const uint32_t *) cmdBuffer->data;
+   const uint32_t *end = (const uint32_t *) ( cmdBuffer->data + cmdBuffer->size );
+
+   while ( cmd < end )
+   {
+      const uint32_t *args = cmd + 1;
+
+      switch ( CMD_OPCODE ( cmd[0] ) )
+      {
+         case CMD_USE_PROGRAM:
+            esStateUseProgram ( args[0] );
+            break;
+         case CMD_BIND_TEXTURE:
+            esStateActiveTexture ( args[0] );
+            esStateBindTexture ( args[1], args[2] );
+            break;
+         case CMD_BIND_BUFFER:
+            esStateBindBuffer ( args[0], args[1] );
+            break;
+         case CMD_ENABLE:
+            esStateEnable ( args[0] );
+            break;
+         case CMD_DISABLE:
+            esStateDisable ( args[0] );
+            break;
+         case CMD_BLEND_FUNC:
+            esStateBlendFunc ( args[0], args[1] );
+            break;
+         case CMD_DEPTH_FUNC:
+            esStateDepthFunc ( args[0] );
+            break;
+         case CMD_DEPTH_MASK:
+            esStateDepthMask ( (GLboolean) args[0] );
+            break;
+         case CMD_STENCIL_FUNC:
+            esStateStencilFunc ( args[0], (GLint) args[1], args[2] );
+            break;
+         case CMD_STENCIL_OP:
+            esStateStencilOp ( args[0], args[1], args[2] );
+            break;
+         case CMD_STENCIL_MASK:
+            esStateStencilMask ( args[0] );
+            break;
+         case CMD_VIEWPORT:
+            esStateViewport ( (GLint) args[0], (GLint) args[1], (GLsizei) args[2], (GLsizei) args[3] );
+            break;
+         case CMD_CLEAR_COLOR:
+            glClearColor ( BitsFloat ( args[0] ), BitsFloat ( args[1] ), BitsFloat ( args[2] ), BitsFloat ( args[3] ) );
+            break;
+         case CMD_CLEAR:
+            glClear ( args[0] );
+            break;
+         case CMD_UNIFORM_1I:
+            glUniform1i ( (GLint) args[0], (GLint) args[1] );
+            break;
+         case CMD_UNIFORM_1F:
+            glUniform1f ( (GLint) args[0], BitsFloat ( args[1] ) );
+            break;
+         case CMD_UNIFORM_FV:
+         {
+            const GLfloat *v = (const GLfloat *) &args[3];
+            switch ( args[1] )
+            {
+               case 1: glUniform1fv ( (GLint) args[0], (GLsizei) args[2], v ); break;
+               case 2: glUniform2fv ( (GLint) args[0], (GLsizei) args[2], v ); break;
+               case 3: glUniform3fv ( (GLint) args[0], (GLsizei) args[2], v ); break;
+               case 4: glUniform4fv ( (GLint) args[0], (GLsizei) args[2], v ); break;
+            }
+            break;
+         }
+         case CMD_UNIFORM_MATRIX_4FV:
+            glUniformMatrix4fv ( (GLint) args[0], (GLsizei) args[1], GL_FALSE, (const GLfloat *) &args[2] );
+            break;
+         case CMD_VERTEX_ATTRIB_POINTER:
+            glVertexAttribPointer ( args[0], (GLint) args[1], args[2], (GLboolean) args[3],
+                                    (GLsizei) args[4], LoadPointer ( &args[5] ) );
+            break;
+         case CMD_ENABLE_VERTEX_ATTRIB_ARRAY:
+            esStateEnableVertexAttribArray ( args[0] );
+            break;
+         case CMD_DISABLE_VERTEX_ATTRIB_ARRAY:
+            esStateDisableVertexAttribArray ( args[0] );
+            break;
+         case CMD_DRAW_ARRAYS:
+            glDrawArrays ( args[0], (GLint) args[1], (GLsizei) args[2] );
+            break;
+         case CMD_DRAW_ELEMENTS:
+            glDrawElements ( args[0], (GLsizei) args[1], args[2], LoadPointer ( &args[3] ) );
+            break;
+      }
+
+      cmd += CMD_WORDS ( cmd[0] );
+   }
+}
+
+///
+//  esCmdBufferReplayList()
+//
+void ESUTIL_API esCmdBufferReplayList ( ESCommandBuffer * const *cmdBuffers, int numBuffers )
+{
+   int i;
+
+   for ( i = 0; i < numBuffers; i++ )
+      esCmdBufferReplay ( cmdBuffers[i] );
+}
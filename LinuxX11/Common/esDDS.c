@@ -0,0 +1,757 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESDDS.c
+//
+//    Loads DirectDraw Surface (DDS) textures: DXT1, DXT3 and DXT5 blocks,
+//    uncompressed RGB, luminance and alpha formats, mip chains, cube maps
+//    and volumes.  The file is mapped and every image goes to GL from the
+//    mapping when GL takes its format as is.  S3TC data the implementation
+//    does not support, and S3TC volumes, which no ES extension accepts, are
+//    decompressed on the CPU; uncompressed formats GL has no equivalent for
+//    are converted to RGB(A).
+//
+//    The BCn decoder computes the four colors of a block and then expands
+//    each row of 2-bit indices with one byte shuffle through a 256-entry
+//    table where the CPU has SSSE3 or NEON.
+//
+
+///
+//  Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <EGL/egl.h>
+#include "esUtil.h"
+#include "esUtil_internal.h"
+#include <GLES2/gl2ext.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#define ES_DDS_SSSE3
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define ES_DDS_NEON
+#endif
+
+///
+// Defines
+//
+#define DDS_MAGIC             0x20534444
+#define DDS_HEADER_SIZE       128
+#define DDS_DX10_HEADER_SIZE  20
+
+// dwFlags
+#define DDSD_MIPMAPCOUNT      0x20000
+#define DDSD_DEPTH            0x800000
+
+// ddspf.dwFlags
+#define DDPF_ALPHAPIXELS      0x1
+#define DDPF_ALPHA            0x2
+#define DDPF_FOURCC           0x4
+#define DDPF_RGB              0x40
+#define DDPF_LUMINANCE        0x20000
+
+// dwCaps2
+#define DDSCAPS2_CUBEMAP      0x200
+#define DDSCAPS2_ALLFACES     0xFC00
+#define DDSCAPS2_VOLUME       0x200000
+
+#define FOURCC(a, b, c, d)    ( (GLuint) (a) | ( (GLuint) (b) << 8 ) | ( (GLuint) (c) << 16 ) | ( (GLuint) (d) << 24 ) )
+
+// DXGI formats of the DX10 header extension
+#define DXGI_R8G8B8A8_UNORM   28
+#define DXGI_R8_UNORM         61
+#define DXGI_BC1_UNORM        71
+#define DXGI_BC2_UNORM        74
+#define DXGI_BC3_UNORM        77
+#define DXGI_B8G8R8A8_UNORM   87
+#define DXGI_MISC_TEXTURECUBE 0x4
+#define DXGI_DIMENSION_3D     4
+
+// Shuffle that expands a row of four 2-bit color indices from a 4-color RGBA palette
+#define PIXEL(i)              4 * (i), 4 * (i) + 1, 4 * (i) + 2, 4 * (i) + 3
+#define ROW(v)                { PIXEL ( (v) & 3 ), PIXEL ( ( (v) >> 2 ) & 3 ), PIXEL ( ( (v) >> 4 ) & 3 ), PIXEL ( ( (v) >> 6 ) & 3 ) }
+#define ROWS4(v)              ROW ( v ), ROW ( (v) + 1 ), ROW ( (v) + 2 ), ROW ( (v) + 3 )
+#define ROWS16(v)             ROWS4 ( v ), ROWS4 ( (v) + 4 ), ROWS4 ( (v) + 8 ), ROWS4 ( (v) + 12 )
+#define ROWS64(v)             ROWS16 ( v ), ROWS16 ( (v) + 16 ), ROWS16 ( (v) + 32 ), ROWS16 ( (v) + 48 )
+
+static const unsigned char rowShuffle[256][16] =
+{
+   ROWS64 ( 0 ), ROWS64 ( 64 ), ROWS64 ( 128 ), ROWS64 ( 192 )
+};
+
+// Moves the alpha values of row y, one byte per pixel, into the fourth byte of each pixel
+static const signed char alphaShuffle[4][16] =
+{
+   { -128, -128, -128,  0, -128, -128, -128,  1, -128, -128, -128,  2, -128, -128, -128,  3 },
+   { -128, -128, -128,  4, -128, -128, -128,  5, -128, -128, -128,  6, -128, -128, -128,  7 },
+   { -128, -128, -128,  8, -128, -128, -128,  9, -128, -128, -128, 10, -128, -128, -128, 11 },
+   { -128, -128, -128, 12, -128, -128, -128, 13, -128, -128, -128, 14, -128, -128, -128, 15 }
+};
+
+///
+// Types
+//
+
+// How the images of a file are uploaded
+typedef struct
+{
+   // S3TC format of the blocks, 0 for uncompressed data
+   GLenum         compressed;
+   int            blockBytes;
+
+   // Uncompressed data: bytes per pixel and the format and type GL takes it as
+   int            pixelBytes;
+   GLenum         format;
+   GLenum         type;
+
+   // Set when the pixels have to be converted to format from the channel masks
+   GLboolean      convert;
+   GLuint         masks[4];
+} DDSFormat;
+
+// Expands the 16 pixels of a block from its palette, 2-bit indices and optional alpha
+typedef void (*ExpandFunc) ( unsigned char *dst, size_t stride, const unsigned char palette[16],
+                             GLuint indices, const unsigned char *alpha );
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// ReadWord()
+//
+static GLuint ReadWord ( const unsigned char *src )
+{
+   return src[0] | ( src[1] << 8 ) | ( src[2] << 16 ) | ( (GLuint) src[3] << 24 );
+}
+
+///
+// ExpandBlock()
+//
+//    Scalar kernel
+//
+static void ExpandBlock ( unsigned char *dst, size_t stride, const unsigned char palette[16],
+                          GLuint indices, const unsigned char *alpha )
+{
+   int x, y;
+
+   for ( y = 0; y < 4; y++, dst += stride )
+   {
+      for ( x = 0; x < 4; x++, indices >>= 2 )
+      {
+         memcpy ( dst + x * 4, palette + ( indices & 3 ) * 4, 4 );
+         if ( alpha != NULL )
+            dst[x * 4 + 3] = alpha[y * 4 + x];
+      }
+   }
+}
+
+#ifdef ES_DDS_SSSE3
+///
+// ExpandBlock_SSSE3()
+//
+__attribute__((target("ssse3")))
+static void ExpandBlock_SSSE3 ( unsigned char *dst, size_t stride, const unsigned char palette[16],
+                                GLuint indices, const unsigned char *alpha )
+{
+   __m128i colors = _mm_loadu_si128 ( (const __m128i *) palette );
+   int y;
+
+   if ( alpha == NULL )
+   {
+      for ( y = 0; y < 4; y++, dst += stride, indices >>= 8 )
+         _mm_storeu_si128 ( (__m128i *) dst, _mm_shuffle_epi8 ( colors, _mm_loadu_si128 ( (const __m128i *) rowShuffle[indices & 255] ) ) );
+   }
+   else
+   {
+      __m128i alphas = _mm_loadu_si128 ( (const __m128i *) alpha );
+      __m128i rgbMask = _mm_set1_epi32 ( 0x00FFFFFF );
+
+      for ( y = 0; y < 4; y++, dst += stride, indices >>= 8 )
+      {
+         __m128i row = _mm_shuffle_epi8 ( colors, _mm_loadu_si128 ( (const __m128i *) rowShuffle[indices & 255] ) );
+
+         row = _mm_or_si128 ( _mm_and_si128 ( row, rgbMask ),
+                              _mm_shuffle_epi8 ( alphas, _mm_loadu_si128 ( (const __m128i *) alphaShuffle[y] ) ) );
+         _mm_storeu_si128 ( (__m128i *) dst, row );
+      }
+   }
+}
+#endif
+
+#ifdef ES_DDS_NEON
+///
+// ExpandBlock_NEON()
+//
+static void ExpandBlock_NEON ( unsigned char *dst, size_t stride, const unsigned char palette[16],
+                               GLuint indices, const unsigned char *alpha )
+{
+   uint8x16_t colors = vld1q_u8 ( palette );
+   uint8x16_t alphas = alpha != NULL ? vld1q_u8 ( alpha ) : vdupq_n_u8 ( 0 );
+   uint8x16_t rgbMask = vreinterpretq_u8_u32 ( vdupq_n_u32 ( alpha != NULL ? 0x00FFFFFF : 0xFFFFFFFF ) );
+   int y;
+
+   // Out of range table indices read as zero, like the -128 entries do for pshufb
+   for ( y = 0; y < 4; y++, dst += stride, indices >>= 8 )
+   {
+      uint8x16_t row = vqtbl1q_u8 ( colors, vld1q_u8 ( rowShuffle[indices & 255] ) );
+
+      row = vorrq_u8 ( vandq_u8 ( row, rgbMask ), vqtbl1q_u8 ( alphas, vreinterpretq_u8_s8 ( vld1q_s8 ( alphaShuffle[y] ) ) ) );
+      vst1q_u8 ( dst, row );
+   }
+}
+#endif
+
+///
+// SelectExpand()
+//
+static ExpandFunc SelectExpand ( void )
+{
+#if defined(ES_DDS_SSSE3)
+   if ( __builtin_cpu_supports ( "ssse3" ) )
+      return ExpandBlock_SSSE3;
+#elif defined(ES_DDS_NEON)
+   return ExpandBlock_NEON;
+#endif
+   return ExpandBlock;
+}
+
+///
+// ColorPalette()
+//
+//    Computes the four RGBA colors of a DXT color block.  The 565 end points
+//    are widened by repeating their top bits and the colors in between are
+//    rounded down, as most hardware and Mesa's decoder do.  DXT1 blocks
+//    with color0 <= color1 have three colors and black, transparent for
+//    GL_COMPRESSED_RGBA_S3TC_DXT1_EXT.
+//
+static void ColorPalette ( const unsigned char *block, GLenum format, unsigned char palette[16] )
+{
+   GLuint c0 = block[0] | ( block[1] << 8 );
+   GLuint c1 = block[2] | ( block[3] << 8 );
+   int end[2][3];
+   int i, c;
+
+   for ( i = 0; i < 2; i++ )
+   {
+      GLuint color = i == 0 ? c0 : c1;
+      int r = color >> 11, g = ( color >> 5 ) & 63, b = color & 31;
+
+      end[i][0] = ( r << 3 ) | ( r >> 2 );
+      end[i][1] = ( g << 2 ) | ( g >> 4 );
+      end[i][2] = ( b << 3 ) | ( b >> 2 );
+   }
+
+   for ( c = 0; c < 3; c++ )
+   {
+      palette[c] = (unsigned char) end[0][c];
+      palette[4 + c] = (unsigned char) end[1][c];
+
+      if ( c0 > c1 || ( format != GL_COMPRESSED_RGB_S3TC_DXT1_EXT && format != GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ) )
+      {
+         palette[8 + c] = (unsigned char) ( ( 2 * end[0][c] + end[1][c] ) / 3 );
+         palette[12 + c] = (unsigned char) ( ( end[0][c] + 2 * end[1][c] ) / 3 );
+      }
+      else
+      {
+         palette[8 + c] = (unsigned char) ( ( end[0][c] + end[1][c] ) / 2 );
+         palette[12 + c] = 0;
+      }
+   }
+
+   palette[3] = palette[7] = palette[11] = 255;
+   palette[15] = ( c0 <= c1 && format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ) ? 0 : 255;
+}
+
+///
+// BlockAlpha()
+//
+//    Decodes the alpha half of a DXT3 or DXT5 block, one byte per pixel
+//
+static void BlockAlpha ( const unsigned char *block, GLenum format, unsigned char alpha[16] )
+{
+   int i;
+
+   if ( format == GL_COMPRESSED_RGBA_S3TC_DXT3_ANGLE )
+   {
+      // Explicit 4-bit alpha
+      for ( i = 0; i < 16; i++ )
+      {
+         int value = ( block[i / 2] >> ( ( i & 1 ) * 4 ) ) & 15;
+         alpha[i] = (unsigned char) ( value | ( value << 4 ) );
+      }
+   }
+   else
+   {
+      // Two end points and 3-bit indices into 8 interpolated values, or 6 and 0 and 255
+      int a0 = block[0], a1 = block[1];
+      unsigned char values[8];
+      unsigned long long bits = 0;
+
+      for ( i = 0; i < 6; i++ )
+         bits |= (unsigned long long) block[2 + i] << ( i * 8 );
+
+      values[0] = (unsigned char) a0;
+      values[1] = (unsigned char) a1;
+      for ( i = 2; i < 8; i++ )
+      {
+         if ( a0 > a1 )
+            values[i] = (unsigned char) ( ( a0 * ( 8 - i ) + a1 * ( i - 1 ) ) / 7 );
+         else if ( i < 6 )
+            values[i] = (unsigned char) ( ( a0 * ( 6 - i ) + a1 * ( i - 1 ) ) / 5 );
+         else
+            values[i] = i == 6 ? 0 : 255;
+      }
+
+      for ( i = 0; i < 16; i++, bits >>= 3 )
+         alpha[i] = values[bits & 7];
+   }
+}
+
+///
+// BlockBytes()
+//
+static int BlockBytes ( GLenum format )
+{
+   return format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? 8 : 16;
+}
+
+///
+// MaskShift(), MaskBits()
+//
+static int MaskShift ( GLuint mask )
+{
+   return mask != 0 ? __builtin_ctz ( mask ) : 0;
+}
+
+static int MaskBits ( GLuint mask )
+{
+   return __builtin_popcount ( mask );
+}
+
+///
+// ConvertPixels()
+//
+//    Converts count pixels described by channel masks into RGB or RGBA,
+//    widening every channel to 8 bits.  Luminance comes in the red mask.
+//
+static void ConvertPixels ( const DDSFormat *fmt, const unsigned char *src, int count, unsigned char *dst )
+{
+   int channels = fmt->format == GL_RGBA ? 4 : 3;
+   int shift[4], max[4];
+   int i, c;
+
+   for ( c = 0; c < 4; c++ )
+   {
+      shift[c] = MaskShift ( fmt->masks[c] );
+      max[c] = fmt->masks[c] >> shift[c];
+   }
+
+   for ( i = 0; i < count; i++, src += fmt->pixelBytes, dst += channels )
+   {
+      GLuint pixel = 0;
+
+      memcpy ( &pixel, src, fmt->pixelBytes );
+      for ( c = 0; c < channels; c++ )
+      {
+         // Luminance fills green and blue from the red mask
+         int m = fmt->masks[1] == 0 && fmt->masks[2] == 0 && c < 3 ? 0 : c;
+
+         if ( max[m] == 0 )
+            dst[c] = c == 3 ? 255 : 0;
+         else
+            dst[c] = (unsigned char) ( ( ( ( pixel & fmt->masks[m] ) >> shift[m] ) * 255 + max[m] / 2 ) / max[m] );
+      }
+   }
+}
+
+///
+// ParseFormat()
+//
+//    Works out how to upload the pixel format of a DDS header, returns
+//    GL_FALSE if it is not supported
+//
+static GLboolean ParseFormat ( const unsigned char *pf, const unsigned char *dx10, GLboolean bgra, DDSFormat *fmt )
+{
+   GLuint flags = ReadWord ( pf + 4 );
+   GLuint fourCC = ReadWord ( pf + 8 );
+   GLuint bits = ReadWord ( pf + 12 );
+   GLuint r = 0, g = 0, b = 0, a = 0;
+
+   memset ( fmt, 0, sizeof ( DDSFormat ) );
+
+   if ( dx10 != NULL )
+   {
+      switch ( ReadWord ( dx10 ) )
+      {
+         case DXGI_BC1_UNORM: fmt->compressed = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
+         case DXGI_BC2_UNORM: fmt->compressed = GL_COMPRESSED_RGBA_S3TC_DXT3_ANGLE; break;
+         case DXGI_BC3_UNORM: fmt->compressed = GL_COMPRESSED_RGBA_S3TC_DXT5_ANGLE; break;
+         case DXGI_R8G8B8A8_UNORM: flags = DDPF_RGB | DDPF_ALPHAPIXELS; bits = 32; r = 0xFF; g = 0xFF00; b = 0xFF0000; a = 0xFF000000; break;
+         case DXGI_B8G8R8A8_UNORM: flags = DDPF_RGB | DDPF_ALPHAPIXELS; bits = 32; r = 0xFF0000; g = 0xFF00; b = 0xFF; a = 0xFF000000; break;
+         case DXGI_R8_UNORM: flags = DDPF_LUMINANCE; bits = 8; r = 0xFF; g = b = a = 0; break;
+         default: return GL_FALSE;
+      }
+   }
+   else if ( flags & DDPF_FOURCC )
+   {
+      if ( fourCC == FOURCC ( 'D', 'X', 'T', '1' ) )
+         fmt->compressed = ( flags & DDPF_ALPHAPIXELS ) ? GL_COMPRESSED_RGBA_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+      else if ( fourCC == FOURCC ( 'D', 'X', 'T', '3' ) )
+         fmt->compressed = GL_COMPRESSED_RGBA_S3TC_DXT3_ANGLE;
+      else if ( fourCC == FOURCC ( 'D', 'X', 'T', '5' ) )
+         fmt->compressed = GL_COMPRESSED_RGBA_S3TC_DXT5_ANGLE;
+      else
+         return GL_FALSE;
+   }
+   else
+   {
+      r = ReadWord ( pf + 16 );
+      g = ReadWord ( pf + 20 );
+      b = ReadWord ( pf + 24 );
+      a = ( flags & ( DDPF_ALPHAPIXELS | DDPF_ALPHA ) ) ? ReadWord ( pf + 28 ) : 0;
+   }
+
+   if ( fmt->compressed != 0 )
+   {
+      fmt->blockBytes = BlockBytes ( fmt->compressed );
+      return GL_TRUE;
+   }
+
+   if ( bits == 0 || bits > 32 || ( bits & 7 ) != 0 || ( flags & ( DDPF_RGB | DDPF_LUMINANCE | DDPF_ALPHA ) ) == 0 )
+      return GL_FALSE;
+
+   fmt->pixelBytes = bits / 8;
+   fmt->masks[0] = r;
+   fmt->masks[1] = g;
+   fmt->masks[2] = b;
+   fmt->masks[3] = a;
+   fmt->type = GL_UNSIGNED_BYTE;
+
+   // Layouts GL takes as they are, on a little-endian machine
+   if ( ( flags & DDPF_ALPHA ) && bits == 8 && a == 0xFF )
+      fmt->format = GL_ALPHA;
+   else if ( ( flags & DDPF_LUMINANCE ) && bits == 8 && r == 0xFF && a == 0 )
+      fmt->format = GL_LUMINANCE;
+   else if ( ( flags & DDPF_LUMINANCE ) && bits == 16 && r == 0xFF && a == 0xFF00 )
+      fmt->format = GL_LUMINANCE_ALPHA;
+   else if ( bits == 32 && r == 0xFF && g == 0xFF00 && b == 0xFF0000 && a == 0xFF000000 )
+      fmt->format = GL_RGBA;
+   else if ( bits == 32 && r == 0xFF0000 && g == 0xFF00 && b == 0xFF && a == 0xFF000000 && bgra )
+      fmt->format = GL_BGRA_EXT;
+   else if ( bits == 24 && r == 0xFF && g == 0xFF00 && b == 0xFF0000 )
+      fmt->format = GL_RGB;
+   else if ( bits == 16 && r == 0xF800 && g == 0x7E0 && b == 0x1F && a == 0 )
+   {
+      fmt->format = GL_RGB;
+      fmt->type = GL_UNSIGNED_SHORT_5_6_5;
+   }
+   else if ( MaskBits ( r | g | b | a ) > 0 )
+   {
+      // Everything else, like BGR(X) or ARGB4444, is widened to 8 bits per channel
+      fmt->format = a != 0 ? GL_RGBA : GL_RGB;
+      fmt->convert = GL_TRUE;
+   }
+   else
+      return GL_FALSE;
+
+   return GL_TRUE;
+}
+
+///
+// ImageBytes()
+//
+//    Size of one image of a level, all its slices for a volume
+//
+static size_t ImageBytes ( const DDSFormat *fmt, int width, int height, int depth )
+{
+   if ( fmt->compressed != 0 )
+      return (size_t) ( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) * fmt->blockBytes * depth;
+
+   return (size_t) width * height * depth * fmt->pixelBytes;
+}
+
+///
+// UploadImage()
+//
+//    Specifies one face of one mip level, decompressing or converting it
+//    into scratch when needed
+//
+static GLboolean UploadImage ( const DDSFormat *fmt, GLenum target, GLint level, int width, int height, int depth,
+                               const unsigned char *data, GLboolean native, PFNGLTEXIMAGE3DOESPROC texImage3D,
+                               unsigned char **scratch, size_t *scratchSize )
+{
+   GLenum format = fmt->format, type = fmt->type;
+   const void *pixels = data;
+
+   if ( fmt->compressed != 0 && native && target != GL_TEXTURE_3D_OES )
+   {
+      glCompressedTexImage2D ( target, level, fmt->compressed, width, height, 0,
+                               (GLsizei) ImageBytes ( fmt, width, height, 1 ), data );
+      return glGetError ( ) == GL_NO_ERROR;
+   }
+
+   if ( fmt->compressed != 0 || fmt->convert )
+   {
+      int channels = fmt->compressed != 0 ? 4 : format == GL_RGBA ? 4 : 3;
+      size_t needed = (size_t) width * height * depth * channels;
+      int z;
+
+      if ( needed > *scratchSize )
+      {
+         unsigned char *grown = realloc ( *scratch, needed );
+
+         if ( grown == NULL )
+            return GL_FALSE;
+         *scratch = grown;
+         *scratchSize = needed;
+      }
+
+      if ( fmt->compressed != 0 )
+      {
+         for ( z = 0; z < depth; z++ )
+            esDecodeBCn ( fmt->compressed, data + ImageBytes ( fmt, width, height, z ), width, height,
+                          *scratch + (size_t) width * height * 4 * z );
+         format = GL_RGBA;
+      }
+      else
+      {
+         ConvertPixels ( fmt, data, width * height * depth, *scratch );
+      }
+
+      type = GL_UNSIGNED_BYTE;
+      pixels = *scratch;
+   }
+
+   if ( target == GL_TEXTURE_3D_OES )
+      texImage3D ( target, level, format, width, height, depth, 0, format, type, pixels );
+   else
+      glTexImage2D ( target, level, format, width, height, 0, format, type, pixels );
+
+   return glGetError ( ) == GL_NO_ERROR;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+// esDecodeBCn()
+//
+//    Decompresses DXT1, DXT3 or DXT5 blocks into RGBA
+//
+void ESUTIL_API esDecodeBCn ( GLenum format, const unsigned char *data, int width, int height, unsigned char *rgba )
+{
+   ExpandFunc expand = SelectExpand ( );
+   int blockBytes = BlockBytes ( format );
+   GLboolean hasAlpha = blockBytes == 16;
+   size_t stride = (size_t) width * 4;
+   unsigned char palette[16], alpha[16], partial[4 * 16];
+   int bx, by, y;
+
+   for ( by = 0; by < height; by += 4 )
+   {
+      for ( bx = 0; bx < width; bx += 4, data += blockBytes )
+      {
+         const unsigned char *color = hasAlpha ? data + 8 : data;
+         GLuint indices = ReadWord ( color + 4 );
+         unsigned char *dst = rgba + by * stride + bx * 4;
+
+         ColorPalette ( color, format, palette );
+         if ( hasAlpha )
+            BlockAlpha ( data, format, alpha );
+
+         if ( bx + 4 <= width && by + 4 <= height )
+         {
+            expand ( dst, stride, palette, indices, hasAlpha ? alpha : NULL );
+            continue;
+         }
+
+         // Blocks over the right or bottom edge are expanded aside and clipped
+         expand ( partial, 16, palette, indices, hasAlpha ? alpha : NULL );
+         for ( y = 0; y < 4 && by + y < height; y++ )
+            memcpy ( dst + y * stride, partial + y * 16, ( width - bx < 4 ? width - bx : 4 ) * 4 );
+      }
+   }
+}
+
+///
+// esLoadDDS()
+//
+//    Creates a 2D, cube map or 3D texture from a DDS file with all its mip levels
+//
+GLuint ESUTIL_API esLoadDDS ( const char *fileName, GLenum *target, int *width, int *height, int *depth )
+{
+   PFNGLTEXIMAGE3DOESPROC texImage3D = NULL;
+   const unsigned char *header, *dx10 = NULL;
+   unsigned char *file, *scratch = NULL;
+   size_t size, offset, scratchSize = 0;
+   GLuint flags, caps2, levels, fullLevels, level, faces, face;
+   int baseWidth, baseHeight, baseDepth;
+   GLboolean native = GL_FALSE, ok = GL_TRUE;
+   GLenum texTarget = GL_TEXTURE_2D;
+   GLint unpackAlignment, binding;
+   DDSFormat fmt;
+   GLuint texId;
+
+   file = MapFile ( fileName, &size );
+   if ( file == NULL )
+   {
+      esLog ( ES_LOG_ERROR, "esLoadDDS: unable to open %s\n", fileName );
+      return 0;
+   }
+
+   if ( size < DDS_HEADER_SIZE || ReadWord ( file ) != DDS_MAGIC )
+   {
+      esLog ( ES_LOG_ERROR, "esLoadDDS: %s is not a DDS file\n", fileName );
+      munmap ( file, size );
+      return 0;
+   }
+
+   header = file + 4;
+   flags = ReadWord ( header + 4 );
+   baseHeight = (int) ReadWord ( header + 8 );
+   baseWidth = (int) ReadWord ( header + 12 );
+   baseDepth = ( flags & DDSD_DEPTH ) && ReadWord ( header + 20 ) > 0 ? (int) ReadWord ( header + 20 ) : 1;
+   levels = ( flags & DDSD_MIPMAPCOUNT ) && ReadWord ( header + 24 ) > 0 ? ReadWord ( header + 24 ) : 1;
+   caps2 = ReadWord ( header + 108 );
+   offset = DDS_HEADER_SIZE;
+
+   if ( ReadWord ( header + 76 ) & DDPF_FOURCC && ReadWord ( header + 80 ) == FOURCC ( 'D', 'X', '1', '0' ) )
+   {
+      // The extended header may be cut off, read none of it then
+      if ( size < DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE )
+      {
+         esLog ( ES_LOG_ERROR, "esLoadDDS: %s is truncated\n", fileName );
+         munmap ( file, size );
+         return 0;
+      }
+
+      dx10 = file + DDS_HEADER_SIZE;
+      if ( ReadWord ( dx10 + 12 ) > 1 )
+         ok = GL_FALSE;
+      if ( ReadWord ( dx10 + 8 ) & DXGI_MISC_TEXTURECUBE )
+         caps2 |= DDSCAPS2_CUBEMAP | DDSCAPS2_ALLFACES;
+      if ( ReadWord ( dx10 + 4 ) == DXGI_DIMENSION_3D )
+         caps2 |= DDSCAPS2_VOLUME;
+      offset += DDS_DX10_HEADER_SIZE;
+   }
+
+   if ( ( caps2 & DDSCAPS2_CUBEMAP ) )
+      texTarget = ( caps2 & DDSCAPS2_ALLFACES ) == DDSCAPS2_ALLFACES ? GL_TEXTURE_CUBE_MAP : 0;
+   else if ( ( caps2 & DDSCAPS2_VOLUME ) && baseDepth > 1 )
+      texTarget = GL_TEXTURE_3D_OES;
+   else
+      baseDepth = 1;
+
+   if ( texTarget == GL_TEXTURE_3D_OES )
+   {
+      if ( HasExtension ( "GL_OES_texture_3D" ) )
+         texImage3D = (PFNGLTEXIMAGE3DOESPROC) eglGetProcAddress ( "glTexImage3DOES" );
+      if ( texImage3D == NULL )
+         texTarget = 0;
+   }
+
+   if ( !ok || texTarget == 0 || baseWidth < 1 || baseHeight < 1 ||
+        !ParseFormat ( header + 72, dx10, HasExtension ( "GL_EXT_texture_format_BGRA8888" ), &fmt ) )
+   {
+      esLog ( ES_LOG_ERROR, "esLoadDDS: %s has a layout or format that is not supported\n", fileName );
+      munmap ( file, size );
+      return 0;
+   }
+
+   if ( fmt.compressed == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || fmt.compressed == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT )
+      native = HasExtension ( "GL_EXT_texture_compression_dxt1" ) || HasExtension ( "GL_EXT_texture_compression_s3tc" );
+   else if ( fmt.compressed == GL_COMPRESSED_RGBA_S3TC_DXT3_ANGLE )
+      native = HasExtension ( "GL_ANGLE_texture_compression_dxt3" ) || HasExtension ( "GL_EXT_texture_compression_s3tc" );
+   else if ( fmt.compressed == GL_COMPRESSED_RGBA_S3TC_DXT5_ANGLE )
+      native = HasExtension ( "GL_ANGLE_texture_compression_dxt5" ) || HasExtension ( "GL_EXT_texture_compression_s3tc" );
+
+   // Rows are tightly packed in the file and in the converted images
+   glGetIntegerv ( GL_UNPACK_ALIGNMENT, &unpackAlignment );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, 1 );
+
+   // Errors are checked after every image, so do not inherit one
+   while ( glGetError ( ) != GL_NO_ERROR );
+
+   // The texture is bound only while it is filled in, the caller's binding is put back
+   glGetIntegerv ( texTarget == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_BINDING_CUBE_MAP :
+                   texTarget == GL_TEXTURE_3D_OES ? GL_TEXTURE_BINDING_3D_OES : GL_TEXTURE_BINDING_2D, &binding );
+   glGenTextures ( 1, &texId );
+   glBindTexture ( texTarget, texId );
+
+   // Faces are stored one after the other, each with its whole mip chain
+   faces = texTarget == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+   for ( face = 0; face < faces && ok; face++ )
+   {
+      GLenum faceTarget = texTarget == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : texTarget;
+
+      for ( level = 0; level < levels && ok; level++ )
+      {
+         int w = baseWidth >> level ? baseWidth >> level : 1;
+         int h = baseHeight >> level ? baseHeight >> level : 1;
+         int d = baseDepth >> level ? baseDepth >> level : 1;
+         size_t bytes = ImageBytes ( &fmt, w, h, d );
+
+         if ( offset + bytes > size )
+         {
+            ok = GL_FALSE;
+            break;
+         }
+
+         ok = UploadImage ( &fmt, faceTarget, level, w, h, d, file + offset, native, texImage3D, &scratch, &scratchSize );
+         offset += bytes;
+      }
+   }
+
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, unpackAlignment );
+   free ( scratch );
+   munmap ( file, size );
+
+   if ( !ok )
+   {
+      esLog ( ES_LOG_ERROR, "esLoadDDS: %s is truncated or could not be uploaded\n", fileName );
+      glBindTexture ( texTarget, binding );
+      glDeleteTextures ( 1, &texId );
+      return 0;
+   }
+
+   // ES 2.0 cannot limit the levels used, so only a complete chain is sampled with mipmapping
+   for ( fullLevels = 1; ( baseWidth | baseHeight | ( texTarget == GL_TEXTURE_3D_OES ? baseDepth : 0 ) ) >> fullLevels; fullLevels++ );
+
+   glTexParameteri ( texTarget, GL_TEXTURE_MIN_FILTER, levels == fullLevels && levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR );
+   glTexParameteri ( texTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   glTexParameteri ( texTarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+   glTexParameteri ( texTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+   if ( texTarget == GL_TEXTURE_3D_OES )
+      glTexParameteri ( texTarget, GL_TEXTURE_WRAP_R_OES, GL_CLAMP_TO_EDGE );
+   glBindTexture ( texTarget, binding );
+
+   esLog ( ES_LOG_INFO, "esLoadDDS: %s %dx%dx%d, %u faces, %u levels%s\n", fileName, baseWidth, baseHeight, baseDepth,
+           faces, levels, fmt.compressed == 0 ? ( fmt.convert ? ", converted" : "" ) :
+                          native && texTarget != GL_TEXTURE_3D_OES ? ", S3TC" : ", S3TC decompressed" );
+
+   if ( target != NULL )
+      *target = texTarget;
+   if ( width != NULL )
+      *width = baseWidth;
+   if ( height != NULL )
+      *height = baseHeight;
+   if ( depth != NULL )
+      *depth = baseDepth;
+   return texId;
+}
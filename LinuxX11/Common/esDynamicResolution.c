@@ -0,0 +1,458 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESDynamicResolution.c
+//
+//    Renders the draw callback into an offscreen framebuffer smaller than the
+//    window and stretches it over the window afterwards.  The render scale is
+//    steered towards a frame time budget by a PID controller fed with the GPU
+//    time of each frame when esGpuTimerEnable is on, or the frame time
+//    otherwise.  The offscreen color texture is allocated once at the largest
+//    scale and the frame is rendered into its lower left corner, so changing
+//    the scale never reallocates anything.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <GLES2/gl2ext.h>
+
+///
+// Defines
+//
+
+// Controller gains, applied to the log of the ratio between budget and measured time
+#define ES_DYNRES_KP          0.10f
+#define ES_DYNRES_KI          0.20f
+#define ES_DYNRES_KD          0.02f
+
+// Errors below this (about 5% of the frame time) are ignored so the scale settles
+#define ES_DYNRES_DEADBAND    0.025f
+
+// Render sizes are rounded to multiples of this
+#define ES_DYNRES_ALIGN       8
+
+///
+// Types
+//
+typedef struct _esdynamicresolution
+{
+   float          targetTime;
+   float          minScale;
+   float          maxScale;
+   float          scale;
+
+   // Errors of the previous two controller updates
+   float          error[2];
+
+   // Frames before this one have been used by the controller or skipped
+   unsigned int   nextMeasured;
+
+   // Window size, and the size of the offscreen frame being drawn
+   GLint          windowWidth, windowHeight;
+   GLint          renderWidth, renderHeight;
+
+   // Offscreen target, maxScale times the window size
+   GLint          textureWidth, textureHeight;
+   GLuint         fbo;
+   GLuint         texture;
+   GLuint         renderbuffers[2];
+
+   // Framebuffer bound when drawing started, the window or the headless stand-in
+   GLint          outputFramebuffer;
+
+   // Upscale pass
+   GLuint         program;
+   GLuint         vertexBuffer;
+   GLint          texCoordScaleLoc;
+   GLint          texCoordMaxLoc;
+   GLint          samplerLoc;
+} ESDynamicResolution;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// UpdateRenderSize()
+//
+static void UpdateRenderSize ( ESDynamicResolution *dr )
+{
+   GLint width = (GLint) ( dr->windowWidth * dr->scale / ES_DYNRES_ALIGN + 0.5f ) * ES_DYNRES_ALIGN;
+   GLint height = (GLint) ( dr->windowHeight * dr->scale / ES_DYNRES_ALIGN + 0.5f ) * ES_DYNRES_ALIGN;
+
+   dr->renderWidth = width < ES_DYNRES_ALIGN ? ES_DYNRES_ALIGN : width > dr->textureWidth ? dr->textureWidth : width;
+   dr->renderHeight = height < ES_DYNRES_ALIGN ? ES_DYNRES_ALIGN : height > dr->textureHeight ? dr->textureHeight : height;
+}
+
+///
+// CreateTarget()
+//
+//    Creates the offscreen framebuffer with the depth and stencil buffers the
+//    window has
+//
+static GLboolean CreateTarget ( ESDynamicResolution *dr )
+{
+   const char *extensions = (const char *) glGetString ( GL_EXTENSIONS );
+   GLboolean packedDepthStencil = extensions != NULL && strstr ( extensions, "GL_OES_packed_depth_stencil" ) != NULL;
+   GLint depthBits, stencilBits, texture, renderbuffer;
+   GLenum status;
+
+   glGetIntegerv ( GL_DEPTH_BITS, &depthBits );
+   glGetIntegerv ( GL_STENCIL_BITS, &stencilBits );
+   glGetIntegerv ( GL_FRAMEBUFFER_BINDING, &dr->outputFramebuffer );
+   glGetIntegerv ( GL_TEXTURE_BINDING_2D, &texture );
+   glGetIntegerv ( GL_RENDERBUFFER_BINDING, &renderbuffer );
+
+   glGenTextures ( 1, &dr->texture );
+   glBindTexture ( GL_TEXTURE_2D, dr->texture );
+   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGBA, dr->textureWidth, dr->textureHeight, 0,
+                  GL_RGBA, GL_UNSIGNED_BYTE, NULL );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+   glBindTexture ( GL_TEXTURE_2D, texture );
+
+   glGenFramebuffers ( 1, &dr->fbo );
+   glBindFramebuffer ( GL_FRAMEBUFFER, dr->fbo );
+   glFramebufferTexture2D ( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, dr->texture, 0 );
+
+   if ( depthBits > 0 && stencilBits > 0 && packedDepthStencil )
+   {
+      glGenRenderbuffers ( 1, dr->renderbuffers );
+      glBindRenderbuffer ( GL_RENDERBUFFER, dr->renderbuffers[0] );
+      glRenderbufferStorage ( GL_RENDERBUFFER, GL_DEPTH24_STENCIL8_OES, dr->textureWidth, dr->textureHeight );
+      glFramebufferRenderbuffer ( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, dr->renderbuffers[0] );
+      glFramebufferRenderbuffer ( GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, dr->renderbuffers[0] );
+   }
+   else
+   {
+      if ( depthBits > 0 )
+      {
+         glGenRenderbuffers ( 1, &dr->renderbuffers[0] );
+         glBindRenderbuffer ( GL_RENDERBUFFER, dr->renderbuffers[0] );
+         glRenderbufferStorage ( GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, dr->textureWidth, dr->textureHeight );
+         glFramebufferRenderbuffer ( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, dr->renderbuffers[0] );
+      }
+      if ( stencilBits > 0 )
+      {
+         glGenRenderbuffers ( 1, &dr->renderbuffers[1] );
+         glBindRenderbuffer ( GL_RENDERBUFFER, dr->renderbuffers[1] );
+         glRenderbufferStorage ( GL_RENDERBUFFER, GL_STENCIL_INDEX8, dr->textureWidth, dr->textureHeight );
+         glFramebufferRenderbuffer ( GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, dr->renderbuffers[1] );
+      }
+   }
+   glBindRenderbuffer ( GL_RENDERBUFFER, renderbuffer );
+
+   status = glCheckFramebufferStatus ( GL_FRAMEBUFFER );
+   glBindFramebuffer ( GL_FRAMEBUFFER, dr->outputFramebuffer );
+   return status == GL_FRAMEBUFFER_COMPLETE ? GL_TRUE : GL_FALSE;
+}
+
+///
+// CreateUpscalePass()
+//
+static GLboolean CreateUpscalePass ( ESDynamicResolution *dr )
+{
+   const char vShaderStr[] =
+      "attribute vec4 a_position;                                       \n"
+      "uniform vec2 u_texCoordScale;                                    \n"
+      "varying vec2 v_texCoord;                                         \n"
+      "void main()                                                      \n"
+      "{                                                                \n"
+      "   gl_Position = a_position;                                     \n"
+      "   v_texCoord = ( a_position.xy * 0.5 + 0.5 ) * u_texCoordScale; \n"
+      "}                                                                \n";
+
+   const char fShaderStr[] =
+      "precision mediump float;                                         \n"
+      "varying vec2 v_texCoord;                                         \n"
+      "uniform sampler2D s_texture;                                     \n"
+      "uniform vec2 u_texCoordMax;                                      \n"
+      "void main()                                                      \n"
+      "{                                                                \n"
+      "  vec2 texCoord = min ( v_texCoord, u_texCoordMax );             \n"
+      "  gl_FragColor = texture2D ( s_texture, texCoord );              \n"
+      "}                                                                \n";
+
+   GLfloat quad[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+   GLint buffer;
+
+   dr->program = esLoadProgram ( vShaderStr, fShaderStr );
+   if ( dr->program == 0 )
+      return GL_FALSE;
+
+   glBindAttribLocation ( dr->program, 0, "a_position" );
+   glLinkProgram ( dr->program );
+   dr->texCoordScaleLoc = glGetUniformLocation ( dr->program, "u_texCoordScale" );
+   dr->texCoordMaxLoc = glGetUniformLocation ( dr->program, "u_texCoordMax" );
+   dr->samplerLoc = glGetUniformLocation ( dr->program, "s_texture" );
+
+   glGetIntegerv ( GL_ARRAY_BUFFER_BINDING, &buffer );
+   glGenBuffers ( 1, &dr->vertexBuffer );
+   glBindBuffer ( GL_ARRAY_BUFFER, dr->vertexBuffer );
+   glBufferData ( GL_ARRAY_BUFFER, sizeof ( quad ), quad, GL_STATIC_DRAW );
+   glBindBuffer ( GL_ARRAY_BUFFER, buffer );
+   return GL_TRUE;
+}
+
+///
+// Upscale()
+//
+//    Stretches the rendered frame over the output framebuffer, leaving the
+//    GL state the draw callback relies on as it was
+//
+static void Upscale ( ESDynamicResolution *dr )
+{
+   static const GLenum caps[] = { GL_BLEND, GL_CULL_FACE, GL_DEPTH_TEST, GL_SCISSOR_TEST, GL_STENCIL_TEST };
+   GLboolean enabled[sizeof ( caps ) / sizeof ( caps[0] )];
+   GLint program, activeTexture, texture, arrayBuffer;
+   GLint attribEnabled, attribSize, attribType, attribNormalized, attribStride, attribBuffer;
+   GLvoid *attribPointer;
+   GLboolean colorMask[4];
+   unsigned int i;
+
+   glGetIntegerv ( GL_CURRENT_PROGRAM, &program );
+   glGetIntegerv ( GL_ACTIVE_TEXTURE, &activeTexture );
+   glActiveTexture ( GL_TEXTURE0 );
+   glGetIntegerv ( GL_TEXTURE_BINDING_2D, &texture );
+   glGetIntegerv ( GL_ARRAY_BUFFER_BINDING, &arrayBuffer );
+   glGetVertexAttribiv ( 0, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &attribEnabled );
+   glGetVertexAttribiv ( 0, GL_VERTEX_ATTRIB_ARRAY_SIZE, &attribSize );
+   glGetVertexAttribiv ( 0, GL_VERTEX_ATTRIB_ARRAY_TYPE, &attribType );
+   glGetVertexAttribiv ( 0, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &attribNormalized );
+   glGetVertexAttribiv ( 0, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &attribStride );
+   glGetVertexAttribiv ( 0, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &attribBuffer );
+   glGetVertexAttribPointerv ( 0, GL_VERTEX_ATTRIB_ARRAY_POINTER, &attribPointer );
+   glGetBooleanv ( GL_COLOR_WRITEMASK, colorMask );
+   for ( i = 0; i < sizeof ( caps ) / sizeof ( caps[0] ); i++ )
+   {
+      enabled[i] = glIsEnabled ( caps[i] );
+      glDisable ( caps[i] );
+   }
+
+   glBindFramebuffer ( GL_FRAMEBUFFER, dr->outputFramebuffer );
+   esStateViewport ( 0, 0, dr->windowWidth, dr->windowHeight );
+   glColorMask ( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+   glUseProgram ( dr->program );
+   glBindTexture ( GL_TEXTURE_2D, dr->texture );
+   glUniform1i ( dr->samplerLoc, 0 );
+   glUniform2f ( dr->texCoordScaleLoc, (GLfloat) dr->renderWidth / dr->textureWidth,
+                 (GLfloat) dr->renderHeight / dr->textureHeight );
+
+   // Keep bilinear filtering from reaching past the frame into stale texels
+   glUniform2f ( dr->texCoordMaxLoc, ( dr->renderWidth - 0.5f ) / dr->textureWidth,
+                 ( dr->renderHeight - 0.5f ) / dr->textureHeight );
+   glBindBuffer ( GL_ARRAY_BUFFER, dr->vertexBuffer );
+   glVertexAttribPointer ( 0, 2, GL_FLOAT, GL_FALSE, 0, 0 );
+   glEnableVertexAttribArray ( 0 );
+   glDrawArrays ( GL_TRIANGLE_STRIP, 0, 4 );
+
+   // Restore the state
+   glBindBuffer ( GL_ARRAY_BUFFER, attribBuffer );
+   glVertexAttribPointer ( 0, attribSize, attribType, (GLboolean) attribNormalized, attribStride, attribPointer );
+   if ( !attribEnabled )
+      glDisableVertexAttribArray ( 0 );
+   glBindBuffer ( GL_ARRAY_BUFFER, arrayBuffer );
+   glBindTexture ( GL_TEXTURE_2D, texture );
+   glActiveTexture ( activeTexture );
+   glUseProgram ( program );
+   glColorMask ( colorMask[0], colorMask[1], colorMask[2], colorMask[3] );
+   for ( i = 0; i < sizeof ( caps ) / sizeof ( caps[0] ); i++ )
+   {
+      if ( enabled[i] )
+         glEnable ( caps[i] );
+   }
+}
+
+///
+// LatestMeasurement()
+//
+//    Returns the newest GPU or frame time in milliseconds that the controller
+//    has not used yet, or a negative value if there is none
+//
+static float LatestMeasurement ( ESContext *esContext, ESDynamicResolution *dr )
+{
+   ESFrameHistory *history = &esContext->frameHistory;
+   unsigned int oldest = history->total - history->count;
+   unsigned int frame;
+
+   if ( oldest < dr->nextMeasured )
+      oldest = dr->nextMeasured;
+
+   // GPU times arrive a few frames late, and some frames may not get one
+   for ( frame = history->total; frame-- > oldest; )
+   {
+      const ESFrameTime *frameTime = &history->frames[frame % ES_FRAME_HISTORY];
+      float measured = esContext->gpuTimer != NULL ? frameTime->gpu : frameTime->frame;
+
+      if ( measured >= 0.0f )
+      {
+         dr->nextMeasured = frame + 1;
+         return measured;
+      }
+   }
+   return -1.0f;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  DynamicResolutionBeginDraw()
+//
+void DynamicResolutionBeginDraw ( ESContext *esContext )
+{
+   ESDynamicResolution *dr = esContext->dynamicResolution;
+
+   glGetIntegerv ( GL_FRAMEBUFFER_BINDING, &dr->outputFramebuffer );
+   glBindFramebuffer ( GL_FRAMEBUFFER, dr->fbo );
+   esStateViewport ( 0, 0, dr->renderWidth, dr->renderHeight );
+
+   // The draw callback sees the render size as the window size
+   esContext->width = dr->renderWidth;
+   esContext->height = dr->renderHeight;
+}
+
+///
+//  DynamicResolutionEndDraw()
+//
+void DynamicResolutionEndDraw ( ESContext *esContext )
+{
+   ESDynamicResolution *dr = esContext->dynamicResolution;
+
+   esContext->width = dr->windowWidth;
+   esContext->height = dr->windowHeight;
+   Upscale ( dr );
+}
+
+///
+//  DynamicResolutionEndFrame()
+//
+void DynamicResolutionEndFrame ( ESContext *esContext )
+{
+   ESDynamicResolution *dr = esContext->dynamicResolution;
+   float measured = LatestMeasurement ( esContext, dr );
+   float error, delta;
+
+   if ( measured <= 0.0f )
+      return;
+
+   // Cost grows with the number of pixels, so half the log of the time ratio
+   // is the log of the scale change that would meet the budget
+   error = 0.5f * logf ( dr->targetTime / measured );
+
+   // Velocity form of the PID controller, the output changes the log of the scale
+   delta = ES_DYNRES_KP * ( error - dr->error[0] ) +
+           ES_DYNRES_KI * ( fabsf ( error ) > ES_DYNRES_DEADBAND ? error : 0.0f ) +
+           ES_DYNRES_KD * ( error - 2.0f * dr->error[0] + dr->error[1] );
+   dr->error[1] = dr->error[0];
+   dr->error[0] = error;
+
+   dr->scale *= expf ( delta );
+   if ( dr->scale < dr->minScale )
+      dr->scale = dr->minScale;
+   if ( dr->scale > dr->maxScale )
+      dr->scale = dr->maxScale;
+   UpdateRenderSize ( dr );
+}
+
+///
+//  esEnableDynamicResolution()
+//
+GLboolean ESUTIL_API esEnableDynamicResolution ( ESContext *esContext, float targetTime,
+                                                 float minScale, float maxScale )
+{
+   ESDynamicResolution *dr;
+   GLint maxSize;
+
+   if ( esContext->dynamicResolution != NULL )
+      esDisableDynamicResolution ( esContext );
+
+   if ( targetTime <= 0.0f || minScale <= 0.0f || maxScale < minScale )
+      return GL_FALSE;
+
+   dr = calloc ( 1, sizeof ( ESDynamicResolution ) );
+   if ( dr == NULL )
+      return GL_FALSE;
+
+   glGetIntegerv ( GL_MAX_TEXTURE_SIZE, &maxSize );
+   dr->targetTime = targetTime;
+   dr->minScale = minScale;
+   dr->maxScale = maxScale;
+   dr->scale = maxScale < 1.0f ? maxScale : 1.0f;
+   dr->windowWidth = esContext->width;
+   dr->windowHeight = esContext->height;
+   dr->textureWidth = (GLint) ceilf ( esContext->width * maxScale );
+   dr->textureHeight = (GLint) ceilf ( esContext->height * maxScale );
+   if ( dr->textureWidth > maxSize )
+      dr->textureWidth = maxSize;
+   if ( dr->textureHeight > maxSize )
+      dr->textureHeight = maxSize;
+   dr->nextMeasured = esContext->frameHistory.total;
+
+   esContext->dynamicResolution = dr;
+   if ( !CreateTarget ( dr ) || !CreateUpscalePass ( dr ) )
+   {
+      esLog ( ES_LOG_ERROR, "esEnableDynamicResolution: unable to create the offscreen framebuffer\n" );
+      esDisableDynamicResolution ( esContext );
+      return GL_FALSE;
+   }
+
+   UpdateRenderSize ( dr );
+   esLog ( ES_LOG_INFO, "esEnableDynamicResolution: %.2f ms budget, scale %.2f to %.2f of %dx%d\n",
+           targetTime, minScale, maxScale, dr->windowWidth, dr->windowHeight );
+   return GL_TRUE;
+}
+
+///
+//  esDisableDynamicResolution()
+//
+void ESUTIL_API esDisableDynamicResolution ( ESContext *esContext )
+{
+   ESDynamicResolution *dr = esContext->dynamicResolution;
+
+   if ( dr == NULL )
+      return;
+
+   glDeleteFramebuffers ( 1, &dr->fbo );
+   glDeleteTextures ( 1, &dr->texture );
+   glDeleteRenderbuffers ( 2, dr->renderbuffers );
+   glDeleteProgram ( dr->program );
+   glDeleteBuffers ( 1, &dr->vertexBuffer );
+
+   free ( dr );
+   esContext->dynamicResolution = NULL;
+}
+
+///
+//  esGetRenderScale()
+//
+float ESUTIL_API esGetRenderScale ( ESContext *esContext, GLint *width, GLint *height )
+{
+   ESDynamicResolution *dr = esContext->dynamicResolution;
+
+   if ( width != NULL )
+      *width = dr != NULL ? dr->renderWidth : esContext->width;
+   if ( height != NULL )
+      *height = dr != NULL ? dr->renderHeight : esContext->height;
+   return dr != NULL ? dr->scale : 1.0f;
+}
@@ -0,0 +1,251 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESEGLConfig.c
+//
+//    EGL config selection for esCreateWindow.  eglChooseConfig sorts the
+//    configs with the deepest color first and treats every buffer that was
+//    not asked for as "don't care", so taking its first answer can bring in a
+//    24-bit depth buffer, stencil or multisampling nobody uses.  Here every
+//    config of the display is checked against the minimum sizes the window
+//    flags require and the one that stores the fewest bytes per pixel wins,
+//    with configs carrying a caveat only used when nothing else fits.  For a
+//    window the config must also render in the X visual the window was
+//    created with, or eglCreateWindowSurface fails with EGL_BAD_MATCH.
+//
+
+///
+//  Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "esUtil.h"
+#include "esUtil_internal.h"
+
+///
+// Types
+//
+typedef struct
+{
+   EGLint red;
+   EGLint green;
+   EGLint blue;
+   EGLint alpha;
+   EGLint depth;
+   EGLint stencil;
+   EGLint samples;
+} ConfigSizes;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// StorageBytes()
+//
+//    Bytes a buffer with the given bits per pixel occupies in memory,
+//    assuming it is padded to a power of two
+//
+static int StorageBytes ( int bits )
+{
+   int bytes = 1;
+
+   if ( bits <= 0 )
+      return 0;
+
+   while ( bytes * 8 < bits )
+      bytes *= 2;
+   return bytes;
+}
+
+///
+// RequiredSizes()
+//
+//    Minimum buffer sizes for the esCreateWindow flags.  ES 2.0 guarantees a
+//    16-bit depth buffer, which is all the samples need.
+//
+static void RequiredSizes ( GLuint flags, ConfigSizes *sizes )
+{
+   sizes->red = 5;
+   sizes->green = 6;
+   sizes->blue = 5;
+   sizes->alpha = ( flags & ES_WINDOW_ALPHA ) ? 8 : 0;
+   sizes->depth = ( flags & ES_WINDOW_DEPTH ) ? 16 : 0;
+   sizes->stencil = ( flags & ES_WINDOW_STENCIL ) ? 8 : 0;
+   sizes->samples = ( flags & ES_WINDOW_MULTISAMPLE ) ? 2 : 0;
+}
+
+///
+// ScoreConfig()
+//
+//    Returns -1 if the config does not meet the requirements, otherwise a
+//    score where lower is better.  The caveat decides first, then the bytes
+//    per pixel of all buffers including samples, then the bits beyond what
+//    was asked for.
+//
+static long ScoreConfig ( EGLDisplay display, EGLConfig config, EGLint surfaceType, EGLint visualId,
+                          const ConfigSizes *required, GLboolean floatConfigs )
+{
+   ConfigSizes sizes;
+   EGLint bufferType, renderableType, configSurfaceType, caveat, configVisualId = 0;
+   EGLint componentType = EGL_COLOR_COMPONENT_TYPE_FIXED_EXT;
+   long caveatRank, bytes, excess;
+
+   eglGetConfigAttrib ( display, config, EGL_COLOR_BUFFER_TYPE, &bufferType );
+   eglGetConfigAttrib ( display, config, EGL_RENDERABLE_TYPE, &renderableType );
+   eglGetConfigAttrib ( display, config, EGL_SURFACE_TYPE, &configSurfaceType );
+   eglGetConfigAttrib ( display, config, EGL_CONFIG_CAVEAT, &caveat );
+   if ( floatConfigs )
+      eglGetConfigAttrib ( display, config, EGL_COLOR_COMPONENT_TYPE_EXT, &componentType );
+
+   if ( bufferType != EGL_RGB_BUFFER || componentType != EGL_COLOR_COMPONENT_TYPE_FIXED_EXT ||
+        ( renderableType & EGL_OPENGL_ES2_BIT ) == 0 || ( configSurfaceType & surfaceType ) != surfaceType )
+   {
+      return -1;
+   }
+
+   if ( visualId != 0 )
+   {
+      eglGetConfigAttrib ( display, config, EGL_NATIVE_VISUAL_ID, &configVisualId );
+      if ( configVisualId != visualId )
+         return -1;
+   }
+
+   eglGetConfigAttrib ( display, config, EGL_RED_SIZE, &sizes.red );
+   eglGetConfigAttrib ( display, config, EGL_GREEN_SIZE, &sizes.green );
+   eglGetConfigAttrib ( display, config, EGL_BLUE_SIZE, &sizes.blue );
+   eglGetConfigAttrib ( display, config, EGL_ALPHA_SIZE, &sizes.alpha );
+   eglGetConfigAttrib ( display, config, EGL_DEPTH_SIZE, &sizes.depth );
+   eglGetConfigAttrib ( display, config, EGL_STENCIL_SIZE, &sizes.stencil );
+   eglGetConfigAttrib ( display, config, EGL_SAMPLES, &sizes.samples );
+
+   if ( sizes.red < required->red || sizes.green < required->green || sizes.blue < required->blue ||
+        sizes.alpha < required->alpha || sizes.depth < required->depth ||
+        sizes.stencil < required->stencil || sizes.samples < required->samples )
+   {
+      return -1;
+   }
+
+   caveatRank = caveat == EGL_NON_CONFORMANT_CONFIG ? 2 : caveat == EGL_SLOW_CONFIG ? 1 : 0;
+
+   bytes = ( StorageBytes ( sizes.red + sizes.green + sizes.blue + sizes.alpha ) +
+             StorageBytes ( sizes.depth + sizes.stencil ) ) * ( sizes.samples > 1 ? sizes.samples : 1 );
+
+   excess = ( sizes.red - required->red ) + ( sizes.green - required->green ) + ( sizes.blue - required->blue ) +
+            ( sizes.alpha - required->alpha ) + ( sizes.depth - required->depth ) +
+            ( sizes.stencil - required->stencil ) + ( sizes.samples - required->samples );
+
+   return ( caveatRank << 24 ) | ( bytes << 12 ) | ( excess & 0xfff );
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  ChooseEGLConfig()
+//
+//      Picks the cheapest config that supports surfaceType and the buffers
+//      requested by the esCreateWindow flags.  A visualId other than 0 limits
+//      the choice to configs of that native visual, unless none of them fits.
+//
+EGLBoolean ChooseEGLConfig ( EGLDisplay display, EGLint surfaceType, EGLint visualId, GLuint flags,
+                             EGLConfig *config )
+{
+   const char *extensions = eglQueryString ( display, EGL_EXTENSIONS );
+   GLboolean floatConfigs = extensions != NULL && strstr ( extensions, "EGL_EXT_pixel_format_float" ) != NULL;
+   ConfigSizes required;
+   EGLConfig *configs;
+   EGLint numConfigs = 0;
+   long score, bestScore = -1;
+   int i, pass;
+
+   if ( !eglGetConfigs ( display, NULL, 0, &numConfigs ) || numConfigs < 1 )
+   {
+      return EGL_FALSE;
+   }
+
+   configs = malloc ( numConfigs * sizeof ( EGLConfig ) );
+   if ( configs == NULL || !eglGetConfigs ( display, configs, numConfigs, &numConfigs ) )
+   {
+      free ( configs );
+      return EGL_FALSE;
+   }
+
+   RequiredSizes ( flags, &required );
+
+   // Drivers that do not report native visuals get the best config of any visual
+   for ( pass = visualId != 0 ? 0 : 1; pass < 2 && bestScore < 0; pass++ )
+   {
+      for ( i = 0; i < numConfigs; i++ )
+      {
+         score = ScoreConfig ( display, configs[i], surfaceType, pass == 0 ? visualId : 0, &required,
+                               floatConfigs );
+         if ( score >= 0 && ( bestScore < 0 || score < bestScore ) )
+         {
+            bestScore = score;
+            *config = configs[i];
+         }
+      }
+   }
+
+   free ( configs );
+   return bestScore >= 0 ? EGL_TRUE : EGL_FALSE;
+}
+
+///
+//  DescribeFramebuffer()
+//
+//      Fills in esContext->framebuffer from the framebuffer the context renders
+//      to and logs it with the memory traffic it implies per frame
+//
+void DescribeFramebuffer ( ESContext *esContext )
+{
+   ESFramebufferInfo *info = &esContext->framebuffer;
+   EGLint caveat = EGL_NONE;
+   EGLConfig config;
+   EGLint numConfigs;
+   EGLint configAttribs[] = { EGL_CONFIG_ID, 0, EGL_NONE };
+   int colorBytes, depthStencilBytes, samples;
+
+   eglQueryContext ( esContext->eglDisplay, esContext->eglContext, EGL_CONFIG_ID, &info->configId );
+   configAttribs[1] = info->configId;
+   if ( eglChooseConfig ( esContext->eglDisplay, configAttribs, &config, 1, &numConfigs ) && numConfigs == 1 )
+      eglGetConfigAttrib ( esContext->eglDisplay, config, EGL_CONFIG_CAVEAT, &caveat );
+
+   // Ask GL so the framebuffer object of a surfaceless headless context is described too
+   glGetIntegerv ( GL_RED_BITS, &info->redBits );
+   glGetIntegerv ( GL_GREEN_BITS, &info->greenBits );
+   glGetIntegerv ( GL_BLUE_BITS, &info->blueBits );
+   glGetIntegerv ( GL_ALPHA_BITS, &info->alphaBits );
+   glGetIntegerv ( GL_DEPTH_BITS, &info->depthBits );
+   glGetIntegerv ( GL_STENCIL_BITS, &info->stencilBits );
+   glGetIntegerv ( GL_SAMPLES, &info->samples );
+
+   // Every sample is cleared and written once and its depth and stencil cleared, read and
+   // written once, then the color is read once for display, after a resolve if multisampled
+   colorBytes = StorageBytes ( info->redBits + info->greenBits + info->blueBits + info->alphaBits );
+   depthStencilBytes = StorageBytes ( info->depthBits + info->stencilBits );
+   samples = info->samples > 1 ? info->samples : 1;
+   info->frameBytes = (unsigned long) esContext->width * esContext->height *
+                      ( samples * ( 2 * colorBytes + 3 * depthStencilBytes ) + ( samples > 1 ? 2 * colorBytes : 0 ) + colorBytes );
+
+   esLog ( ES_LOG_INFO, "esCreateWindow: EGL config %d%s, R%dG%dB%dA%d D%dS%d, %d samples, "
+           "%.1f MB framebuffer traffic per frame (%.0f MB/s at 60 fps)\n",
+           info->configId, caveat == EGL_SLOW_CONFIG ? " (slow)" : caveat == EGL_NON_CONFORMANT_CONFIG ? " (non-conformant)" : "",
+           info->redBits, info->greenBits, info->blueBits, info->alphaBits, info->depthBits, info->stencilBits,
+           info->samples, info->frameBytes / ( 1024.0 * 1024.0 ), info->frameBytes * 60.0 / ( 1024.0 * 1024.0 ) );
+}
@@ -0,0 +1,419 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESETC1.c
+//
+//    ETC1 (GL_OES_compressed_ETC1_RGB8_texture) block compression.  Every
+//    4x4 block is stored in 64 bits as two 2x4 or 4x2 halves, each with a
+//    base color and a table of four luminance offsets, and a 2-bit offset
+//    index per pixel.  The encoder searches both ways of splitting the block
+//    and both ways of storing the base colors; the quality level widens the
+//    search around the average color of each half.
+//
+
+///
+//  Includes
+//
+#include <limits.h>
+#include <string.h>
+#include "esUtil.h"
+
+///
+// Defines
+//
+
+// Pixel offsets of the eight modifier tables, indexed by the 2-bit pixel index
+static const int modifierTable[8][4] =
+{
+   {  2,   8,  -2,   -8 },
+   {  5,  17,  -5,  -17 },
+   {  9,  29,  -9,  -29 },
+   { 13,  42, -13,  -42 },
+   { 18,  60, -18,  -60 },
+   { 24,  80, -24,  -80 },
+   { 33, 106, -33, -106 },
+   { 47, 183, -47, -183 }
+};
+
+///
+// Types
+//
+
+// Best encoding found for one half of a block with a given base color
+typedef struct
+{
+   int            error;
+   int            table;
+   int            base[3];
+
+   // Quantized base color, 4 or 5 bits per channel
+   int            quantized[3];
+
+   // Pixel indices in the order of the pixels of the half
+   unsigned char  indices[8];
+} HalfBlock;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// Clamp255()
+//
+static int Clamp255 ( int value )
+{
+   return value < 0 ? 0 : value > 255 ? 255 : value;
+}
+
+///
+// Expand4(), Expand5()
+//
+//    Expands a quantized channel to 8 bits the way the hardware does
+//
+static int Expand4 ( int value )
+{
+   return ( value << 4 ) | value;
+}
+
+static int Expand5 ( int value )
+{
+   return ( value << 3 ) | ( value >> 2 );
+}
+
+///
+// HalfPixels()
+//
+//    Pixel (x, y) positions of the eight pixels of half 0 or 1 of a block,
+//    as offsets x * 4 + y, the order of the index bits
+//
+static void HalfPixels ( int flip, int half, int positions[8] )
+{
+   int i;
+
+   for ( i = 0; i < 8; i++ )
+   {
+      int x = flip ? i % 4 : half * 2 + i / 4;
+      int y = flip ? half * 2 + i / 4 : i % 4;
+      positions[i] = x * 4 + y;
+   }
+}
+
+///
+// EvaluateHalf()
+//
+//    Finds the modifier table and pixel indices with the smallest squared
+//    error for a half block with the given expanded base color.  Gives up
+//    early once the error reaches limit.
+//
+static void EvaluateHalf ( const unsigned char pixels[8][3], const int base[3], int limit, HalfBlock *result )
+{
+   unsigned char indices[8];
+   int t, p, m;
+
+   result->error = INT_MAX;
+
+   for ( t = 0; t < 8; t++ )
+   {
+      int error = 0;
+
+      for ( p = 0; p < 8 && error < limit && error < result->error; p++ )
+      {
+         int best = INT_MAX;
+
+         for ( m = 0; m < 4; m++ )
+         {
+            int dr = Clamp255 ( base[0] + modifierTable[t][m] ) - pixels[p][0];
+            int dg = Clamp255 ( base[1] + modifierTable[t][m] ) - pixels[p][1];
+            int db = Clamp255 ( base[2] + modifierTable[t][m] ) - pixels[p][2];
+            int e = dr * dr + dg * dg + db * db;
+
+            if ( e < best )
+            {
+               best = e;
+               indices[p] = (unsigned char) m;
+            }
+         }
+         error += best;
+      }
+
+      if ( p == 8 && error < result->error )
+      {
+         result->error = error;
+         result->table = t;
+         memcpy ( result->base, base, sizeof ( result->base ) );
+         memcpy ( result->indices, indices, sizeof ( indices ) );
+      }
+   }
+}
+
+///
+// SearchHalf()
+//
+//    Tries base colors quantized to bits per channel within radius steps of
+//    the average color of the half and returns the best of each in results,
+//    ordered like the candidates: ( dr + radius ) * side * side + ...
+//
+static int SearchHalf ( const unsigned char pixels[8][3], int bits, int radius, HalfBlock *results )
+{
+   int levels = ( 1 << bits ) - 1;
+   int side = 2 * radius + 1;
+   int average[3], center[3];
+   int c, i, n = 0;
+
+   for ( c = 0; c < 3; c++ )
+   {
+      int sum = 0;
+
+      for ( i = 0; i < 8; i++ )
+         sum += pixels[i][c];
+      average[c] = ( sum + 4 ) / 8;
+      center[c] = ( average[c] * levels + 127 ) / 255;
+   }
+
+   for ( i = 0; i < side * side * side; i++ )
+   {
+      int quantized[3], base[3];
+
+      quantized[0] = center[0] + i / ( side * side ) - radius;
+      quantized[1] = center[1] + ( i / side ) % side - radius;
+      quantized[2] = center[2] + i % side - radius;
+
+      results[n].error = INT_MAX;
+      if ( quantized[0] >= 0 && quantized[0] <= levels && quantized[1] >= 0 && quantized[1] <= levels &&
+           quantized[2] >= 0 && quantized[2] <= levels )
+      {
+         for ( c = 0; c < 3; c++ )
+            base[c] = bits == 4 ? Expand4 ( quantized[c] ) : Expand5 ( quantized[c] );
+
+         EvaluateHalf ( pixels, base, INT_MAX, &results[n] );
+         memcpy ( results[n].quantized, quantized, sizeof ( quantized ) );
+      }
+      n++;
+   }
+
+   return n;
+}
+
+///
+// PackBlock()
+//
+//    Writes the 64-bit block, most significant byte first
+//
+static void PackBlock ( int differential, int flip, const HalfBlock *half0, const HalfBlock *half1,
+                        unsigned char *block )
+{
+   unsigned int high = 0, low = 0;
+   int positions[8];
+   int h, i, c;
+
+   for ( c = 0; c < 3; c++ )
+   {
+      int shift = 28 - c * 8;
+
+      if ( differential )
+         high |= ( half0->quantized[c] << ( shift - 1 ) ) | ( ( ( half1->quantized[c] - half0->quantized[c] ) & 7 ) << ( shift - 4 ) );
+      else
+         high |= ( half0->quantized[c] << shift ) | ( half1->quantized[c] << ( shift - 4 ) );
+   }
+   high |= ( half0->table << 5 ) | ( half1->table << 2 ) | ( differential << 1 ) | flip;
+
+   for ( h = 0; h < 2; h++ )
+   {
+      const HalfBlock *half = h == 0 ? half0 : half1;
+
+      HalfPixels ( flip, h, positions );
+      for ( i = 0; i < 8; i++ )
+      {
+         low |= ( ( half->indices[i] >> 1 ) & 1 ) << ( positions[i] + 16 );
+         low |= ( half->indices[i] & 1 ) << positions[i];
+      }
+   }
+
+   for ( i = 0; i < 4; i++ )
+   {
+      block[i] = (unsigned char) ( high >> ( 24 - i * 8 ) );
+      block[i + 4] = (unsigned char) ( low >> ( 24 - i * 8 ) );
+   }
+}
+
+///
+// EncodeBlock()
+//
+//    Encodes 16 RGB pixels, stored (x, y) at [y * 4 + x]
+//
+static void EncodeBlock ( const unsigned char pixels[16][3], int quality, unsigned char *block )
+{
+   // At most ( 2 * 2 + 1 )^3 candidates per half
+   HalfBlock individual[2][125], differential[2][125];
+   unsigned char halfPixels[2][8][3];
+   int radius = quality <= 0 ? 0 : quality == 1 ? 1 : 2;
+   int bestError = INT_MAX;
+   int flip, h, i, j, n;
+
+   for ( flip = 0; flip < 2; flip++ )
+   {
+      const HalfBlock *best[2] = { NULL, NULL };
+      int bestDifferential = 0;
+      int error = INT_MAX;
+
+      for ( h = 0; h < 2; h++ )
+      {
+         int positions[8];
+
+         HalfPixels ( flip, h, positions );
+         for ( i = 0; i < 8; i++ )
+            memcpy ( halfPixels[h][i], pixels[( positions[i] % 4 ) * 4 + positions[i] / 4], 3 );
+
+         n = SearchHalf ( halfPixels[h], 4, radius, individual[h] );
+         SearchHalf ( halfPixels[h], 5, radius, differential[h] );
+      }
+
+      // Individual mode, the halves are independent
+      for ( h = 0; h < 2; h++ )
+      {
+         best[h] = &individual[h][0];
+         for ( i = 1; i < n; i++ )
+            if ( individual[h][i].error < best[h]->error )
+               best[h] = &individual[h][i];
+      }
+      if ( best[0]->error != INT_MAX && best[1]->error != INT_MAX )
+         error = best[0]->error + best[1]->error;
+
+      // Differential mode, the second base color must be within -4..3 of the first
+      for ( i = 0; i < n; i++ )
+      {
+         if ( differential[0][i].error >= error )
+            continue;
+
+         for ( j = 0; j < n; j++ )
+         {
+            const HalfBlock *a = &differential[0][i], *b = &differential[1][j];
+            int dr = b->quantized[0] - a->quantized[0];
+            int dg = b->quantized[1] - a->quantized[1];
+            int db = b->quantized[2] - a->quantized[2];
+
+            if ( b->error == INT_MAX || dr < -4 || dr > 3 || dg < -4 || dg > 3 || db < -4 || db > 3 )
+               continue;
+
+            if ( a->error + b->error < error )
+            {
+               error = a->error + b->error;
+               best[0] = a;
+               best[1] = b;
+               bestDifferential = 1;
+            }
+         }
+      }
+
+      if ( error < bestError )
+      {
+         bestError = error;
+         PackBlock ( bestDifferential, flip, best[0], best[1], block );
+      }
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+// esEncodeETC1()
+//
+//    Compresses an RGB image, top row first, into ETC1 blocks.  Partial
+//    blocks at the right and bottom edges repeat the last column and row.
+//
+void ESUTIL_API esEncodeETC1 ( const unsigned char *rgb, int width, int height, int quality, unsigned char *data )
+{
+   unsigned char pixels[16][3];
+   int bx, by, x, y;
+
+   for ( by = 0; by < height; by += 4 )
+   {
+      for ( bx = 0; bx < width; bx += 4, data += 8 )
+      {
+         for ( y = 0; y < 4; y++ )
+         {
+            for ( x = 0; x < 4; x++ )
+            {
+               int sx = bx + x < width ? bx + x : width - 1;
+               int sy = by + y < height ? by + y : height - 1;
+
+               memcpy ( pixels[y * 4 + x], rgb + ( (size_t) sy * width + sx ) * 3, 3 );
+            }
+         }
+
+         EncodeBlock ( pixels, quality, data );
+      }
+   }
+}
+
+///
+// esDecodeETC1()
+//
+//    Decompresses ETC1 blocks into a tightly packed RGB image
+//
+void ESUTIL_API esDecodeETC1 ( const unsigned char *data, int width, int height, unsigned char *rgb )
+{
+   int bx, by, x, y, h, c;
+
+   for ( by = 0; by < height; by += 4 )
+   {
+      for ( bx = 0; bx < width; bx += 4, data += 8 )
+      {
+         unsigned int high = ( data[0] << 24 ) | ( data[1] << 16 ) | ( data[2] << 8 ) | data[3];
+         unsigned int low = ( data[4] << 24 ) | ( data[5] << 16 ) | ( data[6] << 8 ) | data[7];
+         int flip = high & 1;
+         int base[2][3];
+         int table[2];
+
+         table[0] = ( high >> 5 ) & 7;
+         table[1] = ( high >> 2 ) & 7;
+
+         for ( c = 0; c < 3; c++ )
+         {
+            int shift = 28 - c * 8;
+
+            if ( high & 2 )
+            {
+               int first = ( high >> ( shift - 1 ) ) & 31;
+               int delta = ( high >> ( shift - 4 ) ) & 7;
+
+               // The delta is a signed 3-bit value
+               base[0][c] = Expand5 ( first );
+               base[1][c] = Expand5 ( ( first + ( delta >= 4 ? delta - 8 : delta ) ) & 31 );
+            }
+            else
+            {
+               base[0][c] = Expand4 ( ( high >> shift ) & 15 );
+               base[1][c] = Expand4 ( ( high >> ( shift - 4 ) ) & 15 );
+            }
+         }
+
+         for ( y = 0; y < 4 && by + y < height; y++ )
+         {
+            for ( x = 0; x < 4 && bx + x < width; x++ )
+            {
+               int k = x * 4 + y;
+               int index = ( ( ( low >> ( k + 16 ) ) & 1 ) << 1 ) | ( ( low >> k ) & 1 );
+               unsigned char *dst = rgb + ( (size_t) ( by + y ) * width + bx + x ) * 3;
+
+               h = flip ? y >= 2 : x >= 2;
+               for ( c = 0; c < 3; c++ )
+                  dst[c] = (unsigned char) Clamp255 ( base[h][c] + modifierTable[table[h]][index] );
+            }
+         }
+      }
+   }
+}
@@ -0,0 +1,256 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESFrameStats.c
+//
+//    Frame timing history and percentile statistics.  esMainLoop records
+//    the update, draw and swap time of every frame into a ring buffer so
+//    that the spikes an average frame rate hides can be reported.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// CompareFloat()
+//
+//    qsort() comparison function for floats
+//
+static int CompareFloat ( const void *a, const void *b )
+{
+   float fa = *(const float *) a;
+   float fb = *(const float *) b;
+
+   return ( fa > fb ) - ( fa < fb );
+}
+
+///
+// Percentile()
+//
+//    Nearest-rank percentile of a sorted array
+//
+static float Percentile ( const float *sorted, unsigned int count, float percent )
+{
+   unsigned int rank = (unsigned int) ( percent / 100.0f * count + 0.5f );
+
+   if ( rank < 1 )
+      rank = 1;
+   if ( rank > count )
+      rank = count;
+
+   return sorted[rank - 1];
+}
+
+///
+// ComputeTimeStats()
+//
+//    Sort values in place and fill in the statistics for them
+//
+static void ComputeTimeStats ( float *values, unsigned int count, ESTimeStats *stats )
+{
+   unsigned int i;
+   float sum = 0.0f;
+   float squares = 0.0f;
+
+   memset ( stats, 0, sizeof ( ESTimeStats ) );
+   if ( count == 0 )
+      return;
+
+   for ( i = 0; i < count; i++ )
+      sum += values[i];
+   stats->avg = sum / count;
+
+   if ( count > 1 )
+   {
+      for ( i = 0; i < count; i++ )
+         squares += ( values[i] - stats->avg ) * ( values[i] - stats->avg );
+      stats->stddev = sqrtf ( squares / ( count - 1 ) );
+   }
+
+   qsort ( values, count, sizeof ( float ), CompareFloat );
+
+   stats->p50 = Percentile ( values, count, 50.0f );
+   stats->p95 = Percentile ( values, count, 95.0f );
+   stats->p99 = Percentile ( values, count, 99.0f );
+   stats->max = values[count - 1];
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esRecordFrameTime()
+//
+void ESUTIL_API esRecordFrameTime ( ESContext *esContext, const ESFrameTime *frameTime )
+{
+   ESFrameHistory *history = &esContext->frameHistory;
+
+   history->frames[history->next] = *frameTime;
+   history->next = ( history->next + 1 ) % ES_FRAME_HISTORY;
+
+   if ( history->count < ES_FRAME_HISTORY )
+      history->count++;
+   history->total++;
+}
+
+///
+//  esRecordGpuTime()
+//
+void ESUTIL_API esRecordGpuTime ( ESContext *esContext, unsigned int frameNumber,
+                                  const float *passTimes, int numPasses )
+{
+   ESFrameHistory *history = &esContext->frameHistory;
+   ESFrameTime *frameTime;
+   int i;
+
+   // The slot has been reused if the frame is older than the history
+   if ( frameNumber >= history->total || history->total - frameNumber > history->count )
+      return;
+
+   frameTime = &history->frames[frameNumber % ES_FRAME_HISTORY];
+   frameTime->gpu = 0.0f;
+   for ( i = 0; i < numPasses && i < ES_MAX_GPU_PASSES; i++ )
+   {
+      frameTime->gpuPass[i] = passTimes[i];
+      frameTime->gpu += passTimes[i];
+   }
+   for ( ; i < ES_MAX_GPU_PASSES; i++ )
+      frameTime->gpuPass[i] = 0.0f;
+}
+
+///
+//  esGetFrameStats()
+//
+void ESUTIL_API esGetFrameStats ( ESContext *esContext, ESFrameStats *stats )
+{
+   ESFrameHistory *history = &esContext->frameHistory;
+   float values[ES_FRAME_HISTORY];
+   unsigned int count = history->count;
+   unsigned int gpuCount;
+   unsigned int i;
+   int pass;
+   float threshold;
+
+   memset ( stats, 0, sizeof ( ESFrameStats ) );
+   stats->numFrames = count;
+
+   for ( i = 0; i < count; i++ )
+      values[i] = history->frames[i].update;
+   ComputeTimeStats ( values, count, &stats->update );
+
+   for ( i = 0; i < count; i++ )
+      values[i] = history->frames[i].draw;
+   ComputeTimeStats ( values, count, &stats->draw );
+
+   for ( i = 0; i < count; i++ )
+      values[i] = history->frames[i].swap;
+   ComputeTimeStats ( values, count, &stats->swap );
+
+   gpuCount = 0;
+   for ( i = 0; i < count; i++ )
+   {
+      if ( history->frames[i].gpu >= 0.0f )
+         values[gpuCount++] = history->frames[i].gpu;
+   }
+   stats->numGpuFrames = gpuCount;
+   ComputeTimeStats ( values, gpuCount, &stats->gpu );
+
+   for ( pass = 0; pass < ES_MAX_GPU_PASSES; pass++ )
+   {
+      gpuCount = 0;
+      for ( i = 0; i < count; i++ )
+      {
+         if ( history->frames[i].gpu >= 0.0f )
+            values[gpuCount++] = history->frames[i].gpuPass[pass];
+      }
+      ComputeTimeStats ( values, gpuCount, &stats->gpuPass[pass] );
+   }
+
+   for ( i = 0; i < count; i++ )
+      values[i] = history->frames[i].frame;
+   ComputeTimeStats ( values, count, &stats->frame );
+
+   // values is now sorted, so the stutters are the tail above the threshold
+   threshold = stats->frame.p50 * ES_STUTTER_FACTOR;
+   for ( i = count; i > 0 && values[i - 1] > threshold; i-- )
+      stats->stutters++;
+}
+
+///
+// WriteTimeStats()
+//
+static void WriteTimeStats ( FILE *file, const char *name, const ESTimeStats *stats )
+{
+   fprintf ( file, "  \"%s\": {\"avg\":%.4f,\"stddev\":%.4f,\"p50\":%.4f,\"p95\":%.4f,\"p99\":%.4f,\"max\":%.4f}",
+             name, stats->avg, stats->stddev, stats->p50, stats->p95, stats->p99, stats->max );
+}
+
+///
+//  esWriteFrameStats()
+//
+//    The statistics only cover the frames still in the history, i.e. the
+//    last ES_FRAME_HISTORY frames.
+//
+GLboolean ESUTIL_API esWriteFrameStats ( ESContext *esContext, const char *fileName )
+{
+   ESFrameStats stats;
+   FILE *file = fopen ( fileName, "w" );
+
+   if ( file == NULL )
+   {
+      esLog ( ES_LOG_ERROR, "esWriteFrameStats: unable to open %s\n", fileName );
+      return GL_FALSE;
+   }
+
+   esGetFrameStats ( esContext, &stats );
+
+   fprintf ( file, "{\n  \"width\": %d,\n  \"height\": %d,\n", esContext->width, esContext->height );
+   fprintf ( file, "  \"totalFrames\": %u,\n  \"numFrames\": %u,\n  \"stutters\": %u,\n",
+             esContext->frameHistory.total, stats.numFrames, stats.stutters );
+   WriteTimeStats ( file, "frame", &stats.frame );
+   fprintf ( file, ",\n" );
+   WriteTimeStats ( file, "update", &stats.update );
+   fprintf ( file, ",\n" );
+   WriteTimeStats ( file, "draw", &stats.draw );
+   fprintf ( file, ",\n" );
+   WriteTimeStats ( file, "swap", &stats.swap );
+   if ( stats.numGpuFrames > 0 )
+   {
+      fprintf ( file, ",\n" );
+      WriteTimeStats ( file, "gpu", &stats.gpu );
+   }
+   fprintf ( file, "\n}\n" );
+
+   fclose ( file );
+   return GL_TRUE;
+}
+
+///
+//  esResetFrameStats()
+//
+void ESUTIL_API esResetFrameStats ( ESContext *esContext )
+{
+   memset ( &esContext->frameHistory, 0, sizeof ( ESFrameHistory ) );
+}
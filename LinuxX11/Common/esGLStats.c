@@ -0,0 +1,493 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESGLStats.c
+//
+//    Per-frame GL call statistics, built only with -DES_GL_STATS
+//    (make GLSTATS=1).  esUtil.h then renames the GL entry points used by
+//    Common and the examples to the esGLStats* wrappers below, which count
+//    the call and forward it to GL.  Besides call counts the wrappers track
+//    how many bytes a frame uploads: buffer and texture data, and the vertex
+//    data that draws with client-side arrays make the driver copy.  They only
+//    see calls made through them, e.g. not those made inside the driver.
+//
+#ifdef ES_GL_STATS
+
+// Forward to the real entry points in this file
+#define ES_GL_STATS_IMPL
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <string.h>
+
+///
+// Defines
+//
+#define MAX_VERTEX_ATTRIBS    16
+
+///
+// Types
+//
+typedef struct
+{
+   GLboolean   enabled;
+   GLboolean   clientArray;
+   GLsizei     elementSize;
+} ESAttribState;
+
+///
+// Local variables
+//
+static ESGLStats        stats;
+static ESGLCallCounts   counts;
+static ESAttribState    attribs[MAX_VERTEX_ATTRIBS];
+static GLuint           arrayBuffer;
+static GLuint           elementArrayBuffer;
+static GLint            unpackAlignment = 4;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// TypeSize()
+//
+static GLsizei TypeSize ( GLenum type )
+{
+   switch ( type )
+   {
+      case GL_BYTE:
+      case GL_UNSIGNED_BYTE:  return 1;
+      case GL_SHORT:
+      case GL_UNSIGNED_SHORT: return 2;
+      default:                return 4;
+   }
+}
+
+///
+// PixelSize()
+//
+//    Size in bytes of one pixel of client texture data
+//
+static GLsizei PixelSize ( GLenum format, GLenum type )
+{
+   if ( type != GL_UNSIGNED_BYTE )
+      return 2; // The packed 565, 4444 and 5551 types
+
+   switch ( format )
+   {
+      case GL_RGBA:              return 4;
+      case GL_RGB:               return 3;
+      case GL_LUMINANCE_ALPHA:   return 2;
+      default:                   return 1;
+   }
+}
+
+///
+// ImageSize()
+//
+//    Size of client texture data, with rows padded to GL_UNPACK_ALIGNMENT
+//
+static unsigned long ImageSize ( GLsizei width, GLsizei height, GLenum format, GLenum type )
+{
+   unsigned long row = (unsigned long) width * PixelSize ( format, type );
+
+   row = ( row + unpackAlignment - 1 ) / unpackAlignment * unpackAlignment;
+   return row * height;
+}
+
+///
+// CountDraw()
+//
+//    Counts a draw of numVertices vertices and the client-side vertex data
+//    the driver has to copy for it
+//
+static void CountDraw ( GLsizei count, GLsizei numVertices )
+{
+   int i;
+
+   counts.drawCalls++;
+   counts.vertices += count;
+
+   for ( i = 0; i < MAX_VERTEX_ATTRIBS; i++ )
+   {
+      if ( attribs[i].enabled && attribs[i].clientArray )
+         counts.clientArrayBytes += (unsigned long) numVertices * attribs[i].elementSize;
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  Draw calls
+//
+void ESUTIL_API esGLStatsDrawArrays ( GLenum mode, GLint first, GLsizei count )
+{
+   CountDraw ( count, count );
+   glDrawArrays ( mode, first, count );
+}
+
+///
+//  esGLStatsDrawElements()
+//
+//    Client-side indices are scanned for the highest index to know how many
+//    vertices the draw references.  With an index buffer the index count is
+//    used instead.
+//
+void ESUTIL_API esGLStatsDrawElements ( GLenum mode, GLsizei count, GLenum type, const GLvoid *indices )
+{
+   GLsizei numVertices = count;
+
+   if ( elementArrayBuffer == 0 && indices != NULL )
+   {
+      GLuint maxIndex = 0;
+      GLsizei i;
+
+      for ( i = 0; i < count; i++ )
+      {
+         GLuint index;
+
+         if ( type == GL_UNSIGNED_BYTE )
+            index = ( (const GLubyte *) indices )[i];
+         else if ( type == GL_UNSIGNED_SHORT )
+            index = ( (const GLushort *) indices )[i];
+         else
+            index = ( (const GLuint *) indices )[i];
+         if ( index > maxIndex )
+            maxIndex = index;
+      }
+
+      numVertices = count > 0 ? (GLsizei) maxIndex + 1 : 0;
+      counts.clientArrayBytes += (unsigned long) count * TypeSize ( type );
+   }
+
+   CountDraw ( count, numVertices );
+   glDrawElements ( mode, count, type, indices );
+}
+
+void ESUTIL_API esGLStatsClear ( GLbitfield mask )
+{
+   counts.clears++;
+   glClear ( mask );
+}
+
+///
+//  State changes
+//
+void ESUTIL_API esGLStatsEnable ( GLenum cap )
+{
+   counts.stateChanges++;
+   glEnable ( cap );
+}
+
+void ESUTIL_API esGLStatsDisable ( GLenum cap )
+{
+   counts.stateChanges++;
+   glDisable ( cap );
+}
+
+void ESUTIL_API esGLStatsBlendFunc ( GLenum sfactor, GLenum dfactor )
+{
+   counts.stateChanges++;
+   glBlendFunc ( sfactor, dfactor );
+}
+
+void ESUTIL_API esGLStatsDepthFunc ( GLenum func )
+{
+   counts.stateChanges++;
+   glDepthFunc ( func );
+}
+
+void ESUTIL_API esGLStatsDepthMask ( GLboolean flag )
+{
+   counts.stateChanges++;
+   glDepthMask ( flag );
+}
+
+void ESUTIL_API esGLStatsCullFace ( GLenum mode )
+{
+   counts.stateChanges++;
+   glCullFace ( mode );
+}
+
+void ESUTIL_API esGLStatsStencilFunc ( GLenum func, GLint ref, GLuint mask )
+{
+   counts.stateChanges++;
+   glStencilFunc ( func, ref, mask );
+}
+
+void ESUTIL_API esGLStatsStencilOp ( GLenum fail, GLenum zfail, GLenum zpass )
+{
+   counts.stateChanges++;
+   glStencilOp ( fail, zfail, zpass );
+}
+
+void ESUTIL_API esGLStatsStencilMask ( GLuint mask )
+{
+   counts.stateChanges++;
+   glStencilMask ( mask );
+}
+
+void ESUTIL_API esGLStatsViewport ( GLint x, GLint y, GLsizei width, GLsizei height )
+{
+   counts.stateChanges++;
+   glViewport ( x, y, width, height );
+}
+
+void ESUTIL_API esGLStatsClearColor ( GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha )
+{
+   counts.stateChanges++;
+   glClearColor ( red, green, blue, alpha );
+}
+
+void ESUTIL_API esGLStatsClearDepthf ( GLclampf depth )
+{
+   counts.stateChanges++;
+   glClearDepthf ( depth );
+}
+
+void ESUTIL_API esGLStatsClearStencil ( GLint s )
+{
+   counts.stateChanges++;
+   glClearStencil ( s );
+}
+
+void ESUTIL_API esGLStatsPixelStorei ( GLenum pname, GLint param )
+{
+   counts.stateChanges++;
+   if ( pname == GL_UNPACK_ALIGNMENT )
+      unpackAlignment = param;
+   glPixelStorei ( pname, param );
+}
+
+void ESUTIL_API esGLStatsTexParameteri ( GLenum target, GLenum pname, GLint param )
+{
+   counts.stateChanges++;
+   glTexParameteri ( target, pname, param );
+}
+
+///
+//  Object bindings
+//
+void ESUTIL_API esGLStatsUseProgram ( GLuint program )
+{
+   counts.bindings++;
+   glUseProgram ( program );
+}
+
+void ESUTIL_API esGLStatsActiveTexture ( GLenum texture )
+{
+   counts.bindings++;
+   glActiveTexture ( texture );
+}
+
+void ESUTIL_API esGLStatsBindTexture ( GLenum target, GLuint texture )
+{
+   counts.bindings++;
+   glBindTexture ( target, texture );
+}
+
+void ESUTIL_API esGLStatsBindBuffer ( GLenum target, GLuint buffer )
+{
+   counts.bindings++;
+   if ( target == GL_ARRAY_BUFFER )
+      arrayBuffer = buffer;
+   else if ( target == GL_ELEMENT_ARRAY_BUFFER )
+      elementArrayBuffer = buffer;
+   glBindBuffer ( target, buffer );
+}
+
+void ESUTIL_API esGLStatsBindFramebuffer ( GLenum target, GLuint framebuffer )
+{
+   counts.bindings++;
+   glBindFramebuffer ( target, framebuffer );
+}
+
+void ESUTIL_API esGLStatsBindRenderbuffer ( GLenum target, GLuint renderbuffer )
+{
+   counts.bindings++;
+   glBindRenderbuffer ( target, renderbuffer );
+}
+
+///
+//  Vertex attributes
+//
+void ESUTIL_API esGLStatsVertexAttribPointer ( GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                               GLsizei stride, const GLvoid *ptr )
+{
+   counts.stateChanges++;
+   if ( index < MAX_VERTEX_ATTRIBS )
+   {
+      attribs[index].clientArray = arrayBuffer == 0;
+      attribs[index].elementSize = size * TypeSize ( type );
+   }
+   glVertexAttribPointer ( index, size, type, normalized, stride, ptr );
+}
+
+void ESUTIL_API esGLStatsEnableVertexAttribArray ( GLuint index )
+{
+   counts.stateChanges++;
+   if ( index < MAX_VERTEX_ATTRIBS )
+      attribs[index].enabled = GL_TRUE;
+   glEnableVertexAttribArray ( index );
+}
+
+void ESUTIL_API esGLStatsDisableVertexAttribArray ( GLuint index )
+{
+   counts.stateChanges++;
+   if ( index < MAX_VERTEX_ATTRIBS )
+      attribs[index].enabled = GL_FALSE;
+   glDisableVertexAttribArray ( index );
+}
+
+///
+//  Uniforms
+//
+void ESUTIL_API esGLStatsUniform1i ( GLint location, GLint x )
+{
+   counts.uniformUpdates++;
+   glUniform1i ( location, x );
+}
+
+void ESUTIL_API esGLStatsUniform1f ( GLint location, GLfloat x )
+{
+   counts.uniformUpdates++;
+   glUniform1f ( location, x );
+}
+
+void ESUTIL_API esGLStatsUniform2f ( GLint location, GLfloat x, GLfloat y )
+{
+   counts.uniformUpdates++;
+   glUniform2f ( location, x, y );
+}
+
+void ESUTIL_API esGLStatsUniform3f ( GLint location, GLfloat x, GLfloat y, GLfloat z )
+{
+   counts.uniformUpdates++;
+   glUniform3f ( location, x, y, z );
+}
+
+void ESUTIL_API esGLStatsUniform4f ( GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w )
+{
+   counts.uniformUpdates++;
+   glUniform4f ( location, x, y, z, w );
+}
+
+void ESUTIL_API esGLStatsUniform1fv ( GLint location, GLsizei count, const GLfloat *v )
+{
+   counts.uniformUpdates++;
+   glUniform1fv ( location, count, v );
+}
+
+void ESUTIL_API esGLStatsUniform2fv ( GLint location, GLsizei count, const GLfloat *v )
+{
+   counts.uniformUpdates++;
+   glUniform2fv ( location, count, v );
+}
+
+void ESUTIL_API esGLStatsUniform3fv ( GLint location, GLsizei count, const GLfloat *v )
+{
+   counts.uniformUpdates++;
+   glUniform3fv ( location, count, v );
+}
+
+void ESUTIL_API esGLStatsUniform4fv ( GLint location, GLsizei count, const GLfloat *v )
+{
+   counts.uniformUpdates++;
+   glUniform4fv ( location, count, v );
+}
+
+void ESUTIL_API esGLStatsUniformMatrix4fv ( GLint location, GLsizei count, GLboolean transpose, const GLfloat *value )
+{
+   counts.uniformUpdates++;
+   glUniformMatrix4fv ( location, count, transpose, value );
+}
+
+///
+//  Uploads
+//
+void ESUTIL_API esGLStatsBufferData ( GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage )
+{
+   counts.uploads++;
+   if ( data != NULL )
+      counts.bufferBytes += size;
+   glBufferData ( target, size, data, usage );
+}
+
+void ESUTIL_API esGLStatsBufferSubData ( GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data )
+{
+   counts.uploads++;
+   counts.bufferBytes += size;
+   glBufferSubData ( target, offset, size, data );
+}
+
+void ESUTIL_API esGLStatsTexImage2D ( GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                                      GLint border, GLenum format, GLenum type, const GLvoid *pixels )
+{
+   counts.uploads++;
+   if ( pixels != NULL )
+      counts.textureBytes += ImageSize ( width, height, format, type );
+   glTexImage2D ( target, level, internalformat, width, height, border, format, type, pixels );
+}
+
+void ESUTIL_API esGLStatsTexSubImage2D ( GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                                         GLsizei width, GLsizei height, GLenum format, GLenum type,
+                                         const GLvoid *pixels )
+{
+   counts.uploads++;
+   counts.textureBytes += ImageSize ( width, height, format, type );
+   glTexSubImage2D ( target, level, xoffset, yoffset, width, height, format, type, pixels );
+}
+
+void ESUTIL_API esGLStatsCompressedTexImage2D ( GLenum target, GLint level, GLenum internalformat, GLsizei width,
+                                                GLsizei height, GLint border, GLsizei imageSize, const GLvoid *data )
+{
+   counts.uploads++;
+   counts.textureBytes += imageSize;
+   glCompressedTexImage2D ( target, level, internalformat, width, height, border, imageSize, data );
+}
+
+///
+//  esGLStatsEndFrame()
+//
+void ESUTIL_API esGLStatsEndFrame ( void )
+{
+   stats.frame = counts;
+   stats.total.drawCalls += counts.drawCalls;
+   stats.total.vertices += counts.vertices;
+   stats.total.clears += counts.clears;
+   stats.total.stateChanges += counts.stateChanges;
+   stats.total.bindings += counts.bindings;
+   stats.total.uniformUpdates += counts.uniformUpdates;
+   stats.total.uploads += counts.uploads;
+   stats.total.bufferBytes += counts.bufferBytes;
+   stats.total.textureBytes += counts.textureBytes;
+   stats.total.clientArrayBytes += counts.clientArrayBytes;
+   stats.frames++;
+   memset ( &counts, 0, sizeof ( counts ) );
+}
+
+///
+//  esGetGLStats()
+//
+void ESUTIL_API esGetGLStats ( ESGLStats *glStats )
+{
+   *glStats = stats;
+}
+
+#endif // ES_GL_STATS
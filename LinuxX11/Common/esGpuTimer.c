@@ -0,0 +1,376 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESGpuTimer.c
+//
+//    GPU time per render pass.  With EXT_disjoint_timer_query every pass is
+//    wrapped in a GL_TIME_ELAPSED_EXT query from a pool of
+//    ES_GPU_TIMER_LATENCY frames, and results are collected a few frames
+//    later when they are available, so the CPU never waits on the GPU.
+//    Without the extension each pass is bracketed by fences that the CPU
+//    waits on, which gives usable numbers at the cost of serializing CPU and
+//    GPU.  Resolved times are written into the frame timing history entry of
+//    the frame they were measured in.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdlib.h>
+#include <string.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2ext.h>
+
+///
+// Defines
+//
+
+// Number of frames of queries in flight before results are read back
+#define ES_GPU_TIMER_LATENCY   4
+
+///
+// Types
+//
+typedef struct
+{
+   GLuint         queries[ES_MAX_GPU_PASSES];
+   unsigned int   usedPasses;
+   int            numPasses;
+   unsigned int   frameNumber;
+   GLboolean      pending;
+} ESGpuTimerFrame;
+
+typedef struct _esgputimer
+{
+   GLboolean      useQueries;
+   ESGpuTimerFrame frames[ES_GPU_TIMER_LATENCY];
+   int            current;
+   int            activePass;
+   const char    *passNames[ES_MAX_GPU_PASSES];
+   int            numPassNames;
+
+   // Fence fallback
+   EGLDisplay     display;
+   double         passStart;
+   float          fenceTimes[ES_MAX_GPU_PASSES];
+
+   PFNGLGENQUERIESEXTPROC              genQueries;
+   PFNGLDELETEQUERIESEXTPROC           deleteQueries;
+   PFNGLBEGINQUERYEXTPROC              beginQuery;
+   PFNGLENDQUERYEXTPROC                endQuery;
+   PFNGLGETQUERYOBJECTUIVEXTPROC       getQueryObjectuiv;
+   PFNGLGETQUERYOBJECTUI64VEXTPROC     getQueryObjectui64v;
+   PFNEGLCREATESYNCKHRPROC             createSync;
+   PFNEGLDESTROYSYNCKHRPROC            destroySync;
+   PFNEGLCLIENTWAITSYNCKHRPROC         clientWaitSync;
+} ESGpuTimer;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// WaitForGpu()
+//
+//    Blocks until the GPU has executed all commands issued so far
+//
+static void WaitForGpu ( ESGpuTimer *timer )
+{
+   if ( timer->createSync != NULL )
+   {
+      EGLSyncKHR sync = timer->createSync ( timer->display, EGL_SYNC_FENCE_KHR, NULL );
+
+      if ( sync != EGL_NO_SYNC_KHR )
+      {
+         timer->clientWaitSync ( timer->display, sync, EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, EGL_FOREVER_KHR );
+         timer->destroySync ( timer->display, sync );
+         return;
+      }
+   }
+   glFinish ( );
+}
+
+///
+// PassIndex()
+//
+//    Returns the slot for a pass name, registering it on first use
+//
+static int PassIndex ( ESGpuTimer *timer, const char *name )
+{
+   int i;
+
+   for ( i = 0; i < timer->numPassNames; i++ )
+   {
+      if ( strcmp ( timer->passNames[i], name ) == 0 )
+         return i;
+   }
+
+   if ( timer->numPassNames == ES_MAX_GPU_PASSES )
+      return -1;
+
+   timer->passNames[timer->numPassNames] = name;
+   return timer->numPassNames++;
+}
+
+///
+// CollectResults()
+//
+//    Reads back every pending frame whose queries have all completed.  As
+//    EXT_disjoint_timer_query asks, the disjoint flag is read after the
+//    results are available and before they are used.
+//
+static void CollectResults ( ESContext *esContext, ESGpuTimer *timer )
+{
+   int i, j;
+
+   for ( i = 1; i <= ES_GPU_TIMER_LATENCY; i++ )
+   {
+      ESGpuTimerFrame *frame = &timer->frames[( timer->current + i ) % ES_GPU_TIMER_LATENCY];
+      float passTimes[ES_MAX_GPU_PASSES];
+      GLuint available = GL_TRUE;
+      GLint disjoint = 0;
+      int p;
+
+      if ( !frame->pending )
+         continue;
+
+      for ( p = 0; p < frame->numPasses && available; p++ )
+      {
+         if ( frame->usedPasses & ( 1u << p ) )
+            timer->getQueryObjectuiv ( frame->queries[p], GL_QUERY_RESULT_AVAILABLE_EXT, &available );
+      }
+
+      // Queries complete in order, so later frames cannot be ready either
+      if ( !available )
+         break;
+
+      // A disjoint event (e.g. a GPU frequency change) invalidates every query in flight,
+      // and reading the flag clears it
+      glGetIntegerv ( GL_GPU_DISJOINT_EXT, &disjoint );
+      if ( disjoint )
+      {
+         for ( j = 0; j < ES_GPU_TIMER_LATENCY; j++ )
+            timer->frames[j].pending = GL_FALSE;
+         return;
+      }
+
+      for ( p = 0; p < frame->numPasses; p++ )
+      {
+         GLuint64 ns = 0;
+
+         if ( frame->usedPasses & ( 1u << p ) )
+            timer->getQueryObjectui64v ( frame->queries[p], GL_QUERY_RESULT_EXT, &ns );
+         passTimes[p] = (float) ( ns / 1.0e6 );
+      }
+
+      esRecordGpuTime ( esContext, frame->frameNumber, passTimes, frame->numPasses );
+      frame->pending = GL_FALSE;
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esGpuTimerEnable()
+//
+GLboolean ESUTIL_API esGpuTimerEnable ( ESContext *esContext )
+{
+   const char *extensions = (const char *) glGetString ( GL_EXTENSIONS );
+   const char *eglExtensions;
+   ESGpuTimer *timer;
+   int i;
+
+   if ( esContext->gpuTimer != NULL )
+      return GL_TRUE;
+
+   timer = calloc ( 1, sizeof ( ESGpuTimer ) );
+   if ( timer == NULL )
+      return GL_FALSE;
+
+   timer->activePass = -1;
+   timer->display = esContext->eglDisplay;
+
+   if ( extensions != NULL && strstr ( extensions, "GL_EXT_disjoint_timer_query" ) != NULL )
+   {
+      timer->genQueries = (PFNGLGENQUERIESEXTPROC) eglGetProcAddress ( "glGenQueriesEXT" );
+      timer->deleteQueries = (PFNGLDELETEQUERIESEXTPROC) eglGetProcAddress ( "glDeleteQueriesEXT" );
+      timer->beginQuery = (PFNGLBEGINQUERYEXTPROC) eglGetProcAddress ( "glBeginQueryEXT" );
+      timer->endQuery = (PFNGLENDQUERYEXTPROC) eglGetProcAddress ( "glEndQueryEXT" );
+      timer->getQueryObjectuiv = (PFNGLGETQUERYOBJECTUIVEXTPROC) eglGetProcAddress ( "glGetQueryObjectuivEXT" );
+      timer->getQueryObjectui64v = (PFNGLGETQUERYOBJECTUI64VEXTPROC) eglGetProcAddress ( "glGetQueryObjectui64vEXT" );
+
+      timer->useQueries = timer->genQueries && timer->deleteQueries && timer->beginQuery &&
+                          timer->endQuery && timer->getQueryObjectuiv && timer->getQueryObjectui64v;
+   }
+
+   if ( timer->useQueries )
+   {
+      for ( i = 0; i < ES_GPU_TIMER_LATENCY; i++ )
+         timer->genQueries ( ES_MAX_GPU_PASSES, timer->frames[i].queries );
+   }
+   else
+   {
+      eglExtensions = eglQueryString ( timer->display, EGL_EXTENSIONS );
+      if ( eglExtensions != NULL && strstr ( eglExtensions, "EGL_KHR_fence_sync" ) != NULL )
+      {
+         timer->createSync = (PFNEGLCREATESYNCKHRPROC) eglGetProcAddress ( "eglCreateSyncKHR" );
+         timer->destroySync = (PFNEGLDESTROYSYNCKHRPROC) eglGetProcAddress ( "eglDestroySyncKHR" );
+         timer->clientWaitSync = (PFNEGLCLIENTWAITSYNCKHRPROC) eglGetProcAddress ( "eglClientWaitSyncKHR" );
+         if ( !timer->destroySync || !timer->clientWaitSync )
+            timer->createSync = NULL;
+      }
+      esLog ( ES_LOG_WARNING, "esGpuTimerEnable: GL_EXT_disjoint_timer_query not available, "
+              "timing passes with %s (serializes CPU and GPU)\n",
+              timer->createSync ? "EGL fences" : "glFinish" );
+   }
+
+   esContext->gpuTimer = timer;
+   return GL_TRUE;
+}
+
+///
+//  esGpuTimerDisable()
+//
+void ESUTIL_API esGpuTimerDisable ( ESContext *esContext )
+{
+   ESGpuTimer *timer = esContext->gpuTimer;
+   int i;
+
+   if ( timer == NULL )
+      return;
+
+   if ( timer->useQueries )
+   {
+      for ( i = 0; i < ES_GPU_TIMER_LATENCY; i++ )
+         timer->deleteQueries ( ES_MAX_GPU_PASSES, timer->frames[i].queries );
+   }
+
+   free ( timer );
+   esContext->gpuTimer = NULL;
+}
+
+///
+//  esGpuTimerBegin()
+//
+void ESUTIL_API esGpuTimerBegin ( ESContext *esContext, const char *passName )
+{
+   ESGpuTimer *timer = esContext->gpuTimer;
+   ESGpuTimerFrame *frame;
+   int pass;
+
+   if ( timer == NULL )
+      return;
+
+   // Passes do not nest, starting one ends the one in progress
+   esGpuTimerEnd ( esContext );
+
+   pass = PassIndex ( timer, passName );
+   if ( pass < 0 )
+      return;
+
+   frame = &timer->frames[timer->current];
+   if ( frame->usedPasses & ( 1u << pass ) )
+      return;
+   if ( frame->numPasses <= pass )
+      frame->numPasses = pass + 1;
+   frame->usedPasses |= 1u << pass;
+   timer->activePass = pass;
+
+   if ( timer->useQueries )
+   {
+      timer->beginQuery ( GL_TIME_ELAPSED_EXT, frame->queries[pass] );
+   }
+   else
+   {
+      WaitForGpu ( timer );
+      timer->passStart = esGetTime ( );
+   }
+}
+
+///
+//  esGpuTimerEnd()
+//
+void ESUTIL_API esGpuTimerEnd ( ESContext *esContext )
+{
+   ESGpuTimer *timer = esContext->gpuTimer;
+
+   if ( timer == NULL || timer->activePass < 0 )
+      return;
+
+   if ( timer->useQueries )
+   {
+      timer->endQuery ( GL_TIME_ELAPSED_EXT );
+   }
+   else
+   {
+      WaitForGpu ( timer );
+      timer->fenceTimes[timer->activePass] = (float) ( ( esGetTime ( ) - timer->passStart ) * 1000.0 );
+   }
+
+   timer->activePass = -1;
+}
+
+///
+//  esGpuTimerEndFrame()
+//
+//    The query pool slot of the frame just finished is only reused
+//    ES_GPU_TIMER_LATENCY frames later.  If its results still have not
+//    arrived by then they are dropped rather than waited for.
+//
+void ESUTIL_API esGpuTimerEndFrame ( ESContext *esContext, unsigned int frameNumber )
+{
+   ESGpuTimer *timer = esContext->gpuTimer;
+   ESGpuTimerFrame *frame;
+
+   if ( timer == NULL )
+      return;
+
+   esGpuTimerEnd ( esContext );
+   frame = &timer->frames[timer->current];
+
+   if ( !timer->useQueries )
+   {
+      esRecordGpuTime ( esContext, frameNumber, timer->fenceTimes, frame->numPasses );
+      memset ( timer->fenceTimes, 0, sizeof ( timer->fenceTimes ) );
+      frame->numPasses = 0;
+      frame->usedPasses = 0;
+      return;
+   }
+
+   frame->frameNumber = frameNumber;
+   frame->pending = frame->numPasses > 0;
+
+   CollectResults ( esContext, timer );
+
+   timer->current = ( timer->current + 1 ) % ES_GPU_TIMER_LATENCY;
+   frame = &timer->frames[timer->current];
+   frame->pending = GL_FALSE;
+   frame->numPasses = 0;
+   frame->usedPasses = 0;
+}
+
+///
+//  esGpuTimerPassName()
+//
+const char* ESUTIL_API esGpuTimerPassName ( ESContext *esContext, int pass )
+{
+   ESGpuTimer *timer = esContext->gpuTimer;
+
+   if ( timer == NULL || pass < 0 || pass >= timer->numPassNames )
+      return NULL;
+   return timer->passNames[pass];
+}
@@ -0,0 +1,385 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESKTX.c
+//
+//    Loads KTX (version 1.1) texture containers.  The file is mapped and
+//    every mip level of every face is passed to GL straight from the
+//    mapping.  ETC1 levels go to glCompressedTexImage2D when the
+//    implementation exposes GL_OES_compressed_ETC1_RGB8_texture and are
+//    decompressed to RGB on the CPU otherwise, or when the renderer is a
+//    software rasterizer that would decode them again on every sample.
+//
+
+///
+//  Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "esUtil.h"
+#include "esUtil_internal.h"
+#include <GLES2/gl2ext.h>
+
+///
+// Defines
+//
+#define KTX_HEADER_SIZE       64
+#define KTX_ENDIANNESS        0x04030201
+
+static const unsigned char ktxIdentifier[12] =
+{
+   0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+};
+
+///
+// Types
+//
+typedef struct
+{
+   GLuint glType;
+   GLuint glTypeSize;
+   GLuint glFormat;
+   GLuint glInternalFormat;
+   GLuint glBaseInternalFormat;
+   GLuint pixelWidth;
+   GLuint pixelHeight;
+   GLuint pixelDepth;
+   GLuint numberOfArrayElements;
+   GLuint numberOfFaces;
+   GLuint numberOfMipmapLevels;
+   GLuint bytesOfKeyValueData;
+} KTXHeader;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// ReadWord()
+//
+static GLuint ReadWord ( const unsigned char *src, GLboolean swap )
+{
+   GLuint word;
+
+   memcpy ( &word, src, sizeof ( word ) );
+   return swap ? __builtin_bswap32 ( word ) : word;
+}
+
+///
+// SwapPixels()
+//
+//    Converts the 16 or 32-bit components of an uncompressed level written
+//    on a machine of the other endianness, in place in the private mapping
+//
+static void SwapPixels ( unsigned char *data, GLuint size, GLuint typeSize )
+{
+   GLuint i;
+
+   if ( typeSize == 2 )
+   {
+      for ( i = 0; i + 1 < size; i += 2 )
+      {
+         unsigned char t = data[i];
+         data[i] = data[i + 1];
+         data[i + 1] = t;
+      }
+   }
+   else if ( typeSize == 4 )
+   {
+      for ( i = 0; i + 3 < size; i += 4 )
+      {
+         GLuint word;
+         memcpy ( &word, data + i, 4 );
+         word = __builtin_bswap32 ( word );
+         memcpy ( data + i, &word, 4 );
+      }
+   }
+}
+
+///
+// BytesPerPixel()
+//
+//    Size of an uncompressed pixel, 0 for formats ES 2.0 cannot load
+//
+static int BytesPerPixel ( GLenum format, GLenum type )
+{
+   if ( type == GL_UNSIGNED_SHORT_5_6_5 || type == GL_UNSIGNED_SHORT_4_4_4_4 || type == GL_UNSIGNED_SHORT_5_5_5_1 )
+      return 2;
+   if ( type != GL_UNSIGNED_BYTE )
+      return 0;
+
+   switch ( format )
+   {
+      case GL_ALPHA:
+      case GL_LUMINANCE:
+         return 1;
+      case GL_LUMINANCE_ALPHA:
+         return 2;
+      case GL_RGB:
+         return 3;
+      case GL_RGBA:
+         return 4;
+      default:
+         return 0;
+   }
+}
+
+///
+// UploadLevel()
+//
+//    Specifies one face of one mip level.  Without ETC1 support the level is
+//    decompressed into scratch, which is grown as needed.
+//
+static GLboolean UploadLevel ( const KTXImage *ktx, GLenum faceTarget, GLint level, GLsizei width, GLsizei height,
+                               const unsigned char *data, GLuint size, GLboolean nativeETC1,
+                               unsigned char **scratch, size_t *scratchSize )
+{
+   if ( ktx->type != 0 )
+   {
+      glTexImage2D ( faceTarget, level, ktx->format, width, height, 0, ktx->format, ktx->type, data );
+   }
+   else if ( ktx->internalFormat != GL_ETC1_RGB8_OES || nativeETC1 )
+   {
+      glCompressedTexImage2D ( faceTarget, level, ktx->internalFormat, width, height, 0, size, data );
+   }
+   else
+   {
+      size_t needed = (size_t) width * height * 3;
+
+      if ( needed > *scratchSize )
+      {
+         unsigned char *grown = realloc ( *scratch, needed );
+
+         if ( grown == NULL )
+            return GL_FALSE;
+         *scratch = grown;
+         *scratchSize = needed;
+      }
+
+      esDecodeETC1 ( data, width, height, *scratch );
+      glTexImage2D ( faceTarget, level, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, *scratch );
+   }
+
+   return glGetError ( ) == GL_NO_ERROR;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  ParseKTX()
+//
+GLboolean ParseKTX ( unsigned char *file, size_t size, KTXImage *ktx, const char **error )
+{
+   KTXHeader header;
+   GLuint *fields = (GLuint *) &header;
+   GLboolean swap;
+   GLuint level, face;
+   size_t offset;
+   int i, bytesPerPixel;
+
+   memset ( ktx, 0, sizeof ( KTXImage ) );
+
+   if ( size < KTX_HEADER_SIZE || memcmp ( file, ktxIdentifier, sizeof ( ktxIdentifier ) ) != 0 ||
+        ( ReadWord ( file + 12, GL_FALSE ) != KTX_ENDIANNESS && ReadWord ( file + 12, GL_TRUE ) != KTX_ENDIANNESS ) )
+   {
+      *error = "is not a KTX 1.1 file";
+      return GL_FALSE;
+   }
+
+   swap = ReadWord ( file + 12, GL_FALSE ) != KTX_ENDIANNESS;
+   for ( i = 0; i < 12; i++ )
+      fields[i] = ReadWord ( file + 16 + i * 4, swap );
+
+   // ES 2.0 has neither 1D, 3D nor array textures
+   if ( header.pixelWidth == 0 || header.pixelHeight == 0 || header.pixelDepth > 1 ||
+        header.numberOfArrayElements > 1 || ( header.numberOfFaces != 1 && header.numberOfFaces != 6 ) ||
+        ( header.glType == 0 ) != ( header.glFormat == 0 ) )
+   {
+      *error = "is not a 2D texture or cube map";
+      return GL_FALSE;
+   }
+
+   ktx->type = header.glType;
+   ktx->format = header.glFormat;
+   ktx->internalFormat = header.glInternalFormat;
+   ktx->width = (GLsizei) header.pixelWidth;
+   ktx->height = (GLsizei) header.pixelHeight;
+   ktx->faces = header.numberOfFaces;
+   ktx->levels = header.numberOfMipmapLevels > 0 ? header.numberOfMipmapLevels : 1;
+   ktx->generateMipmaps = header.numberOfMipmapLevels == 0;
+
+   *error = "is truncated or its format is not supported";
+   if ( ktx->levels > KTX_MAX_LEVELS )
+      return GL_FALSE;
+
+   bytesPerPixel = BytesPerPixel ( ktx->format, ktx->type );
+   if ( ktx->type != 0 && bytesPerPixel == 0 )
+      return GL_FALSE;
+
+   offset = KTX_HEADER_SIZE + (size_t) header.bytesOfKeyValueData;
+   for ( level = 0; level < ktx->levels; level++ )
+   {
+      GLsizei levelWidth = ktx->width >> level ? ktx->width >> level : 1;
+      GLsizei levelHeight = ktx->height >> level ? ktx->height >> level : 1;
+      GLuint imageSize;
+
+      if ( offset + 4 > size )
+         return GL_FALSE;
+      imageSize = ReadWord ( file + offset, swap );
+      offset += 4;
+
+      // ETC1 blocks cover 4x4 pixels and take 8 bytes, uncompressed rows are padded to 4 bytes
+      if ( ktx->internalFormat == GL_ETC1_RGB8_OES &&
+           imageSize < (GLuint) ( ( levelWidth + 3 ) / 4 ) * ( ( levelHeight + 3 ) / 4 ) * 8 )
+         return GL_FALSE;
+      if ( ktx->type != 0 &&
+           imageSize < (GLuint) ( ( levelWidth * bytesPerPixel + 3 ) & ~3 ) * (GLuint) levelHeight )
+         return GL_FALSE;
+
+      ktx->imageSize[level] = imageSize;
+      for ( face = 0; face < ktx->faces; face++ )
+      {
+         if ( offset + imageSize > size )
+            return GL_FALSE;
+
+         if ( swap && ktx->type != 0 )
+            SwapPixels ( file + offset, imageSize, header.glTypeSize );
+         ktx->images[level][face] = file + offset;
+
+         // Faces and levels start on 4-byte boundaries
+         offset += ( imageSize + 3 ) & ~3u;
+      }
+   }
+
+   return GL_TRUE;
+}
+
+///
+//  NativeETC1()
+//
+GLboolean NativeETC1 ( void )
+{
+   const char *renderer = (const char *) glGetString ( GL_RENDERER );
+
+   // llvmpipe and softpipe expose the extension but decode the block of every texel fetched
+   if ( renderer != NULL && ( strstr ( renderer, "llvmpipe" ) != NULL || strstr ( renderer, "softpipe" ) != NULL ) )
+      return GL_FALSE;
+
+   return HasExtension ( "GL_OES_compressed_ETC1_RGB8_texture" );
+}
+
+///
+// esLoadKTX()
+//
+//    Creates a 2D or cube map texture from a KTX file with all its mip levels
+//
+GLuint ESUTIL_API esLoadKTX ( const char *fileName, GLenum *target, int *width, int *height )
+{
+   KTXImage ktx;
+   unsigned char *file, *scratch = NULL;
+   size_t size, scratchSize = 0;
+   const char *error;
+   GLboolean nativeETC1, ok = GL_TRUE;
+   GLenum texTarget;
+   GLuint levels, fullLevels, level, face;
+   GLint unpackAlignment, binding;
+   GLuint texId;
+
+   file = MapFile ( fileName, &size );
+   if ( file == NULL )
+   {
+      esLog ( ES_LOG_ERROR, "esLoadKTX: unable to open %s\n", fileName );
+      return 0;
+   }
+
+   if ( !ParseKTX ( file, size, &ktx, &error ) )
+   {
+      esLog ( ES_LOG_ERROR, "esLoadKTX: %s %s\n", fileName, error );
+      munmap ( file, size );
+      return 0;
+   }
+
+   nativeETC1 = NativeETC1 ( );
+   texTarget = ktx.faces == 6 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+   levels = ktx.levels;
+
+   // Rows of uncompressed levels are only padded to 4 bytes and decompressed ones not at all
+   glGetIntegerv ( GL_UNPACK_ALIGNMENT, &unpackAlignment );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, ktx.type != 0 ? 4 : 1 );
+
+   // Errors are checked after every level, so do not inherit one
+   while ( glGetError ( ) != GL_NO_ERROR );
+
+   // The texture is bound only while it is filled in, the caller's binding is put back
+   glGetIntegerv ( texTarget == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_BINDING_CUBE_MAP : GL_TEXTURE_BINDING_2D, &binding );
+   glGenTextures ( 1, &texId );
+   glBindTexture ( texTarget, texId );
+
+   for ( level = 0; level < levels && ok; level++ )
+   {
+      GLsizei levelWidth = ktx.width >> level ? ktx.width >> level : 1;
+      GLsizei levelHeight = ktx.height >> level ? ktx.height >> level : 1;
+
+      for ( face = 0; face < ktx.faces && ok; face++ )
+      {
+         GLenum faceTarget = texTarget == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+
+         ok = UploadLevel ( &ktx, faceTarget, level, levelWidth, levelHeight, ktx.images[level][face],
+                            ktx.imageSize[level], nativeETC1, &scratch, &scratchSize );
+      }
+   }
+
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, unpackAlignment );
+   free ( scratch );
+   munmap ( file, size );
+
+   if ( !ok )
+   {
+      esLog ( ES_LOG_ERROR, "esLoadKTX: %s is truncated or its format is not supported\n", fileName );
+      glBindTexture ( texTarget, binding );
+      glDeleteTextures ( 1, &texId );
+      return 0;
+   }
+
+   // A level count of 0 asks for the chain to be generated, which compressed textures cannot do
+   for ( fullLevels = 1; ( ktx.width | ktx.height ) >> fullLevels; fullLevels++ );
+   if ( ktx.generateMipmaps && ( ktx.type != 0 || !nativeETC1 ) )
+   {
+      glGenerateMipmap ( texTarget );
+      levels = glGetError ( ) == GL_NO_ERROR ? fullLevels : 1;
+   }
+
+   // ES 2.0 cannot limit sampling to the stored levels, so a partial chain is not mipmapped
+   glTexParameteri ( texTarget, GL_TEXTURE_MIN_FILTER,
+                     levels == fullLevels && levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR );
+   glTexParameteri ( texTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   glTexParameteri ( texTarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+   glTexParameteri ( texTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+   glBindTexture ( texTarget, binding );
+
+   esLog ( ES_LOG_INFO, "esLoadKTX: %s %dx%d, %u faces, %u levels%s\n", fileName, ktx.width, ktx.height,
+           ktx.faces, levels,
+           ktx.internalFormat == GL_ETC1_RGB8_OES ? ( nativeETC1 ? ", ETC1" : ", ETC1 decompressed" ) : "" );
+
+   if ( target != NULL )
+      *target = texTarget;
+   if ( width != NULL )
+      *width = ktx.width;
+   if ( height != NULL )
+      *height = ktx.height;
+   return texId;
+}
@@ -0,0 +1,568 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESLoader.c
+//
+//    Background creation of textures, programs and buffers.  The first
+//    request starts a loader thread with its own EGL context, sharing
+//    objects with the application's context.  The loader reads and uploads
+//    each asset, then inserts an EGL fence behind the GL commands that
+//    created it (or calls glFinish without EGL_KHR_fence_sync) and queues
+//    it as done.  esMainLoop polls the fences at the start of every frame
+//    and calls the completion callbacks of the assets whose fences have
+//    signaled, in the order they were requested, on the render thread.  If
+//    no shared context can be created the requests are carried out on the
+//    render thread instead, still through the callbacks.
+//
+
+///
+//  Includes
+//
+// The loader thread makes its GL calls on the shared context.  The esGLStats counters
+// belong to the render thread's frames and are not atomic, so bypass the wrappers.
+#define ES_GL_STATS_NO_WRAP
+
+#include "esUtil.h"
+#include "esUtil_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <EGL/eglext.h>
+
+///
+// Types
+//
+enum
+{
+   ES_ASSET_TEXTURE,
+   ES_ASSET_PROGRAM,
+   ES_ASSET_BUFFER
+};
+
+typedef struct _esloaderjob
+{
+   int               type;
+   ESLoaderCallback  callback;
+   void             *userData;
+
+   // ES_ASSET_TEXTURE: file name, ES_ASSET_PROGRAM: vertex and fragment shader
+   char             *source[2];
+
+   // ES_ASSET_BUFFER
+   GLenum            target;
+   GLsizeiptr        size;
+   const void       *data;
+   GLenum            usage;
+
+   // Created object, 0 on failure
+   GLuint            object;
+   EGLSyncKHR        fence;
+
+   struct _esloaderjob *next;
+} ESLoaderJob;
+
+typedef struct _esloader
+{
+   EGLDisplay        display;
+   EGLContext        context;
+   EGLSurface        surface;
+   GLboolean         threaded;
+
+   pthread_t         thread;
+   pthread_mutex_t   lock;
+   pthread_cond_t    cond;
+   int               quit;
+
+   // Requests not started yet, and created objects not delivered yet, oldest first
+   ESLoaderJob      *queued, **queuedTail;
+   ESLoaderJob      *done, **doneTail;
+   unsigned int      pending;
+
+   ESContext        *esContext;
+
+   PFNEGLCREATESYNCKHRPROC       createSync;
+   PFNEGLDESTROYSYNCKHRPROC      destroySync;
+   PFNEGLCLIENTWAITSYNCKHRPROC   clientWaitSync;
+} ESLoader;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// FreeJob()
+//
+static void FreeJob ( ESLoaderJob *job )
+{
+   free ( job->source[0] );
+   free ( job->source[1] );
+   free ( job );
+}
+
+///
+// CreateTexture()
+//
+static GLuint CreateTexture ( const char *fileName )
+{
+   ESImage image;
+   GLint unpackAlignment, binding;
+   GLuint texId;
+
+   if ( !esMapTGA ( fileName, &image ) )
+   {
+      esLog ( ES_LOG_ERROR, "esLoadTextureAsync: error loading (%s) image.\n", fileName );
+      return 0;
+   }
+
+   // Rows are tightly packed, which the default alignment of 4 does not cover
+   glGetIntegerv ( GL_UNPACK_ALIGNMENT, &unpackAlignment );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, 1 );
+
+   // Without a shared context this runs on the render thread, so put its binding back
+   glGetIntegerv ( GL_TEXTURE_BINDING_2D, &binding );
+   glGenTextures ( 1, &texId );
+   glBindTexture ( GL_TEXTURE_2D, texId );
+   glTexImage2D ( GL_TEXTURE_2D, 0, image.format, image.width, image.height, 0, image.format, GL_UNSIGNED_BYTE, image.pixels );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+   glBindTexture ( GL_TEXTURE_2D, binding );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, unpackAlignment );
+
+   // glTexImage2D has copied the pixels, the mapping can go
+   esFreeImage ( &image );
+   return texId;
+}
+
+///
+// RunJob()
+//
+//    Creates the object of a job with the calling thread's context
+//
+static void RunJob ( ESLoaderJob *job )
+{
+   GLint binding;
+   ES_TRACE_ZONE("esLoaderJob");
+
+   switch ( job->type )
+   {
+      case ES_ASSET_TEXTURE:
+         job->object = CreateTexture ( job->source[0] );
+         break;
+
+      case ES_ASSET_PROGRAM:
+         job->object = esLoadProgram ( job->source[0], job->source[1] );
+         break;
+
+      case ES_ASSET_BUFFER:
+         glGetIntegerv ( job->target == GL_ELEMENT_ARRAY_BUFFER ? GL_ELEMENT_ARRAY_BUFFER_BINDING :
+                         GL_ARRAY_BUFFER_BINDING, &binding );
+         glGenBuffers ( 1, &job->object );
+         glBindBuffer ( job->target, job->object );
+         glBufferData ( job->target, job->size, job->data, job->usage );
+         glBindBuffer ( job->target, binding );
+         break;
+   }
+}
+
+///
+// LoaderMain()
+//
+//    Loader thread.  Runs the queued jobs and publishes each one once the
+//    commands that created its object are known to complete.
+//
+static void *LoaderMain ( void *arg )
+{
+   ESLoader *loader = arg;
+
+   ES_TRACE_THREAD_NAME("loader");
+   eglBindAPI ( EGL_OPENGL_ES_API );
+   eglMakeCurrent ( loader->display, loader->surface, loader->surface, loader->context );
+
+   pthread_mutex_lock ( &loader->lock );
+   for ( ;; )
+   {
+      ESLoaderJob *job;
+
+      while ( loader->queued == NULL && !loader->quit )
+         pthread_cond_wait ( &loader->cond, &loader->lock );
+      if ( loader->quit )
+         break;
+
+      job = loader->queued;
+      loader->queued = job->next;
+      if ( loader->queued == NULL )
+         loader->queuedTail = &loader->queued;
+      pthread_mutex_unlock ( &loader->lock );
+
+      RunJob ( job );
+
+      // The fence is waited on by the render thread, the flush makes sure it gets there
+      job->fence = EGL_NO_SYNC_KHR;
+      if ( loader->createSync != NULL )
+         job->fence = loader->createSync ( loader->display, EGL_SYNC_FENCE_KHR, NULL );
+      if ( job->fence != EGL_NO_SYNC_KHR )
+         glFlush ( );
+      else
+         glFinish ( );
+
+      pthread_mutex_lock ( &loader->lock );
+      job->next = NULL;
+      *loader->doneTail = job;
+      loader->doneTail = &job->next;
+      pthread_mutex_unlock ( &loader->lock );
+
+      // Wake up the main loop in on-demand mode
+      esRequestRedraw ( loader->esContext );
+
+      pthread_mutex_lock ( &loader->lock );
+   }
+   pthread_mutex_unlock ( &loader->lock );
+
+   eglMakeCurrent ( loader->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+   eglReleaseThread ( );
+   return NULL;
+}
+
+///
+// CreateSharedContext()
+//
+//    Creates a context sharing objects with the application's, current
+//    without a surface if EGL_KHR_surfaceless_context is supported and with a
+//    small pbuffer otherwise
+//
+static GLboolean CreateSharedContext ( ESLoader *loader, ESContext *esContext )
+{
+   EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE };
+   EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+   const char *extensions = eglQueryString ( esContext->eglDisplay, EGL_EXTENSIONS );
+   EGLint configAttribs[] = { EGL_CONFIG_ID, 0, EGL_NONE };
+   EGLConfig config;
+   EGLint numConfigs = 0;
+
+   eglQueryContext ( esContext->eglDisplay, esContext->eglContext, EGL_CONFIG_ID, &configAttribs[1] );
+   if ( !eglChooseConfig ( esContext->eglDisplay, configAttribs, &config, 1, &numConfigs ) || numConfigs < 1 )
+      return GL_FALSE;
+
+   loader->display = esContext->eglDisplay;
+   loader->surface = EGL_NO_SURFACE;
+   if ( extensions == NULL || strstr ( extensions, "EGL_KHR_surfaceless_context" ) == NULL )
+   {
+      loader->surface = eglCreatePbufferSurface ( loader->display, config, pbufferAttribs );
+      if ( loader->surface == EGL_NO_SURFACE )
+         return GL_FALSE;
+   }
+
+   loader->context = eglCreateContext ( loader->display, config, esContext->eglContext, contextAttribs );
+   if ( loader->context == EGL_NO_CONTEXT )
+   {
+      if ( loader->surface != EGL_NO_SURFACE )
+         eglDestroySurface ( loader->display, loader->surface );
+      return GL_FALSE;
+   }
+
+   if ( extensions != NULL && strstr ( extensions, "EGL_KHR_fence_sync" ) != NULL )
+   {
+      loader->createSync = (PFNEGLCREATESYNCKHRPROC) eglGetProcAddress ( "eglCreateSyncKHR" );
+      loader->destroySync = (PFNEGLDESTROYSYNCKHRPROC) eglGetProcAddress ( "eglDestroySyncKHR" );
+      loader->clientWaitSync = (PFNEGLCLIENTWAITSYNCKHRPROC) eglGetProcAddress ( "eglClientWaitSyncKHR" );
+      if ( !loader->destroySync || !loader->clientWaitSync )
+         loader->createSync = NULL;
+   }
+
+   return GL_TRUE;
+}
+
+///
+// GetLoader()
+//
+//    Returns the loader of a context, starting it on first use
+//
+static ESLoader *GetLoader ( ESContext *esContext )
+{
+   ESLoader *loader = esContext->loader;
+
+   if ( loader != NULL )
+      return loader;
+
+   loader = calloc ( 1, sizeof ( ESLoader ) );
+   if ( loader == NULL )
+      return NULL;
+
+   loader->esContext = esContext;
+   loader->queuedTail = &loader->queued;
+   loader->doneTail = &loader->done;
+   pthread_mutex_init ( &loader->lock, NULL );
+   pthread_cond_init ( &loader->cond, NULL );
+
+   if ( CreateSharedContext ( loader, esContext ) )
+   {
+      loader->threaded = pthread_create ( &loader->thread, NULL, LoaderMain, loader ) == 0;
+      if ( !loader->threaded )
+      {
+         eglDestroyContext ( loader->display, loader->context );
+         if ( loader->surface != EGL_NO_SURFACE )
+            eglDestroySurface ( loader->display, loader->surface );
+      }
+   }
+
+   esLog ( ES_LOG_INFO, "esLoader: %s\n", !loader->threaded ? "no shared context, loading on the render thread" :
+           loader->createSync != NULL ? "loader thread, EGL fences" : "loader thread, glFinish" );
+
+   esContext->loader = loader;
+   return loader;
+}
+
+///
+// Submit()
+//
+static GLboolean Submit ( ESContext *esContext, ESLoaderJob *job )
+{
+   ESLoader *loader = GetLoader ( esContext );
+
+   if ( loader == NULL )
+   {
+      FreeJob ( job );
+      return GL_FALSE;
+   }
+
+   job->next = NULL;
+   pthread_mutex_lock ( &loader->lock );
+   if ( loader->threaded )
+   {
+      *loader->queuedTail = job;
+      loader->queuedTail = &job->next;
+      pthread_cond_signal ( &loader->cond );
+   }
+   else
+   {
+      // Created by LoaderPoll on the render thread
+      *loader->doneTail = job;
+      loader->doneTail = &job->next;
+   }
+   loader->pending++;
+   pthread_mutex_unlock ( &loader->lock );
+   return GL_TRUE;
+}
+
+///
+// NewJob()
+//
+static ESLoaderJob *NewJob ( int type, ESLoaderCallback callback, void *userData )
+{
+   ESLoaderJob *job = calloc ( 1, sizeof ( ESLoaderJob ) );
+
+   if ( job != NULL )
+   {
+      job->type = type;
+      job->callback = callback;
+      job->userData = userData;
+   }
+   return job;
+}
+
+///
+// DeleteObject()
+//
+static void DeleteObject ( ESLoaderJob *job )
+{
+   if ( job->object == 0 )
+      return;
+
+   switch ( job->type )
+   {
+      case ES_ASSET_TEXTURE:  glDeleteTextures ( 1, &job->object );  break;
+      case ES_ASSET_PROGRAM:  glDeleteProgram ( job->object );       break;
+      case ES_ASSET_BUFFER:   glDeleteBuffers ( 1, &job->object );   break;
+   }
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  LoaderPoll()
+//
+void LoaderPoll ( ESContext *esContext )
+{
+   ESLoader *loader = esContext->loader;
+   GLboolean inFlight = GL_FALSE;
+
+   if ( loader == NULL )
+      return;
+
+   while ( !inFlight )
+   {
+      ESLoaderJob *job;
+
+      pthread_mutex_lock ( &loader->lock );
+      job = loader->done;
+      if ( job != NULL && job->fence != EGL_NO_SYNC_KHR &&
+           loader->clientWaitSync ( loader->display, job->fence, 0, 0 ) != EGL_CONDITION_SATISFIED_KHR )
+      {
+         inFlight = GL_TRUE;
+         job = NULL;
+      }
+      if ( job != NULL )
+      {
+         loader->done = job->next;
+         if ( loader->done == NULL )
+            loader->doneTail = &loader->done;
+         loader->pending--;
+      }
+      pthread_mutex_unlock ( &loader->lock );
+
+      if ( job == NULL )
+         break;
+
+      if ( job->fence != EGL_NO_SYNC_KHR )
+         loader->destroySync ( loader->display, job->fence );
+      if ( !loader->threaded )
+         RunJob ( job );
+
+      if ( job->callback != NULL )
+         job->callback ( esContext, job->object, job->userData );
+      FreeJob ( job );
+   }
+
+   // Keep on-demand rendering going until the fence has signaled
+   if ( inFlight )
+      esRequestRedraw ( esContext );
+}
+
+///
+//  LoaderStop()
+//
+void LoaderStop ( ESContext *esContext )
+{
+   ESLoader *loader = esContext->loader;
+
+   if ( loader == NULL )
+      return;
+
+   if ( loader->threaded )
+   {
+      pthread_mutex_lock ( &loader->lock );
+      loader->quit = 1;
+      pthread_cond_signal ( &loader->cond );
+      pthread_mutex_unlock ( &loader->lock );
+      pthread_join ( loader->thread, NULL );
+   }
+
+   while ( loader->queued != NULL )
+   {
+      ESLoaderJob *job = loader->queued;
+
+      loader->queued = job->next;
+      FreeJob ( job );
+   }
+
+   // The application never saw these objects, so nobody else will delete them
+   while ( loader->done != NULL )
+   {
+      ESLoaderJob *job = loader->done;
+
+      loader->done = job->next;
+      if ( job->fence != EGL_NO_SYNC_KHR )
+         loader->destroySync ( loader->display, job->fence );
+      DeleteObject ( job );
+      FreeJob ( job );
+   }
+
+   if ( loader->threaded )
+   {
+      eglDestroyContext ( loader->display, loader->context );
+      if ( loader->surface != EGL_NO_SURFACE )
+         eglDestroySurface ( loader->display, loader->surface );
+   }
+
+   pthread_mutex_destroy ( &loader->lock );
+   pthread_cond_destroy ( &loader->cond );
+   free ( loader );
+   esContext->loader = NULL;
+}
+
+///
+//  esLoadTextureAsync()
+//
+GLboolean ESUTIL_API esLoadTextureAsync ( ESContext *esContext, const char *fileName,
+                                          ESLoaderCallback callback, void *userData )
+{
+   ESLoaderJob *job = NewJob ( ES_ASSET_TEXTURE, callback, userData );
+
+   if ( job == NULL || ( job->source[0] = strdup ( fileName ) ) == NULL )
+   {
+      free ( job );
+      return GL_FALSE;
+   }
+   return Submit ( esContext, job );
+}
+
+///
+//  esLoadProgramAsync()
+//
+GLboolean ESUTIL_API esLoadProgramAsync ( ESContext *esContext, const char *vertShaderSrc, const char *fragShaderSrc,
+                                          ESLoaderCallback callback, void *userData )
+{
+   ESLoaderJob *job = NewJob ( ES_ASSET_PROGRAM, callback, userData );
+
+   if ( job == NULL )
+      return GL_FALSE;
+
+   job->source[0] = strdup ( vertShaderSrc );
+   job->source[1] = strdup ( fragShaderSrc );
+   if ( job->source[0] == NULL || job->source[1] == NULL )
+   {
+      FreeJob ( job );
+      return GL_FALSE;
+   }
+   return Submit ( esContext, job );
+}
+
+///
+//  esCreateBufferAsync()
+//
+GLboolean ESUTIL_API esCreateBufferAsync ( ESContext *esContext, GLenum target, GLsizeiptr size, const void *data,
+                                           GLenum usage, ESLoaderCallback callback, void *userData )
+{
+   ESLoaderJob *job = NewJob ( ES_ASSET_BUFFER, callback, userData );
+
+   if ( job == NULL )
+      return GL_FALSE;
+
+   job->target = target;
+   job->size = size;
+   job->data = data;
+   job->usage = usage;
+   return Submit ( esContext, job );
+}
+
+///
+//  esLoaderPending()
+//
+unsigned int ESUTIL_API esLoaderPending ( ESContext *esContext )
+{
+   ESLoader *loader = esContext->loader;
+   unsigned int pending;
+
+   if ( loader == NULL )
+      return 0;
+
+   pthread_mutex_lock ( &loader->lock );
+   pending = loader->pending;
+   pthread_mutex_unlock ( &loader->lock );
+   return pending;
+}
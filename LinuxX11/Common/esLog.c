@@ -0,0 +1,743 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESLog.c
+//
+//    Asynchronous logger behind esLogMessage and esLog.  The calling thread
+//    does not format anything: it walks the format string only to pull the
+//    arguments off the va_list, copies them (and any strings they point to)
+//    together with the format string into a record, and appends the record
+//    to a single-producer ring buffer owned by the thread.  A background
+//    thread drains the rings every few milliseconds, merging them in time
+//    order, and does the printf-style formatting and the writes to stdout.
+//    If a ring is full the message is dropped and counted instead of
+//    blocking the caller.  Messages still queued are written at exit, or
+//    earlier by esLogFlush.
+//
+//    Records are only queued while esMainLoop runs frames.  Messages logged
+//    before and after it, at init and shutdown, are written synchronously so
+//    they stay in order with the application's own printf output.
+//
+//    A thread's ring is written out and freed when the thread exits.
+//
+
+#define _GNU_SOURCE
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+///
+// Defines
+//
+
+// Bytes of queued messages per thread, must be a power of two
+#define ES_LOG_RING_SIZE      ( 128 * 1024 )
+
+// Largest record, messages with longer string arguments are written synchronously
+#define ES_LOG_MAX_RECORD     ( 16 * 1024 )
+
+// Interval at which the background thread drains the rings
+#define ES_LOG_FLUSH_MS       10
+
+// Severity of the records that fill the end of the ring when a record wraps
+#define ES_LOG_PADDING        0xFFFF
+
+#define ALIGN8(n)             ( ( (n) + 7 ) & ~(size_t) 7 )
+
+///
+// Types
+//
+typedef enum
+{
+   ARG_INT,
+   ARG_DOUBLE,
+   ARG_POINTER,
+   ARG_STRING,
+   ARG_NONE
+} ESLogArgType;
+
+typedef struct
+{
+   // Total size including this header, a multiple of 8
+   uint32_t       size;
+   uint16_t       severity;
+   uint16_t       formatLength;
+   uint64_t       time;
+
+   // Followed by the NUL-terminated format string, padded to 8 bytes, then
+   // the arguments: 8 bytes each, strings as a length and the padded bytes
+} ESLogRecord;
+
+typedef struct
+{
+   // Position of the conversion in the format string, and its length
+   const char    *start;
+   size_t         length;
+
+   // Number of '*' widths and precisions, each takes an int argument
+   int            numStars;
+
+   // Length modifier and conversion character
+   char           modifier[3];
+   char           conversion;
+   ESLogArgType   type;
+} ESLogSpec;
+
+typedef struct _eslogring
+{
+   unsigned char  data[ES_LOG_RING_SIZE];
+
+   // Byte offsets that only grow, head is written by the owning thread and
+   // tail by the thread draining the ring
+   atomic_size_t  head;
+   atomic_size_t  tail;
+   atomic_uint    dropped;
+
+   // Record being encoded
+   unsigned char  scratch[ES_LOG_MAX_RECORD];
+
+   struct _eslogring *next;
+} ESLogRing;
+
+///
+// Local variables
+//
+static __thread ESLogRing  *threadRing;
+static ESLogRing           *_Atomic rings;
+static pthread_mutex_t      ringsLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t      drainLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t       logOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t        ringKey;
+static pthread_t            flushThread;
+static atomic_int           running;
+static atomic_int           synchronous;
+static atomic_int           queueDepth;
+static atomic_int           logLevel = ES_LOG_INFO;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+static uint64_t Now ( void )
+{
+   struct timespec ts;
+
+   clock_gettime ( CLOCK_MONOTONIC, &ts );
+   return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+///
+// ParseSpec()
+//
+//    Parses the conversion starting at the '%' that p points to.  Returns a
+//    pointer past it.
+//
+static const char *ParseSpec ( const char *p, ESLogSpec *spec )
+{
+   int m = 0;
+
+   spec->start = p++;
+   spec->numStars = 0;
+
+   while ( *p != '\0' && strchr ( "-+ #0'", *p ) != NULL )
+      p++;
+   if ( *p == '*' )
+   {
+      spec->numStars++;
+      p++;
+   }
+   while ( *p >= '0' && *p <= '9' )
+      p++;
+   if ( *p == '.' )
+   {
+      p++;
+      if ( *p == '*' )
+      {
+         spec->numStars++;
+         p++;
+      }
+      while ( *p >= '0' && *p <= '9' )
+         p++;
+   }
+   while ( *p != '\0' && strchr ( "hlLqjzt", *p ) != NULL )
+   {
+      if ( m < 2 )
+         spec->modifier[m++] = *p;
+      p++;
+   }
+   spec->modifier[m] = '\0';
+   spec->conversion = *p;
+
+   switch ( *p )
+   {
+      case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+         spec->type = ARG_INT;
+         break;
+      case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+         spec->type = ARG_DOUBLE;
+         break;
+      case 's':
+         spec->type = ARG_STRING;
+         break;
+      case 'p': case 'n':
+         spec->type = ARG_POINTER;
+         break;
+      default:
+         // "%%", or an invalid conversion that is printed as is
+         spec->type = ARG_NONE;
+         break;
+   }
+
+   if ( *p != '\0' )
+      p++;
+   spec->length = p - spec->start;
+   return p;
+}
+
+///
+// Encode()
+//
+//    Encodes a message into the ring's scratch buffer and returns its size,
+//    0 if it does not fit
+//
+static size_t Encode ( ESLogRing *ring, int severity, const char *formatStr, va_list params )
+{
+   ESLogRecord *record = (ESLogRecord *) ring->scratch;
+   unsigned char *end = ring->scratch + ES_LOG_MAX_RECORD;
+   unsigned char *out;
+   size_t formatLength = strlen ( formatStr );
+   const char *p = formatStr;
+
+   if ( formatLength >= 0xFFFF || sizeof ( ESLogRecord ) + ALIGN8 ( formatLength + 1 ) > ES_LOG_MAX_RECORD )
+      return 0;
+
+   record->severity = (uint16_t) severity;
+   record->formatLength = (uint16_t) formatLength;
+   record->time = Now ( );
+   memcpy ( record + 1, formatStr, formatLength + 1 );
+   out = (unsigned char *) ( record + 1 ) + ALIGN8 ( formatLength + 1 );
+
+   while ( ( p = strchr ( p, '%' ) ) != NULL )
+   {
+      ESLogSpec spec;
+      int i;
+
+      p = ParseSpec ( p, &spec );
+
+      if ( out + 8 * ( spec.numStars + 1 ) > end )
+         return 0;
+
+      for ( i = 0; i < spec.numStars; i++ )
+      {
+         int64_t star = va_arg ( params, int );
+         memcpy ( out, &star, 8 );
+         out += 8;
+      }
+
+      if ( spec.type == ARG_INT )
+      {
+         int64_t value;
+
+         if ( spec.modifier[0] == 'l' && spec.modifier[1] == 'l' )
+            value = va_arg ( params, long long );
+         else if ( spec.modifier[0] == 'l' || spec.modifier[0] == 'z' ||
+                   spec.modifier[0] == 'j' || spec.modifier[0] == 't' || spec.modifier[0] == 'q' )
+            value = va_arg ( params, long );
+         else
+            value = va_arg ( params, int );
+
+         // Sign or zero extension happens at format time from the modifier
+         memcpy ( out, &value, 8 );
+         out += 8;
+      }
+      else if ( spec.type == ARG_DOUBLE )
+      {
+         double value = spec.modifier[0] == 'L' ? (double) va_arg ( params, long double )
+                                                : va_arg ( params, double );
+         memcpy ( out, &value, 8 );
+         out += 8;
+      }
+      else if ( spec.type == ARG_POINTER )
+      {
+         void *value = va_arg ( params, void * );
+         memcpy ( out, &value, sizeof ( void * ) );
+         out += 8;
+      }
+      else if ( spec.type == ARG_STRING )
+      {
+         const char *str = va_arg ( params, const char * );
+         uint64_t length;
+
+         if ( str == NULL )
+            str = "(null)";
+         length = strlen ( str );
+
+         // Strings that do not fit in the record are written synchronously, not cut
+         if ( length + 1 > (size_t) ( end - out ) || out + 8 + ALIGN8 ( length + 1 ) > end )
+            return 0;
+         memcpy ( out, &length, 8 );
+         memcpy ( out + 8, str, length );
+         out[8 + length] = '\0';
+         out += 8 + ALIGN8 ( length + 1 );
+      }
+   }
+
+   record->size = (uint32_t) ( out - ring->scratch );
+   return record->size;
+}
+
+///
+// WriteRecord()
+//
+//    Formats a record to stdout, one conversion at a time so that no
+//    intermediate buffer can overflow
+//
+static void WriteRecord ( const ESLogRecord *record )
+{
+   const char *format = (const char *) ( record + 1 );
+   const unsigned char *in = (const unsigned char *) format + ALIGN8 ( record->formatLength + 1 );
+   const char *p = format;
+   const char *next;
+
+   if ( record->severity == ES_LOG_WARNING )
+      fputs ( "warning: ", stdout );
+   else if ( record->severity == ES_LOG_ERROR )
+      fputs ( "error: ", stdout );
+
+   while ( ( next = strchr ( p, '%' ) ) != NULL )
+   {
+      ESLogSpec spec;
+      char specFormat[64];
+      int stars[2] = { 0, 0 };
+      int64_t value;
+      int i;
+
+      fwrite ( p, 1, next - p, stdout );
+      p = ParseSpec ( next, &spec );
+
+      if ( spec.type == ARG_NONE || spec.length + 3 >= sizeof ( specFormat ) )
+      {
+         if ( spec.conversion == '%' )
+            fputc ( '%', stdout );
+         else
+            fwrite ( spec.start, 1, spec.length, stdout );
+         continue;
+      }
+
+      for ( i = 0; i < spec.numStars; i++ )
+      {
+         memcpy ( &value, in, 8 );
+         stars[i] = (int) value;
+         in += 8;
+      }
+
+      // Rebuild the conversion with the modifier matching the stored type
+      snprintf ( specFormat, sizeof ( specFormat ), "%.*s%s%c",
+                 (int) ( spec.length - 1 - strlen ( spec.modifier ) ), spec.start,
+                 spec.type == ARG_INT && spec.conversion != 'c' ? "ll" : "", spec.conversion );
+
+#define PRINT_ARG(arg) \
+      ( spec.numStars == 0 ? printf ( specFormat, arg ) : \
+        spec.numStars == 1 ? printf ( specFormat, stars[0], arg ) : \
+                             printf ( specFormat, stars[0], stars[1], arg ) )
+
+      if ( spec.type == ARG_INT )
+      {
+         memcpy ( &value, in, 8 );
+         in += 8;
+
+         // Apply the width of the original argument before widening it to long long
+         if ( strchr ( "uoxX", spec.conversion ) != NULL )
+         {
+            unsigned long long u = (unsigned long long) value;
+
+            if ( spec.modifier[0] == 'h' && spec.modifier[1] == 'h' )
+               u = (unsigned char) u;
+            else if ( spec.modifier[0] == 'h' )
+               u = (unsigned short) u;
+            else if ( spec.modifier[0] == '\0' )
+               u = (unsigned int) u;
+            else if ( spec.modifier[0] != 'l' || spec.modifier[1] != 'l' )
+               u = (unsigned long) u;
+            PRINT_ARG ( u );
+         }
+         else if ( spec.conversion == 'c' )
+         {
+            PRINT_ARG ( (int) value );
+         }
+         else
+         {
+            long long s = value;
+
+            if ( spec.modifier[0] == 'h' && spec.modifier[1] == 'h' )
+               s = (signed char) s;
+            else if ( spec.modifier[0] == 'h' )
+               s = (short) s;
+            PRINT_ARG ( s );
+         }
+      }
+      else if ( spec.type == ARG_DOUBLE )
+      {
+         double d;
+
+         memcpy ( &d, in, 8 );
+         in += 8;
+         PRINT_ARG ( d );
+      }
+      else if ( spec.type == ARG_POINTER )
+      {
+         void *ptr;
+
+         memcpy ( &ptr, in, sizeof ( void * ) );
+         in += 8;
+         if ( spec.conversion == 'p' )
+            PRINT_ARG ( ptr );
+      }
+      else
+      {
+         uint64_t length;
+
+         memcpy ( &length, in, 8 );
+         PRINT_ARG ( (const char *) in + 8 );
+         in += 8 + ALIGN8 ( length + 1 );
+      }
+
+#undef PRINT_ARG
+   }
+
+   fputs ( p, stdout );
+}
+
+///
+// DrainRingsLocked()
+//
+//    Writes every queued record, oldest first across all threads, with
+//    drainLock held
+//
+static void DrainRingsLocked ( void )
+{
+   for ( ;; )
+   {
+      ESLogRing *ring;
+      ESLogRing *oldest = NULL;
+      const ESLogRecord *oldestRecord = NULL;
+
+      for ( ring = atomic_load ( &rings ); ring != NULL; ring = ring->next )
+      {
+         size_t head = atomic_load_explicit ( &ring->head, memory_order_acquire );
+         size_t tail = atomic_load_explicit ( &ring->tail, memory_order_relaxed );
+         const ESLogRecord *record = NULL;
+         unsigned int dropped = atomic_exchange ( &ring->dropped, 0 );
+
+         if ( dropped != 0 )
+            printf ( "esLog: %u message(s) dropped, log ring full\n", dropped );
+
+         // Skip the padding at the end of the ring
+         while ( tail != head )
+         {
+            record = (const ESLogRecord *) &ring->data[tail & ( ES_LOG_RING_SIZE - 1 )];
+            if ( record->severity != ES_LOG_PADDING )
+               break;
+            tail += record->size;
+            atomic_store_explicit ( &ring->tail, tail, memory_order_release );
+         }
+         if ( tail == head )
+            continue;
+
+         if ( oldestRecord == NULL || record->time < oldestRecord->time )
+         {
+            oldest = ring;
+            oldestRecord = record;
+         }
+      }
+
+      if ( oldest == NULL )
+         break;
+
+      WriteRecord ( oldestRecord );
+      atomic_store_explicit ( &oldest->tail, atomic_load ( &oldest->tail ) + oldestRecord->size,
+                              memory_order_release );
+   }
+
+   fflush ( stdout );
+}
+
+///
+// DrainRings()
+//
+static void DrainRings ( void )
+{
+   pthread_mutex_lock ( &drainLock );
+   DrainRingsLocked ( );
+   pthread_mutex_unlock ( &drainLock );
+}
+
+static void *FlushThreadMain ( void *arg )
+{
+   struct timespec interval = { 0, ES_LOG_FLUSH_MS * 1000000L };
+
+   (void) arg;
+   while ( atomic_load ( &running ) )
+   {
+      nanosleep ( &interval, NULL );
+      DrainRings ( );
+   }
+   return NULL;
+}
+
+///
+// Shutdown()
+//
+//    At exit, stops the flush thread and writes what is left.  Messages
+//    logged after this are written synchronously.
+//
+static void Shutdown ( void )
+{
+   if ( atomic_exchange ( &running, 0 ) )
+      pthread_join ( flushThread, NULL );
+   DrainRings ( );
+   atomic_store ( &synchronous, 1 );
+}
+
+///
+// FreeThreadRing()
+//
+//    Destructor of ringKey, writes what is left in the ring of an exiting
+//    thread and unlinks it
+//
+static void FreeThreadRing ( void *arg )
+{
+   ESLogRing *ring = arg;
+   ESLogRing *prev;
+
+   // The flush thread only walks the list with drainLock held
+   pthread_mutex_lock ( &drainLock );
+   DrainRingsLocked ( );
+   pthread_mutex_lock ( &ringsLock );
+   prev = atomic_load ( &rings );
+   if ( prev == ring )
+   {
+      atomic_store ( &rings, ring->next );
+   }
+   else
+   {
+      while ( prev != NULL && prev->next != ring )
+         prev = prev->next;
+      if ( prev != NULL )
+         prev->next = ring->next;
+   }
+   pthread_mutex_unlock ( &ringsLock );
+   pthread_mutex_unlock ( &drainLock );
+
+   threadRing = NULL;
+   free ( ring );
+}
+
+static void LogInit ( void )
+{
+   const char *env = getenv ( "ES_LOG_LEVEL" );
+
+   if ( env != NULL )
+   {
+      if ( strcmp ( env, "debug" ) == 0 )
+         atomic_store ( &logLevel, ES_LOG_DEBUG );
+      else if ( strcmp ( env, "info" ) == 0 )
+         atomic_store ( &logLevel, ES_LOG_INFO );
+      else if ( strcmp ( env, "warning" ) == 0 )
+         atomic_store ( &logLevel, ES_LOG_WARNING );
+      else if ( strcmp ( env, "error" ) == 0 )
+         atomic_store ( &logLevel, ES_LOG_ERROR );
+      else
+         atomic_store ( &logLevel, atoi ( env ) );
+   }
+
+   pthread_key_create ( &ringKey, FreeThreadRing );
+
+   atomic_store ( &running, 1 );
+   if ( pthread_create ( &flushThread, NULL, FlushThreadMain, NULL ) != 0 )
+   {
+      atomic_store ( &running, 0 );
+      atomic_store ( &synchronous, 1 );
+   }
+   atexit ( Shutdown );
+}
+
+///
+// GetThreadRing()
+//
+static ESLogRing *GetThreadRing ( void )
+{
+   ESLogRing *ring = threadRing;
+
+   if ( ring != NULL )
+      return ring;
+
+   ring = calloc ( 1, sizeof ( ESLogRing ) );
+   if ( ring == NULL )
+      return NULL;
+
+   pthread_mutex_lock ( &ringsLock );
+   ring->next = atomic_load ( &rings );
+   atomic_store ( &rings, ring );
+   pthread_mutex_unlock ( &ringsLock );
+
+   threadRing = ring;
+   pthread_setspecific ( ringKey, ring );
+   return ring;
+}
+
+///
+// LogV()
+//
+static void LogV ( int severity, const char *formatStr, va_list params )
+{
+   ESLogRing *ring;
+   size_t size, head, tail, offset, padding;
+
+   pthread_once ( &logOnce, LogInit );
+   if ( severity < atomic_load_explicit ( &logLevel, memory_order_relaxed ) )
+      return;
+
+   ring = atomic_load_explicit ( &synchronous, memory_order_relaxed ) ||
+          atomic_load_explicit ( &queueDepth, memory_order_relaxed ) == 0 ? NULL : GetThreadRing ( );
+   if ( ring != NULL )
+   {
+      va_list copy;
+
+      va_copy ( copy, params );
+      size = Encode ( ring, severity, formatStr, copy );
+      va_end ( copy );
+   }
+   else
+   {
+      size = 0;
+   }
+
+   if ( size == 0 )
+   {
+      // No ring or a message that cannot be queued, write it out directly after the
+      // messages already queued
+      pthread_mutex_lock ( &drainLock );
+      DrainRingsLocked ( );
+      if ( severity == ES_LOG_WARNING )
+         fputs ( "warning: ", stdout );
+      else if ( severity == ES_LOG_ERROR )
+         fputs ( "error: ", stdout );
+      vprintf ( formatStr, params );
+      fflush ( stdout );
+      pthread_mutex_unlock ( &drainLock );
+      return;
+   }
+
+   head = atomic_load_explicit ( &ring->head, memory_order_relaxed );
+   tail = atomic_load_explicit ( &ring->tail, memory_order_acquire );
+   offset = head & ( ES_LOG_RING_SIZE - 1 );
+
+   // Records are contiguous, pad out the end of the ring if this one does not fit there
+   padding = offset + size > ES_LOG_RING_SIZE ? ES_LOG_RING_SIZE - offset : 0;
+
+   if ( ES_LOG_RING_SIZE - ( head - tail ) < padding + size )
+   {
+      atomic_fetch_add_explicit ( &ring->dropped, 1, memory_order_relaxed );
+      return;
+   }
+
+   if ( padding != 0 )
+   {
+      ESLogRecord *pad = (ESLogRecord *) &ring->data[offset];
+
+      pad->size = (uint32_t) padding;
+      pad->severity = ES_LOG_PADDING;
+      head += padding;
+      offset = 0;
+   }
+
+   memcpy ( &ring->data[offset], ring->scratch, size );
+   atomic_store_explicit ( &ring->head, head + size, memory_order_release );
+}
+
+///
+//  LogQueueBegin()
+//
+void LogQueueBegin ( void )
+{
+   atomic_fetch_add ( &queueDepth, 1 );
+}
+
+///
+//  LogQueueEnd()
+//
+void LogQueueEnd ( void )
+{
+   atomic_fetch_sub ( &queueDepth, 1 );
+   DrainRings ( );
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+// esLogMessage()
+//
+//    Log a message to the debug output for the platform
+//
+void ESUTIL_API esLogMessage ( const char *formatStr, ... )
+{
+   va_list params;
+
+   va_start ( params, formatStr );
+   LogV ( ES_LOG_INFO, formatStr, params );
+   va_end ( params );
+}
+
+///
+//  esLog()
+//
+void ESUTIL_API esLog ( int severity, const char *formatStr, ... )
+{
+   va_list params;
+
+   va_start ( params, formatStr );
+   LogV ( severity, formatStr, params );
+   va_end ( params );
+}
+
+///
+//  esSetLogLevel()
+//
+void ESUTIL_API esSetLogLevel ( int severity )
+{
+   pthread_once ( &logOnce, LogInit );
+   atomic_store ( &logLevel, severity );
+}
+
+///
+//  esLogFlush()
+//
+void ESUTIL_API esLogFlush ( void )
+{
+   DrainRings ( );
+}
@@ -0,0 +1,411 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESMipChain.c
+//
+//    Builds the mip chain of an 8-bit luminance, luminance alpha, RGB or
+//    RGBA image down to 1x1 with the box filter of the MipMap2D example:
+//    each texel is the sum of a 2x2 block divided by four and truncated.
+//    The last row or column of an odd size is dropped, a side of one texel
+//    is used twice.  All levels after the first go into one allocation.
+//
+//    The filter sums each horizontal pair with one multiply-add of bytes,
+//    after a byte shuffle groups the pairs of each channel, where the CPU
+//    has SSSE3 (picked at runtime) or NEON.  Levels with enough texels are
+//    split between threads taking a few rows at a time.
+//
+
+///
+//  Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "esUtil.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#define ES_MIP_SSSE3
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ES_MIP_NEON
+#endif
+
+///
+// Defines
+//
+
+// Most threads a chain is split between
+#define ES_MIP_MAX_THREADS       16
+
+// Output rows a thread takes at a time
+#define ES_MIP_ROWS_PER_TASK     16
+
+// Output texels of a level below which it is not worth waking other threads
+#define ES_MIP_PARALLEL_TEXELS   ( 128 * 128 )
+
+///
+// Types
+//
+
+// Filters one output row from two input rows, width output pixels
+typedef void (*RowFunc) ( unsigned char *dst, const unsigned char *row0, const unsigned char *row1,
+                          int width, int bpp );
+
+typedef struct
+{
+   const ESMipChain *chain;
+   RowFunc           filter;
+   int               bpp;
+   int               level;
+
+   // Next row of the level to filter
+   int               nextRow;
+} MipJob;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// FilterRow()
+//
+//    Scalar filter, also used for the last pixels of a row and for sources
+//    one texel wide
+//
+static void FilterRow ( unsigned char *dst, const unsigned char *row0, const unsigned char *row1,
+                        int width, int bpp, int srcWidth )
+{
+   int step = srcWidth > 1 ? bpp : 0;
+   int x, c;
+
+   for ( x = 0; x < width; x++, row0 += 2 * step, row1 += 2 * step )
+   {
+      for ( c = 0; c < bpp; c++ )
+         *dst++ = (unsigned char) ( ( row0[c] + row0[c + step] + row1[c] + row1[c + step] ) >> 2 );
+   }
+}
+
+static void FilterRowC ( unsigned char *dst, const unsigned char *row0, const unsigned char *row1,
+                         int width, int bpp )
+{
+   FilterRow ( dst, row0, row1, width, bpp, 2 );
+}
+
+#ifdef ES_MIP_SSSE3
+// Shuffles that put the two pixels of each output channel next to each other, for 1, 2 and
+// 4 bytes per pixel, and for RGB the 4 pixels at the start of a register and at byte 4
+static const signed char pairShuffle[5][16] =
+{
+   { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+   { 0, 2, 1, 3, 4, 6, 5, 7, 8, 10, 9, 11, 12, 14, 13, 15 },
+   { 0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15 },
+   { 0, 3, 1, 4, 2, 5, 6, 9, 7, 10, 8, 11, -128, -128, -128, -128 },
+   { 4, 7, 5, 8, 6, 9, 10, 13, 11, 14, 12, 15, -128, -128, -128, -128 }
+};
+
+///
+// SSSE3 kernels, 16 output bytes per iteration for 1, 2 and 4 bytes per pixel
+//
+__attribute__((target("ssse3")))
+static void FilterRow_SSSE3 ( unsigned char *dst, const unsigned char *row0, const unsigned char *row1,
+                              int width, int bpp )
+{
+   __m128i mask = _mm_loadu_si128 ( (const __m128i *) pairShuffle[bpp == 4 ? 2 : bpp - 1] );
+   __m128i ones = _mm_set1_epi8 ( 1 );
+   int pixels = 16 / bpp;
+
+   for ( ; width >= pixels; width -= pixels, dst += 16, row0 += 32, row1 += 32 )
+   {
+      // Pair sums of each row are at most 510, of both 1020
+      __m128i lo = _mm_add_epi16 (
+         _mm_maddubs_epi16 ( _mm_shuffle_epi8 ( _mm_loadu_si128 ( (const __m128i *) row0 ), mask ), ones ),
+         _mm_maddubs_epi16 ( _mm_shuffle_epi8 ( _mm_loadu_si128 ( (const __m128i *) row1 ), mask ), ones ) );
+      __m128i hi = _mm_add_epi16 (
+         _mm_maddubs_epi16 ( _mm_shuffle_epi8 ( _mm_loadu_si128 ( (const __m128i *) ( row0 + 16 ) ), mask ), ones ),
+         _mm_maddubs_epi16 ( _mm_shuffle_epi8 ( _mm_loadu_si128 ( (const __m128i *) ( row1 + 16 ) ), mask ), ones ) );
+
+      _mm_storeu_si128 ( (__m128i *) dst, _mm_packus_epi16 ( _mm_srli_epi16 ( lo, 2 ), _mm_srli_epi16 ( hi, 2 ) ) );
+   }
+
+   FilterRowC ( dst, row0, row1, width, bpp );
+}
+
+///
+// RGB, 4 output pixels from 24 bytes of each row per iteration
+//
+__attribute__((target("ssse3")))
+static void FilterRowRGB_SSSE3 ( unsigned char *dst, const unsigned char *row0, const unsigned char *row1,
+                                 int width, int bpp )
+{
+   __m128i first = _mm_loadu_si128 ( (const __m128i *) pairShuffle[3] );
+   __m128i second = _mm_loadu_si128 ( (const __m128i *) pairShuffle[4] );
+   __m128i pack = _mm_setr_epi8 ( 0, 1, 2, 3, 4, 5, 8, 9, 10, 11, 12, 13, -128, -128, -128, -128 );
+   __m128i ones = _mm_set1_epi8 ( 1 );
+   int tail;
+
+   for ( ; width >= 4; width -= 4, dst += 12, row0 += 24, row1 += 24 )
+   {
+      __m128i lo = _mm_add_epi16 (
+         _mm_maddubs_epi16 ( _mm_shuffle_epi8 ( _mm_loadu_si128 ( (const __m128i *) row0 ), first ), ones ),
+         _mm_maddubs_epi16 ( _mm_shuffle_epi8 ( _mm_loadu_si128 ( (const __m128i *) row1 ), first ), ones ) );
+      __m128i hi = _mm_add_epi16 (
+         _mm_maddubs_epi16 ( _mm_shuffle_epi8 ( _mm_loadu_si128 ( (const __m128i *) ( row0 + 8 ) ), second ), ones ),
+         _mm_maddubs_epi16 ( _mm_shuffle_epi8 ( _mm_loadu_si128 ( (const __m128i *) ( row1 + 8 ) ), second ), ones ) );
+      __m128i out = _mm_shuffle_epi8 ( _mm_packus_epi16 ( _mm_srli_epi16 ( lo, 2 ), _mm_srli_epi16 ( hi, 2 ) ), pack );
+
+      _mm_storel_epi64 ( (__m128i *) dst, out );
+      tail = _mm_cvtsi128_si32 ( _mm_srli_si128 ( out, 8 ) );
+      memcpy ( dst + 8, &tail, 4 );
+   }
+
+   FilterRowC ( dst, row0, row1, width, bpp );
+}
+#endif
+
+#ifdef ES_MIP_NEON
+///
+// NEON kernel, 16 output pixels per iteration.  The loads split the channels, a pairwise
+// widening add then sums neighbors.
+//
+static void FilterRow_NEON ( unsigned char *dst, const unsigned char *row0, const unsigned char *row1,
+                             int width, int bpp )
+{
+   for ( ; width >= 16; width -= 16, dst += 16 * bpp, row0 += 32 * bpp, row1 += 32 * bpp )
+   {
+      switch ( bpp )
+      {
+         case 1:
+         {
+            uint16x8_t lo = vaddq_u16 ( vpaddlq_u8 ( vld1q_u8 ( row0 ) ), vpaddlq_u8 ( vld1q_u8 ( row1 ) ) );
+            uint16x8_t hi = vaddq_u16 ( vpaddlq_u8 ( vld1q_u8 ( row0 + 16 ) ), vpaddlq_u8 ( vld1q_u8 ( row1 + 16 ) ) );
+
+            vst1q_u8 ( dst, vcombine_u8 ( vshrn_n_u16 ( lo, 2 ), vshrn_n_u16 ( hi, 2 ) ) );
+            break;
+         }
+         case 2:
+         {
+            uint8x16x2_t a = vld2q_u8 ( row0 ), b = vld2q_u8 ( row1 );
+            uint8x8x2_t out;
+            int c;
+
+            for ( c = 0; c < 2; c++ )
+               out.val[c] = vshrn_n_u16 ( vaddq_u16 ( vpaddlq_u8 ( a.val[c] ), vpaddlq_u8 ( b.val[c] ) ), 2 );
+            vst2_u8 ( dst, out );
+            a = vld2q_u8 ( row0 + 32 );
+            b = vld2q_u8 ( row1 + 32 );
+            for ( c = 0; c < 2; c++ )
+               out.val[c] = vshrn_n_u16 ( vaddq_u16 ( vpaddlq_u8 ( a.val[c] ), vpaddlq_u8 ( b.val[c] ) ), 2 );
+            vst2_u8 ( dst + 16, out );
+            break;
+         }
+         case 3:
+         {
+            uint8x16x3_t a = vld3q_u8 ( row0 ), b = vld3q_u8 ( row1 );
+            uint8x8x3_t out;
+            int c;
+
+            for ( c = 0; c < 3; c++ )
+               out.val[c] = vshrn_n_u16 ( vaddq_u16 ( vpaddlq_u8 ( a.val[c] ), vpaddlq_u8 ( b.val[c] ) ), 2 );
+            vst3_u8 ( dst, out );
+            a = vld3q_u8 ( row0 + 48 );
+            b = vld3q_u8 ( row1 + 48 );
+            for ( c = 0; c < 3; c++ )
+               out.val[c] = vshrn_n_u16 ( vaddq_u16 ( vpaddlq_u8 ( a.val[c] ), vpaddlq_u8 ( b.val[c] ) ), 2 );
+            vst3_u8 ( dst + 24, out );
+            break;
+         }
+         default:
+         {
+            uint8x16x4_t a = vld4q_u8 ( row0 ), b = vld4q_u8 ( row1 );
+            uint8x8x4_t out;
+            int c;
+
+            for ( c = 0; c < 4; c++ )
+               out.val[c] = vshrn_n_u16 ( vaddq_u16 ( vpaddlq_u8 ( a.val[c] ), vpaddlq_u8 ( b.val[c] ) ), 2 );
+            vst4_u8 ( dst, out );
+            a = vld4q_u8 ( row0 + 64 );
+            b = vld4q_u8 ( row1 + 64 );
+            for ( c = 0; c < 4; c++ )
+               out.val[c] = vshrn_n_u16 ( vaddq_u16 ( vpaddlq_u8 ( a.val[c] ), vpaddlq_u8 ( b.val[c] ) ), 2 );
+            vst4_u8 ( dst + 32, out );
+            break;
+         }
+      }
+   }
+
+   FilterRowC ( dst, row0, row1, width, bpp );
+}
+#endif
+
+///
+// SelectFilter()
+//
+//    Picks the row kernel for bpp bytes per pixel, using SIMD where the CPU
+//    has it
+//
+static RowFunc SelectFilter ( int bpp )
+{
+#if defined(ES_MIP_SSSE3)
+   if ( __builtin_cpu_supports ( "ssse3" ) )
+      return bpp == 3 ? FilterRowRGB_SSSE3 : FilterRow_SSSE3;
+#elif defined(ES_MIP_NEON)
+   return FilterRow_NEON;
+#endif
+   (void) bpp;
+   return FilterRowC;
+}
+
+///
+// FilterRows()
+//
+//    Filters output rows first to last - 1 of a level from the level above
+//
+static void FilterRows ( const ESMipChain *chain, RowFunc filter, int bpp, int level, int first, int last )
+{
+   const unsigned char *src = esMipChainLevel ( chain, level - 1 );
+   unsigned char *dst = (unsigned char *) esMipChainLevel ( chain, level );
+   int srcWidth = chain->width[level - 1];
+   int srcHeight = chain->height[level - 1];
+   int width = chain->width[level];
+   size_t srcPitch = (size_t) srcWidth * bpp;
+   int y;
+
+   for ( y = first; y < last; y++ )
+   {
+      const unsigned char *row0 = src + (size_t) y * 2 * srcPitch;
+      const unsigned char *row1 = srcHeight > 1 ? row0 + srcPitch : row0;
+
+      if ( srcWidth > 1 )
+         filter ( dst + (size_t) y * width * bpp, row0, row1, width, bpp );
+      else
+         FilterRow ( dst + (size_t) y * width * bpp, row0, row1, width, bpp, srcWidth );
+   }
+}
+
+///
+// MipThread()
+//
+//    Filters tasks of rows of a level until none are left
+//
+static void *MipThread ( void *arg )
+{
+   MipJob *job = arg;
+   int height = job->chain->height[job->level];
+   int row;
+
+   while ( ( row = __sync_fetch_and_add ( &job->nextRow, ES_MIP_ROWS_PER_TASK ) ) < height )
+      FilterRows ( job->chain, job->filter, job->bpp, job->level, row,
+                   row + ES_MIP_ROWS_PER_TASK < height ? row + ES_MIP_ROWS_PER_TASK : height );
+
+   return NULL;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esGenerateMipChain()
+//
+GLboolean ESUTIL_API esGenerateMipChain ( const void *pixels, GLint width, GLint height, GLenum format,
+                                          int numThreads, ESMipChain *chain )
+{
+   pthread_t threads[ES_MIP_MAX_THREADS];
+   MipJob job;
+   int bpp, level, i;
+   size_t size = 0;
+
+   memset ( chain, 0, sizeof ( ESMipChain ) );
+   bpp = format == GL_RGBA ? 4 : format == GL_RGB ? 3 : format == GL_LUMINANCE_ALPHA ? 2 :
+         format == GL_LUMINANCE ? 1 : 0;
+   if ( bpp == 0 || width < 1 || height < 1 || width >= ( 1 << ES_MAX_MIP_LEVELS ) ||
+        height >= ( 1 << ES_MAX_MIP_LEVELS ) )
+   {
+      esLog ( ES_LOG_ERROR, "esGenerateMipChain: unsupported %dx%d image of format 0x%04x\n",
+              width, height, format );
+      return GL_FALSE;
+   }
+
+   chain->format = format;
+   chain->base = pixels;
+   chain->width[0] = width;
+   chain->height[0] = height;
+   for ( level = 1; width > 1 || height > 1; level++ )
+   {
+      width = width > 1 ? width / 2 : 1;
+      height = height > 1 ? height / 2 : 1;
+      chain->width[level] = width;
+      chain->height[level] = height;
+      chain->offset[level] = size;
+      size += (size_t) width * height * bpp;
+   }
+   chain->numLevels = level;
+   chain->size = size;
+
+   if ( size == 0 )
+      return GL_TRUE;
+   chain->data = malloc ( size );
+   if ( chain->data == NULL )
+      return GL_FALSE;
+
+   job.chain = chain;
+   job.filter = SelectFilter ( bpp );
+   job.bpp = bpp;
+
+   if ( numThreads <= 0 )
+      numThreads = (int) sysconf ( _SC_NPROCESSORS_ONLN );
+   if ( numThreads > ES_MIP_MAX_THREADS )
+      numThreads = ES_MIP_MAX_THREADS;
+
+   for ( level = 1; level < chain->numLevels; level++ )
+   {
+      job.level = level;
+      job.nextRow = 0;
+
+      i = 1;
+      if ( (long) chain->width[level] * chain->height[level] >= ES_MIP_PARALLEL_TEXELS )
+      {
+         for ( ; i < numThreads; i++ )
+         {
+            if ( pthread_create ( &threads[i], NULL, MipThread, &job ) != 0 )
+               break;
+         }
+      }
+
+      MipThread ( &job );
+      while ( --i > 0 )
+         pthread_join ( threads[i], NULL );
+   }
+
+   return GL_TRUE;
+}
+
+///
+//  esMipChainLevel()
+//
+const void* ESUTIL_API esMipChainLevel ( const ESMipChain *chain, int level )
+{
+   return level == 0 ? chain->base : chain->data + chain->offset[level];
+}
+
+///
+//  esFreeMipChain()
+//
+void ESUTIL_API esFreeMipChain ( ESMipChain *chain )
+{
+   free ( chain->data );
+   chain->data = NULL;
+}
@@ -0,0 +1,481 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESPixelFormat.c
+//
+//    Converts RGB8 and RGBA8 images into the compact formats ES 2.0 takes:
+//    RGB565, RGBA4444 and RGBA5551 packed shorts, luminance and luminance
+//    alpha.  A channel of n levels gets floor ( ( v * ( n - 1 ) + t ) / 255 )
+//    with t = 127 when rounding to nearest, or t from a 4x4 Bayer matrix for
+//    ordered dithering; the division by 255 is exact as
+//    ( x + ( x >> 8 ) + 1 ) >> 8 on 16 bits.  Floyd-Steinberg dithering
+//    carries the error of every texel to its neighbors and runs one row
+//    after the other.  Alpha is never dithered.  Luminance is
+//    ( 77 R + 150 G + 29 B + 128 ) >> 8.
+//
+//    The SSSE3 (picked at runtime) and NEON kernels split 8 pixels into
+//    16-bit lanes per channel and pack them back with shifts.
+//
+
+///
+//  Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include "esUtil.h"
+#include <GLES2/gl2ext.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#define ES_PIXEL_SSSE3
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ES_PIXEL_NEON
+#endif
+
+///
+// Defines
+//
+
+// Threshold of rounding to nearest
+#define ES_PIXEL_ROUND     127
+
+///
+// Types
+//
+typedef struct
+{
+   GLenum   dstFormat;
+
+   // Format and type to upload with, and bytes per pixel
+   GLenum   format;
+   GLenum   type;
+   int      bytes;
+
+   // Largest value and position of red, green, blue and alpha in a packed short
+   int      max[4];
+   int      shift[4];
+} PixelFormat;
+
+// Converts a row of count pixels of srcBytes each; threshold holds the 4 thresholds of the
+// row, repeated every 4 pixels
+typedef void (*ConvertFunc) ( void *dst, const unsigned char *src, int count, int srcBytes,
+                              const PixelFormat *fmt, const unsigned char *threshold );
+
+static const PixelFormat pixelFormats[] =
+{
+   { GL_RGB565,          GL_RGB,             GL_UNSIGNED_SHORT_5_6_5,   2, { 31, 63, 31, 0 },  { 11, 5, 0, 0 } },
+   { GL_RGBA4,           GL_RGBA,            GL_UNSIGNED_SHORT_4_4_4_4, 2, { 15, 15, 15, 15 }, { 12, 8, 4, 0 } },
+   { GL_RGB5_A1,         GL_RGBA,            GL_UNSIGNED_SHORT_5_5_5_1, 2, { 31, 31, 31, 1 },  { 11, 6, 1, 0 } },
+   { GL_LUMINANCE,       GL_LUMINANCE,       GL_UNSIGNED_BYTE,          1, { 0, 0, 0, 0 },     { 0, 0, 0, 0 } },
+   { GL_LUMINANCE_ALPHA, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE,          2, { 0, 0, 0, 0 },     { 0, 0, 0, 0 } },
+};
+
+// 4x4 Bayer matrix as thresholds ( 2 b + 1 ) * 255 / 32
+static const unsigned char bayerThreshold[4][4] =
+{
+   {   7, 135,  39, 167 },
+   { 199,  71, 231, 103 },
+   {  55, 183,  23, 151 },
+   { 247, 119, 215,  87 }
+};
+
+static const unsigned char roundThreshold[4] =
+{
+   ES_PIXEL_ROUND, ES_PIXEL_ROUND, ES_PIXEL_ROUND, ES_PIXEL_ROUND
+};
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// FindFormat()
+//
+static const PixelFormat *FindFormat ( GLenum dstFormat )
+{
+   unsigned int i;
+
+   for ( i = 0; i < sizeof ( pixelFormats ) / sizeof ( pixelFormats[0] ); i++ )
+   {
+      if ( pixelFormats[i].dstFormat == dstFormat )
+         return &pixelFormats[i];
+   }
+   return NULL;
+}
+
+///
+// Quantize()
+//
+//    v * max / 255 plus threshold / 255, truncated
+//
+static int Quantize ( int v, int max, int threshold )
+{
+   int x = v * max + threshold;
+
+   return ( x + ( x >> 8 ) + 1 ) >> 8;
+}
+
+///
+// Pack()
+//
+static unsigned short Pack ( const PixelFormat *fmt, const int q[3], int a )
+{
+   return (unsigned short) ( ( q[0] << fmt->shift[0] ) | ( q[1] << fmt->shift[1] ) | ( q[2] << fmt->shift[2] ) |
+                             ( Quantize ( a, fmt->max[3], ES_PIXEL_ROUND ) << fmt->shift[3] ) );
+}
+
+///
+// ConvertRow()
+//
+//    Scalar kernel, also used for the last pixels of a row
+//
+static void ConvertRow ( void *dst, const unsigned char *src, int count, int srcBytes,
+                         const PixelFormat *fmt, const unsigned char *threshold )
+{
+   unsigned short *dst16 = dst;
+   unsigned char *dst8 = dst;
+   int x, c, q[3];
+
+   for ( x = 0; x < count; x++, src += srcBytes )
+   {
+      int a = srcBytes == 4 ? src[3] : 255;
+
+      if ( fmt->type != GL_UNSIGNED_BYTE )
+      {
+         for ( c = 0; c < 3; c++ )
+            q[c] = Quantize ( src[c], fmt->max[c], threshold[x & 3] );
+         dst16[x] = Pack ( fmt, q, a );
+         continue;
+      }
+
+      *dst8++ = (unsigned char) ( ( 77 * src[0] + 150 * src[1] + 29 * src[2] + 128 ) >> 8 );
+      if ( fmt->dstFormat == GL_LUMINANCE_ALPHA )
+         *dst8++ = (unsigned char) a;
+   }
+}
+
+#ifdef ES_PIXEL_SSSE3
+///
+// SSSE3 kernel, 8 pixels per iteration
+//
+__attribute__((target("ssse3")))
+static void Convert_SSSE3 ( void *dst, const unsigned char *src, int count, int srcBytes,
+                            const PixelFormat *fmt, const unsigned char *threshold )
+{
+   // Each pixel register is shuffled to R0-3 G0-3 B0-3 A0-3, RGB starting at bytes 0 and 12
+   __m128i rgbaMask = _mm_setr_epi8 ( 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15 );
+   __m128i rgbMask0 = _mm_setr_epi8 ( 0, 3, 6, 9, 1, 4, 7, 10, 2, 5, 8, 11, -128, -128, -128, -128 );
+   __m128i rgbMask1 = _mm_setr_epi8 ( 4, 7, 10, 13, 5, 8, 11, 14, 6, 9, 12, 15, -128, -128, -128, -128 );
+   __m128i t = _mm_setr_epi16 ( threshold[0], threshold[1], threshold[2], threshold[3],
+                                threshold[0], threshold[1], threshold[2], threshold[3] );
+   __m128i round = _mm_set1_epi16 ( ES_PIXEL_ROUND );
+   __m128i one = _mm_set1_epi16 ( 1 );
+   __m128i zero = _mm_setzero_si128 ( );
+   __m128i opaque = _mm_set1_epi8 ( (char) 255 );
+   unsigned char *out = dst;
+   int done = count & ~7;
+
+   for ( ; count >= 8; count -= 8, src += 8 * srcBytes )
+   {
+      __m128i lo, hi, rg, ba, ch[4], q, packed;
+      int c;
+
+      if ( srcBytes == 4 )
+      {
+         lo = _mm_shuffle_epi8 ( _mm_loadu_si128 ( (const __m128i *) src ), rgbaMask );
+         hi = _mm_shuffle_epi8 ( _mm_loadu_si128 ( (const __m128i *) ( src + 16 ) ), rgbaMask );
+      }
+      else
+      {
+         // Bytes 8 to 23 hold pixels 4 to 7 from byte 4 on
+         lo = _mm_or_si128 ( _mm_shuffle_epi8 ( _mm_loadu_si128 ( (const __m128i *) src ), rgbMask0 ),
+                             _mm_slli_si128 ( opaque, 12 ) );
+         hi = _mm_or_si128 ( _mm_shuffle_epi8 ( _mm_loadu_si128 ( (const __m128i *) ( src + 8 ) ), rgbMask1 ),
+                             _mm_slli_si128 ( opaque, 12 ) );
+      }
+      rg = _mm_unpacklo_epi32 ( lo, hi );
+      ba = _mm_unpackhi_epi32 ( lo, hi );
+      ch[0] = _mm_unpacklo_epi8 ( rg, zero );
+      ch[1] = _mm_unpackhi_epi8 ( rg, zero );
+      ch[2] = _mm_unpacklo_epi8 ( ba, zero );
+      ch[3] = _mm_unpackhi_epi8 ( ba, zero );
+
+      if ( fmt->type == GL_UNSIGNED_BYTE )
+      {
+         // Sums stay below 65536, so unsigned wraparound of the 16-bit lanes is harmless
+         __m128i l = _mm_add_epi16 ( _mm_add_epi16 ( _mm_mullo_epi16 ( ch[0], _mm_set1_epi16 ( 77 ) ),
+                                                     _mm_mullo_epi16 ( ch[1], _mm_set1_epi16 ( 150 ) ) ),
+                                     _mm_add_epi16 ( _mm_mullo_epi16 ( ch[2], _mm_set1_epi16 ( 29 ) ),
+                                                     _mm_set1_epi16 ( 128 ) ) );
+
+         l = _mm_packus_epi16 ( _mm_srli_epi16 ( l, 8 ), zero );
+         if ( fmt->dstFormat == GL_LUMINANCE )
+         {
+            _mm_storel_epi64 ( (__m128i *) out, l );
+            out += 8;
+         }
+         else
+         {
+            _mm_storeu_si128 ( (__m128i *) out, _mm_unpacklo_epi8 ( l, _mm_packus_epi16 ( ch[3], zero ) ) );
+            out += 16;
+         }
+         continue;
+      }
+
+      packed = zero;
+      for ( c = 0; c < 4; c++ )
+      {
+         if ( fmt->max[c] == 0 )
+            continue;
+         q = _mm_add_epi16 ( _mm_mullo_epi16 ( ch[c], _mm_set1_epi16 ( fmt->max[c] ) ), c < 3 ? t : round );
+         q = _mm_srli_epi16 ( _mm_add_epi16 ( _mm_add_epi16 ( q, _mm_srli_epi16 ( q, 8 ) ), one ), 8 );
+         packed = _mm_or_si128 ( packed, _mm_sll_epi16 ( q, _mm_cvtsi32_si128 ( fmt->shift[c] ) ) );
+      }
+      _mm_storeu_si128 ( (__m128i *) out, packed );
+      out += 16;
+   }
+
+   // The thresholds repeat every 4 pixels, so the tail starts with the first one
+   ConvertRow ( (unsigned char *) dst + (size_t) done * fmt->bytes, src, count, srcBytes, fmt, threshold );
+}
+#endif
+
+#ifdef ES_PIXEL_NEON
+///
+// NEON kernel, 8 pixels per iteration
+//
+static void Convert_NEON ( void *dst, const unsigned char *src, int count, int srcBytes,
+                           const PixelFormat *fmt, const unsigned char *threshold )
+{
+   static const unsigned short lanes[8] = { 0, 1, 2, 3, 0, 1, 2, 3 };
+   uint16x8_t t, round = vdupq_n_u16 ( ES_PIXEL_ROUND ), one = vdupq_n_u16 ( 1 );
+   unsigned char *out = dst;
+   int done = count & ~7, i;
+   unsigned short th[8];
+
+   for ( i = 0; i < 8; i++ )
+      th[i] = threshold[lanes[i]];
+   t = vld1q_u16 ( th );
+
+   for ( ; count >= 8; count -= 8, src += 8 * srcBytes )
+   {
+      uint16x8_t ch[4], q, packed;
+      int c;
+
+      if ( srcBytes == 4 )
+      {
+         uint8x8x4_t rgba = vld4_u8 ( src );
+
+         for ( c = 0; c < 4; c++ )
+            ch[c] = vmovl_u8 ( rgba.val[c] );
+      }
+      else
+      {
+         uint8x8x3_t rgb = vld3_u8 ( src );
+
+         for ( c = 0; c < 3; c++ )
+            ch[c] = vmovl_u8 ( rgb.val[c] );
+         ch[3] = vdupq_n_u16 ( 255 );
+      }
+
+      if ( fmt->type == GL_UNSIGNED_BYTE )
+      {
+         uint16x8_t l = vmlaq_n_u16 ( vmlaq_n_u16 ( vmlaq_n_u16 ( vdupq_n_u16 ( 128 ), ch[0], 77 ), ch[1], 150 ),
+                                      ch[2], 29 );
+
+         if ( fmt->dstFormat == GL_LUMINANCE )
+         {
+            vst1_u8 ( out, vshrn_n_u16 ( l, 8 ) );
+            out += 8;
+         }
+         else
+         {
+            uint8x8x2_t la = { { vshrn_n_u16 ( l, 8 ), vmovn_u16 ( ch[3] ) } };
+
+            vst2_u8 ( out, la );
+            out += 16;
+         }
+         continue;
+      }
+
+      packed = vdupq_n_u16 ( 0 );
+      for ( c = 0; c < 4; c++ )
+      {
+         if ( fmt->max[c] == 0 )
+            continue;
+         q = vmlaq_n_u16 ( c < 3 ? t : round, ch[c], (unsigned short) fmt->max[c] );
+         q = vshrq_n_u16 ( vaddq_u16 ( vaddq_u16 ( q, vshrq_n_u16 ( q, 8 ) ), one ), 8 );
+         packed = vorrq_u16 ( packed, vshlq_u16 ( q, vdupq_n_s16 ( (short) fmt->shift[c] ) ) );
+      }
+      vst1q_u16 ( (unsigned short *) out, packed );
+      out += 16;
+   }
+
+   ConvertRow ( (unsigned char *) dst + (size_t) done * fmt->bytes, src, count, srcBytes, fmt, threshold );
+}
+#endif
+
+///
+// SelectConvert()
+//
+//    Picks the row kernel, using SIMD where the CPU has it
+//
+static ConvertFunc SelectConvert ( void )
+{
+#if defined(ES_PIXEL_SSSE3)
+   if ( __builtin_cpu_supports ( "ssse3" ) )
+      return Convert_SSSE3;
+#elif defined(ES_PIXEL_NEON)
+   return Convert_NEON;
+#endif
+   return ConvertRow;
+}
+
+///
+// ConvertFloydSteinberg()
+//
+//    Floyd-Steinberg dithering to a packed short format.  Errors are kept
+//    in sixteenths for the row being converted and the next one, and
+//    tables give each channel value its level and the error against the
+//    value that level expands back to.
+//
+static GLboolean ConvertFloydSteinberg ( unsigned short *dst, const unsigned char *src, int width, int height,
+                                         int srcBytes, const PixelFormat *fmt )
+{
+   int pitch = ( width + 2 ) * 3;
+   int *errors = calloc ( 2 * pitch, sizeof ( int ) );
+   unsigned char level[3][256];
+   signed char residual[3][256];
+   int x, y, c, v, q[3];
+
+   if ( errors == NULL )
+      return GL_FALSE;
+
+   for ( c = 0; c < 3; c++ )
+   {
+      for ( v = 0; v < 256; v++ )
+      {
+         level[c][v] = (unsigned char) Quantize ( v, fmt->max[c], ES_PIXEL_ROUND );
+         residual[c][v] = (signed char) ( v - ( level[c][v] * 255 + fmt->max[c] / 2 ) / fmt->max[c] );
+      }
+   }
+
+   for ( y = 0; y < height; y++ )
+   {
+      int *cur = errors + ( y & 1 ) * pitch;
+      int *next = errors + ( ~y & 1 ) * pitch;
+
+      memset ( next, 0, pitch * sizeof ( int ) );
+      for ( x = 0; x < width; x++, src += srcBytes )
+      {
+         for ( c = 0; c < 3; c++ )
+         {
+            int e = cur[( x + 1 ) * 3 + c];
+
+            v = src[c] + ( e >= 0 ? ( e + 8 ) >> 4 : -( ( 8 - e ) >> 4 ) );
+            v = v < 0 ? 0 : v > 255 ? 255 : v;
+            q[c] = level[c][v];
+
+            e = residual[c][v];
+            cur[( x + 2 ) * 3 + c] += e * 7;
+            next[x * 3 + c] += e * 3;
+            next[( x + 1 ) * 3 + c] += e * 5;
+            next[( x + 2 ) * 3 + c] += e;
+         }
+         *dst++ = Pack ( fmt, q, srcBytes == 4 ? src[3] : 255 );
+      }
+   }
+
+   free ( errors );
+   return GL_TRUE;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esConvertPixels()
+//
+GLboolean ESUTIL_API esConvertPixels ( const void *pixels, GLsizei width, GLsizei height, GLenum srcFormat,
+                                       GLenum dstFormat, int dither, void *dst, GLenum *format, GLenum *type )
+{
+   const PixelFormat *fmt = FindFormat ( dstFormat );
+   int srcBytes = srcFormat == GL_RGBA ? 4 : srcFormat == GL_RGB ? 3 : 0;
+   const unsigned char *src = pixels;
+   ConvertFunc convert;
+   int y;
+
+   if ( fmt == NULL || srcBytes == 0 || width < 0 || height < 0 )
+   {
+      esLog ( ES_LOG_ERROR, "esConvertPixels: cannot convert format 0x%04x to 0x%04x\n", srcFormat, dstFormat );
+      return GL_FALSE;
+   }
+
+   if ( format != NULL )
+      *format = fmt->format;
+   if ( type != NULL )
+      *type = fmt->type;
+
+   // Dithering only matters for the packed formats, luminance keeps 8 bits
+   if ( dither == ES_DITHER_FLOYD_STEINBERG && fmt->type != GL_UNSIGNED_BYTE )
+      return ConvertFloydSteinberg ( dst, src, width, height, srcBytes, fmt );
+
+   convert = SelectConvert ( );
+   for ( y = 0; y < height; y++ )
+   {
+      convert ( (unsigned char *) dst + (size_t) y * width * fmt->bytes, src + (size_t) y * width * srcBytes,
+                width, srcBytes, fmt, dither == ES_DITHER_ORDERED ? bayerThreshold[y & 3] : roundThreshold );
+   }
+   return GL_TRUE;
+}
+
+///
+//  esTexImage2DConverted()
+//
+GLboolean ESUTIL_API esTexImage2DConverted ( GLenum target, GLint level, GLsizei width, GLsizei height,
+                                             GLenum srcFormat, const void *pixels, GLenum dstFormat, int dither )
+{
+   const PixelFormat *fmt = FindFormat ( dstFormat );
+   size_t pitch = (size_t) width * ( fmt != NULL ? fmt->bytes : 0 );
+   void *converted;
+   GLenum format, type;
+   GLint alignment;
+
+   if ( fmt == NULL || width <= 0 || height <= 0 )
+   {
+      esLog ( ES_LOG_ERROR, "esTexImage2DConverted: unsupported %dx%d image or format 0x%04x\n",
+              width, height, dstFormat );
+      return GL_FALSE;
+   }
+
+   converted = malloc ( pitch * height );
+   if ( converted == NULL )
+      return GL_FALSE;
+   if ( !esConvertPixels ( pixels, width, height, srcFormat, dstFormat, dither, converted, &format, &type ) )
+   {
+      free ( converted );
+      return GL_FALSE;
+   }
+
+   // Rows are tightly packed, tell GL the largest alignment they keep
+   glGetIntegerv ( GL_UNPACK_ALIGNMENT, &alignment );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, pitch % 8 == 0 ? 8 : pitch % 4 == 0 ? 4 : pitch % 2 == 0 ? 2 : 1 );
+   glTexImage2D ( target, level, format, width, height, 0, format, type, converted );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, alignment );
+
+   free ( converted );
+   return GL_TRUE;
+}
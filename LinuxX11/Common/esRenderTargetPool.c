@@ -0,0 +1,413 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESRenderTargetPool.c
+//
+//    Transient render targets for multi-pass effects.  A pass acquires the
+//    color and depth targets it renders into and releases each one after the
+//    last pass that reads it.  A released target goes back to the pool and is
+//    handed to the next pass that asks for the same size and format, so
+//    passes whose lifetimes do not overlap share the same GPU memory, within
+//    a frame as well as across frames.  ES 2.0 cannot place textures of
+//    different formats in the same memory, so targets are only shared between
+//    requests with identical descriptions.  Framebuffer objects are cached per
+//    combination of attachments, targets left unused for
+//    ES_RENDER_TARGET_MAX_IDLE frames are deleted.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdlib.h>
+#include <GLES2/gl2ext.h>
+
+///
+// Defines
+//
+
+// Frames a free target is kept around for before it is deleted
+#define ES_RENDER_TARGET_MAX_IDLE   60
+
+// Framebuffer objects kept per pool
+#define ES_RENDER_TARGET_MAX_FBOS   16
+
+///
+// Types
+//
+typedef struct _esrendertargetnode
+{
+   ESRenderTarget    target;
+   GLboolean         inUse;
+   unsigned int      lastUsed;
+   struct _esrendertargetnode *next;
+} ESRenderTargetNode;
+
+typedef struct
+{
+   GLuint         fbo;
+   GLuint         texture;
+   GLuint         renderbuffer;
+   unsigned int   lastUsed;
+} ESRenderTargetFbo;
+
+struct _esrendertargetpool
+{
+   ESRenderTargetNode  *targets;
+   ESRenderTargetFbo    fbos[ES_RENDER_TARGET_MAX_FBOS];
+   unsigned int         frame;
+
+   // Counters of the frame in progress
+   unsigned int         frameAcquires;
+   unsigned int         frameAllocations;
+   size_t               frameAcquiredBytes;
+
+   ESRenderTargetPoolStats stats;
+};
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// FormatInfo()
+//
+//    Returns the bytes per pixel of a target format, 0 if the format is not
+//    supported.  Color formats are stored in textures so later passes can
+//    sample them, depth and stencil formats in renderbuffers.  Drivers store
+//    GL_RGB with 8 bits per channel padded to 32 bits.
+//
+static int FormatInfo ( GLenum format, GLenum *texFormat, GLenum *texType )
+{
+   *texFormat = GL_NONE;
+   *texType = GL_NONE;
+
+   switch ( format )
+   {
+      case GL_RGBA:
+         *texFormat = GL_RGBA;   *texType = GL_UNSIGNED_BYTE;           return 4;
+      case GL_RGB:
+         *texFormat = GL_RGB;    *texType = GL_UNSIGNED_BYTE;           return 4;
+      case GL_RGB565:
+         *texFormat = GL_RGB;    *texType = GL_UNSIGNED_SHORT_5_6_5;    return 2;
+      case GL_RGBA4:
+         *texFormat = GL_RGBA;   *texType = GL_UNSIGNED_SHORT_4_4_4_4;  return 2;
+      case GL_RGB5_A1:
+         *texFormat = GL_RGBA;   *texType = GL_UNSIGNED_SHORT_5_5_5_1;  return 2;
+      case GL_DEPTH_COMPONENT16:                                        return 2;
+      case GL_STENCIL_INDEX8:                                           return 1;
+      case GL_DEPTH24_STENCIL8_OES:                                     return 4;
+   }
+   return 0;
+}
+
+///
+// CreateTarget()
+//
+static ESRenderTargetNode *CreateTarget ( GLsizei width, GLsizei height, GLenum format )
+{
+   ESRenderTargetNode *node;
+   GLenum texFormat, texType;
+   int bytesPerPixel = FormatInfo ( format, &texFormat, &texType );
+   GLint binding;
+
+   if ( bytesPerPixel == 0 )
+   {
+      esLog ( ES_LOG_ERROR, "esRenderTargetAcquire: unsupported format 0x%04x\n", format );
+      return NULL;
+   }
+
+   node = calloc ( 1, sizeof ( ESRenderTargetNode ) );
+   if ( node == NULL )
+      return NULL;
+
+   node->target.width = width;
+   node->target.height = height;
+   node->target.format = format;
+   node->target.bytes = (size_t) width * height * bytesPerPixel;
+
+   if ( texFormat != GL_NONE )
+   {
+      glGetIntegerv ( GL_TEXTURE_BINDING_2D, &binding );
+      glGenTextures ( 1, &node->target.texture );
+      glBindTexture ( GL_TEXTURE_2D, node->target.texture );
+      glTexImage2D ( GL_TEXTURE_2D, 0, texFormat, width, height, 0, texFormat, texType, NULL );
+
+      // Sizes are usually not powers of two, which ES 2.0 only samples without
+      // mipmaps and with clamped coordinates
+      glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+      glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+      glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+      glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+      glBindTexture ( GL_TEXTURE_2D, binding );
+   }
+   else
+   {
+      glGetIntegerv ( GL_RENDERBUFFER_BINDING, &binding );
+      glGenRenderbuffers ( 1, &node->target.renderbuffer );
+      glBindRenderbuffer ( GL_RENDERBUFFER, node->target.renderbuffer );
+      glRenderbufferStorage ( GL_RENDERBUFFER, format, width, height );
+      glBindRenderbuffer ( GL_RENDERBUFFER, binding );
+   }
+
+   return node;
+}
+
+///
+// DeleteTarget()
+//
+//    Deletes a target and the framebuffer objects it is attached to
+//
+static void DeleteTarget ( ESRenderTargetPool *pool, ESRenderTargetNode *node )
+{
+   int i;
+
+   for ( i = 0; i < ES_RENDER_TARGET_MAX_FBOS; i++ )
+   {
+      ESRenderTargetFbo *fbo = &pool->fbos[i];
+
+      if ( fbo->fbo != 0 &&
+           ( ( node->target.texture != 0 && fbo->texture == node->target.texture ) ||
+             ( node->target.renderbuffer != 0 && fbo->renderbuffer == node->target.renderbuffer ) ) )
+      {
+         glDeleteFramebuffers ( 1, &fbo->fbo );
+         fbo->fbo = 0;
+      }
+   }
+
+   if ( node->target.texture != 0 )
+      glDeleteTextures ( 1, &node->target.texture );
+   if ( node->target.renderbuffer != 0 )
+      glDeleteRenderbuffers ( 1, &node->target.renderbuffer );
+
+   pool->stats.numTargets--;
+   pool->stats.bytes -= node->target.bytes;
+   free ( node );
+}
+
+///
+// GetFramebuffer()
+//
+//    Returns the framebuffer object with the given attachments, creating it
+//    in place of the least recently used one when it is not cached
+//
+static GLuint GetFramebuffer ( ESRenderTargetPool *pool, const ESRenderTarget *color,
+                               const ESRenderTarget *depthStencil )
+{
+   GLuint texture = color != NULL ? color->texture : 0;
+   GLuint renderbuffer = depthStencil != NULL ? depthStencil->renderbuffer : 0;
+   ESRenderTargetFbo *fbo = &pool->fbos[0];
+   GLenum status;
+   int i;
+
+   for ( i = 0; i < ES_RENDER_TARGET_MAX_FBOS; i++ )
+   {
+      ESRenderTargetFbo *candidate = &pool->fbos[i];
+
+      if ( candidate->fbo != 0 && candidate->texture == texture && candidate->renderbuffer == renderbuffer )
+      {
+         candidate->lastUsed = pool->frame;
+         glBindFramebuffer ( GL_FRAMEBUFFER, candidate->fbo );
+         return candidate->fbo;
+      }
+
+      if ( fbo->fbo != 0 && ( candidate->fbo == 0 || candidate->lastUsed < fbo->lastUsed ) )
+         fbo = candidate;
+   }
+
+   if ( fbo->fbo != 0 )
+      glDeleteFramebuffers ( 1, &fbo->fbo );
+
+   fbo->texture = texture;
+   fbo->renderbuffer = renderbuffer;
+   fbo->lastUsed = pool->frame;
+   glGenFramebuffers ( 1, &fbo->fbo );
+   glBindFramebuffer ( GL_FRAMEBUFFER, fbo->fbo );
+
+   if ( texture != 0 )
+      glFramebufferTexture2D ( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0 );
+   if ( renderbuffer != 0 )
+   {
+      if ( depthStencil->format != GL_STENCIL_INDEX8 )
+         glFramebufferRenderbuffer ( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffer );
+      if ( depthStencil->format != GL_DEPTH_COMPONENT16 )
+         glFramebufferRenderbuffer ( GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffer );
+   }
+
+   status = glCheckFramebufferStatus ( GL_FRAMEBUFFER );
+   if ( status != GL_FRAMEBUFFER_COMPLETE )
+   {
+      esLog ( ES_LOG_ERROR, "esRenderTargetBind: framebuffer incomplete (0x%04x)\n", status );
+      glDeleteFramebuffers ( 1, &fbo->fbo );
+      fbo->fbo = 0;
+      return 0;
+   }
+
+   return fbo->fbo;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esRenderTargetPoolCreate()
+//
+ESRenderTargetPool* ESUTIL_API esRenderTargetPoolCreate ( void )
+{
+   return calloc ( 1, sizeof ( ESRenderTargetPool ) );
+}
+
+///
+//  esRenderTargetPoolDestroy()
+//
+void ESUTIL_API esRenderTargetPoolDestroy ( ESRenderTargetPool *pool )
+{
+   int i;
+
+   if ( pool == NULL )
+      return;
+
+   while ( pool->targets != NULL )
+   {
+      ESRenderTargetNode *node = pool->targets;
+
+      pool->targets = node->next;
+      DeleteTarget ( pool, node );
+   }
+
+   for ( i = 0; i < ES_RENDER_TARGET_MAX_FBOS; i++ )
+   {
+      if ( pool->fbos[i].fbo != 0 )
+         glDeleteFramebuffers ( 1, &pool->fbos[i].fbo );
+   }
+
+   free ( pool );
+}
+
+///
+//  esRenderTargetAcquire()
+//
+ESRenderTarget* ESUTIL_API esRenderTargetAcquire ( ESRenderTargetPool *pool, GLsizei width, GLsizei height,
+                                                   GLenum format )
+{
+   ESRenderTargetNode *node;
+
+   if ( width <= 0 || height <= 0 )
+      return NULL;
+
+   pool->frameAcquires++;
+
+   for ( node = pool->targets; node != NULL; node = node->next )
+   {
+      if ( !node->inUse && node->target.width == width && node->target.height == height &&
+           node->target.format == format )
+         break;
+   }
+
+   if ( node == NULL )
+   {
+      node = CreateTarget ( width, height, format );
+      if ( node == NULL )
+         return NULL;
+
+      node->next = pool->targets;
+      pool->targets = node;
+
+      pool->frameAllocations++;
+      pool->stats.numTargets++;
+      pool->stats.bytes += node->target.bytes;
+      pool->stats.totalAllocations++;
+      if ( pool->stats.bytes > pool->stats.peakBytes )
+         pool->stats.peakBytes = pool->stats.bytes;
+   }
+
+   node->inUse = GL_TRUE;
+   node->lastUsed = pool->frame;
+   pool->frameAcquiredBytes += node->target.bytes;
+   pool->stats.totalAcquires++;
+   return &node->target;
+}
+
+///
+//  esRenderTargetRelease()
+//
+void ESUTIL_API esRenderTargetRelease ( ESRenderTargetPool *pool, ESRenderTarget *target )
+{
+   ESRenderTargetNode *node = (ESRenderTargetNode *) target;
+
+   if ( target == NULL )
+      return;
+
+   node->inUse = GL_FALSE;
+   node->lastUsed = pool->frame;
+}
+
+///
+//  esRenderTargetBind()
+//
+GLboolean ESUTIL_API esRenderTargetBind ( ESRenderTargetPool *pool, const ESRenderTarget *color,
+                                          const ESRenderTarget *depthStencil )
+{
+   const ESRenderTarget *size = color != NULL ? color : depthStencil;
+
+   if ( size == NULL )
+      return GL_FALSE;
+
+   if ( GetFramebuffer ( pool, color, depthStencil ) == 0 )
+      return GL_FALSE;
+
+   esStateViewport ( 0, 0, size->width, size->height );
+   return GL_TRUE;
+}
+
+///
+//  esRenderTargetPoolEndFrame()
+//
+void ESUTIL_API esRenderTargetPoolEndFrame ( ESRenderTargetPool *pool )
+{
+   ESRenderTargetNode **link = &pool->targets;
+
+   pool->stats.frameAcquires = pool->frameAcquires;
+   pool->stats.frameAllocations = pool->frameAllocations;
+   pool->stats.frameAcquiredBytes = pool->frameAcquiredBytes;
+   pool->stats.frames++;
+   pool->frameAcquires = 0;
+   pool->frameAllocations = 0;
+   pool->frameAcquiredBytes = 0;
+   pool->frame++;
+
+   while ( *link != NULL )
+   {
+      ESRenderTargetNode *node = *link;
+
+      if ( !node->inUse && pool->frame - node->lastUsed > ES_RENDER_TARGET_MAX_IDLE )
+      {
+         *link = node->next;
+         DeleteTarget ( pool, node );
+      }
+      else
+      {
+         link = &node->next;
+      }
+   }
+}
+
+///
+//  esGetRenderTargetPoolStats()
+//
+void ESUTIL_API esGetRenderTargetPoolStats ( ESRenderTargetPool *pool, ESRenderTargetPoolStats *poolStats )
+{
+   *poolStats = pool->stats;
+}
@@ -44,6 +44,7 @@ GLuint ESUTIL_API esLoadShader ( GLenum type, const char *shaderSrc )
 {
    GLuint shader;
    GLint compiled;
+   ES_TRACE_ZONE("esLoadShader");
    
    // Create the shader object
    shader = glCreateShader ( type );
@@ -99,6 +100,7 @@ GLuint ESUTIL_API esLoadProgram ( const char *vertShaderSrc, const char *fragSha
    GLuint fragmentShader;
    GLuint programObject;
    GLint linked;
+   ES_TRACE_ZONE("esLoadProgram");
 
    // Load the vertex/fragment shaders
    vertexShader = esLoadShader ( GL_VERTEX_SHADER, vertShaderSrc );
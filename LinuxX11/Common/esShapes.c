@@ -60,6 +60,7 @@ int ESUTIL_API esGenSphere ( int numSlices, float radius, GLfloat **vertices, GL
    int numVertices = ( numParallels + 1 ) * ( numSlices + 1 );
    int numIndices = numParallels * numSlices * 6;
    float angleStep = (2.0f * ES_PI) / ((float) numSlices);
+   ES_TRACE_ZONE("esGenSphere");
 
    // Allocate memory for buffers
    if ( vertices != NULL )
@@ -144,6 +145,7 @@ int ESUTIL_API esGenCube ( float scale, GLfloat **vertices, GLfloat **normals,
    int i;
    int numVertices = 24;
    int numIndices = 36;
+   ES_TRACE_ZONE("esGenCube");
    
    GLfloat cubeVerts[] =
    {
@@ -0,0 +1,368 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESStateCache.c
+//
+//    Shadow copy of the GL state that examples set every frame.  Each
+//    esState* function compares against the shadowed value and only calls
+//    GL when the state actually changes.  Everything starts out unknown, so
+//    the first call always goes through.  The cache assumes it is the only
+//    one changing the state it tracks; call esStateInvalidate after setting
+//    that state directly or through other code.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <string.h>
+
+///
+// Defines
+//
+#define MAX_TEXTURE_UNITS     16
+#define MAX_VERTEX_ATTRIBS    16
+#define UNKNOWN               0xFFFFFFFFu
+
+///
+// Types
+//
+enum
+{
+   CAP_BLEND,
+   CAP_CULL_FACE,
+   CAP_DEPTH_TEST,
+   CAP_DITHER,
+   CAP_POLYGON_OFFSET_FILL,
+   CAP_SAMPLE_ALPHA_TO_COVERAGE,
+   CAP_SAMPLE_COVERAGE,
+   CAP_SCISSOR_TEST,
+   CAP_STENCIL_TEST,
+   NUM_CAPS
+};
+
+typedef struct
+{
+   GLuint   program;
+   GLuint   activeTexture;
+   GLuint   texture2D[MAX_TEXTURE_UNITS];
+   GLuint   textureCube[MAX_TEXTURE_UNITS];
+   GLuint   arrayBuffer;
+   GLuint   elementArrayBuffer;
+   GLuint   caps[NUM_CAPS];
+   GLuint   blendSrc, blendDst;
+   GLuint   depthFunc;
+   GLuint   depthMask;
+   GLuint   stencilFunc, stencilRef, stencilValueMask;
+   GLuint   stencilFail, stencilZFail, stencilZPass;
+   GLuint   stencilWriteMask;
+   GLboolean stencilWriteMaskValid;
+   GLint    viewport[4];
+   GLboolean viewportValid;
+   GLuint   vertexAttribArray[MAX_VERTEX_ATTRIBS];
+} ESStateShadow;
+
+///
+// Local variables
+//
+static ESStateShadow       shadow;
+static GLboolean           initialized = GL_FALSE;
+static ESStateCacheStats   stats;
+static unsigned int        frameCalls;
+static unsigned int        frameFiltered;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// CheckInit()
+//
+static void CheckInit ( void )
+{
+   if ( !initialized )
+      esStateInvalidate ( );
+}
+
+///
+// Changed()
+//
+//    Counts the call and returns GL_TRUE if value differs from the shadow,
+//    updating the shadow
+//
+static GLboolean Changed ( GLuint *shadowValue, GLuint value )
+{
+   frameCalls++;
+   if ( *shadowValue == value )
+   {
+      frameFiltered++;
+      return GL_FALSE;
+   }
+   *shadowValue = value;
+   return GL_TRUE;
+}
+
+///
+// CapIndex()
+//
+//    Returns the shadow slot for a glEnable/glDisable capability, -1 if untracked
+//
+static int CapIndex ( GLenum cap )
+{
+   switch ( cap )
+   {
+      case GL_BLEND:                    return CAP_BLEND;
+      case GL_CULL_FACE:                return CAP_CULL_FACE;
+      case GL_DEPTH_TEST:               return CAP_DEPTH_TEST;
+      case GL_DITHER:                   return CAP_DITHER;
+      case GL_POLYGON_OFFSET_FILL:      return CAP_POLYGON_OFFSET_FILL;
+      case GL_SAMPLE_ALPHA_TO_COVERAGE: return CAP_SAMPLE_ALPHA_TO_COVERAGE;
+      case GL_SAMPLE_COVERAGE:          return CAP_SAMPLE_COVERAGE;
+      case GL_SCISSOR_TEST:             return CAP_SCISSOR_TEST;
+      case GL_STENCIL_TEST:             return CAP_STENCIL_TEST;
+   }
+   return -1;
+}
+
+static void SetCap ( GLenum cap, GLuint enable )
+{
+   int index = CapIndex ( cap );
+
+   CheckInit ( );
+   if ( index < 0 )
+   {
+      // Not a capability we track, always pass it through
+      frameCalls++;
+   }
+   else if ( !Changed ( &shadow.caps[index], enable ) )
+   {
+      return;
+   }
+
+   if ( enable )
+      glEnable ( cap );
+   else
+      glDisable ( cap );
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esStateInvalidate()
+//
+void ESUTIL_API esStateInvalidate ( void )
+{
+   memset ( &shadow, 0xFF, sizeof ( shadow ) );
+   shadow.viewportValid = GL_FALSE;
+   shadow.stencilWriteMaskValid = GL_FALSE;
+   initialized = GL_TRUE;
+}
+
+void ESUTIL_API esStateUseProgram ( GLuint program )
+{
+   CheckInit ( );
+   if ( Changed ( &shadow.program, program ) )
+      glUseProgram ( program );
+}
+
+void ESUTIL_API esStateActiveTexture ( GLenum texture )
+{
+   CheckInit ( );
+   if ( Changed ( &shadow.activeTexture, texture ) )
+      glActiveTexture ( texture );
+}
+
+///
+//  esStateBindTexture()
+//
+//    Binds to the active texture unit as set through esStateActiveTexture
+//
+void ESUTIL_API esStateBindTexture ( GLenum target, GLuint texture )
+{
+   GLuint unit;
+
+   CheckInit ( );
+   unit = shadow.activeTexture == UNKNOWN ? MAX_TEXTURE_UNITS : shadow.activeTexture - GL_TEXTURE0;
+
+   if ( unit < MAX_TEXTURE_UNITS && target == GL_TEXTURE_2D )
+   {
+      if ( !Changed ( &shadow.texture2D[unit], texture ) )
+         return;
+   }
+   else if ( unit < MAX_TEXTURE_UNITS && target == GL_TEXTURE_CUBE_MAP )
+   {
+      if ( !Changed ( &shadow.textureCube[unit], texture ) )
+         return;
+   }
+   else
+   {
+      frameCalls++;
+   }
+
+   glBindTexture ( target, texture );
+}
+
+void ESUTIL_API esStateBindBuffer ( GLenum target, GLuint buffer )
+{
+   GLuint *shadowValue = target == GL_ARRAY_BUFFER ? &shadow.arrayBuffer : &shadow.elementArrayBuffer;
+
+   CheckInit ( );
+   if ( Changed ( shadowValue, buffer ) )
+      glBindBuffer ( target, buffer );
+}
+
+void ESUTIL_API esStateEnable ( GLenum cap )
+{
+   SetCap ( cap, 1 );
+}
+
+void ESUTIL_API esStateDisable ( GLenum cap )
+{
+   SetCap ( cap, 0 );
+}
+
+void ESUTIL_API esStateBlendFunc ( GLenum sfactor, GLenum dfactor )
+{
+   CheckInit ( );
+   frameCalls++;
+   if ( shadow.blendSrc == sfactor && shadow.blendDst == dfactor )
+   {
+      frameFiltered++;
+      return;
+   }
+   shadow.blendSrc = sfactor;
+   shadow.blendDst = dfactor;
+   glBlendFunc ( sfactor, dfactor );
+}
+
+void ESUTIL_API esStateDepthFunc ( GLenum func )
+{
+   CheckInit ( );
+   if ( Changed ( &shadow.depthFunc, func ) )
+      glDepthFunc ( func );
+}
+
+void ESUTIL_API esStateDepthMask ( GLboolean flag )
+{
+   CheckInit ( );
+   if ( Changed ( &shadow.depthMask, flag ? 1 : 0 ) )
+      glDepthMask ( flag );
+}
+
+void ESUTIL_API esStateStencilFunc ( GLenum func, GLint ref, GLuint mask )
+{
+   CheckInit ( );
+   frameCalls++;
+   if ( shadow.stencilFunc == func && shadow.stencilRef == (GLuint) ref && shadow.stencilValueMask == mask )
+   {
+      frameFiltered++;
+      return;
+   }
+   shadow.stencilFunc = func;
+   shadow.stencilRef = (GLuint) ref;
+   shadow.stencilValueMask = mask;
+   glStencilFunc ( func, ref, mask );
+}
+
+void ESUTIL_API esStateStencilOp ( GLenum fail, GLenum zfail, GLenum zpass )
+{
+   CheckInit ( );
+   frameCalls++;
+   if ( shadow.stencilFail == fail && shadow.stencilZFail == zfail && shadow.stencilZPass == zpass )
+   {
+      frameFiltered++;
+      return;
+   }
+   shadow.stencilFail = fail;
+   shadow.stencilZFail = zfail;
+   shadow.stencilZPass = zpass;
+   glStencilOp ( fail, zfail, zpass );
+}
+
+void ESUTIL_API esStateStencilMask ( GLuint mask )
+{
+   CheckInit ( );
+   // All ones is a legal mask, so UNKNOWN cannot mark it invalid
+   frameCalls++;
+   if ( shadow.stencilWriteMaskValid && shadow.stencilWriteMask == mask )
+   {
+      frameFiltered++;
+      return;
+   }
+   shadow.stencilWriteMask = mask;
+   shadow.stencilWriteMaskValid = GL_TRUE;
+   glStencilMask ( mask );
+}
+
+void ESUTIL_API esStateViewport ( GLint x, GLint y, GLsizei width, GLsizei height )
+{
+   CheckInit ( );
+   frameCalls++;
+   if ( shadow.viewportValid && shadow.viewport[0] == x && shadow.viewport[1] == y &&
+        shadow.viewport[2] == width && shadow.viewport[3] == height )
+   {
+      frameFiltered++;
+      return;
+   }
+   shadow.viewport[0] = x;
+   shadow.viewport[1] = y;
+   shadow.viewport[2] = width;
+   shadow.viewport[3] = height;
+   shadow.viewportValid = GL_TRUE;
+   glViewport ( x, y, width, height );
+}
+
+void ESUTIL_API esStateEnableVertexAttribArray ( GLuint index )
+{
+   CheckInit ( );
+   if ( index >= MAX_VERTEX_ATTRIBS )
+      frameCalls++;
+   else if ( !Changed ( &shadow.vertexAttribArray[index], 1 ) )
+      return;
+   glEnableVertexAttribArray ( index );
+}
+
+void ESUTIL_API esStateDisableVertexAttribArray ( GLuint index )
+{
+   CheckInit ( );
+   if ( index >= MAX_VERTEX_ATTRIBS )
+      frameCalls++;
+   else if ( !Changed ( &shadow.vertexAttribArray[index], 0 ) )
+      return;
+   glDisableVertexAttribArray ( index );
+}
+
+///
+//  esStateCacheEndFrame()
+//
+void ESUTIL_API esStateCacheEndFrame ( void )
+{
+   stats.frameCalls = frameCalls;
+   stats.frameFiltered = frameFiltered;
+   stats.totalCalls += frameCalls;
+   stats.totalFiltered += frameFiltered;
+   stats.frames++;
+   frameCalls = 0;
+   frameFiltered = 0;
+}
+
+///
+//  esGetStateCacheStats()
+//
+void ESUTIL_API esGetStateCacheStats ( ESStateCacheStats *cacheStats )
+{
+   *cacheStats = stats;
+}
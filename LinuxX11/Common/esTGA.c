@@ -0,0 +1,730 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESTGA.c
+//
+//    TGA image loading.  Uncompressed and run-length encoded true-color
+//    (24 and 32-bit), grayscale and color-mapped images are decoded into
+//    RGB(A) or luminance with the top row first, the same layout the Windows
+//    WinTGALoad produces.  Files are memory mapped and every pixel is
+//    converted once on its way to the output, by SSSE3 (picked at runtime)
+//    or NEON kernels that swap the blue and red channels 16 pixels at a time.
+//    esMapTGA skips the output buffer altogether for uncompressed images.
+//
+
+///
+//  Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "esUtil.h"
+#include "esUtil_internal.h"
+#include <GLES2/gl2ext.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#define ES_TGA_SSSE3
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define ES_TGA_NEON
+#endif
+
+///
+// Defines
+//
+
+// Image types of the TGA header, the RLE variants add 8
+#define TGA_COLOR_MAPPED      1
+#define TGA_TRUE_COLOR        2
+#define TGA_GRAYSCALE         3
+#define TGA_RLE               8
+
+// Image descriptor bit set when the first row in the file is the top one
+#define TGA_TOP_ORIGIN        0x20
+
+#define TGA_HEADER_SIZE       18
+
+///
+// Types
+//
+
+// Header fields of a TGA file in memory
+typedef struct
+{
+   int                  type;
+   GLboolean            rle;
+   int                  width;
+   int                  height;
+   int                  srcBytes;
+   GLboolean            topOrigin;
+
+   // Color map entries, only converted for color-mapped images
+   const unsigned char *colorMap;
+   int                  mapFirst;
+   int                  mapLength;
+   int                  mapEntryBytes;
+
+   // Pixel data up to the end of the file
+   unsigned char       *data;
+   const unsigned char *end;
+} TGAFile;
+
+// Converts count pixels from the file to the output format
+typedef void (*ConvertFunc) ( unsigned char *dst, const unsigned char *src, int count, const unsigned char *palette );
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// Scalar kernels
+//
+static void CopyPixels ( unsigned char *dst, const unsigned char *src, int count, const unsigned char *palette )
+{
+   (void) palette;
+   memcpy ( dst, src, count );
+}
+
+static void GrayToRGB ( unsigned char *dst, const unsigned char *src, int count, const unsigned char *palette )
+{
+   int i;
+
+   (void) palette;
+   for ( i = 0; i < count; i++, dst += 3 )
+      dst[0] = dst[1] = dst[2] = src[i];
+}
+
+static void BGRToRGB ( unsigned char *dst, const unsigned char *src, int count, const unsigned char *palette )
+{
+   int i;
+
+   (void) palette;
+   for ( i = 0; i < count; i++, dst += 3, src += 3 )
+   {
+      unsigned char b = src[0];
+      dst[1] = src[1];
+      dst[0] = src[2];
+      dst[2] = b;
+   }
+}
+
+static void BGRAToRGBA ( unsigned char *dst, const unsigned char *src, int count, const unsigned char *palette )
+{
+   int i;
+
+   (void) palette;
+   for ( i = 0; i < count; i++, dst += 4, src += 4 )
+   {
+      unsigned char b = src[0];
+      dst[1] = src[1];
+      dst[3] = src[3];
+      dst[0] = src[2];
+      dst[2] = b;
+   }
+}
+
+static void BGRAToRGB ( unsigned char *dst, const unsigned char *src, int count, const unsigned char *palette )
+{
+   int i;
+
+   (void) palette;
+   for ( i = 0; i < count; i++, dst += 3, src += 4 )
+   {
+      dst[0] = src[2];
+      dst[1] = src[1];
+      dst[2] = src[0];
+   }
+}
+
+// The palette is converted to the output format beforehand, 3 or 4 bytes per entry
+static void LookupRGB ( unsigned char *dst, const unsigned char *src, int count, const unsigned char *palette )
+{
+   int i;
+
+   for ( i = 0; i < count; i++, dst += 3 )
+   {
+      const unsigned char *entry = palette + src[i] * 3;
+      dst[0] = entry[0];
+      dst[1] = entry[1];
+      dst[2] = entry[2];
+   }
+}
+
+static void LookupRGBA ( unsigned char *dst, const unsigned char *src, int count, const unsigned char *palette )
+{
+   int i;
+
+   for ( i = 0; i < count; i++, dst += 4 )
+      memcpy ( dst, palette + src[i] * 4, 4 );    // a single load and store
+}
+
+#ifdef ES_TGA_SSSE3
+// BGR to RGB shuffles, 16 pixels span three registers and pixels 5 and 10 straddle two
+// of them.  Entry 3 * i + j moves the bytes of source register j into output register i.
+static const signed char bgrShuffle[9][16] =
+{
+   { 2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, -128 },
+   { -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 1 },
+   { -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128 },
+   { -128, 15, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128 },
+   { 0, -128, 4, 3, 2, 7, 6, 5, 10, 9, 8, 13, 12, 11, -128, 15 },
+   { -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 0, -128 },
+   { -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128 },
+   { 14, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128 },
+   { -128, 3, 2, 1, 6, 5, 4, 9, 8, 7, 12, 11, 10, 15, 14, 13 }
+};
+
+///
+// SSSE3 kernels, 16 pixels per iteration
+//
+__attribute__((target("ssse3")))
+static void BGRToRGB_SSSE3 ( unsigned char *dst, const unsigned char *src, int count, const unsigned char *palette )
+{
+   const __m128i *shuffle = (const __m128i *) bgrShuffle;
+
+   for ( ; count >= 16; count -= 16, dst += 48, src += 48 )
+   {
+      __m128i a = _mm_loadu_si128 ( (const __m128i *) src );
+      __m128i b = _mm_loadu_si128 ( (const __m128i *) ( src + 16 ) );
+      __m128i c = _mm_loadu_si128 ( (const __m128i *) ( src + 32 ) );
+
+      _mm_storeu_si128 ( (__m128i *) dst, _mm_or_si128 ( _mm_shuffle_epi8 ( a, _mm_loadu_si128 ( shuffle ) ),
+                                                         _mm_shuffle_epi8 ( b, _mm_loadu_si128 ( shuffle + 1 ) ) ) );
+      _mm_storeu_si128 ( (__m128i *) ( dst + 16 ), _mm_or_si128 ( _mm_or_si128 ( _mm_shuffle_epi8 ( a, _mm_loadu_si128 ( shuffle + 3 ) ),
+                                                                                 _mm_shuffle_epi8 ( b, _mm_loadu_si128 ( shuffle + 4 ) ) ),
+                                                                  _mm_shuffle_epi8 ( c, _mm_loadu_si128 ( shuffle + 5 ) ) ) );
+      _mm_storeu_si128 ( (__m128i *) ( dst + 32 ), _mm_or_si128 ( _mm_shuffle_epi8 ( b, _mm_loadu_si128 ( shuffle + 7 ) ),
+                                                                  _mm_shuffle_epi8 ( c, _mm_loadu_si128 ( shuffle + 8 ) ) ) );
+   }
+
+   BGRToRGB ( dst, src, count, palette );
+}
+
+__attribute__((target("ssse3")))
+static void BGRAToRGBA_SSSE3 ( unsigned char *dst, const unsigned char *src, int count, const unsigned char *palette )
+{
+   __m128i mask;
+
+   if ( count < 16 )
+   {
+      BGRAToRGBA ( dst, src, count, palette );
+      return;
+   }
+
+   mask = _mm_setr_epi8 ( 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15 );
+   for ( ; count >= 16; count -= 16, dst += 64, src += 64 )
+   {
+      __m128i a = _mm_loadu_si128 ( (const __m128i *) src );
+      __m128i b = _mm_loadu_si128 ( (const __m128i *) ( src + 16 ) );
+      __m128i c = _mm_loadu_si128 ( (const __m128i *) ( src + 32 ) );
+      __m128i d = _mm_loadu_si128 ( (const __m128i *) ( src + 48 ) );
+
+      _mm_storeu_si128 ( (__m128i *) dst, _mm_shuffle_epi8 ( a, mask ) );
+      _mm_storeu_si128 ( (__m128i *) ( dst + 16 ), _mm_shuffle_epi8 ( b, mask ) );
+      _mm_storeu_si128 ( (__m128i *) ( dst + 32 ), _mm_shuffle_epi8 ( c, mask ) );
+      _mm_storeu_si128 ( (__m128i *) ( dst + 48 ), _mm_shuffle_epi8 ( d, mask ) );
+   }
+
+   BGRAToRGBA ( dst, src, count, palette );
+}
+
+__attribute__((target("ssse3")))
+static void BGRAToRGB_SSSE3 ( unsigned char *dst, const unsigned char *src, int count, const unsigned char *palette )
+{
+   // Each register packs 4 pixels into its low 12 bytes, then the four are stitched into three
+   __m128i mask;
+
+   if ( count < 16 )
+   {
+      BGRAToRGB ( dst, src, count, palette );
+      return;
+   }
+
+   mask = _mm_setr_epi8 ( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -128, -128, -128, -128 );
+   for ( ; count >= 16; count -= 16, dst += 48, src += 64 )
+   {
+      __m128i a = _mm_shuffle_epi8 ( _mm_loadu_si128 ( (const __m128i *) src ), mask );
+      __m128i b = _mm_shuffle_epi8 ( _mm_loadu_si128 ( (const __m128i *) ( src + 16 ) ), mask );
+      __m128i c = _mm_shuffle_epi8 ( _mm_loadu_si128 ( (const __m128i *) ( src + 32 ) ), mask );
+      __m128i d = _mm_shuffle_epi8 ( _mm_loadu_si128 ( (const __m128i *) ( src + 48 ) ), mask );
+
+      _mm_storeu_si128 ( (__m128i *) dst, _mm_or_si128 ( a, _mm_slli_si128 ( b, 12 ) ) );
+      _mm_storeu_si128 ( (__m128i *) ( dst + 16 ), _mm_or_si128 ( _mm_srli_si128 ( b, 4 ), _mm_slli_si128 ( c, 8 ) ) );
+      _mm_storeu_si128 ( (__m128i *) ( dst + 32 ), _mm_or_si128 ( _mm_srli_si128 ( c, 8 ), _mm_slli_si128 ( d, 4 ) ) );
+   }
+
+   BGRAToRGB ( dst, src, count, palette );
+}
+#endif
+
+#ifdef ES_TGA_NEON
+///
+// NEON kernels, 16 pixels per iteration
+//
+static void BGRToRGB_NEON ( unsigned char *dst, const unsigned char *src, int count, const unsigned char *palette )
+{
+   for ( ; count >= 16; count -= 16, dst += 48, src += 48 )
+   {
+      uint8x16x3_t bgr = vld3q_u8 ( src );
+      uint8x16x3_t rgb = { { bgr.val[2], bgr.val[1], bgr.val[0] } };
+      vst3q_u8 ( dst, rgb );
+   }
+
+   BGRToRGB ( dst, src, count, palette );
+}
+
+static void BGRAToRGBA_NEON ( unsigned char *dst, const unsigned char *src, int count, const unsigned char *palette )
+{
+   for ( ; count >= 16; count -= 16, dst += 64, src += 64 )
+   {
+      uint8x16x4_t bgra = vld4q_u8 ( src );
+      uint8x16x4_t rgba = { { bgra.val[2], bgra.val[1], bgra.val[0], bgra.val[3] } };
+      vst4q_u8 ( dst, rgba );
+   }
+
+   BGRAToRGBA ( dst, src, count, palette );
+}
+
+static void BGRAToRGB_NEON ( unsigned char *dst, const unsigned char *src, int count, const unsigned char *palette )
+{
+   for ( ; count >= 16; count -= 16, dst += 48, src += 64 )
+   {
+      uint8x16x4_t bgra = vld4q_u8 ( src );
+      uint8x16x3_t rgb = { { bgra.val[2], bgra.val[1], bgra.val[0] } };
+      vst3q_u8 ( dst, rgb );
+   }
+
+   BGRAToRGB ( dst, src, count, palette );
+}
+#endif
+
+///
+// SelectConvert()
+//
+//    Picks the kernel for srcBytes per file pixel and dstBytes per output
+//    pixel, using SIMD where the CPU has it
+//
+static ConvertFunc SelectConvert ( int srcBytes, int dstBytes, GLboolean mapped )
+{
+#ifdef ES_TGA_SSSE3
+   GLboolean ssse3 = __builtin_cpu_supports ( "ssse3" ) ? GL_TRUE : GL_FALSE;
+#endif
+
+   if ( mapped )
+      return dstBytes == 4 ? LookupRGBA : LookupRGB;
+
+   if ( srcBytes == dstBytes && srcBytes == 1 )
+      return CopyPixels;
+   if ( srcBytes == 1 )
+      return GrayToRGB;
+
+#if defined(ES_TGA_SSSE3)
+   if ( ssse3 )
+      return srcBytes == 3 ? BGRToRGB_SSSE3 : dstBytes == 4 ? BGRAToRGBA_SSSE3 : BGRAToRGB_SSSE3;
+#elif defined(ES_TGA_NEON)
+   return srcBytes == 3 ? BGRToRGB_NEON : dstBytes == 4 ? BGRAToRGBA_NEON : BGRAToRGB_NEON;
+#endif
+
+   return srcBytes == 3 ? BGRToRGB : dstBytes == 4 ? BGRAToRGBA : BGRAToRGB;
+}
+
+///
+// DecodeRLE()
+//
+//    Decodes run-length encoded pixels from src into the rows of pixels,
+//    starting at row and moving by rowStep.  Packets may run across row ends.
+//
+static GLboolean DecodeRLE ( unsigned char *pixels, int w, int h, int row, int rowStep,
+                             const unsigned char *src, const unsigned char *end, int srcBytes, int dstBytes,
+                             ConvertFunc convert, const unsigned char *palette )
+{
+   size_t rowBytes = (size_t) w * dstBytes;
+   int x = 0;
+
+   while ( row >= 0 && row < h )
+   {
+      unsigned char *dst;
+      int count, n;
+      GLboolean run;
+
+      if ( src >= end )
+         return GL_FALSE;
+      run = ( *src & 0x80 ) != 0;
+      count = ( *src++ & 0x7f ) + 1;
+      if ( src + ( run ? 1 : count ) * srcBytes > end )
+         return GL_FALSE;
+
+      while ( count > 0 && row >= 0 && row < h )
+      {
+         n = count < w - x ? count : w - x;
+         dst = pixels + row * rowBytes + x * dstBytes;
+
+         if ( run )
+         {
+            int filled = dstBytes, total = n * dstBytes;
+
+            // Convert one pixel and repeat it, doubling up the copies for long runs
+            convert ( dst, src, 1, palette );
+            if ( dstBytes == 1 )
+               memset ( dst + 1, dst[0], total - 1 );
+            else if ( n <= 32 )
+            {
+               unsigned char r = dst[0], g = dst[1], b = dst[2], a = dst[dstBytes - 1];
+
+               for ( ; filled < total; filled += dstBytes )
+               {
+                  dst[filled] = r;
+                  dst[filled + 1] = g;
+                  dst[filled + 2] = b;
+                  dst[filled + dstBytes - 1] = a;
+               }
+            }
+            else
+            {
+               while ( filled < total )
+               {
+                  int copy = filled < total - filled ? filled : total - filled;
+                  memcpy ( dst + filled, dst, copy );
+                  filled += copy;
+               }
+            }
+         }
+         else
+         {
+            convert ( dst, src, n, palette );
+            src += n * srcBytes;
+         }
+
+         count -= n;
+         x += n;
+         if ( x == w )
+         {
+            x = 0;
+            row += rowStep;
+         }
+      }
+
+      if ( run )
+         src += srcBytes;
+   }
+
+   return GL_TRUE;
+}
+
+///
+// ParseTGA()
+//
+//    Reads the header of a TGA file in memory and checks that the color map
+//    and, for uncompressed images, the pixels are all there
+//
+static GLboolean ParseTGA ( unsigned char *file, size_t size, TGAFile *tga )
+{
+   const unsigned char *header = file;
+
+   if ( size < TGA_HEADER_SIZE )
+      return GL_FALSE;
+
+   tga->type = header[2] & ~TGA_RLE;
+   tga->rle = ( header[2] & TGA_RLE ) ? GL_TRUE : GL_FALSE;
+   tga->width = header[12] | ( header[13] << 8 );
+   tga->height = header[14] | ( header[15] << 8 );
+   tga->srcBytes = header[16] / 8;
+   tga->topOrigin = ( header[17] & TGA_TOP_ORIGIN ) ? GL_TRUE : GL_FALSE;
+   tga->mapFirst = header[3] | ( header[4] << 8 );
+   tga->mapLength = header[1] == 1 ? header[5] | ( header[6] << 8 ) : 0;
+   tga->mapEntryBytes = ( header[7] + 7 ) / 8;
+   tga->colorMap = file + TGA_HEADER_SIZE + header[0];
+   tga->data = (unsigned char *) tga->colorMap + tga->mapLength * tga->mapEntryBytes;
+   tga->end = file + size;
+
+   // A color map may also be present in true-color images, it is skipped
+   if ( tga->width == 0 || tga->height == 0 || tga->type == 0 || ( header[2] & ~( TGA_RLE | 3 ) ) != 0 ||
+        ( tga->type == TGA_TRUE_COLOR && header[16] != 24 && header[16] != 32 ) ||
+        ( tga->type != TGA_TRUE_COLOR && header[16] != 8 ) ||
+        ( tga->type == TGA_COLOR_MAPPED && ( header[1] != 1 || ( header[7] != 24 && header[7] != 32 ) ) ) ||
+        tga->data > tga->end ||
+        ( !tga->rle && (size_t) ( tga->end - tga->data ) < (size_t) tga->width * tga->height * tga->srcBytes ) )
+   {
+      return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
+///
+// DecodeTGA()
+//
+//    Converts the image to dstBytes per pixel, top row first
+//
+static GLboolean DecodeTGA ( const TGAFile *tga, int dstBytes, unsigned char *pixels )
+{
+   unsigned char palette[256 * 4];
+   size_t rowBytes = (size_t) tga->width * dstBytes;
+   size_t srcRowBytes = (size_t) tga->width * tga->srcBytes;
+   const unsigned char *src = tga->data;
+   ConvertFunc convert = SelectConvert ( tga->srcBytes, dstBytes, tga->type == TGA_COLOR_MAPPED );
+   int row = tga->topOrigin ? 0 : tga->height - 1;
+   int rowStep = tga->topOrigin ? 1 : -1;
+
+   if ( tga->type == TGA_COLOR_MAPPED )
+   {
+      int length = tga->mapFirst + tga->mapLength > 256 ? 256 - tga->mapFirst : tga->mapLength;
+
+      memset ( palette, 0, sizeof ( palette ) );
+      if ( length > 0 )
+         SelectConvert ( tga->mapEntryBytes, dstBytes, GL_FALSE ) ( palette + tga->mapFirst * dstBytes, tga->colorMap, length, NULL );
+   }
+
+   if ( tga->rle )
+      return DecodeRLE ( pixels, tga->width, tga->height, row, rowStep, src, tga->end,
+                         tga->srcBytes, dstBytes, convert, palette );
+
+   // Rows are written top first whatever order the file stores them in
+   for ( ; row >= 0 && row < tga->height; row += rowStep, src += srcRowBytes )
+      convert ( pixels + row * rowBytes, src, tga->width, palette );
+   return GL_TRUE;
+}
+
+///
+// NativeBytes()
+//
+//    Bytes per pixel of the format the image is stored in
+//
+static int NativeBytes ( const TGAFile *tga )
+{
+   return tga->type == TGA_COLOR_MAPPED ? tga->mapEntryBytes : tga->srcBytes;
+}
+
+///
+// LoadTGA()
+//
+//    Loads a TGA file into a new buffer.  The output has dstBytes per pixel
+//    when non-zero, otherwise the format of the file, returned in *format.
+//
+static unsigned char *LoadTGA ( const char *fileName, int dstBytes, int *width, int *height, GLenum *format )
+{
+   unsigned char *file, *pixels = NULL;
+   size_t size;
+   TGAFile tga;
+
+   file = MapFile ( fileName, &size );
+   if ( file == NULL )
+      return NULL;
+
+   if ( ParseTGA ( file, size, &tga ) )
+   {
+      if ( dstBytes == 0 )
+         dstBytes = NativeBytes ( &tga );
+
+      pixels = malloc ( (size_t) tga.width * tga.height * dstBytes );
+      if ( pixels != NULL && !DecodeTGA ( &tga, dstBytes, pixels ) )
+      {
+         free ( pixels );
+         pixels = NULL;
+      }
+
+      *width = tga.width;
+      *height = tga.height;
+      *format = dstBytes == 1 ? GL_LUMINANCE : dstBytes == 3 ? GL_RGB : GL_RGBA;
+   }
+
+   munmap ( file, size );
+   return pixels;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  MapFile()
+//
+//      Maps a file copy-on-write, so pixels can be converted in place without
+//      touching the file, and tells the kernel it will be read front to back
+//
+unsigned char *MapFile ( const char *fileName, size_t *size )
+{
+   struct stat st;
+   void *data = MAP_FAILED;
+   int fd = open ( fileName, O_RDONLY );
+
+   if ( fd < 0 )
+      return NULL;
+
+   if ( fstat ( fd, &st ) == 0 && st.st_size > 0 )
+   {
+      *size = (size_t) st.st_size;
+      data = mmap ( NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+   }
+   close ( fd );
+
+   if ( data == MAP_FAILED )
+      return NULL;
+
+   madvise ( data, *size, MADV_SEQUENTIAL );
+   return data;
+}
+
+///
+// esLoadTGA()
+//
+//    Loads a TGA image from a file as RGB, top row first.  Alpha is dropped
+//    and grayscale is expanded, so the result can always be uploaded as GL_RGB.
+//
+char* ESUTIL_API esLoadTGA ( char *fileName, int *width, int *height )
+{
+   GLenum format;
+   ES_TRACE_ZONE("esLoadTGA");
+
+   return (char *) LoadTGA ( fileName, 3, width, height, &format );
+}
+
+///
+// esLoadTGAEx()
+//
+//    Loads a TGA image from a file in the format it is stored in, top row first
+//
+char* ESUTIL_API esLoadTGAEx ( const char *fileName, int *width, int *height, GLenum *format )
+{
+   ES_TRACE_ZONE("esLoadTGAEx");
+
+   return (char *) LoadTGA ( fileName, 0, width, height, format );
+}
+
+///
+// esMapTGA()
+//
+//    Maps a TGA image for uploading.  Uncompressed images are used where they
+//    lie in the mapping, converted in place if their rows are stored bottom
+//    first or their channels need swapping; only the pages that change are
+//    copied.  Compressed and color-mapped images are decoded into a buffer.
+//
+GLboolean ESUTIL_API esMapTGA ( const char *fileName, ESImage *image )
+{
+   unsigned char *file;
+   size_t size;
+   TGAFile tga;
+   ES_TRACE_ZONE("esMapTGA");
+
+   memset ( image, 0, sizeof ( ESImage ) );
+
+   file = MapFile ( fileName, &size );
+   if ( file == NULL )
+      return GL_FALSE;
+
+   if ( !ParseTGA ( file, size, &tga ) )
+   {
+      munmap ( file, size );
+      return GL_FALSE;
+   }
+
+   image->width = tga.width;
+   image->height = tga.height;
+
+   if ( !tga.rle && tga.type != TGA_COLOR_MAPPED )
+   {
+      const char *extensions = eglGetCurrentContext ( ) != EGL_NO_CONTEXT ? (const char *) glGetString ( GL_EXTENSIONS ) : NULL;
+      size_t rowBytes = (size_t) tga.width * tga.srcBytes;
+      ConvertFunc convert = NULL;
+
+      // BGRA can be uploaded as it is where the driver takes it, BGR never
+      if ( tga.srcBytes == 1 )
+         image->format = GL_LUMINANCE;
+      else if ( tga.srcBytes == 4 && extensions != NULL && strstr ( extensions, "GL_EXT_texture_format_BGRA8888" ) != NULL )
+         image->format = GL_BGRA_EXT;
+      else
+      {
+         image->format = tga.srcBytes == 3 ? GL_RGB : GL_RGBA;
+         convert = SelectConvert ( tga.srcBytes, tga.srcBytes, GL_FALSE );
+      }
+
+#ifdef MADV_POPULATE_WRITE
+      // Take the copy-on-write copies of all pages in one go rather than a fault per page
+      if ( convert != NULL || !tga.topOrigin )
+         madvise ( file, size, MADV_POPULATE_WRITE );
+#endif
+
+      if ( !tga.topOrigin )
+      {
+         unsigned char *top = tga.data;
+         unsigned char *bottom = tga.data + ( tga.height - 1 ) * rowBytes;
+         unsigned char *row = malloc ( rowBytes );
+
+         if ( row == NULL )
+         {
+            munmap ( file, size );
+            return GL_FALSE;
+         }
+
+         for ( ; top < bottom; top += rowBytes, bottom -= rowBytes )
+         {
+            memcpy ( row, top, rowBytes );
+            if ( convert != NULL )
+            {
+               convert ( top, bottom, tga.width, NULL );
+               convert ( bottom, row, tga.width, NULL );
+            }
+            else
+            {
+               memcpy ( top, bottom, rowBytes );
+               memcpy ( bottom, row, rowBytes );
+            }
+         }
+         if ( top == bottom && convert != NULL )
+            convert ( top, top, tga.width, NULL );
+         free ( row );
+      }
+      else if ( convert != NULL )
+      {
+         convert ( tga.data, tga.data, tga.width * tga.height, NULL );
+      }
+
+      image->pixels = tga.data;
+      image->mapped = GL_TRUE;
+      image->base = file;
+      image->size = size;
+      return GL_TRUE;
+   }
+
+   image->format = NativeBytes ( &tga ) == 1 ? GL_LUMINANCE : NativeBytes ( &tga ) == 3 ? GL_RGB : GL_RGBA;
+   image->base = malloc ( (size_t) tga.width * tga.height * NativeBytes ( &tga ) );
+   if ( image->base == NULL || !DecodeTGA ( &tga, NativeBytes ( &tga ), image->base ) )
+   {
+      free ( image->base );
+      image->base = NULL;
+   }
+   munmap ( file, size );
+
+   image->pixels = image->base;
+   return image->base != NULL ? GL_TRUE : GL_FALSE;
+}
+
+///
+// esFreeImage()
+//
+//    Unmaps or frees the pixels of an image returned by esMapTGA
+//
+void ESUTIL_API esFreeImage ( ESImage *image )
+{
+   if ( image->mapped )
+      munmap ( image->base, image->size );
+   else
+      free ( image->base );
+
+   memset ( image, 0, sizeof ( ESImage ) );
+}
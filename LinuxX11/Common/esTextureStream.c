@@ -0,0 +1,730 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESTextureStream.c
+//
+//    Streams textures in without stalling the render thread.  A pool of
+//    worker threads reads and decodes the files (TGA through esMapTGA, KTX
+//    through ParseKTX, with ETC1 decompressed there when GL cannot sample
+//    it or NativeETC1 finds a software rasterizer).  esMainLoop then calls TextureStreamUpdate at the start of every
+//    frame, which uploads the decoded pixels in horizontal slices with
+//    glTexSubImage2D, no more bytes per frame than the budget allows.  Until
+//    the last slice of a texture is in, the application draws with a shared
+//    1x1 placeholder, and the callback hands over the real texture.
+//
+//    The storage of a level cannot be specified piecewise in ES 2.0, and
+//    glTexImage2D ( NULL ) costs about as much as uploading the whole level
+//    since the driver clears it, so a level is allocated in a frame of its
+//    own and counted against the budget like its pixels.  Allocating on a
+//    shared context does not help, Mesa holds the texture lock while it
+//    clears the storage and the draws of the render thread wait for it.  The
+//    file mappings are released by the workers as well, an munmap of a large
+//    image takes long enough to show up in the frame time.
+//
+
+///
+//  Includes
+//
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "esUtil.h"
+#include "esUtil_internal.h"
+#include <GLES2/gl2ext.h>
+
+///
+// Defines
+//
+#define STREAM_DEFAULT_WORKERS      2
+#define STREAM_DEFAULT_BUDGET       ( 1024 * 1024 )
+
+// Upper bound on the upload time per frame, in case the driver copies much
+// slower than the byte budget assumes
+#define STREAM_TIME_LIMIT           0.0015
+
+// Niceness of the workers, so decoding gives way to the render thread when
+// they share a core.  SCHED_IDLE would starve them in a loop without vsync.
+#define STREAM_WORKER_NICE          10
+
+///
+// Types
+//
+typedef struct
+{
+   const unsigned char *data;
+   GLsizei        width;
+   GLsizei        height;
+
+   // Compressed size, or the distance between rows
+   GLsizei        size;
+   GLsizei        pitch;
+} ESStreamLevel;
+
+typedef struct _esstreamjob
+{
+   char             *fileName;
+   ESLoaderCallback  callback;
+   void             *userData;
+
+   // Set by the worker
+   GLboolean         ok;
+   GLboolean         compressed;
+   GLenum            format;
+   GLenum            type;
+   GLint             alignment;
+   GLuint            numLevels;
+   ESStreamLevel     levels[KTX_MAX_LEVELS];
+
+   // Memory the levels point into, released by a worker once uploaded
+   ESImage           image;
+   unsigned char    *file;
+   size_t            fileSize;
+   unsigned char    *decoded;
+   GLboolean         release;
+
+   // Upload progress on the render thread, levels with storage and the next row
+   GLuint            texture;
+   GLuint            allocated;
+   GLuint            level;
+   GLsizei           row;
+   unsigned int      frames;
+
+   struct _esstreamjob *next;
+} ESStreamJob;
+
+typedef struct _estexturestream
+{
+   ESContext        *esContext;
+   GLuint            placeholder;
+   GLboolean         nativeETC1;
+   GLsizei           budget;
+
+   pthread_t        *workers;
+   int               numWorkers;
+   pthread_mutex_t   lock;
+   pthread_cond_t    cond;
+   int               quit;
+
+   // Files to decode and uploaded jobs to release, then decoded jobs to upload, oldest first
+   ESStreamJob      *todo, **todoTail;
+   ESStreamJob      *ready, **readyTail;
+   unsigned int      pending;
+
+   // Reported when the stream stops, bytes of pixels
+   unsigned int      textures;
+   double            bytes;
+   double            maxUploadTime;
+} ESTextureStream;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// FreeJob()
+//
+static void FreeJob ( ESStreamJob *job )
+{
+   esFreeImage ( &job->image );
+   if ( job->file != NULL )
+      munmap ( job->file, job->fileSize );
+   free ( job->decoded );
+   free ( job->fileName );
+   free ( job );
+}
+
+///
+// DecodeTGA()
+//
+static GLboolean DecodeTGA ( ESStreamJob *job )
+{
+   ESImage *image = &job->image;
+   int bytesPerPixel;
+
+   // No context is current here, so 32-bit images are swizzled to RGBA
+   if ( !esMapTGA ( job->fileName, image ) )
+      return GL_FALSE;
+
+   bytesPerPixel = image->format == GL_LUMINANCE ? 1 : image->format == GL_RGB ? 3 : 4;
+   job->format = image->format;
+   job->type = GL_UNSIGNED_BYTE;
+   job->alignment = 1;
+   job->numLevels = 1;
+   job->levels[0].data = image->pixels;
+   job->levels[0].width = image->width;
+   job->levels[0].height = image->height;
+   job->levels[0].pitch = image->width * bytesPerPixel;
+   return GL_TRUE;
+}
+
+///
+// DecodeKTX()
+//
+//    Locates the levels of a 2D KTX texture in its mapping, decompressing
+//    ETC1 levels to RGB when the implementation cannot sample them
+//
+static GLboolean DecodeKTX ( ESTextureStream *stream, ESStreamJob *job )
+{
+   KTXImage ktx;
+   const char *error;
+   size_t decodedSize = 0;
+   GLuint level;
+
+   job->file = MapFile ( job->fileName, &job->fileSize );
+   if ( job->file == NULL )
+   {
+      esLog ( ES_LOG_ERROR, "esStreamTexture: unable to open %s\n", job->fileName );
+      return GL_FALSE;
+   }
+
+   if ( !ParseKTX ( job->file, job->fileSize, &ktx, &error ) )
+   {
+      esLog ( ES_LOG_ERROR, "esStreamTexture: %s %s\n", job->fileName, error );
+      return GL_FALSE;
+   }
+   if ( ktx.faces != 1 )
+   {
+      esLog ( ES_LOG_ERROR, "esStreamTexture: %s is a cube map, load it with esLoadKTX\n", job->fileName );
+      return GL_FALSE;
+   }
+
+   job->numLevels = ktx.levels;
+   job->compressed = ktx.type == 0;
+   job->format = ktx.type != 0 ? ktx.format : ktx.internalFormat;
+   job->type = ktx.type;
+   job->alignment = 4;
+
+   if ( ktx.internalFormat == GL_ETC1_RGB8_OES && !stream->nativeETC1 )
+   {
+      for ( level = 0; level < ktx.levels; level++ )
+      {
+         GLsizei width = ktx.width >> level ? ktx.width >> level : 1;
+         GLsizei height = ktx.height >> level ? ktx.height >> level : 1;
+
+         decodedSize += (size_t) width * height * 3;
+      }
+
+      job->decoded = malloc ( decodedSize );
+      if ( job->decoded == NULL )
+         return GL_FALSE;
+
+      job->compressed = GL_FALSE;
+      job->format = GL_RGB;
+      job->type = GL_UNSIGNED_BYTE;
+      job->alignment = 1;
+      decodedSize = 0;
+   }
+
+   for ( level = 0; level < ktx.levels; level++ )
+   {
+      ESStreamLevel *dst = &job->levels[level];
+      int bytesPerPixel;
+
+      dst->width = ktx.width >> level ? ktx.width >> level : 1;
+      dst->height = ktx.height >> level ? ktx.height >> level : 1;
+      dst->data = ktx.images[level][0];
+      dst->size = (GLsizei) ktx.imageSize[level];
+
+      if ( job->decoded != NULL )
+      {
+         dst->data = job->decoded + decodedSize;
+         esDecodeETC1 ( ktx.images[level][0], dst->width, dst->height, job->decoded + decodedSize );
+         dst->pitch = dst->width * 3;
+         decodedSize += (size_t) dst->pitch * dst->height;
+      }
+      else if ( !job->compressed )
+      {
+         // KTX pads the rows of uncompressed images to 4 bytes
+         bytesPerPixel = ktx.format == GL_LUMINANCE || ktx.format == GL_ALPHA ? 1 :
+                         ktx.format == GL_LUMINANCE_ALPHA ? 2 : ktx.format == GL_RGB ? 3 : 4;
+         if ( ktx.type != GL_UNSIGNED_BYTE )
+            bytesPerPixel = 2;
+         dst->pitch = ( dst->width * bytesPerPixel + 3 ) & ~3;
+         if ( (size_t) dst->pitch * dst->height > ktx.imageSize[level] )
+            return GL_FALSE;
+      }
+   }
+
+   return GL_TRUE;
+}
+
+///
+// DecodeJob()
+//
+static void DecodeJob ( ESTextureStream *stream, ESStreamJob *job )
+{
+   const char *ext = strrchr ( job->fileName, '.' );
+
+   ES_TRACE_ZONE("esStreamDecode");
+
+   if ( ext != NULL && strcasecmp ( ext, ".ktx" ) == 0 )
+   {
+      job->ok = DecodeKTX ( stream, job );
+   }
+   else
+   {
+      job->ok = DecodeTGA ( job );
+      if ( !job->ok )
+         esLog ( ES_LOG_ERROR, "esStreamTexture: error loading (%s) image.\n", job->fileName );
+   }
+}
+
+///
+// SetParameters()
+//
+//    Filtering and wrapping of the bound texture.  Only a full chain is
+//    mipmapped, ES 2.0 cannot limit sampling to the levels a file stores.
+//
+static void SetParameters ( const ESStreamJob *job )
+{
+   GLuint fullLevels;
+
+   for ( fullLevels = 1; ( job->levels[0].width | job->levels[0].height ) >> fullLevels; fullLevels++ );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                     job->numLevels == fullLevels && job->numLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+}
+
+///
+// WorkerMain()
+//
+//    Worker thread.  Decodes the queued files and hands them to the render
+//    thread, and releases the memory of the jobs it has finished uploading.
+//
+static void *WorkerMain ( void *arg )
+{
+   ESTextureStream *stream = arg;
+
+   ES_TRACE_THREAD_NAME("stream");
+
+   // Linux keeps a niceness per thread
+   setpriority ( PRIO_PROCESS, (id_t) syscall ( SYS_gettid ), STREAM_WORKER_NICE );
+
+   pthread_mutex_lock ( &stream->lock );
+   for ( ;; )
+   {
+      ESStreamJob *job;
+
+      while ( stream->todo == NULL && !stream->quit )
+         pthread_cond_wait ( &stream->cond, &stream->lock );
+      if ( stream->quit )
+         break;
+
+      job = stream->todo;
+      stream->todo = job->next;
+      if ( stream->todo == NULL )
+         stream->todoTail = &stream->todo;
+      pthread_mutex_unlock ( &stream->lock );
+
+      if ( job->release )
+      {
+         FreeJob ( job );
+      }
+      else
+      {
+         DecodeJob ( stream, job );
+
+         pthread_mutex_lock ( &stream->lock );
+         job->next = NULL;
+         *stream->readyTail = job;
+         stream->readyTail = &job->next;
+         pthread_mutex_unlock ( &stream->lock );
+
+         // Wake up the main loop in on-demand mode
+         esRequestRedraw ( stream->esContext );
+      }
+
+      pthread_mutex_lock ( &stream->lock );
+   }
+   pthread_mutex_unlock ( &stream->lock );
+   return NULL;
+}
+
+///
+// PushTodo()
+//
+static void PushTodo ( ESTextureStream *stream, ESStreamJob *job )
+{
+   job->next = NULL;
+   pthread_mutex_lock ( &stream->lock );
+   *stream->todoTail = job;
+   stream->todoTail = &job->next;
+   pthread_cond_signal ( &stream->cond );
+   pthread_mutex_unlock ( &stream->lock );
+}
+
+///
+// GetStream()
+//
+//    Returns the texture stream of a context, starting the workers on first use
+//
+static ESTextureStream *GetStream ( ESContext *esContext )
+{
+   ESTextureStream *stream = esContext->textureStream;
+   unsigned char gray[4] = { 128, 128, 128, 255 };
+   const char *env;
+   int i;
+
+   if ( stream != NULL && stream->workers != NULL )
+      return stream;
+
+   if ( stream == NULL )
+   {
+      if ( !esTextureStreamConfig ( esContext, 0, 0 ) )
+         return NULL;
+      stream = esContext->textureStream;
+   }
+
+   env = getenv ( "ES_STREAM_BUDGET" );
+   if ( env != NULL && atoi ( env ) > 0 )
+      stream->budget = atoi ( env ) * 1024;
+
+   stream->workers = calloc ( stream->numWorkers, sizeof ( pthread_t ) );
+   if ( stream->workers == NULL )
+      return NULL;
+
+   stream->nativeETC1 = NativeETC1 ( );
+
+   for ( i = 0; i < stream->numWorkers; i++ )
+   {
+      if ( pthread_create ( &stream->workers[i], NULL, WorkerMain, stream ) != 0 )
+         break;
+   }
+   stream->numWorkers = i;
+   if ( i == 0 )
+   {
+      free ( stream->workers );
+      stream->workers = NULL;
+      return NULL;
+   }
+
+   glGenTextures ( 1, &stream->placeholder );
+   esStateBindTexture ( GL_TEXTURE_2D, stream->placeholder );
+   glTexImage2D ( GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, gray );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+   glTexParameteri ( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+
+   esLog ( ES_LOG_INFO, "esTextureStream: %d workers, %d KB per frame\n", stream->numWorkers, stream->budget / 1024 );
+   return stream;
+}
+
+///
+// UploadSlices()
+//
+//    Uploads as much of a job as the budget left this frame allows.
+//    Compressed levels and the storage of uncompressed ones go in whole, but
+//    only as the first upload of a frame if they exceed what is left.
+//    Returns GL_TRUE once every level is in.
+//
+static GLboolean UploadSlices ( ESTextureStream *stream, ESStreamJob *job, GLsizei *used, double start )
+{
+   if ( job->texture == 0 )
+   {
+      glGenTextures ( 1, &job->texture );
+      esStateBindTexture ( GL_TEXTURE_2D, job->texture );
+      SetParameters ( job );
+   }
+   esStateBindTexture ( GL_TEXTURE_2D, job->texture );
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, job->alignment );
+
+   while ( job->level < job->numLevels )
+   {
+      const ESStreamLevel *level = &job->levels[job->level];
+      GLsizei rows;
+
+      if ( *used >= stream->budget || esGetTime ( ) - start > STREAM_TIME_LIMIT )
+         return GL_FALSE;
+
+      if ( job->compressed )
+      {
+         if ( *used > 0 && *used + level->size > stream->budget )
+            return GL_FALSE;
+
+         glCompressedTexImage2D ( GL_TEXTURE_2D, job->level, job->format, level->width, level->height, 0,
+                                  level->size, level->data );
+         *used += level->size;
+         job->level++;
+         continue;
+      }
+
+      if ( job->allocated == job->level )
+      {
+         if ( *used > 0 && *used + level->pitch * level->height > stream->budget )
+            return GL_FALSE;
+
+         glTexImage2D ( GL_TEXTURE_2D, job->level, job->format, level->width, level->height, 0,
+                        job->format, job->type, NULL );
+         *used += level->pitch * level->height;
+         job->allocated++;
+         continue;
+      }
+
+      rows = ( stream->budget - *used ) / level->pitch;
+      if ( rows < 1 )
+         rows = 1;
+      if ( rows > level->height - job->row )
+         rows = level->height - job->row;
+
+      glTexSubImage2D ( GL_TEXTURE_2D, job->level, 0, job->row, level->width, rows, job->format, job->type,
+                        level->data + (size_t) job->row * level->pitch );
+      *used += rows * level->pitch;
+      job->row += rows;
+
+      if ( job->row == level->height )
+      {
+         job->level++;
+         job->row = 0;
+      }
+   }
+
+   return GL_TRUE;
+}
+
+///
+// Complete()
+//
+//    Hands a job's texture to the application and its memory back to the workers
+//
+static void Complete ( ESTextureStream *stream, ESStreamJob *job )
+{
+   GLuint texture = job->ok ? job->texture : 0;
+   GLuint i;
+
+   pthread_mutex_lock ( &stream->lock );
+   stream->ready = job->next;
+   if ( stream->ready == NULL )
+      stream->readyTail = &stream->ready;
+   stream->pending--;
+   pthread_mutex_unlock ( &stream->lock );
+
+   if ( job->ok )
+   {
+      for ( i = 0; i < job->numLevels; i++ )
+         stream->bytes += job->compressed ? job->levels[i].size : job->levels[i].pitch * job->levels[i].height;
+      stream->textures++;
+      esLog ( ES_LOG_INFO, "esStreamTexture: %s %dx%d, %u levels, uploaded over %u frames\n", job->fileName,
+              job->levels[0].width, job->levels[0].height, job->numLevels, job->frames );
+   }
+
+   if ( job->callback != NULL )
+      job->callback ( stream->esContext, texture, job->userData );
+
+   job->release = GL_TRUE;
+   PushTodo ( stream, job );
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  TextureStreamUpdate()
+//
+void TextureStreamUpdate ( ESContext *esContext )
+{
+   ESTextureStream *stream = esContext->textureStream;
+   GLsizei used = 0;
+   GLint unpackAlignment;
+   double start, elapsed;
+   GLboolean uploaded = GL_FALSE;
+
+   if ( stream == NULL || stream->ready == NULL )
+      return;
+
+   ES_TRACE_ZONE("textureStream");
+
+   start = esGetTime ( );
+   glGetIntegerv ( GL_UNPACK_ALIGNMENT, &unpackAlignment );
+
+   // Only this thread takes jobs off the ready list, so the head stays put while unlocked
+   for ( ;; )
+   {
+      ESStreamJob *job;
+
+      pthread_mutex_lock ( &stream->lock );
+      job = stream->ready;
+      pthread_mutex_unlock ( &stream->lock );
+
+      if ( job == NULL )
+         break;
+
+      if ( job->ok )
+      {
+         GLsizei before = used;
+         GLboolean done = UploadSlices ( stream, job, &used, start );
+
+         if ( used > before )
+         {
+            job->frames++;
+            uploaded = GL_TRUE;
+         }
+         if ( !done )
+            break;
+      }
+
+      Complete ( stream, job );
+   }
+
+   glPixelStorei ( GL_UNPACK_ALIGNMENT, unpackAlignment );
+
+   if ( uploaded )
+   {
+      elapsed = esGetTime ( ) - start;
+      if ( elapsed > stream->maxUploadTime )
+         stream->maxUploadTime = elapsed;
+   }
+
+   // Keep on-demand rendering going until every decoded texture is in
+   if ( stream->ready != NULL )
+      esRequestRedraw ( esContext );
+}
+
+///
+//  TextureStreamStop()
+//
+void TextureStreamStop ( ESContext *esContext )
+{
+   ESTextureStream *stream = esContext->textureStream;
+   int i;
+
+   if ( stream == NULL )
+      return;
+
+   if ( stream->workers != NULL )
+   {
+      pthread_mutex_lock ( &stream->lock );
+      stream->quit = 1;
+      pthread_cond_broadcast ( &stream->cond );
+      pthread_mutex_unlock ( &stream->lock );
+
+      for ( i = 0; i < stream->numWorkers; i++ )
+         pthread_join ( stream->workers[i], NULL );
+      free ( stream->workers );
+
+      esLog ( ES_LOG_INFO, "esTextureStream: %u textures, %.1f MB, longest upload %.2f ms\n",
+              stream->textures, stream->bytes / ( 1024.0 * 1024.0 ), stream->maxUploadTime * 1000.0 );
+   }
+
+   while ( stream->todo != NULL )
+   {
+      ESStreamJob *job = stream->todo;
+
+      stream->todo = job->next;
+      FreeJob ( job );
+   }
+
+   // The application never saw these textures, so nobody else will delete them
+   while ( stream->ready != NULL )
+   {
+      ESStreamJob *job = stream->ready;
+
+      stream->ready = job->next;
+      if ( job->texture != 0 )
+         glDeleteTextures ( 1, &job->texture );
+      FreeJob ( job );
+   }
+
+   if ( stream->placeholder != 0 )
+      glDeleteTextures ( 1, &stream->placeholder );
+   esStateInvalidate ( );
+
+   pthread_mutex_destroy ( &stream->lock );
+   pthread_cond_destroy ( &stream->cond );
+   free ( stream );
+   esContext->textureStream = NULL;
+}
+
+///
+//  esTextureStreamConfig()
+//
+GLboolean ESUTIL_API esTextureStreamConfig ( ESContext *esContext, int numWorkers, GLsizei bytesPerFrame )
+{
+   ESTextureStream *stream = esContext->textureStream;
+
+   if ( stream == NULL )
+   {
+      stream = calloc ( 1, sizeof ( ESTextureStream ) );
+      if ( stream == NULL )
+         return GL_FALSE;
+
+      stream->esContext = esContext;
+      stream->numWorkers = STREAM_DEFAULT_WORKERS;
+      stream->budget = STREAM_DEFAULT_BUDGET;
+      stream->todoTail = &stream->todo;
+      stream->readyTail = &stream->ready;
+      pthread_mutex_init ( &stream->lock, NULL );
+      pthread_cond_init ( &stream->cond, NULL );
+      esContext->textureStream = stream;
+   }
+
+   // The pool size is fixed once the workers run
+   if ( numWorkers > 0 && stream->workers == NULL )
+      stream->numWorkers = numWorkers;
+   if ( bytesPerFrame > 0 )
+      stream->budget = bytesPerFrame;
+   return GL_TRUE;
+}
+
+///
+//  esStreamTexture()
+//
+GLuint ESUTIL_API esStreamTexture ( ESContext *esContext, const char *fileName,
+                                    ESLoaderCallback callback, void *userData )
+{
+   ESTextureStream *stream = GetStream ( esContext );
+   ESStreamJob *job;
+
+   if ( stream == NULL )
+      return 0;
+
+   job = calloc ( 1, sizeof ( ESStreamJob ) );
+   if ( job == NULL || ( job->fileName = strdup ( fileName ) ) == NULL )
+   {
+      free ( job );
+      return 0;
+   }
+   job->callback = callback;
+   job->userData = userData;
+
+   pthread_mutex_lock ( &stream->lock );
+   stream->pending++;
+   pthread_mutex_unlock ( &stream->lock );
+
+   PushTodo ( stream, job );
+   return stream->placeholder;
+}
+
+///
+//  esTextureStreamPending()
+//
+unsigned int ESUTIL_API esTextureStreamPending ( ESContext *esContext )
+{
+   ESTextureStream *stream = esContext->textureStream;
+   unsigned int pending;
+
+   if ( stream == NULL )
+      return 0;
+
+   pthread_mutex_lock ( &stream->lock );
+   pending = stream->pending;
+   pthread_mutex_unlock ( &stream->lock );
+   return pending;
+}
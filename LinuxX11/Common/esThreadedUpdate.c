@@ -0,0 +1,327 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESThreadedUpdate.c
+//
+//    Runs the update callback on a worker thread so that simulation overlaps
+//    with rendering.  The worker writes each frame's state into a snapshot
+//    and publishes it through a lock-free triple buffer; the render thread
+//    always draws the newest complete snapshot.
+//
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include "esUtil_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+
+///
+// Defines
+//
+
+// Set in the shared index when the snapshot it names has not been read yet
+#define SNAPSHOT_FRESH  4
+
+// Snapshots are padded to this so the writer and reader never share a cache line
+#define SNAPSHOT_ALIGN  64
+
+///
+// Types
+//
+typedef struct _esupdatethread
+{
+   void (ESCALLBACK *updateFunc) ( ESContext *, float, void * );
+   size_t         snapshotSize;
+   size_t         snapshotStride;
+   unsigned char *snapshots;
+
+   // Triple buffer: the writer owns back, the reader owns front, and middle
+   // is exchanged atomically between them
+   int            back;
+   int            front;
+   atomic_int     middle;
+
+   // Time each snapshot was started at, written with the snapshot
+   double         snapshotTime[3];
+
+   // Fixed timestep and step cap, copied from the context when the thread starts
+   float          step;
+   int            maxSteps;
+
+   pthread_t      thread;
+   sem_t          frameSem;
+
+   // Set while a wake-up is posted and the worker has not taken it, so that
+   // frames drawn during a long update do not queue extra updates
+   atomic_int     wakePending;
+   atomic_int     running;
+   GLboolean      started;
+
+   // Duration of the last update in milliseconds, stored as float bits
+   atomic_uint    lastUpdateTime;
+} ESUpdateThread;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// Publish()
+//
+//    Hand the back buffer to the reader and take over the buffer it was done with
+//
+static void Publish ( ESUpdateThread *ut )
+{
+   int previous = atomic_exchange_explicit ( &ut->middle, ut->back | SNAPSHOT_FRESH,
+                                             memory_order_acq_rel );
+   ut->back = previous & ~SNAPSHOT_FRESH;
+}
+
+///
+// RunUpdate()
+//
+//    Call the update function on the back buffer and publish the result
+//
+static void RunUpdate ( ESContext *esContext, ESUpdateThread *ut, float deltaTime )
+{
+   double start = esGetTime ( );
+   float  ms;
+   unsigned int bits;
+   ES_TRACE_ZONE("update");
+
+   ut->snapshotTime[ut->back] = start;
+   ut->updateFunc ( esContext, deltaTime, ut->snapshots + ut->back * ut->snapshotStride );
+   Publish ( ut );
+
+   ms = (float) ( ( esGetTime ( ) - start ) * 1000.0 );
+   memcpy ( &bits, &ms, sizeof ( bits ) );
+   atomic_store_explicit ( &ut->lastUpdateTime, bits, memory_order_relaxed );
+}
+
+///
+// UpdateThreadMain()
+//
+//    Without a fixed timestep the worker produces one snapshot per rendered
+//    frame, starting as soon as the renderer has taken the previous one, and
+//    at most one per wake-up when several frames were drawn during an update.  With
+//    a fixed timestep it ticks on its own clock, independent of the frame rate,
+//    and drops the time it falls behind by beyond maxSteps steps instead of
+//    running every missed step back to back.
+//
+static void *UpdateThreadMain ( void *arg )
+{
+   ESContext *esContext = arg;
+   ESUpdateThread *ut = esContext->updateThread;
+   double last = esGetTime ( );
+   struct timespec next;
+
+   ES_TRACE_THREAD_NAME("update");
+   clock_gettime ( CLOCK_MONOTONIC, &next );
+
+   while ( atomic_load_explicit ( &ut->running, memory_order_acquire ) )
+   {
+      double now;
+
+      if ( ut->step > 0.0f )
+      {
+         long stepNs = (long) ( ut->step * 1e9f );
+         struct timespec current;
+
+         next.tv_nsec += stepNs;
+         while ( next.tv_nsec >= 1000000000L )
+         {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+         }
+
+         clock_gettime ( CLOCK_MONOTONIC, &current );
+         if ( ( current.tv_sec - next.tv_sec ) * 1000000000LL + ( current.tv_nsec - next.tv_nsec ) >
+              (long long) ut->maxSteps * stepNs )
+            next = current;
+         clock_nanosleep ( CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL );
+
+         RunUpdate ( esContext, ut, ut->step );
+         continue;
+      }
+
+      sem_wait ( &ut->frameSem );
+      atomic_store_explicit ( &ut->wakePending, 0, memory_order_release );
+      if ( !atomic_load_explicit ( &ut->running, memory_order_acquire ) )
+         break;
+
+      now = esGetTime ( );
+      RunUpdate ( esContext, ut, (float) ( now - last ) );
+      last = now;
+   }
+
+   return NULL;
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  UpdateThreadStart()
+//
+GLboolean UpdateThreadStart ( ESContext *esContext )
+{
+   ESUpdateThread *ut = esContext->updateThread;
+
+   if ( ut == NULL || ut->started )
+      return GL_TRUE;
+
+   // The thread never reads the context's step, esSetFixedTimestep applies from the next esMainLoop
+   ut->step = esContext->fixedTimestep;
+   ut->maxSteps = esContext->maxStepsPerFrame > 0 ? esContext->maxStepsPerFrame : 1;
+
+   // Produce the first snapshot synchronously so there is always one to draw
+   RunUpdate ( esContext, ut, 0.0f );
+
+   atomic_store ( &ut->running, 1 );
+   if ( pthread_create ( &ut->thread, NULL, UpdateThreadMain, esContext ) != 0 )
+   {
+      esLog ( ES_LOG_ERROR, "UpdateThreadStart: unable to create update thread\n" );
+      atomic_store ( &ut->running, 0 );
+      return GL_FALSE;
+   }
+
+   ut->started = GL_TRUE;
+   return GL_TRUE;
+}
+
+///
+//  UpdateThreadBeginFrame()
+//
+void UpdateThreadBeginFrame ( ESContext *esContext )
+{
+   ESUpdateThread *ut = esContext->updateThread;
+
+   if ( atomic_load_explicit ( &ut->middle, memory_order_relaxed ) & SNAPSHOT_FRESH )
+   {
+      int previous = atomic_exchange_explicit ( &ut->middle, ut->front, memory_order_acq_rel );
+      ut->front = previous & ~SNAPSHOT_FRESH;
+   }
+
+   // Let the worker compute the next frame while this one is drawn, or with a fixed
+   // timestep report how far the clock has moved past the snapshot
+   if ( ut->step <= 0.0f )
+   {
+      if ( !atomic_exchange_explicit ( &ut->wakePending, 1, memory_order_acq_rel ) )
+         sem_post ( &ut->frameSem );
+   }
+   else
+   {
+      float alpha = (float) ( ( esGetTime ( ) - ut->snapshotTime[ut->front] ) / ut->step );
+
+      esContext->interpolationAlpha = alpha < 0.0f ? 0.0f : alpha > 1.0f ? 1.0f : alpha;
+   }
+}
+
+///
+//  UpdateThreadLastUpdateTime()
+//
+float UpdateThreadLastUpdateTime ( ESContext *esContext )
+{
+   unsigned int bits = atomic_load_explicit ( &esContext->updateThread->lastUpdateTime,
+                                              memory_order_relaxed );
+   float ms;
+
+   memcpy ( &ms, &bits, sizeof ( ms ) );
+   return ms;
+}
+
+///
+//  UpdateThreadStop()
+//
+void UpdateThreadStop ( ESContext *esContext )
+{
+   ESUpdateThread *ut = esContext->updateThread;
+
+   if ( ut == NULL || !ut->started )
+      return;
+
+   atomic_store ( &ut->running, 0 );
+   sem_post ( &ut->frameSem );
+   pthread_join ( ut->thread, NULL );
+   ut->started = GL_FALSE;
+}
+
+///
+//  esRegisterThreadedUpdateFunc()
+//
+GLboolean ESUTIL_API esRegisterThreadedUpdateFunc ( ESContext *esContext, size_t snapshotSize,
+                                                    void (ESCALLBACK *updateFunc) ( ESContext*, float, void* ) )
+{
+   ESUpdateThread *ut = esContext->updateThread;
+
+   if ( ut != NULL )
+   {
+      UpdateThreadStop ( esContext );
+      sem_destroy ( &ut->frameSem );
+      free ( ut->snapshots );
+      free ( ut );
+      esContext->updateThread = NULL;
+   }
+
+   if ( updateFunc == NULL )
+      return GL_TRUE;
+
+   ut = calloc ( 1, sizeof ( ESUpdateThread ) );
+   if ( ut == NULL )
+      return GL_FALSE;
+
+   ut->updateFunc = updateFunc;
+   ut->snapshotSize = snapshotSize;
+   ut->snapshotStride = ( snapshotSize + SNAPSHOT_ALIGN - 1 ) & ~(size_t) ( SNAPSHOT_ALIGN - 1 );
+   if ( ut->snapshotStride == 0 )
+      ut->snapshotStride = SNAPSHOT_ALIGN;
+
+   if ( posix_memalign ( (void **) &ut->snapshots, SNAPSHOT_ALIGN, 3 * ut->snapshotStride ) != 0 )
+   {
+      free ( ut );
+      return GL_FALSE;
+   }
+   memset ( ut->snapshots, 0, 3 * ut->snapshotStride );
+
+   ut->back = 0;
+   ut->front = 1;
+   atomic_init ( &ut->middle, 2 );
+   atomic_init ( &ut->running, 0 );
+   atomic_init ( &ut->lastUpdateTime, 0 );
+   atomic_init ( &ut->wakePending, 0 );
+   sem_init ( &ut->frameSem, 0, 0 );
+
+   esContext->updateThread = ut;
+   return GL_TRUE;
+}
+
+///
+//  esGetFrameSnapshot()
+//
+const void* ESUTIL_API esGetFrameSnapshot ( ESContext *esContext )
+{
+   ESUpdateThread *ut = esContext->updateThread;
+
+   if ( ut == NULL )
+      return NULL;
+
+   return ut->snapshots + ut->front * ut->snapshotStride;
+}
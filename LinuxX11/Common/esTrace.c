@@ -0,0 +1,273 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ESTrace.c
+//
+//    Scoped CPU trace zones, built only with -DES_TRACE (make TRACE=1).
+//    ES_TRACE_ZONE records the begin time of the enclosing scope and, through
+//    a cleanup attribute, appends a complete event to a ring buffer owned by
+//    the calling thread when the scope exits.  Recording takes no locks; the
+//    rings are only walked when the trace is written out as Chrome
+//    trace_event JSON (chrome://tracing, Perfetto), either on demand with
+//    ES_TRACE_DUMP or at exit into $ES_TRACE_FILE (default trace.json).
+//
+#ifdef ES_TRACE
+
+#define _GNU_SOURCE
+
+///
+//  Includes
+//
+#include "esUtil.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+///
+// Defines
+//
+
+// Number of events each thread keeps, older events are overwritten
+#define ES_TRACE_RING_SIZE    16384
+
+///
+// Types
+//
+typedef struct
+{
+   const char    *name;
+   uint64_t       start;
+   uint64_t       duration;
+} ESTraceEvent;
+
+typedef struct _estracering
+{
+   ESTraceEvent   events[ES_TRACE_RING_SIZE];
+
+   // Number of events ever written, the ring index is written % ES_TRACE_RING_SIZE
+   atomic_uint    written;
+
+   long           tid;
+   const char    *threadName;
+   struct _estracering *next;
+} ESTraceRing;
+
+///
+// Local variables
+//
+static __thread ESTraceRing  *threadRing;
+static ESTraceRing           *rings;
+static pthread_mutex_t        ringsLock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t               traceStart;
+
+//////////////////////////////////////////////////////////////////
+//
+//  Private Functions
+//
+//
+
+///
+// Now()
+//
+//    Monotonic time in nanoseconds.  clock_gettime is a vDSO call on Linux,
+//    only a little more expensive than reading the TSC directly, and does not
+//    need to be calibrated.
+//
+static uint64_t Now ( void )
+{
+   struct timespec ts;
+
+   clock_gettime ( CLOCK_MONOTONIC, &ts );
+   return (uint64_t) ts.tv_sec * 1000000000ull + (uint64_t) ts.tv_nsec;
+}
+
+///
+// DumpAtExit()
+//
+static void DumpAtExit ( void )
+{
+   const char *fileName = getenv ( "ES_TRACE_FILE" );
+
+   esTraceDump ( fileName != NULL ? fileName : "trace.json" );
+}
+
+///
+// TraceInit()
+//
+//    Runs before main so that every zone starts after the trace origin
+//
+__attribute__((constructor)) static void TraceInit ( void )
+{
+   traceStart = Now ( );
+   atexit ( DumpAtExit );
+}
+
+///
+// GetThreadRing()
+//
+//    Returns the calling thread's ring, creating it on first use.  Rings are
+//    never freed so that events of threads that have exited can be written out.
+//
+static ESTraceRing *GetThreadRing ( void )
+{
+   ESTraceRing *ring = threadRing;
+
+   if ( ring != NULL )
+      return ring;
+
+   ring = calloc ( 1, sizeof ( ESTraceRing ) );
+   if ( ring == NULL )
+      return NULL;
+   ring->tid = (long) syscall ( SYS_gettid );
+
+   pthread_mutex_lock ( &ringsLock );
+   ring->next = rings;
+   rings = ring;
+   pthread_mutex_unlock ( &ringsLock );
+
+   threadRing = ring;
+   return ring;
+}
+
+///
+// WriteString()
+//
+//    Writes a JSON string literal
+//
+static void WriteString ( FILE *file, const char *str )
+{
+   fputc ( '"', file );
+   for ( ; *str != '\0'; str++ )
+   {
+      if ( *str == '"' || *str == '\\' )
+         fputc ( '\\', file );
+      if ( (unsigned char) *str >= 0x20 )
+         fputc ( *str, file );
+   }
+   fputc ( '"', file );
+}
+
+//////////////////////////////////////////////////////////////////
+//
+//  Public Functions
+//
+//
+
+///
+//  esTraceZoneBegin()
+//
+ESTraceZone ESUTIL_API esTraceZoneBegin ( const char *name )
+{
+   ESTraceZone zone;
+
+   zone.name = name;
+   zone.start = Now ( );
+   return zone;
+}
+
+///
+//  esTraceZoneEnd()
+//
+void ESUTIL_API esTraceZoneEnd ( ESTraceZone *zone )
+{
+   uint64_t end = Now ( );
+   ESTraceRing *ring = GetThreadRing ( );
+   ESTraceEvent *event;
+   unsigned int written;
+
+   if ( ring == NULL )
+      return;
+
+   // Only this thread writes the counter, the release store publishes the event to esTraceDump
+   written = atomic_load_explicit ( &ring->written, memory_order_relaxed );
+   event = &ring->events[written % ES_TRACE_RING_SIZE];
+   event->name = zone->name;
+   event->start = zone->start;
+   event->duration = end - zone->start;
+   atomic_store_explicit ( &ring->written, written + 1, memory_order_release );
+}
+
+///
+//  esTraceThreadName()
+//
+void ESUTIL_API esTraceThreadName ( const char *name )
+{
+   ESTraceRing *ring = GetThreadRing ( );
+
+   if ( ring != NULL )
+      ring->threadName = name;
+}
+
+///
+//  esTraceDump()
+//
+//    Events other threads record while the dump runs may or may not be
+//    included.  A thread that wraps its ring during the dump can overwrite an
+//    event as it is being written out.
+//
+int ESUTIL_API esTraceDump ( const char *fileName )
+{
+   FILE *file = fopen ( fileName, "w" );
+   ESTraceRing *ring;
+   int pid = (int) getpid ( );
+   int numEvents = 0;
+   const char *separator = "\n";
+
+   if ( file == NULL )
+   {
+      esLog ( ES_LOG_ERROR, "esTraceDump: unable to open %s\n", fileName );
+      return -1;
+   }
+
+   fprintf ( file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" );
+
+   pthread_mutex_lock ( &ringsLock );
+   for ( ring = rings; ring != NULL; ring = ring->next )
+   {
+      unsigned int written = atomic_load_explicit ( &ring->written, memory_order_acquire );
+      unsigned int first = written > ES_TRACE_RING_SIZE ? written - ES_TRACE_RING_SIZE : 0;
+      unsigned int i;
+
+      if ( ring->threadName != NULL )
+      {
+         fprintf ( file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%ld,\"args\":{\"name\":",
+                   separator, pid, ring->tid );
+         WriteString ( file, ring->threadName );
+         fprintf ( file, "}}" );
+         separator = ",\n";
+      }
+
+      for ( i = first; i != written; i++ )
+      {
+         const ESTraceEvent *event = &ring->events[i % ES_TRACE_RING_SIZE];
+
+         fprintf ( file, "%s{\"ph\":\"X\",\"name\":", separator );
+         WriteString ( file, event->name );
+         fprintf ( file, ",\"pid\":%d,\"tid\":%ld,\"ts\":%.3f,\"dur\":%.3f}",
+                   pid, ring->tid, ( event->start - traceStart ) / 1000.0, event->duration / 1000.0 );
+         separator = ",\n";
+         numEvents++;
+      }
+   }
+   pthread_mutex_unlock ( &ringsLock );
+
+   fprintf ( file, "\n]}\n" );
+   fclose ( file );
+
+   esLog ( ES_LOG_INFO, "esTraceDump: wrote %d events to %s\n", numEvents, fileName );
+   return numEvents;
+}
+
+#endif // ES_TRACE
@@ -22,18 +22,34 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
-#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <GLES2/gl2.h>
 #include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2ext.h>
 #include "esUtil.h"
+#include "esUtil_internal.h"
 
 #include  <X11/Xlib.h>
 #include  <X11/Xatom.h>
 #include  <X11/Xutil.h>
 
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
 // X11 related local variables
 static Display *x_display = NULL;
 
+// Headless related local variables
+static GLboolean headless = GL_FALSE;
+static GLuint headlessFramebuffer = 0;
+static GLuint headlessRenderbuffers[3] = { 0, 0, 0 };
+
 ///
 // CreateEGLContext()
 //
@@ -41,9 +57,8 @@ static Display *x_display = NULL;
 //
 EGLBoolean CreateEGLContext ( EGLNativeWindowType hWnd, EGLDisplay* eglDisplay,
                               EGLContext* eglContext, EGLSurface* eglSurface,
-                              EGLint attribList[])
+                              GLuint flags)
 {
-   EGLint numConfigs;
    EGLint majorVersion;
    EGLint minorVersion;
    EGLDisplay display;
@@ -51,6 +66,8 @@ EGLBoolean CreateEGLContext ( EGLNativeWindowType hWnd, EGLDisplay* eglDisplay,
    EGLSurface surface;
    EGLConfig config;
    EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE, EGL_NONE };
+   XWindowAttributes windowAttribs;
+   EGLint visualId = 0;
 
    // Get Display
    display = eglGetDisplay((EGLNativeDisplayType)x_display);
@@ -65,14 +82,12 @@ EGLBoolean CreateEGLContext ( EGLNativeWindowType hWnd, EGLDisplay* eglDisplay,
       return EGL_FALSE;
    }
 
-   // Get configs
-   if ( !eglGetConfigs(display, NULL, 0, &numConfigs) )
+   // Choose config, it has to match the visual WinCreate created the window with
+   if ( XGetWindowAttributes(x_display, (Window)hWnd, &windowAttribs) )
    {
-      return EGL_FALSE;
+      visualId = (EGLint)XVisualIDFromVisual(windowAttribs.visual);
    }
-
-   // Choose config
-   if ( !eglChooseConfig(display, attribList, &config, 1, &numConfigs) )
+   if ( !ChooseEGLConfig(display, EGL_WINDOW_BIT, visualId, flags, &config) )
    {
       return EGL_FALSE;
    }
@@ -104,6 +119,172 @@ EGLBoolean CreateEGLContext ( EGLNativeWindowType hWnd, EGLDisplay* eglDisplay,
 } 
 
 
+///
+// GetHeadlessDisplay()
+//
+//    Returns a display that does not need a window system.  Mesa's surfaceless
+//    platform is preferred, otherwise the default display is used which works
+//    with drivers that do not depend on X for offscreen rendering.
+//
+static EGLDisplay GetHeadlessDisplay ( void )
+{
+   const char *extensions = eglQueryString ( EGL_NO_DISPLAY, EGL_EXTENSIONS );
+
+   if ( extensions != NULL && strstr ( extensions, "EGL_MESA_platform_surfaceless" ) != NULL )
+   {
+      PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+         (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress ( "eglGetPlatformDisplayEXT" );
+
+      if ( getPlatformDisplay != NULL )
+      {
+         EGLDisplay display = getPlatformDisplay ( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL );
+         if ( display != EGL_NO_DISPLAY )
+            return display;
+      }
+   }
+
+   return eglGetDisplay ( EGL_DEFAULT_DISPLAY );
+}
+
+///
+// CreateHeadlessFramebuffer()
+//
+//    Creates the framebuffer object that stands in for the window surface when
+//    the context is made current without any surface.
+//
+static EGLBoolean CreateHeadlessFramebuffer ( GLint width, GLint height, GLuint flags )
+{
+   const char *extensions = (const char *) glGetString ( GL_EXTENSIONS );
+   GLboolean rgba8 = extensions != NULL && strstr ( extensions, "GL_OES_rgb8_rgba8" ) != NULL;
+   GLboolean packedDepthStencil = extensions != NULL && strstr ( extensions, "GL_OES_packed_depth_stencil" ) != NULL;
+   GLboolean wantDepth = ( flags & ES_WINDOW_DEPTH ) ? GL_TRUE : GL_FALSE;
+   GLboolean wantStencil = ( flags & ES_WINDOW_STENCIL ) ? GL_TRUE : GL_FALSE;
+   GLenum colorFormat = GL_RGB565;
+   GLenum status;
+
+   // Same sizes ChooseEGLConfig would have asked for
+   if ( flags & ES_WINDOW_ALPHA )
+      colorFormat = rgba8 ? GL_RGBA8_OES : GL_RGBA4;
+
+   glGenFramebuffers ( 1, &headlessFramebuffer );
+   glBindFramebuffer ( GL_FRAMEBUFFER, headlessFramebuffer );
+   glGenRenderbuffers ( 3, headlessRenderbuffers );
+
+   glBindRenderbuffer ( GL_RENDERBUFFER, headlessRenderbuffers[0] );
+   glRenderbufferStorage ( GL_RENDERBUFFER, colorFormat, width, height );
+   glFramebufferRenderbuffer ( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, headlessRenderbuffers[0] );
+
+   if ( wantStencil && packedDepthStencil )
+   {
+      glBindRenderbuffer ( GL_RENDERBUFFER, headlessRenderbuffers[1] );
+      glRenderbufferStorage ( GL_RENDERBUFFER, GL_DEPTH24_STENCIL8_OES, width, height );
+      glFramebufferRenderbuffer ( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, headlessRenderbuffers[1] );
+      glFramebufferRenderbuffer ( GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, headlessRenderbuffers[1] );
+   }
+   else
+   {
+      // Without the packed format depth and stencil get a renderbuffer each, which
+      // not every implementation can combine
+      if ( wantDepth )
+      {
+         glBindRenderbuffer ( GL_RENDERBUFFER, headlessRenderbuffers[1] );
+         glRenderbufferStorage ( GL_RENDERBUFFER, GL_DEPTH_COMPONENT16, width, height );
+         glFramebufferRenderbuffer ( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, headlessRenderbuffers[1] );
+      }
+      if ( wantStencil )
+      {
+         glBindRenderbuffer ( GL_RENDERBUFFER, headlessRenderbuffers[2] );
+         glRenderbufferStorage ( GL_RENDERBUFFER, GL_STENCIL_INDEX8, width, height );
+         glFramebufferRenderbuffer ( GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, headlessRenderbuffers[2] );
+      }
+   }
+
+   status = glCheckFramebufferStatus ( GL_FRAMEBUFFER );
+   if ( status != GL_FRAMEBUFFER_COMPLETE )
+   {
+      esLog ( ES_LOG_ERROR, "CreateHeadlessFramebuffer: framebuffer incomplete (0x%04x)%s\n", status,
+              wantDepth && wantStencil && !packedDepthStencil ?
+              ", separate depth and stencil buffers are not supported without GL_OES_packed_depth_stencil" : "" );
+      return EGL_FALSE;
+   }
+   return EGL_TRUE;
+}
+
+///
+// CreateHeadlessEGLContext()
+//
+//    Creates an EGL rendering context that renders offscreen.  A pbuffer of the
+//    window size is used when the display supports one, otherwise the context is
+//    made current without a surface and rendering goes to a framebuffer object.
+//
+EGLBoolean CreateHeadlessEGLContext ( ESContext *esContext, GLuint flags )
+{
+   EGLint surfaceAttribs[] = { EGL_WIDTH, esContext->width, EGL_HEIGHT, esContext->height, EGL_NONE };
+   EGLint contextAttribs[] = { EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE, EGL_NONE };
+   EGLint majorVersion;
+   EGLint minorVersion;
+   EGLDisplay display;
+   EGLContext context;
+   EGLSurface surface = EGL_NO_SURFACE;
+   EGLConfig config;
+
+   display = GetHeadlessDisplay ( );
+   if ( display == EGL_NO_DISPLAY )
+   {
+      return EGL_FALSE;
+   }
+
+   if ( !eglInitialize ( display, &majorVersion, &minorVersion ) )
+   {
+      return EGL_FALSE;
+   }
+
+   // Ask for the same config as a window would get, but pbuffer capable
+   if ( ChooseEGLConfig ( display, EGL_PBUFFER_BIT, 0, flags, &config ) )
+   {
+      surface = eglCreatePbufferSurface ( display, config, surfaceAttribs );
+   }
+
+   if ( surface == EGL_NO_SURFACE )
+   {
+      // No pbuffer support, fall back to a surfaceless context
+      const char *extensions = eglQueryString ( display, EGL_EXTENSIONS );
+
+      if ( extensions == NULL || strstr ( extensions, "EGL_KHR_surfaceless_context" ) == NULL )
+      {
+         return EGL_FALSE;
+      }
+
+      if ( !ChooseEGLConfig ( display, 0, 0, flags, &config ) )
+      {
+         return EGL_FALSE;
+      }
+   }
+
+   eglBindAPI ( EGL_OPENGL_ES_API );
+   context = eglCreateContext ( display, config, EGL_NO_CONTEXT, contextAttribs );
+   if ( context == EGL_NO_CONTEXT )
+   {
+      return EGL_FALSE;
+   }
+
+   if ( !eglMakeCurrent ( display, surface, surface, context ) )
+   {
+      return EGL_FALSE;
+   }
+
+   if ( surface == EGL_NO_SURFACE && !CreateHeadlessFramebuffer ( esContext->width, esContext->height, flags ) )
+   {
+      return EGL_FALSE;
+   }
+
+   esContext->eglDisplay = display;
+   esContext->eglSurface = surface;
+   esContext->eglContext = context;
+   return EGL_TRUE;
+}
+
+
 ///
 //  WinCreate()
 //
@@ -187,6 +368,9 @@ GLboolean userInterrupt(ESContext *esContext)
     GLboolean userinterrupt = GL_FALSE;
     char text;
 
+    if ( headless )
+        return GL_FALSE;
+
     // Pump all messages from X server. Keypresses are directed to keyfunc (if defined)
     while ( XPending ( x_display ) )
     {
@@ -198,7 +382,11 @@ GLboolean userInterrupt(ESContext *esContext)
                 if (esContext->keyFunc != NULL)
                     esContext->keyFunc(esContext, text, 0, 0);
             }
+            // The key handler has likely changed what is on screen
+            esRequestRedraw(esContext);
         }
+        if ( xev.type == Expose )
+            esRequestRedraw(esContext);
         if ( xev.type == DestroyNotify )
             userinterrupt = GL_TRUE;
     }
@@ -206,12 +394,172 @@ GLboolean userInterrupt(ESContext *esContext)
 }
 
 
+///
+//  OpenRedrawFds()
+//
+//      Creates the eventfd and timerfd the on-demand main loop sleeps on, if
+//      they are not open yet.
+//
+static GLboolean OpenRedrawFds(ESContext *esContext)
+{
+    if (esContext->redrawEventFd < 0)
+        esContext->redrawEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (esContext->redrawTimerFd < 0)
+        esContext->redrawTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    return esContext->redrawEventFd >= 0 && esContext->redrawTimerFd >= 0;
+}
+
+
+///
+//  CloseRedrawFds()
+//
+static void CloseRedrawFds(ESContext *esContext)
+{
+    if (esContext->redrawEventFd >= 0)
+        close(esContext->redrawEventFd);
+    if (esContext->redrawTimerFd >= 0)
+        close(esContext->redrawTimerFd);
+    esContext->redrawEventFd = -1;
+    esContext->redrawTimerFd = -1;
+}
+
+
+///
+//  ConsumeRedraw()
+//
+//      Returns GL_TRUE and clears the request if a redraw was requested or the
+//      redraw timer has expired.  Never blocks.
+//
+static GLboolean ConsumeRedraw(ESContext *esContext)
+{
+    uint64_t count;
+    GLboolean redraw = GL_FALSE;
+
+    if (read(esContext->redrawEventFd, &count, sizeof(count)) == sizeof(count))
+        redraw = GL_TRUE;
+    if (read(esContext->redrawTimerFd, &count, sizeof(count)) == sizeof(count))
+        redraw = GL_TRUE;
+    return redraw;
+}
+
+
+///
+//  WaitForEvents()
+//
+//      Sleeps until a redraw is requested, the redraw timer expires or the X
+//      server sends an event.
+//
+static void WaitForEvents(ESContext *esContext)
+{
+    struct pollfd fds[3];
+    int nfds = 0;
+
+    // Xlib may already have read events off the socket, poll() would miss those
+    if (x_display != NULL && XPending(x_display))
+        return;
+
+    fds[nfds].fd = esContext->redrawEventFd;
+    fds[nfds++].events = POLLIN;
+    fds[nfds].fd = esContext->redrawTimerFd;
+    fds[nfds++].events = POLLIN;
+    if (x_display != NULL)
+    {
+        fds[nfds].fd = ConnectionNumber(x_display);
+        fds[nfds++].events = POLLIN;
+    }
+
+    poll(fds, nfds, -1);
+}
+
+
+///
+//  FixedStepUpdate()
+//
+//      Advances the simulation by as many fixed steps as fit in the time elapsed,
+//      capped at maxStepsPerFrame, and computes the interpolation alpha for the
+//      remainder.
+//
+static void FixedStepUpdate(ESContext *esContext, float deltatime)
+{
+    float step = esContext->fixedTimestep;
+    int steps = 0;
+
+    esContext->stepAccumulator += deltatime;
+
+    while (esContext->stepAccumulator >= step)
+    {
+        if (steps == esContext->maxStepsPerFrame)
+        {
+            // Too far behind to catch up, drop the simulation time we can't afford
+            esContext->stepAccumulator = 0.0f;
+            break;
+        }
+
+        if (esContext->updateFunc != NULL)
+            esContext->updateFunc(esContext, step);
+        esContext->stepAccumulator -= step;
+        steps++;
+    }
+
+    esContext->interpolationAlpha = esContext->stepAccumulator / step;
+}
+
+
+#ifdef ES_GL_STATS
+///
+// PrintGLStats()
+//
+//    Print the GL call counts per frame averaged over the last numFrames frames
+//
+static void PrintGLStats(unsigned int numFrames)
+{
+    static ESGLCallCounts last;
+    ESGLStats glStats;
+    ESGLCallCounts *total = &glStats.total;
+
+    esGetGLStats(&glStats);
+    printf("     gl per frame: draws=%.1f vertices=%.0f clears=%.1f state=%.1f binds=%.1f uniforms=%.1f\n",
+           (float)(total->drawCalls - last.drawCalls) / numFrames,
+           (float)(total->vertices - last.vertices) / numFrames,
+           (float)(total->clears - last.clears) / numFrames,
+           (float)(total->stateChanges - last.stateChanges) / numFrames,
+           (float)(total->bindings - last.bindings) / numFrames,
+           (float)(total->uniformUpdates - last.uniformUpdates) / numFrames);
+    printf("     upload KB per frame: buffers=%.1f textures=%.1f client arrays=%.1f (%.1f uploads)\n",
+           (total->bufferBytes - last.bufferBytes) / 1024.0f / numFrames,
+           (total->textureBytes - last.textureBytes) / 1024.0f / numFrames,
+           (total->clientArrayBytes - last.clientArrayBytes) / 1024.0f / numFrames,
+           (float)(total->uploads - last.uploads) / numFrames);
+    last = *total;
+}
+#endif
+
+
 //////////////////////////////////////////////////////////////////
 //
 //  Public Functions
 //
 //
 
+///
+//  HasExtension()
+//
+GLboolean HasExtension ( const char *name )
+{
+   const char *extensions = (const char *) glGetString ( GL_EXTENSIONS );
+   const char *found = extensions;
+   size_t length = strlen ( name );
+
+   // Names are separated by spaces and one can be the start of another
+   while ( found != NULL && ( found = strstr ( found, name ) ) != NULL )
+   {
+      if ( ( found == extensions || found[-1] == ' ' ) && ( found[length] == ' ' || found[length] == '\0' ) )
+         return GL_TRUE;
+      found += length;
+   }
+   return GL_FALSE;
+}
+
 ///
 //  esInitContext()
 //
@@ -223,6 +571,9 @@ void ESUTIL_API esInitContext ( ESContext *esContext )
    if ( esContext != NULL )
    {
       memset( esContext, 0, sizeof( ESContext) );
+      esContext->interpolationAlpha = 1.0f;
+      esContext->redrawEventFd = -1;
+      esContext->redrawTimerFd = -1;
    }
 }
 
@@ -241,18 +592,9 @@ void ESUTIL_API esInitContext ( ESContext *esContext )
 //
 GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char* title, GLint width, GLint height, GLuint flags )
 {
-   EGLint attribList[] =
-   {
-       EGL_RED_SIZE,       5,
-       EGL_GREEN_SIZE,     6,
-       EGL_BLUE_SIZE,      5,
-       EGL_ALPHA_SIZE,     (flags & ES_WINDOW_ALPHA) ? 8 : EGL_DONT_CARE,
-       EGL_DEPTH_SIZE,     (flags & ES_WINDOW_DEPTH) ? 8 : EGL_DONT_CARE,
-       EGL_STENCIL_SIZE,   (flags & ES_WINDOW_STENCIL) ? 8 : EGL_DONT_CARE,
-       EGL_SAMPLE_BUFFERS, (flags & ES_WINDOW_MULTISAMPLE) ? 1 : 0,
-       EGL_NONE
-   };
-   
+   const char *env;
+   ES_TRACE_ZONE("esCreateWindow");
+
    if ( esContext == NULL )
    {
       return GL_FALSE;
@@ -261,6 +603,44 @@ GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char* title, G
    esContext->width = width;
    esContext->height = height;
 
+   env = getenv ( "ES_FRAMES" );
+   if ( env != NULL )
+   {
+      esContext->maxFrames = (unsigned int) strtoul ( env, NULL, 10 );
+   }
+
+   // Benchmark overrides, see README.linux
+   env = getenv ( "ES_RESOLUTION" );
+   if ( env != NULL && sscanf ( env, "%dx%d", &width, &height ) == 2 )
+   {
+      esContext->width = width;
+      esContext->height = height;
+   }
+
+   env = getenv ( "ES_FIXED_DELTA" );
+   if ( env != NULL )
+   {
+      esContext->fixedDeltaTime = (float) atof ( env );
+   }
+
+   env = getenv ( "ES_HEADLESS" );
+   if ( env != NULL && atoi ( env ) != 0 )
+   {
+      flags |= ES_WINDOW_HEADLESS;
+   }
+
+   if ( flags & ES_WINDOW_HEADLESS )
+   {
+      headless = GL_TRUE;
+      if ( !CreateHeadlessEGLContext ( esContext, flags ) )
+      {
+         return GL_FALSE;
+      }
+
+      DescribeFramebuffer ( esContext );
+      return GL_TRUE;
+   }
+
    if ( !WinCreate ( esContext, title) )
    {
       return GL_FALSE;
@@ -271,11 +651,12 @@ GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char* title, G
                             &esContext->eglDisplay,
                             &esContext->eglContext,
                             &esContext->eglSurface,
-                            attribList) )
+                            flags) )
    {
       return GL_FALSE;
    }
-   
+
+   DescribeFramebuffer ( esContext );
 
    return GL_TRUE;
 }
@@ -289,132 +670,327 @@ GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char* title, G
 
 void ESUTIL_API esMainLoop ( ESContext *esContext )
 {
-    struct timeval t1, t2;
-    struct timezone tz;
+    double t1, t2, frameStart, updateEnd, drawEnd, swapEnd;
     float deltatime;
     float totaltime = 0.0f;
     unsigned int frames = 0;
+    unsigned int frameCount = 0;
+    GLboolean idle = GL_FALSE;
+    ESFrameTime frameTime = { 0 };
+    ESFrameStats stats;
+    ESStateCacheStats cacheStats;
+    unsigned long lastCacheCalls = 0;
+    unsigned long lastCacheFiltered = 0;
+    const char *env;
+    int pass;
+
+    ES_TRACE_THREAD_NAME("render");
+
+    if (!UpdateThreadStart(esContext))
+        return;
+
+    env = getenv("ES_GPU_TIMER");
+    if (env != NULL && atoi(env) != 0)
+        esGpuTimerEnable(esContext);
+
+    env = getenv("ES_DYNAMIC_RESOLUTION");
+    if (env != NULL && atof(env) > 0.0)
+        esEnableDynamicResolution(esContext, (float)atof(env), 0.25f, 1.0f);
+
+    if ((env = getenv("ES_CAPTURE")) != NULL)
+        esCaptureStart(esContext, ES_CAPTURE_TGA, env, 2);
+    else if ((env = getenv("ES_CAPTURE_SHM")) != NULL)
+        esCaptureStart(esContext, ES_CAPTURE_SHM, env, 2);
+
+    // The descriptors are closed when the previous loop returned, and the first frame is always drawn
+    if (esContext->renderMode == ES_RENDER_ON_DEMAND)
+    {
+        if (OpenRedrawFds(esContext))
+            esRequestRedraw(esContext);
+        else
+            esContext->renderMode = ES_RENDER_CONTINUOUS;
+    }
 
-    gettimeofday ( &t1 , &tz );
+    LogQueueBegin();
+    t1 = frameStart = esGetTime();
 
-    while(userInterrupt(esContext) == GL_FALSE)
+    while(userInterrupt(esContext) == GL_FALSE &&
+          (esContext->maxFrames == 0 || frameCount < esContext->maxFrames))
     {
-        gettimeofday(&t2, &tz);
-        deltatime = (float)(t2.tv_sec - t1.tv_sec + (t2.tv_usec - t1.tv_usec) * 1e-6);
-        t1 = t2;
+        if (esContext->renderMode == ES_RENDER_ON_DEMAND && !headless && !esContext->animating)
+        {
+            if (!ConsumeRedraw(esContext))
+            {
+                WaitForEvents(esContext);
+                idle = GL_TRUE;
+                continue;
+            }
 
-        if (esContext->updateFunc != NULL)
-            esContext->updateFunc(esContext, deltatime);
-        if (esContext->drawFunc != NULL)
-            esContext->drawFunc(esContext);
+            // Time spent asleep is neither simulation time nor frame time
+            if (idle)
+            {
+                t1 = frameStart = esGetTime();
+                idle = GL_FALSE;
+            }
+        }
 
-        eglSwapBuffers(esContext->eglDisplay, esContext->eglSurface);
+        ES_TRACE_ZONE("frame");
 
+        t2 = esGetTime();
+        deltatime = (float)(t2 - t1);
         totaltime += deltatime;
+        t1 = t2;
+
+        if (esContext->fixedDeltaTime > 0.0f)
+            deltatime = esContext->fixedDeltaTime;
+
+        LoaderPoll(esContext);
+        TextureStreamUpdate(esContext);
+
+        {
+            ES_TRACE_ZONE("update");
+            if (esContext->updateThread != NULL)
+                UpdateThreadBeginFrame(esContext);
+            else if (esContext->fixedTimestep > 0.0f)
+                FixedStepUpdate(esContext, deltatime);
+            else if (esContext->updateFunc != NULL)
+                esContext->updateFunc(esContext, deltatime);
+        }
+        updateEnd = esGetTime();
+
+        {
+            ES_TRACE_ZONE("draw");
+            esGpuTimerBegin(esContext, "draw");
+            if (esContext->dynamicResolution != NULL)
+                DynamicResolutionBeginDraw(esContext);
+            if (esContext->drawFunc != NULL)
+                esContext->drawFunc(esContext);
+            if (esContext->dynamicResolution != NULL)
+            {
+                esGpuTimerBegin(esContext, "upscale");
+                DynamicResolutionEndDraw(esContext);
+            }
+            esGpuTimerEnd(esContext);
+        }
+        esCaptureFrame(esContext);
+        drawEnd = esGetTime();
+
+        {
+            ES_TRACE_ZONE("swap");
+            // A pbuffer swap is a no-op, so wait for the GPU instead to keep the
+            // frame timings comparable with on-screen rendering
+            if (headless)
+                glFinish();
+            else
+                eglSwapBuffers(esContext->eglDisplay, esContext->eglSurface);
+        }
+        swapEnd = esGetTime();
+        frameCount++;
+
+        if (esContext->updateThread != NULL)
+            frameTime.update = UpdateThreadLastUpdateTime(esContext);
+        else
+            frameTime.update = (float)((updateEnd - t2) * 1000.0);
+        frameTime.draw   = (float)((drawEnd - updateEnd) * 1000.0);
+        frameTime.swap   = (float)((swapEnd - drawEnd) * 1000.0);
+        frameTime.frame  = (float)((swapEnd - frameStart) * 1000.0);
+        frameTime.gpu    = -1.0f;
+        frameStart = swapEnd;
+        esRecordFrameTime(esContext, &frameTime);
+        esGpuTimerEndFrame(esContext, esContext->frameHistory.total - 1);
+        if (esContext->dynamicResolution != NULL)
+            DynamicResolutionEndFrame(esContext);
+        esStateCacheEndFrame();
+#ifdef ES_GL_STATS
+        esGLStatsEndFrame();
+#endif
+
         frames++;
         if (totaltime >  2.0f)
         {
+            esGetFrameStats(esContext, &stats);
             printf("%4d frames rendered in %1.4f seconds -> FPS=%3.4f\n", frames, totaltime, frames/totaltime);
+            printf("     frame ms: p50=%.2f p95=%.2f p99=%.2f max=%.2f stutters=%u/%u\n",
+                   stats.frame.p50, stats.frame.p95, stats.frame.p99, stats.frame.max,
+                   stats.stutters, stats.numFrames);
+            if (stats.numGpuFrames > 0)
+            {
+                printf("     gpu ms: p50=%.2f p95=%.2f", stats.gpu.p50, stats.gpu.p95);
+                for (pass = 0; esGpuTimerPassName(esContext, pass) != NULL; pass++)
+                    printf(" %s=%.2f", esGpuTimerPassName(esContext, pass), stats.gpuPass[pass].p50);
+                printf("\n");
+            }
+            if (esContext->dynamicResolution != NULL)
+            {
+                GLint renderWidth, renderHeight;
+                float scale = esGetRenderScale(esContext, &renderWidth, &renderHeight);
+
+                printf("     render scale: %.2f (%dx%d)\n", scale, renderWidth, renderHeight);
+            }
+            esGetStateCacheStats(&cacheStats);
+            if (cacheStats.totalCalls > lastCacheCalls)
+            {
+                printf("     state calls per frame: %.1f, filtered as redundant: %.1f\n",
+                       (float)(cacheStats.totalCalls - lastCacheCalls) / frames,
+                       (float)(cacheStats.totalFiltered - lastCacheFiltered) / frames);
+            }
+            lastCacheCalls = cacheStats.totalCalls;
+            lastCacheFiltered = cacheStats.totalFiltered;
+#ifdef ES_GL_STATS
+            PrintGLStats(frames);
+#endif
             totaltime -= 2.0f;
             frames = 0;
         }
     }
+    LogQueueEnd();
+
+    UpdateThreadStop(esContext);
+    LoaderStop(esContext);
+    TextureStreamStop(esContext);
+    esCaptureStop(esContext);
+    esDisableDynamicResolution(esContext);
+    CloseRedrawFds(esContext);
+
+    env = getenv("ES_STATS_FILE");
+    if (env != NULL)
+        esWriteFrameStats(esContext, env);
 }
 
 
 ///
-//  esRegisterDrawFunc()
+//  esGetTime()
 //
-void ESUTIL_API esRegisterDrawFunc ( ESContext *esContext, void (ESCALLBACK *drawFunc) (ESContext* ) )
+//    Returns seconds from CLOCK_MONOTONIC, which unlike gettimeofday() never
+//    jumps when the wall clock is adjusted.
+//
+double ESUTIL_API esGetTime ( void )
 {
-   esContext->drawFunc = drawFunc;
+   struct timespec ts;
+
+   clock_gettime ( CLOCK_MONOTONIC, &ts );
+   return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
 }
 
 
 ///
-//  esRegisterUpdateFunc()
+//  esSetFixedTimestep()
 //
-void ESUTIL_API esRegisterUpdateFunc ( ESContext *esContext, void (ESCALLBACK *updateFunc) ( ESContext*, float ) )
+void ESUTIL_API esSetFixedTimestep ( ESContext *esContext, float stepsPerSecond, int maxStepsPerFrame )
 {
-   esContext->updateFunc = updateFunc;
+   if ( stepsPerSecond > 0.0f )
+   {
+      esContext->fixedTimestep = 1.0f / stepsPerSecond;
+      esContext->maxStepsPerFrame = maxStepsPerFrame > 0 ? maxStepsPerFrame : 1;
+   }
+   else
+   {
+      esContext->fixedTimestep = 0.0f;
+      esContext->interpolationAlpha = 1.0f;
+   }
+   esContext->stepAccumulator = 0.0f;
 }
 
 
 ///
-//  esRegisterKeyFunc()
+//  esSetRenderMode()
 //
-void ESUTIL_API esRegisterKeyFunc ( ESContext *esContext,
-                                    void (ESCALLBACK *keyFunc) (ESContext*, unsigned char, int, int ) )
+void ESUTIL_API esSetRenderMode ( ESContext *esContext, int mode )
 {
-   esContext->keyFunc = keyFunc;
+   if ( mode == ES_RENDER_ON_DEMAND && !OpenRedrawFds ( esContext ) )
+   {
+      esLog ( ES_LOG_WARNING, "esSetRenderMode: unable to create wakeup descriptors, rendering continuously\n" );
+      CloseRedrawFds ( esContext );
+      return;
+   }
+   if ( mode != ES_RENDER_ON_DEMAND )
+      CloseRedrawFds ( esContext );
+
+   esContext->renderMode = mode;
+
+   // Make sure the first frame gets drawn
+   esRequestRedraw ( esContext );
 }
 
 
 ///
-// esLogMessage()
+//  esRequestRedraw()
 //
-//    Log an error message to the debug output for the platform
+//    Writing to the eventfd both marks the frame dirty and wakes up the main
+//    loop if it is sleeping in poll(), from any thread.
 //
-void ESUTIL_API esLogMessage ( const char *formatStr, ... )
+void ESUTIL_API esRequestRedraw ( ESContext *esContext )
 {
-    va_list params;
-    char buf[BUFSIZ];
-
-    va_start ( params, formatStr );
-    vsprintf ( buf, formatStr, params );
-    
-    printf ( "%s", buf );
-    
-    va_end ( params );
+   uint64_t one = 1;
+
+   if ( esContext->redrawEventFd >= 0 )
+   {
+      if ( write ( esContext->redrawEventFd, &one, sizeof ( one ) ) != sizeof ( one ) )
+      {
+         // Counter already pending, the loop will wake up anyway
+      }
+   }
 }
 
 
 ///
-// esLoadTGA()
-//
-//    Loads a 24-bit TGA image from a file. This is probably the simplest TGA loader ever.
-//    Does not support loading of compressed TGAs nor TGAa with alpha channel. But for the
-//    sake of the examples, this is sufficient.
+//  esScheduleRedraw()
 //
+void ESUTIL_API esScheduleRedraw ( ESContext *esContext, float seconds )
+{
+   struct itimerspec timeout;
+
+   if ( esContext->redrawTimerFd < 0 )
+      return;
+
+   // A zero it_value would disarm the timer, so round up to one nanosecond
+   memset ( &timeout, 0, sizeof ( timeout ) );
+   timeout.it_value.tv_sec = (time_t) seconds;
+   timeout.it_value.tv_nsec = (long) ( ( seconds - (float) timeout.it_value.tv_sec ) * 1e9f );
+   if ( timeout.it_value.tv_sec == 0 && timeout.it_value.tv_nsec <= 0 )
+      timeout.it_value.tv_nsec = 1;
 
-char* ESUTIL_API esLoadTGA ( char *fileName, int *width, int *height )
+   timerfd_settime ( esContext->redrawTimerFd, 0, &timeout, NULL );
+}
+
+
+///
+//  esSetAnimating()
+//
+void ESUTIL_API esSetAnimating ( ESContext *esContext, GLboolean animating )
 {
-    char *buffer = NULL;
-    FILE *f;
-    unsigned char tgaheader[12];
-    unsigned char attributes[6];
-    unsigned int imagesize;
+   esContext->animating = animating;
 
-    f = fopen(fileName, "rb");
-    if(f == NULL) return NULL;
+   // Draw the final state once the animation stops
+   if ( !animating )
+      esRequestRedraw ( esContext );
+}
 
-    if(fread(&tgaheader, sizeof(tgaheader), 1, f) == 0)
-    {
-        fclose(f);
-        return NULL;
-    }
 
-    if(fread(attributes, sizeof(attributes), 1, f) == 0)
-    {
-        fclose(f);
-        return 0;
-    }
+///
+//  esRegisterDrawFunc()
+//
+void ESUTIL_API esRegisterDrawFunc ( ESContext *esContext, void (ESCALLBACK *drawFunc) (ESContext* ) )
+{
+   esContext->drawFunc = drawFunc;
+}
 
-    *width = attributes[1] * 256 + attributes[0];
-    *height = attributes[3] * 256 + attributes[2];
-    imagesize = attributes[4] / 8 * *width * *height;
-    buffer = malloc(imagesize);
-    if (buffer == NULL)
-    {
-        fclose(f);
-        return 0;
-    }
 
-    if(fread(buffer, 1, imagesize, f) != imagesize)
-    {
-        free(buffer);
-        return NULL;
-    }
-    fclose(f);
-    return buffer;
+///
+//  esRegisterUpdateFunc()
+//
+void ESUTIL_API esRegisterUpdateFunc ( ESContext *esContext, void (ESCALLBACK *updateFunc) ( ESContext*, float ) )
+{
+   esContext->updateFunc = updateFunc;
 }
+
+
+///
+//  esRegisterKeyFunc()
+//
+void ESUTIL_API esRegisterKeyFunc ( ESContext *esContext,
+                                    void (ESCALLBACK *keyFunc) (ESContext*, unsigned char, int, int ) )
+{
+   esContext->keyFunc = keyFunc;
+}
+
@@ -20,6 +20,7 @@
 ///
 //  Includes
 //
+#include <stddef.h>
 #include <GLES2/gl2.h>
 #include <EGL/egl.h>
 
@@ -46,6 +47,32 @@ extern "C" {
 #define ES_WINDOW_STENCIL       4
 /// esCreateWindow flat - multi-sample buffer
 #define ES_WINDOW_MULTISAMPLE   8
+/// esCreateWindow flag - render offscreen without a window system (also selected by ES_HEADLESS=1)
+#define ES_WINDOW_HEADLESS      16
+
+/// esSetRenderMode mode - render frames back to back (default)
+#define ES_RENDER_CONTINUOUS    0
+/// esSetRenderMode mode - sleep until a redraw is requested or the window needs repainting
+#define ES_RENDER_ON_DEMAND     1
+
+/// esCaptureStart mode - write every frame to a numbered TGA file
+#define ES_CAPTURE_TGA          0
+/// esCaptureStart mode - write raw RGBA frames into a POSIX shared memory ring
+#define ES_CAPTURE_SHM          1
+
+/// Value of ESCaptureShmHeader::magic ("ESCF")
+#define ES_CAPTURE_SHM_MAGIC    0x46435345
+
+// esLog severities
+#define ES_LOG_DEBUG            0
+#define ES_LOG_INFO             1
+#define ES_LOG_WARNING          2
+#define ES_LOG_ERROR            3
+
+// esConvertPixels dithering
+#define ES_DITHER_NONE              0
+#define ES_DITHER_ORDERED           1
+#define ES_DITHER_FLOYD_STEINBERG   2
 
 
 ///
@@ -64,15 +91,346 @@ typedef struct
     GLfloat   m[4][4];
 } ESMatrix;
 
+/// Number of frames kept in the frame timing history
+#define ES_FRAME_HISTORY        512
+
+/// Maximum number of GPU timed passes per frame (see esGpuTimerBegin)
+#define ES_MAX_GPU_PASSES       4
+
+/// A frame whose time exceeds this multiple of the median frame time is counted as a stutter
+#define ES_STUTTER_FACTOR       2.0f
+
+typedef struct
+{
+   /// Time spent in the update callback, in milliseconds
+   float       update;
+
+   /// Time spent in the draw callback, in milliseconds
+   float       draw;
+
+   /// Time spent in eglSwapBuffers, in milliseconds
+   float       swap;
+
+   /// Time from the end of the previous frame to the end of this frame, in milliseconds
+   float       frame;
+
+   /// GPU time of the frame in milliseconds, summed over its passes.  Negative if
+   /// GPU timing is off or the result was lost (it arrives a few frames late).
+   float       gpu;
+
+   /// GPU time of each pass in milliseconds, indexed like esGpuTimerPassName
+   float       gpuPass[ES_MAX_GPU_PASSES];
+} ESFrameTime;
+
+typedef struct
+{
+   /// Ring buffer of the most recent frame timings
+   ESFrameTime    frames[ES_FRAME_HISTORY];
+
+   /// Index of the slot the next frame is written to
+   unsigned int   next;
+
+   /// Number of valid entries in frames
+   unsigned int   count;
+
+   /// Number of frames recorded since the history was last reset
+   unsigned int   total;
+} ESFrameHistory;
+
+typedef struct
+{
+   float       avg;
+   float       stddev;
+   float       p50;
+   float       p95;
+   float       p99;
+   float       max;
+} ESTimeStats;
+
+typedef struct
+{
+   /// Number of frames the statistics were computed from
+   unsigned int   numFrames;
+
+   /// Statistics for whole frames and for each phase of a frame, in milliseconds
+   ESTimeStats    frame;
+   ESTimeStats    update;
+   ESTimeStats    draw;
+   ESTimeStats    swap;
+
+   /// GPU time statistics, over the numGpuFrames frames that have GPU timings
+   unsigned int   numGpuFrames;
+   ESTimeStats    gpu;
+   ESTimeStats    gpuPass[ES_MAX_GPU_PASSES];
+
+   /// Number of frames that took longer than ES_STUTTER_FACTOR times the median
+   unsigned int   stutters;
+} ESFrameStats;
+
+typedef struct
+{
+   /// Encoded commands
+   unsigned char *data;
+
+   /// Number of bytes of data in use
+   size_t         size;
+
+   /// Number of bytes allocated for data
+   size_t         capacity;
+
+   /// Number of commands recorded since the last reset
+   unsigned int   numCommands;
+
+   /// Set if a command was dropped because the buffer could not grow
+   GLboolean      overflow;
+} ESCommandBuffer;
+
+typedef struct
+{
+   /// State calls made through the cache during the last completed frame
+   unsigned int   frameCalls;
+
+   /// Calls dropped as redundant during the last completed frame
+   unsigned int   frameFiltered;
+
+   /// Totals since start-up
+   unsigned long  totalCalls;
+   unsigned long  totalFiltered;
+   unsigned int   frames;
+} ESStateCacheStats;
+
+typedef struct
+{
+   /// Color texture, 0 for depth and stencil targets
+   GLuint         texture;
+
+   /// Depth and/or stencil renderbuffer, 0 for color targets
+   GLuint         renderbuffer;
+
+   GLsizei        width;
+   GLsizei        height;
+
+   /// Format the target was requested with
+   GLenum         format;
+
+   /// Estimated GPU memory used by the target
+   size_t         bytes;
+} ESRenderTarget;
+
+typedef struct _esrendertargetpool ESRenderTargetPool;
+
+typedef struct
+{
+   /// Targets currently allocated by the pool and the memory they use
+   unsigned int   numTargets;
+   size_t         bytes;
+
+   /// Highest value bytes has reached
+   size_t         peakBytes;
+
+   /// Acquires and new allocations during the last completed frame
+   unsigned int   frameAcquires;
+   unsigned int   frameAllocations;
+
+   /// Memory of all targets acquired during the last completed frame, i.e. what giving
+   /// every pass its own targets would use
+   size_t         frameAcquiredBytes;
+
+   /// Totals since the pool was created
+   unsigned long  totalAcquires;
+   unsigned long  totalAllocations;
+   unsigned int   frames;
+} ESRenderTargetPoolStats;
+
+typedef struct _esatlas ESAtlas;
+
+typedef struct
+{
+   /// Page texture holding the image and the index of the page
+   GLuint         texture;
+   int            page;
+
+   /// Texels of the image in the page, without the gutter
+   GLint          x;
+   GLint          y;
+   GLsizei        width;
+   GLsizei        height;
+
+   /// Texture coordinates of the first and last corners of the image, i.e. where (0, 0) and
+   /// (1, 1) of a texture of its own land in the page
+   GLfloat        u0;
+   GLfloat        v0;
+   GLfloat        u1;
+   GLfloat        v1;
+} ESAtlasRegion;
+
+typedef struct
+{
+   int            numPages;
+   int            numRegions;
+
+   /// Texels of all pages, of the cells placed in them (images, gutters and alignment) and
+   /// of the images alone
+   unsigned long  pageTexels;
+   unsigned long  usedTexels;
+   unsigned long  imageTexels;
+
+   /// Bytes uploaded for all levels of the pages
+   size_t         uploadedBytes;
+} ESAtlasStats;
+
+typedef struct
+{
+   unsigned long  drawCalls;
+
+   /// Vertices (or indices) submitted by draw calls
+   unsigned long  vertices;
+   unsigned long  clears;
+
+   /// Fixed-function state, vertex attribute and texture parameter calls
+   unsigned long  stateChanges;
+
+   /// Program, texture, buffer and framebuffer bindings
+   unsigned long  bindings;
+   unsigned long  uniformUpdates;
+
+   /// Buffer and texture upload calls and the bytes of client data they read
+   unsigned long  uploads;
+   unsigned long  bufferBytes;
+   unsigned long  textureBytes;
+
+   /// Client-side vertex and index data the driver copies at draw time
+   unsigned long  clientArrayBytes;
+} ESGLCallCounts;
+
+typedef struct
+{
+   /// Counts for the last completed frame
+   ESGLCallCounts frame;
+
+   /// Totals since start-up
+   ESGLCallCounts total;
+   unsigned int   frames;
+} ESGLStats;
+
+typedef struct
+{
+   GLint          width;
+   GLint          height;
+
+   /// Format to pass to glTexImage2D as both internal format and format: GL_LUMINANCE, GL_RGB,
+   /// GL_RGBA or GL_BGRA_EXT.  The type is GL_UNSIGNED_BYTE, rows are tightly packed, top first.
+   GLenum         format;
+
+   /// Pixels, inside the file mapping if mapped is set
+   const void    *pixels;
+   GLboolean      mapped;
+
+   /// Mapping or buffer released by esFreeImage
+   void          *base;
+   size_t         size;
+} ESImage;
+
+/// Levels of the largest mip chain, for images of up to 32768 pixels a side
+#define ES_MAX_MIP_LEVELS       16
+
+typedef struct
+{
+   /// Format of all levels: GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB or GL_RGBA
+   GLenum         format;
+
+   /// Levels down to 1x1 and the size of each
+   int            numLevels;
+   GLint          width[ES_MAX_MIP_LEVELS];
+   GLint          height[ES_MAX_MIP_LEVELS];
+
+   /// Start of each level after the first in data, rows tightly packed
+   size_t         offset[ES_MAX_MIP_LEVELS];
+
+   /// Level 0, the source image, which must stay valid while the chain is used
+   const void    *base;
+
+   /// Levels 1 and up in one allocation of size bytes, released by esFreeMipChain
+   unsigned char *data;
+   size_t         size;
+} ESMipChain;
+
+typedef struct
+{
+   /// EGL_CONFIG_ID of the config esCreateWindow picked
+   EGLint         configId;
+
+   /// Bits per pixel of the framebuffer the draw callback renders to
+   GLint          redBits;
+   GLint          greenBits;
+   GLint          blueBits;
+   GLint          alphaBits;
+   GLint          depthBits;
+   GLint          stencilBits;
+
+   /// Samples per pixel, 0 if not multisampled
+   GLint          samples;
+
+   /// Estimated memory traffic of a frame that clears and covers the window once
+   unsigned long  frameBytes;
+} ESFramebufferInfo;
+
+typedef struct
+{
+   const char    *name;
+   unsigned long long start;
+} ESTraceZone;
+
+//
+/// Layout of the shared memory object written in ES_CAPTURE_SHM mode.  Frame n (counting
+/// from 0) is stored at dataOffset + ( n % numSlots ) * slotSize as width * height RGBA
+/// pixels, bottom row first.  frameCount is incremented with release semantics after a
+/// frame is complete; a reader loads it with acquire semantics and must be done copying a
+/// slot before the writer comes around to it again.
+//
+typedef struct
+{
+   unsigned int   magic;
+   unsigned int   width;
+   unsigned int   height;
+   unsigned int   numSlots;
+   unsigned int   slotSize;
+   unsigned int   dataOffset;
+
+   /// Number of frames written
+   unsigned long long frameCount;
+
+   /// esMainLoop frame number of the capture in each slot
+   unsigned int   frameNumbers[16];
+} ESCaptureShmHeader;
+
+//
+/// \brief Scoped CPU trace zones.  ES_TRACE_ZONE("name") times the rest of the enclosing
+///        scope; the zones of every thread can be written out as Chrome trace JSON.  Only
+///        built with -DES_TRACE (make TRACE=1), otherwise the macros expand to nothing.
+//
+#ifdef ES_TRACE
+#define ES_TRACE_CONCAT_(a, b)      a##b
+#define ES_TRACE_CONCAT(a, b)       ES_TRACE_CONCAT_(a, b)
+#define ES_TRACE_ZONE(name) \
+   ESTraceZone ES_TRACE_CONCAT(esTraceZone, __LINE__) __attribute__((cleanup(esTraceZoneEnd))) = esTraceZoneBegin(name)
+#define ES_TRACE_THREAD_NAME(name)  esTraceThreadName(name)
+#define ES_TRACE_DUMP(fileName)     esTraceDump(fileName)
+#else
+#define ES_TRACE_ZONE(name)
+#define ES_TRACE_THREAD_NAME(name)
+#define ES_TRACE_DUMP(fileName)     0
+#endif
+
 typedef struct _escontext
 {
    /// Put your user data here...
    void*       userData;
 
-   /// Window width
+   /// Window width.  With dynamic resolution on, the render width while the draw callback runs.
    GLint       width;
 
-   /// Window height
+   /// Window height.  With dynamic resolution on, the render height while the draw callback runs.
    GLint       height;
 
    /// Window handle
@@ -87,12 +445,76 @@ typedef struct _escontext
    /// EGL surface
    EGLSurface  eglSurface;
 
+   /// Framebuffer esCreateWindow picked for the flags it was given
+   ESFramebufferInfo framebuffer;
+
+   /// Number of frames after which esMainLoop returns, 0 to run until the window is
+   /// closed.  Initialized from the ES_FRAMES environment variable by esCreateWindow.
+   unsigned int maxFrames;
+
+   /// If non-zero, the deltaTime in seconds passed to the update callback every frame instead
+   /// of the time elapsed, for reproducible runs.  Initialized from ES_FIXED_DELTA by esCreateWindow.
+   float       fixedDeltaTime;
+
    /// Callbacks
    void (ESCALLBACK *drawFunc) ( struct _escontext * );
    void (ESCALLBACK *keyFunc) ( struct _escontext *, unsigned char, int, int );
    void (ESCALLBACK *updateFunc) ( struct _escontext *, float deltaTime );
+
+   /// Fixed simulation step in seconds, 0 for a variable step (see esSetFixedTimestep)
+   float       fixedTimestep;
+
+   /// Maximum number of fixed steps run per frame before simulation time is dropped
+   int         maxStepsPerFrame;
+
+   /// Simulation time accumulated but not yet consumed by a fixed step
+   float       stepAccumulator;
+
+   /// In fixed timestep mode, the fraction of a step between the last update and
+   /// the frame being drawn, in [0,1] (in [0,1) without a threaded update).  Draw
+   /// callbacks use it to interpolate between the previous and current simulation
+   /// state.  With a threaded update only the newest snapshot can be read, so the
+   /// alpha is the time since that snapshot was started and can only be used to
+   /// extrapolate forward from it.  Always 1 otherwise.
+   float       interpolationAlpha;
+
+   /// ES_RENDER_CONTINUOUS or ES_RENDER_ON_DEMAND (see esSetRenderMode)
+   int         renderMode;
+
+   /// In on-demand mode, keep rendering every frame while this is set
+   GLboolean   animating;
+
+   /// In on-demand mode, the eventfd esRequestRedraw writes to and the timerfd armed by
+   /// esScheduleRedraw, -1 otherwise.  Closed when esMainLoop returns.
+   int         redrawEventFd;
+   int         redrawTimerFd;
+
+   /// Update thread state, set up by esRegisterThreadedUpdateFunc
+   struct _esupdatethread *updateThread;
+
+   /// Frame capture state, set up by esCaptureStart
+   struct _escapture *capture;
+
+   /// GPU timer state, set up by esGpuTimerEnable
+   struct _esgputimer *gpuTimer;
+
+   /// Background loader state, set up by the first esLoad*Async request
+   struct _esloader *loader;
+
+   /// Texture streaming state, set up by esTextureStreamConfig or the first esStreamTexture
+   struct _estexturestream *textureStream;
+
+   /// Dynamic resolution state, set up by esEnableDynamicResolution
+   struct _esdynamicresolution *dynamicResolution;
+
+   /// Per-frame timing history recorded by esMainLoop
+   ESFrameHistory frameHistory;
 } ESContext;
 
+/// Called on the render thread when an asset requested with esLoadTextureAsync, esLoadProgramAsync
+/// or esCreateBufferAsync is ready to be used.  object is the texture, program or buffer, 0 on failure.
+typedef void (ESCALLBACK *ESLoaderCallback) ( ESContext *esContext, GLuint object, void *userData );
+
 
 ///
 //  Public Functions
@@ -117,6 +539,9 @@ void ESUTIL_API esInitContext ( ESContext *esContext );
 ///         ES_WINDOW_DEPTH   - specifies that a depth buffer should be created
 ///         ES_WINDOW_STENCIL - specifies that a stencil buffer should be created
 ///         ES_WINDOW_MULTISAMPLE - specifies that a multi-sample buffer should be created
+///         ES_WINDOW_HEADLESS - render into an EGL pbuffer (or a framebuffer object on a
+///                              surfaceless context) without opening an X display.  Also
+///                              selected at runtime by setting ES_HEADLESS=1.
 /// \return GL_TRUE if window creation is succesful, GL_FALSE otherwise
 GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, GLint width, GLint height, GLuint flags );
 
@@ -126,6 +551,47 @@ GLboolean ESUTIL_API esCreateWindow ( ESContext *esContext, const char *title, G
 //
 void ESUTIL_API esMainLoop ( ESContext *esContext );
 
+//
+/// \brief Run the update callback at a fixed rate instead of once per frame
+/// \param esContext Application context
+/// \param stepsPerSecond Simulation tick rate in Hz, 0 to go back to one variable step per frame
+/// \param maxStepsPerFrame Upper bound on the number of steps run in one frame.  When the
+///        renderer falls further behind, the excess simulation time is dropped so that a slow
+///        frame cannot cause ever more update work on the next one.  A threaded update
+///        callback reads both when esMainLoop starts.
+//
+void ESUTIL_API esSetFixedTimestep ( ESContext *esContext, float stepsPerSecond, int maxStepsPerFrame );
+
+//
+/// \brief Select whether esMainLoop renders continuously or only when needed
+/// \param esContext Application context
+/// \param mode ES_RENDER_CONTINUOUS to render frames back to back, or ES_RENDER_ON_DEMAND to
+///        block on the window system connection and draw only after esRequestRedraw, an
+///        expose or key event, or while esSetAnimating is on.  Headless contexts always
+///        render continuously.
+//
+void ESUTIL_API esSetRenderMode ( ESContext *esContext, int mode );
+
+//
+/// \brief Mark the frame dirty so that esMainLoop draws it in on-demand mode.  May be called from any thread.
+/// \param esContext Application context
+//
+void ESUTIL_API esRequestRedraw ( ESContext *esContext );
+
+//
+/// \brief Request a redraw once the given time has passed, replacing any earlier pending request
+/// \param esContext Application context
+/// \param seconds Delay before the frame is drawn
+//
+void ESUTIL_API esScheduleRedraw ( ESContext *esContext, float seconds );
+
+//
+/// \brief Turn continuous rendering on or off while in on-demand mode, e.g. for the duration of an animation
+/// \param esContext Application context
+/// \param animating GL_TRUE to render every frame, GL_FALSE to go back to sleeping between redraws
+//
+void ESUTIL_API esSetAnimating ( ESContext *esContext, GLboolean animating );
+
 //
 /// \brief Register a draw callback function to be used to render each frame
 /// \param esContext Application context
@@ -140,6 +606,102 @@ void ESUTIL_API esRegisterDrawFunc ( ESContext *esContext, void (ESCALLBACK *dra
 //
 void ESUTIL_API esRegisterUpdateFunc ( ESContext *esContext, void (ESCALLBACK *updateFunc) ( ESContext*, float ) );
 
+//
+/// \brief Register an update callback function to be run on its own thread, overlapping with rendering
+/// \param esContext Application context
+/// \param snapshotSize Size in bytes of the per-frame state passed from update to draw
+/// \param updateFunc Update callback.  It receives the time step and a snapshot buffer to fill in
+///        with everything the draw callback needs for the frame.  The buffer is one of three and
+///        holds stale contents, so simulation state must live elsewhere (e.g. in userData).  The
+///        callback runs without a current GL context and must not make GL calls.  It is called
+///        at most once per rendered frame, or at the fixed rate set with esSetFixedTimestep.
+///        NULL stops threaded updates.
+/// \return GL_TRUE on success, GL_FALSE if the snapshot buffers could not be allocated
+//
+GLboolean ESUTIL_API esRegisterThreadedUpdateFunc ( ESContext *esContext, size_t snapshotSize,
+                                                    void (ESCALLBACK *updateFunc) ( ESContext*, float, void* ) );
+
+//
+/// \brief Return the newest snapshot published by the threaded update callback
+/// \param esContext Application context
+/// \return The snapshot to draw this frame, unchanged until the draw callback returns,
+///         or NULL if no threaded update callback is registered
+//
+const void* ESUTIL_API esGetFrameSnapshot ( ESContext *esContext );
+
+//
+/// \brief Load a TGA image into a texture on the loader thread, read with esMapTGA.  The texture
+///        has the format of the image (see ESImage), GL_LINEAR filtering and GL_CLAMP_TO_EDGE
+///        wrapping, the callback may change that.
+/// \param esContext Application context, with a window created by esCreateWindow
+/// \param fileName Name of the file on disk
+/// \param callback Called from esMainLoop on the render thread once the texture can be used
+/// \param userData Passed to the callback
+/// \return GL_TRUE if the request was queued
+//
+GLboolean ESUTIL_API esLoadTextureAsync ( ESContext *esContext, const char *fileName,
+                                          ESLoaderCallback callback, void *userData );
+
+//
+/// \brief Compile and link a program on the loader thread, like esLoadProgram
+/// \param esContext Application context, with a window created by esCreateWindow
+/// \param vertShaderSrc, fragShaderSrc Shader sources, copied before the function returns
+/// \param callback Called from esMainLoop on the render thread once the program can be used
+/// \param userData Passed to the callback
+/// \return GL_TRUE if the request was queued
+//
+GLboolean ESUTIL_API esLoadProgramAsync ( ESContext *esContext, const char *vertShaderSrc, const char *fragShaderSrc,
+                                          ESLoaderCallback callback, void *userData );
+
+//
+/// \brief Create a buffer object and upload its data on the loader thread
+/// \param esContext Application context, with a window created by esCreateWindow
+/// \param target, size, data, usage As for glBufferData.  data must stay valid until the callback runs.
+/// \param callback Called from esMainLoop on the render thread once the buffer can be used
+/// \param userData Passed to the callback
+/// \return GL_TRUE if the request was queued
+//
+GLboolean ESUTIL_API esCreateBufferAsync ( ESContext *esContext, GLenum target, GLsizeiptr size, const void *data,
+                                           GLenum usage, ESLoaderCallback callback, void *userData );
+
+//
+/// \brief Return the number of esLoad*Async requests whose callbacks have not run yet
+/// \param esContext Application context
+//
+unsigned int ESUTIL_API esLoaderPending ( ESContext *esContext );
+
+//
+/// \brief Set up texture streaming.  Optional, esStreamTexture starts it with the defaults of
+///        2 workers and 1 MB per frame, or ES_STREAM_BUDGET KB per frame from the environment.
+/// \param esContext Application context, with a window created by esCreateWindow
+/// \param numWorkers Threads that read and decode the files, 0 for the default.  Ignored once
+///        the first texture has been requested.
+/// \param bytesPerFrame Pixel bytes uploaded per frame at most, 0 for the default.  A slice is at
+///        least one row and compressed levels are uploaded whole.
+/// \return GL_TRUE on success
+//
+GLboolean ESUTIL_API esTextureStreamConfig ( ESContext *esContext, int numWorkers, GLsizei bytesPerFrame );
+
+//
+/// \brief Stream a TGA or 2D KTX texture in.  A worker thread reads and decodes the file, then
+///        esMainLoop uploads it a few rows per frame within the budget set by esTextureStreamConfig.
+///        The texture has linear (mipmap) filtering and GL_CLAMP_TO_EDGE wrapping.
+/// \param esContext Application context, with a window created by esCreateWindow
+/// \param fileName Name of the file on disk
+/// \param callback Called from esMainLoop on the render thread with the texture, 0 on failure
+/// \param userData Passed to the callback
+/// \return A 1x1 gray placeholder texture to draw with until the callback runs, shared by all
+///         requests and deleted when esMainLoop returns.  0 if the request could not be queued.
+//
+GLuint ESUTIL_API esStreamTexture ( ESContext *esContext, const char *fileName,
+                                    ESLoaderCallback callback, void *userData );
+
+//
+/// \brief Return the number of esStreamTexture requests whose callbacks have not run yet
+/// \param esContext Application context
+//
+unsigned int ESUTIL_API esTextureStreamPending ( ESContext *esContext );
+
 //
 /// \brief Register an keyboard input processing callback function
 /// \param esContext Application context
@@ -153,6 +715,117 @@ void ESUTIL_API esRegisterKeyFunc ( ESContext *esContext,
 //
 void ESUTIL_API esLogMessage ( const char *formatStr, ... );
 
+//
+/// \brief Log a message with a severity.  While esMainLoop runs, messages are queued and written
+///        to stdout by a background thread, otherwise they are written before returning;
+///        esLogMessage logs with ES_LOG_INFO.
+/// \param severity One of ES_LOG_DEBUG, ES_LOG_INFO, ES_LOG_WARNING or ES_LOG_ERROR
+/// \param formatStr printf format string
+//
+void ESUTIL_API esLog ( int severity, const char *formatStr, ... );
+
+//
+/// \brief Drop messages below a severity.  Defaults to ES_LOG_INFO or the ES_LOG_LEVEL
+///        environment variable (debug, info, warning or error).
+/// \param severity Lowest severity that is logged
+//
+void ESUTIL_API esSetLogLevel ( int severity );
+
+//
+/// \brief Write all queued messages before returning
+//
+void ESUTIL_API esLogFlush ( void );
+
+//
+/// \brief Return the time in seconds from a monotonic high-resolution clock
+//
+double ESUTIL_API esGetTime ( void );
+
+//
+/// \brief Add the timings of one frame to the frame timing history
+/// \param esContext Application context
+/// \param frameTime Timings for the frame
+//
+void ESUTIL_API esRecordFrameTime ( ESContext *esContext, const ESFrameTime *frameTime );
+
+//
+/// \brief Attach GPU timings to a frame in the frame timing history
+/// \param esContext Application context
+/// \param frameNumber Number of the frame, counted from the last esResetFrameStats.  Ignored if
+///        the frame has already dropped out of the history.
+/// \param passTimes GPU time of each pass in milliseconds
+/// \param numPasses Number of entries in passTimes
+//
+void ESUTIL_API esRecordGpuTime ( ESContext *esContext, unsigned int frameNumber,
+                                  const float *passTimes, int numPasses );
+
+//
+/// \brief Start measuring GPU time per pass.  Uses EXT_disjoint_timer_query when present, read back
+///        a few frames later without stalling; otherwise waits on fences around each pass.
+///        esMainLoop times the whole draw callback as pass "draw".  Also enabled by ES_GPU_TIMER=1.
+/// \param esContext Application context
+/// \return GL_TRUE on success
+//
+GLboolean ESUTIL_API esGpuTimerEnable ( ESContext *esContext );
+
+//
+/// \brief Stop GPU timing and release the query pool
+/// \param esContext Application context
+//
+void ESUTIL_API esGpuTimerDisable ( ESContext *esContext );
+
+//
+/// \brief Start a named GPU pass, ending the pass in progress.  Passes do not nest, so calling
+///        this inside the draw callback splits the "draw" pass.  Does nothing if timing is off.
+/// \param esContext Application context
+/// \param passName Name of the pass.  Must stay valid while the timer is enabled, e.g. a literal.
+//
+void ESUTIL_API esGpuTimerBegin ( ESContext *esContext, const char *passName );
+
+//
+/// \brief End the GPU pass in progress
+/// \param esContext Application context
+//
+void ESUTIL_API esGpuTimerEnd ( ESContext *esContext );
+
+//
+/// \brief Close the frame's GPU passes and collect results of earlier frames that are ready.
+///        Called by esMainLoop after every frame.
+/// \param esContext Application context
+/// \param frameNumber Number of the frame in the frame timing history
+//
+void ESUTIL_API esGpuTimerEndFrame ( ESContext *esContext, unsigned int frameNumber );
+
+//
+/// \brief Return the name of a GPU pass
+/// \param esContext Application context
+/// \param pass Index of the pass in ESFrameTime::gpuPass
+/// \return The name given to esGpuTimerBegin, or NULL if there is no such pass
+//
+const char* ESUTIL_API esGpuTimerPassName ( ESContext *esContext, int pass );
+
+//
+/// \brief Compute percentile statistics over the frame timing history
+/// \param esContext Application context
+/// \param stats Returns the statistics for the frames currently in the history
+//
+void ESUTIL_API esGetFrameStats ( ESContext *esContext, ESFrameStats *stats );
+
+//
+/// \brief Write the statistics of esGetFrameStats to a JSON file.  esMainLoop does this on
+///        return when ES_STATS_FILE names a file.
+/// \param esContext Application context
+/// \param fileName Name of the file to write
+/// \return GL_TRUE on success
+//
+GLboolean ESUTIL_API esWriteFrameStats ( ESContext *esContext, const char *fileName );
+
+//
+/// \brief Discard all frames in the frame timing history
+/// \param esContext Application context
+//
+void ESUTIL_API esResetFrameStats ( ESContext *esContext );
+
 //
 ///
 /// \brief Load a shader, check for compile errors, print error messages to output log
@@ -173,6 +846,222 @@ GLuint ESUTIL_API esLoadShader ( GLenum type, const char *shaderSrc );
 GLuint ESUTIL_API esLoadProgram ( const char *vertShaderSrc, const char *fragShaderSrc );
 
 
+//
+/// \brief Initialize an empty command buffer
+/// \param cmdBuffer Command buffer to initialize
+/// \param initialCapacity Number of bytes to preallocate, 0 to allocate on first use
+//
+void ESUTIL_API esCmdBufferInit ( ESCommandBuffer *cmdBuffer, size_t initialCapacity );
+
+//
+/// \brief Discard all recorded commands, keeping the allocation for the next frame
+/// \param cmdBuffer Command buffer to reset
+//
+void ESUTIL_API esCmdBufferReset ( ESCommandBuffer *cmdBuffer );
+
+//
+/// \brief Free the memory held by a command buffer
+/// \param cmdBuffer Command buffer to free
+//
+void ESUTIL_API esCmdBufferFree ( ESCommandBuffer *cmdBuffer );
+
+//
+/// \brief Execute the recorded commands in order.  Must be called on the thread owning the GL context.
+///        State commands go through the esState* functions, so the state cache stays valid.
+/// \param cmdBuffer Command buffer to replay
+//
+void ESUTIL_API esCmdBufferReplay ( const ESCommandBuffer *cmdBuffer );
+
+//
+/// \brief Replay several command buffers one after the other
+/// \param cmdBuffers Array of command buffers, replayed in array order
+/// \param numBuffers Number of command buffers in the array
+//
+void ESUTIL_API esCmdBufferReplayList ( ESCommandBuffer * const *cmdBuffers, int numBuffers );
+
+//
+/// \brief Record GL commands into a command buffer.  These make no GL calls and can be used
+///        from any thread, as long as each buffer is only recorded by one thread at a time.
+///        Arguments match the GL function of the same name; esCmdBindTexture also selects the
+///        texture unit and esCmdUniformfv covers glUniform{1,2,3,4}fv through components.
+///        Uniform values are copied, vertex and index pointers are recorded as is.
+//
+void ESUTIL_API esCmdUseProgram ( ESCommandBuffer *cmdBuffer, GLuint program );
+void ESUTIL_API esCmdBindTexture ( ESCommandBuffer *cmdBuffer, GLenum unit, GLenum target, GLuint texture );
+void ESUTIL_API esCmdBindBuffer ( ESCommandBuffer *cmdBuffer, GLenum target, GLuint buffer );
+void ESUTIL_API esCmdEnable ( ESCommandBuffer *cmdBuffer, GLenum cap );
+void ESUTIL_API esCmdDisable ( ESCommandBuffer *cmdBuffer, GLenum cap );
+void ESUTIL_API esCmdBlendFunc ( ESCommandBuffer *cmdBuffer, GLenum sfactor, GLenum dfactor );
+void ESUTIL_API esCmdDepthFunc ( ESCommandBuffer *cmdBuffer, GLenum func );
+void ESUTIL_API esCmdDepthMask ( ESCommandBuffer *cmdBuffer, GLboolean flag );
+void ESUTIL_API esCmdStencilFunc ( ESCommandBuffer *cmdBuffer, GLenum func, GLint ref, GLuint mask );
+void ESUTIL_API esCmdStencilOp ( ESCommandBuffer *cmdBuffer, GLenum fail, GLenum zfail, GLenum zpass );
+void ESUTIL_API esCmdStencilMask ( ESCommandBuffer *cmdBuffer, GLuint mask );
+void ESUTIL_API esCmdViewport ( ESCommandBuffer *cmdBuffer, GLint x, GLint y, GLsizei width, GLsizei height );
+void ESUTIL_API esCmdClearColor ( ESCommandBuffer *cmdBuffer, GLfloat r, GLfloat g, GLfloat b, GLfloat a );
+void ESUTIL_API esCmdClear ( ESCommandBuffer *cmdBuffer, GLbitfield mask );
+void ESUTIL_API esCmdUniform1i ( ESCommandBuffer *cmdBuffer, GLint location, GLint x );
+void ESUTIL_API esCmdUniform1f ( ESCommandBuffer *cmdBuffer, GLint location, GLfloat x );
+void ESUTIL_API esCmdUniformfv ( ESCommandBuffer *cmdBuffer, GLint location, GLint components,
+                                 GLsizei count, const GLfloat *v );
+void ESUTIL_API esCmdUniformMatrix4fv ( ESCommandBuffer *cmdBuffer, GLint location, GLsizei count, const GLfloat *value );
+void ESUTIL_API esCmdVertexAttribPointer ( ESCommandBuffer *cmdBuffer, GLuint index, GLint size, GLenum type,
+                                           GLboolean normalized, GLsizei stride, const void *ptr );
+void ESUTIL_API esCmdEnableVertexAttribArray ( ESCommandBuffer *cmdBuffer, GLuint index );
+void ESUTIL_API esCmdDisableVertexAttribArray ( ESCommandBuffer *cmdBuffer, GLuint index );
+void ESUTIL_API esCmdDrawArrays ( ESCommandBuffer *cmdBuffer, GLenum mode, GLint first, GLsizei count );
+void ESUTIL_API esCmdDrawElements ( ESCommandBuffer *cmdBuffer, GLenum mode, GLsizei count, GLenum type,
+                                    const void *indices );
+
+//
+/// \brief Forget all shadowed GL state so the next esState* call of each kind reaches GL.
+///        Call after changing tracked state without going through the cache.
+//
+void ESUTIL_API esStateInvalidate ( void );
+
+//
+/// \brief Set GL state through the redundant state filter.  Arguments match the GL function of
+///        the same name, and the call is dropped when the state is already set to that value.
+///        Tracks the program, the active texture unit and its 2D and cube map bindings, array
+///        and element array buffers, enables, blend, depth and stencil state, the viewport and
+///        vertex attribute array enables.
+//
+void ESUTIL_API esStateUseProgram ( GLuint program );
+void ESUTIL_API esStateActiveTexture ( GLenum texture );
+void ESUTIL_API esStateBindTexture ( GLenum target, GLuint texture );
+void ESUTIL_API esStateBindBuffer ( GLenum target, GLuint buffer );
+void ESUTIL_API esStateEnable ( GLenum cap );
+void ESUTIL_API esStateDisable ( GLenum cap );
+void ESUTIL_API esStateBlendFunc ( GLenum sfactor, GLenum dfactor );
+void ESUTIL_API esStateDepthFunc ( GLenum func );
+void ESUTIL_API esStateDepthMask ( GLboolean flag );
+void ESUTIL_API esStateStencilFunc ( GLenum func, GLint ref, GLuint mask );
+void ESUTIL_API esStateStencilOp ( GLenum fail, GLenum zfail, GLenum zpass );
+void ESUTIL_API esStateStencilMask ( GLuint mask );
+void ESUTIL_API esStateViewport ( GLint x, GLint y, GLsizei width, GLsizei height );
+void ESUTIL_API esStateEnableVertexAttribArray ( GLuint index );
+void ESUTIL_API esStateDisableVertexAttribArray ( GLuint index );
+
+//
+/// \brief Close the per-frame state cache counters.  Called by esMainLoop after every frame.
+//
+void ESUTIL_API esStateCacheEndFrame ( void );
+
+//
+/// \brief Return how many state calls went through the cache and how many were filtered
+/// \param cacheStats Returns the counts for the last frame and since start-up
+//
+void ESUTIL_API esGetStateCacheStats ( ESStateCacheStats *cacheStats );
+
+//
+/// \brief Create a pool of transient render targets for multi-pass effects
+/// \return The pool, NULL if out of memory
+//
+ESRenderTargetPool* ESUTIL_API esRenderTargetPoolCreate ( void );
+
+//
+/// \brief Delete a pool and all of its targets and framebuffer objects
+/// \param pool Pool returned by esRenderTargetPoolCreate
+//
+void ESUTIL_API esRenderTargetPoolDestroy ( ESRenderTargetPool *pool );
+
+//
+/// \brief Get a render target for a pass.  Returns a target the pool holds with the same size
+///        and format that is not in use, otherwise allocates a new one.  Its contents are undefined.
+/// \param pool Render target pool
+/// \param width, height Size of the target in pixels
+/// \param format GL_RGBA, GL_RGB, GL_RGB565, GL_RGBA4 or GL_RGB5_A1 for a color texture,
+///        GL_DEPTH_COMPONENT16, GL_STENCIL_INDEX8 or GL_DEPTH24_STENCIL8_OES for a renderbuffer
+/// \return The target, NULL on failure
+//
+ESRenderTarget* ESUTIL_API esRenderTargetAcquire ( ESRenderTargetPool *pool, GLsizei width, GLsizei height,
+                                                   GLenum format );
+
+//
+/// \brief Return a target to the pool after the last pass that renders to or samples it has
+///        been issued.  Later passes, in the same frame or later ones, can then be given the target.
+/// \param pool Render target pool
+/// \param target Target returned by esRenderTargetAcquire
+//
+void ESUTIL_API esRenderTargetRelease ( ESRenderTargetPool *pool, ESRenderTarget *target );
+
+//
+/// \brief Bind a framebuffer object with the given attachments and set the viewport to their size
+///        through esStateViewport
+/// \param pool Render target pool
+/// \param color Color target, or NULL
+/// \param depthStencil Depth and/or stencil target of the same size, or NULL
+/// \return GL_TRUE on success, GL_FALSE if the framebuffer is incomplete
+//
+GLboolean ESUTIL_API esRenderTargetBind ( ESRenderTargetPool *pool, const ESRenderTarget *color,
+                                          const ESRenderTarget *depthStencil );
+
+//
+/// \brief Close the per-frame counters and delete targets that have not been used for a while.
+///        Call once per frame after the last pass.
+/// \param pool Render target pool
+//
+void ESUTIL_API esRenderTargetPoolEndFrame ( ESRenderTargetPool *pool );
+
+//
+/// \brief Return the memory used by a pool and how often targets were reused
+/// \param pool Render target pool
+/// \param poolStats Returns the counts for the last frame and since the pool was created
+//
+void ESUTIL_API esGetRenderTargetPoolStats ( ESRenderTargetPool *pool, ESRenderTargetPoolStats *poolStats );
+
+//
+/// \brief Create a texture atlas and allocate its first page with all its mip levels.  Later
+///        pages are allocated whole when an image fits in none of the pages so far.
+/// \param pageSize Width and height of the pages, a power of two
+/// \param format GL_RGBA, GL_BGRA_EXT, GL_RGB, GL_LUMINANCE_ALPHA, GL_LUMINANCE or GL_ALPHA,
+///        with GL_UNSIGNED_BYTE channels
+/// \param padding Texels of gutter repeating the edges of each image, 1 is enough for linear
+///        filtering without mipmaps
+/// \param mipLevels 1 for pages without mipmaps, otherwise the number of levels, from 0, down
+///        to which images stay apart.  Images are aligned to 2^(mipLevels - 1) texels and the
+///        padding is raised to as many; the pages get full mip chains.
+/// \param maxPages Most pages the atlas may allocate
+/// \return The atlas, NULL on failure
+//
+ESAtlas* ESUTIL_API esAtlasCreate ( GLsizei pageSize, GLenum format, GLint padding, GLint mipLevels, int maxPages );
+
+//
+/// \brief Delete an atlas and the textures of its pages
+/// \param atlas Atlas returned by esAtlasCreate
+//
+void ESUTIL_API esAtlasDestroy ( ESAtlas *atlas );
+
+//
+/// \brief Pack an image into the page where it fits best and upload it with its gutter and mip
+///        levels.  Images already placed do not move.
+/// \param atlas Texture atlas
+/// \param width, height Size of the image in pixels
+/// \param format Format of the image, the one of the atlas
+/// \param pixels Tightly packed rows of the image, e.g. the pixels of an ESImage
+/// \param region Returns the page and texture coordinates of the image
+/// \return GL_TRUE on success, GL_FALSE if the image is too large or all pages are full
+//
+GLboolean ESUTIL_API esAtlasAdd ( ESAtlas *atlas, GLsizei width, GLsizei height, GLenum format,
+                                  const void *pixels, ESAtlasRegion *region );
+
+//
+/// \brief Map texture coordinates of a texture of its own to the region of an image in the atlas
+/// \param region Region returned by esAtlasAdd
+/// \param texCoords Pairs of texture coordinates from 0 to 1
+/// \param remapped Returns the pairs in the page, may be texCoords
+/// \param count Number of pairs
+//
+void ESUTIL_API esAtlasRemapTexCoords ( const ESAtlasRegion *region, const GLfloat *texCoords,
+                                        GLfloat *remapped, int count );
+
+//
+/// \brief Return how full the pages of an atlas are
+/// \param atlas Texture atlas
+/// \param atlasStats Returns the counts
+//
+void ESUTIL_API esGetAtlasStats ( ESAtlas *atlas, ESAtlasStats *atlasStats );
+
 //
 /// \brief Generates geometry for a sphere.  Allocates memory for the vertex data and stores 
 ///        the results in the arrays.  Generate index list for a TRIANGLE_STRIP
@@ -202,7 +1091,8 @@ int ESUTIL_API esGenCube ( float scale, GLfloat **vertices, GLfloat **normals,
                            GLfloat **texCoords, GLuint **indices );
 
 //
-/// \brief Loads a 24-bit TGA image from a file
+/// \brief Loads a TGA image from a file as RGB, top row first.  Uncompressed and RLE true-color
+///        (24 or 32-bit), grayscale and color-mapped images are read; alpha is dropped.
 /// \param fileName Name of the file on disk
 /// \param width Width of loaded image in pixels
 /// \param height Height of loaded image in pixels
@@ -210,6 +1100,144 @@ int ESUTIL_API esGenCube ( float scale, GLfloat **vertices, GLfloat **normals,
 //
 char* ESUTIL_API esLoadTGA ( char *fileName, int *width, int *height );
 
+//
+/// \brief Loads a TGA image from a file in its own format, top row first
+/// \param fileName Name of the file on disk
+/// \param width Width of loaded image in pixels
+/// \param height Height of loaded image in pixels
+/// \param format Returns GL_LUMINANCE, GL_RGB or GL_RGBA
+///  \return Pointer to the tightly packed pixels, to be released with free().  NULL on failure.
+//
+char* ESUTIL_API esLoadTGAEx ( const char *fileName, int *width, int *height, GLenum *format );
+
+//
+/// \brief Maps a TGA image from a file for uploading, without copying it into a buffer when it is
+///        uncompressed.  Release it with esFreeImage once it has been uploaded.  With a current
+///        context that supports GL_EXT_texture_format_BGRA8888, 32-bit images keep BGRA order.
+/// \param fileName Name of the file on disk
+/// \param image Returns the image
+///  \return GL_TRUE if the image was loaded, GL_FALSE otherwise
+//
+GLboolean ESUTIL_API esMapTGA ( const char *fileName, ESImage *image );
+
+//
+/// \brief Releases the pixels of an image returned by esMapTGA
+/// \param image The image
+//
+void ESUTIL_API esFreeImage ( ESImage *image );
+
+//
+/// \brief Loads a KTX file into a new 2D or cube map texture with all the mip levels it stores.
+///        ETC1 levels are uploaded compressed when GL_OES_compressed_ETC1_RGB8_texture is
+///        supported and decompressed to RGB otherwise.  The texture is left unbound with linear
+///        (mipmap) filtering and GL_CLAMP_TO_EDGE wrapping.
+/// \param fileName Name of the file on disk
+/// \param target Returns GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP, may be NULL
+/// \param width Returns the width of the base level in pixels, may be NULL
+/// \param height Returns the height of the base level in pixels, may be NULL
+///  \return The texture object, 0 on failure
+//
+GLuint ESUTIL_API esLoadKTX ( const char *fileName, GLenum *target, int *width, int *height );
+
+//
+/// \brief Compresses an RGB image into ETC1 blocks, ((width + 3) / 4) * ((height + 3) / 4) * 8 bytes
+/// \param rgb Tightly packed RGB pixels, top row first
+/// \param width Width of the image in pixels
+/// \param height Height of the image in pixels
+/// \param quality 0 (fast), 1 or 2 (best); higher levels search more base colors per block
+/// \param data Returns the blocks, row by row
+//
+void ESUTIL_API esEncodeETC1 ( const unsigned char *rgb, int width, int height, int quality, unsigned char *data );
+
+//
+/// \brief Decompresses ETC1 blocks into tightly packed RGB pixels
+/// \param data The blocks, row by row
+/// \param width Width of the image in pixels
+/// \param height Height of the image in pixels
+/// \param rgb Returns width * height * 3 bytes
+//
+void ESUTIL_API esDecodeETC1 ( const unsigned char *data, int width, int height, unsigned char *rgb );
+
+//
+/// \brief Loads a DDS file into a new 2D, cube map or 3D (GL_OES_texture_3D) texture with all
+///        the mip levels it stores.  DXT1/3/5 images are uploaded compressed when the matching
+///        S3TC extension is supported and decompressed to RGBA otherwise; uncompressed formats GL
+///        does not take as they are are converted to RGB(A).  The texture is left unbound with
+///        linear filtering, mipmapped if the file has the full chain, and GL_CLAMP_TO_EDGE.
+/// \param fileName Name of the file on disk
+/// \param target Returns GL_TEXTURE_2D, GL_TEXTURE_CUBE_MAP or GL_TEXTURE_3D_OES, may be NULL
+/// \param width Returns the width of the base level in pixels, may be NULL
+/// \param height Returns the height of the base level in pixels, may be NULL
+/// \param depth Returns the depth of the base level in slices, 1 unless 3D, may be NULL
+///  \return The texture object, 0 on failure
+//
+GLuint ESUTIL_API esLoadDDS ( const char *fileName, GLenum *target, int *width, int *height, int *depth );
+
+//
+/// \brief Decompresses S3TC blocks into tightly packed RGBA pixels
+/// \param format GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
+///        GL_COMPRESSED_RGBA_S3TC_DXT3_ANGLE or GL_COMPRESSED_RGBA_S3TC_DXT5_ANGLE
+/// \param data The blocks, row by row
+/// \param width Width of the image in pixels
+/// \param height Height of the image in pixels
+/// \param rgba Returns width * height * 4 bytes
+//
+void ESUTIL_API esDecodeBCn ( GLenum format, const unsigned char *data, int width, int height, unsigned char *rgba );
+
+//
+/// \brief Builds the mip chain of an image down to 1x1, each texel the sum of a 2x2 block of the
+///        level above divided by four and truncated, as the MipMap2D example does
+/// \param pixels Tightly packed rows of the image
+/// \param width, height Size of the image in pixels
+/// \param format GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB or GL_RGBA, 8 bits per channel
+/// \param numThreads Threads to split large levels between, 0 for one per CPU
+/// \param chain Returns the levels, to be released with esFreeMipChain
+///  \return GL_TRUE on success, GL_FALSE if the format is not supported or out of memory
+//
+GLboolean ESUTIL_API esGenerateMipChain ( const void *pixels, GLint width, GLint height, GLenum format,
+                                          int numThreads, ESMipChain *chain );
+
+//
+/// \brief Returns the pixels of a level of a mip chain, the source image for level 0
+/// \param chain Chain returned by esGenerateMipChain
+/// \param level Level from 0 to numLevels - 1
+//
+const void* ESUTIL_API esMipChainLevel ( const ESMipChain *chain, int level );
+
+//
+/// \brief Releases the levels of a mip chain returned by esGenerateMipChain
+/// \param chain The chain
+//
+void ESUTIL_API esFreeMipChain ( ESMipChain *chain );
+
+//
+/// \brief Converts an 8 bit per channel image into a compact format
+/// \param pixels Tightly packed rows of the image
+/// \param width, height Size of the image in pixels
+/// \param srcFormat GL_RGB or GL_RGBA
+/// \param dstFormat GL_RGB565, GL_RGBA4 or GL_RGB5_A1 for packed shorts, GL_LUMINANCE or GL_LUMINANCE_ALPHA
+/// \param dither ES_DITHER_NONE, ES_DITHER_ORDERED or ES_DITHER_FLOYD_STEINBERG; only the color
+///        channels of the packed formats are dithered
+/// \param dst Returns tightly packed rows, 2 bytes per pixel or 1 for GL_LUMINANCE
+/// \param format, type Return the format and type to pass to glTexImage2D, may be NULL
+///  \return GL_TRUE on success, GL_FALSE if a format is not supported
+//
+GLboolean ESUTIL_API esConvertPixels ( const void *pixels, GLsizei width, GLsizei height, GLenum srcFormat,
+                                       GLenum dstFormat, int dither, void *dst, GLenum *format, GLenum *type );
+
+//
+/// \brief Converts an image with esConvertPixels and loads it into the bound texture with
+///        glTexImage2D, setting GL_UNPACK_ALIGNMENT for the rows and restoring it afterwards
+/// \param target, level As for glTexImage2D
+/// \param width, height Size of the image in pixels
+/// \param srcFormat GL_RGB or GL_RGBA
+/// \param pixels Tightly packed rows of the image
+/// \param dstFormat, dither As for esConvertPixels
+///  \return GL_TRUE on success, GL_FALSE if a format is not supported or out of memory
+//
+GLboolean ESUTIL_API esTexImage2DConverted ( GLenum target, GLint level, GLsizei width, GLsizei height,
+                                             GLenum srcFormat, const void *pixels, GLenum dstFormat, int dither );
+
 
 //
 /// \brief multiply matrix specified by result with a scaling matrix and return new matrix in result
@@ -274,6 +1302,201 @@ void ESUTIL_API esMatrixMultiply(ESMatrix *result, ESMatrix *srcA, ESMatrix *src
 //
 void ESUTIL_API esMatrixLoadIdentity(ESMatrix *result);
 
+//
+/// \brief Render into an offscreen framebuffer whose size follows a frame time budget and
+///        stretch it over the window.  The scale is adjusted after every frame from the GPU time
+///        if esGpuTimerEnable is on, the frame time otherwise.  While the draw callback runs
+///        esContext->width and height hold the render size.  esMainLoop enables it with a
+///        0.25 to 1 scale range when ES_DYNAMIC_RESOLUTION=<budget in ms> is set.
+/// \param esContext Application context
+/// \param targetTime Frame time budget in milliseconds
+/// \param minScale, maxScale Range of the scale applied to the window width and height.
+///        maxScale may be above 1 to supersample when there is time to spare.
+/// \return GL_TRUE on success
+//
+GLboolean ESUTIL_API esEnableDynamicResolution ( ESContext *esContext, float targetTime,
+                                                 float minScale, float maxScale );
+
+//
+/// \brief Go back to rendering straight into the window
+/// \param esContext Application context
+//
+void ESUTIL_API esDisableDynamicResolution ( ESContext *esContext );
+
+//
+/// \brief Return the current render scale
+/// \param esContext Application context
+/// \param width, height If not NULL, return the render size in pixels
+/// \return The scale, 1 when dynamic resolution is off
+//
+float ESUTIL_API esGetRenderScale ( ESContext *esContext, GLint *width, GLint *height );
+
+//
+/// \brief Start capturing every frame without stalling the GPU.  Frames are read back latency
+///        frames after they are drawn and written out on a worker thread, which the frame waits
+///        for if it falls behind.  esMainLoop starts a capture from ES_CAPTURE=<printf pattern
+///        for TGA files> or ES_CAPTURE_SHM=</shm name>.
+/// \param esContext Application context
+/// \param mode ES_CAPTURE_TGA or ES_CAPTURE_SHM
+/// \param target For ES_CAPTURE_TGA a file name pattern with one %u for the frame number (e.g.
+///        %05u) and no other %, for ES_CAPTURE_SHM the name of the shared memory object (see
+///        ESCaptureShmHeader)
+/// \param latency Number of frames between drawing a frame and reading it back, 1 to 8
+/// \return GL_TRUE on success
+//
+GLboolean ESUTIL_API esCaptureStart ( ESContext *esContext, int mode, const char *target, int latency );
+
+//
+/// \brief Copy the current frame into the capture ring.  Called by esMainLoop before the swap.
+/// \param esContext Application context
+//
+void ESUTIL_API esCaptureFrame ( ESContext *esContext );
+
+//
+/// \brief Read back the frames still in flight, wait for them to be written and stop capturing
+/// \param esContext Application context
+//
+void ESUTIL_API esCaptureStop ( ESContext *esContext );
+
+#ifdef ES_GL_STATS
+//
+/// \brief Close the per-frame GL call counters.  Called by esMainLoop after every frame.
+//
+void ESUTIL_API esGLStatsEndFrame ( void );
+
+//
+/// \brief Return the GL call and upload counts
+/// \param glStats Returns the counts for the last frame and since start-up
+//
+void ESUTIL_API esGetGLStats ( ESGLStats *glStats );
+
+//
+/// \brief Counting wrappers of the GL entry points, see ESGLStats.c
+//
+void ESUTIL_API esGLStatsDrawArrays ( GLenum mode, GLint first, GLsizei count );
+void ESUTIL_API esGLStatsDrawElements ( GLenum mode, GLsizei count, GLenum type, const GLvoid *indices );
+void ESUTIL_API esGLStatsClear ( GLbitfield mask );
+void ESUTIL_API esGLStatsEnable ( GLenum cap );
+void ESUTIL_API esGLStatsDisable ( GLenum cap );
+void ESUTIL_API esGLStatsBlendFunc ( GLenum sfactor, GLenum dfactor );
+void ESUTIL_API esGLStatsDepthFunc ( GLenum func );
+void ESUTIL_API esGLStatsDepthMask ( GLboolean flag );
+void ESUTIL_API esGLStatsCullFace ( GLenum mode );
+void ESUTIL_API esGLStatsStencilFunc ( GLenum func, GLint ref, GLuint mask );
+void ESUTIL_API esGLStatsStencilOp ( GLenum fail, GLenum zfail, GLenum zpass );
+void ESUTIL_API esGLStatsStencilMask ( GLuint mask );
+void ESUTIL_API esGLStatsViewport ( GLint x, GLint y, GLsizei width, GLsizei height );
+void ESUTIL_API esGLStatsClearColor ( GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha );
+void ESUTIL_API esGLStatsClearDepthf ( GLclampf depth );
+void ESUTIL_API esGLStatsClearStencil ( GLint s );
+void ESUTIL_API esGLStatsPixelStorei ( GLenum pname, GLint param );
+void ESUTIL_API esGLStatsTexParameteri ( GLenum target, GLenum pname, GLint param );
+void ESUTIL_API esGLStatsUseProgram ( GLuint program );
+void ESUTIL_API esGLStatsActiveTexture ( GLenum texture );
+void ESUTIL_API esGLStatsBindTexture ( GLenum target, GLuint texture );
+void ESUTIL_API esGLStatsBindBuffer ( GLenum target, GLuint buffer );
+void ESUTIL_API esGLStatsBindFramebuffer ( GLenum target, GLuint framebuffer );
+void ESUTIL_API esGLStatsBindRenderbuffer ( GLenum target, GLuint renderbuffer );
+void ESUTIL_API esGLStatsVertexAttribPointer ( GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                               GLsizei stride, const GLvoid *ptr );
+void ESUTIL_API esGLStatsEnableVertexAttribArray ( GLuint index );
+void ESUTIL_API esGLStatsDisableVertexAttribArray ( GLuint index );
+void ESUTIL_API esGLStatsUniform1i ( GLint location, GLint x );
+void ESUTIL_API esGLStatsUniform1f ( GLint location, GLfloat x );
+void ESUTIL_API esGLStatsUniform2f ( GLint location, GLfloat x, GLfloat y );
+void ESUTIL_API esGLStatsUniform3f ( GLint location, GLfloat x, GLfloat y, GLfloat z );
+void ESUTIL_API esGLStatsUniform4f ( GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w );
+void ESUTIL_API esGLStatsUniform1fv ( GLint location, GLsizei count, const GLfloat *v );
+void ESUTIL_API esGLStatsUniform2fv ( GLint location, GLsizei count, const GLfloat *v );
+void ESUTIL_API esGLStatsUniform3fv ( GLint location, GLsizei count, const GLfloat *v );
+void ESUTIL_API esGLStatsUniform4fv ( GLint location, GLsizei count, const GLfloat *v );
+void ESUTIL_API esGLStatsUniformMatrix4fv ( GLint location, GLsizei count, GLboolean transpose, const GLfloat *value );
+void ESUTIL_API esGLStatsBufferData ( GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage );
+void ESUTIL_API esGLStatsBufferSubData ( GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data );
+void ESUTIL_API esGLStatsTexImage2D ( GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                                      GLint border, GLenum format, GLenum type, const GLvoid *pixels );
+void ESUTIL_API esGLStatsTexSubImage2D ( GLenum target, GLint level, GLint xoffset, GLint yoffset,
+                                         GLsizei width, GLsizei height, GLenum format, GLenum type,
+                                         const GLvoid *pixels );
+void ESUTIL_API esGLStatsCompressedTexImage2D ( GLenum target, GLint level, GLenum internalformat, GLsizei width,
+                                                GLsizei height, GLint border, GLsizei imageSize, const GLvoid *data );
+
+// Route the GL calls of every file that includes esUtil.h through the wrappers.  Files
+// whose GL calls run off the render thread define ES_GL_STATS_NO_WRAP before including it.
+#if !defined(ES_GL_STATS_IMPL) && !defined(ES_GL_STATS_NO_WRAP)
+#define glDrawArrays                esGLStatsDrawArrays
+#define glDrawElements              esGLStatsDrawElements
+#define glClear                     esGLStatsClear
+#define glEnable                    esGLStatsEnable
+#define glDisable                   esGLStatsDisable
+#define glBlendFunc                 esGLStatsBlendFunc
+#define glDepthFunc                 esGLStatsDepthFunc
+#define glDepthMask                 esGLStatsDepthMask
+#define glCullFace                  esGLStatsCullFace
+#define glStencilFunc               esGLStatsStencilFunc
+#define glStencilOp                 esGLStatsStencilOp
+#define glStencilMask               esGLStatsStencilMask
+#define glViewport                  esGLStatsViewport
+#define glClearColor                esGLStatsClearColor
+#define glClearDepthf               esGLStatsClearDepthf
+#define glClearStencil              esGLStatsClearStencil
+#define glPixelStorei               esGLStatsPixelStorei
+#define glTexParameteri             esGLStatsTexParameteri
+#define glUseProgram                esGLStatsUseProgram
+#define glActiveTexture             esGLStatsActiveTexture
+#define glBindTexture               esGLStatsBindTexture
+#define glBindBuffer                esGLStatsBindBuffer
+#define glBindFramebuffer           esGLStatsBindFramebuffer
+#define glBindRenderbuffer          esGLStatsBindRenderbuffer
+#define glVertexAttribPointer       esGLStatsVertexAttribPointer
+#define glEnableVertexAttribArray   esGLStatsEnableVertexAttribArray
+#define glDisableVertexAttribArray  esGLStatsDisableVertexAttribArray
+#define glUniform1i                 esGLStatsUniform1i
+#define glUniform1f                 esGLStatsUniform1f
+#define glUniform2f                 esGLStatsUniform2f
+#define glUniform3f                 esGLStatsUniform3f
+#define glUniform4f                 esGLStatsUniform4f
+#define glUniform1fv                esGLStatsUniform1fv
+#define glUniform2fv                esGLStatsUniform2fv
+#define glUniform3fv                esGLStatsUniform3fv
+#define glUniform4fv                esGLStatsUniform4fv
+#define glUniformMatrix4fv          esGLStatsUniformMatrix4fv
+#define glBufferData                esGLStatsBufferData
+#define glBufferSubData             esGLStatsBufferSubData
+#define glTexImage2D                esGLStatsTexImage2D
+#define glTexSubImage2D             esGLStatsTexSubImage2D
+#define glCompressedTexImage2D      esGLStatsCompressedTexImage2D
+#endif
+#endif
+
+#ifdef ES_TRACE
+//
+/// \brief Start a trace zone, used by ES_TRACE_ZONE
+/// \param name Name of the zone.  Must stay valid until the trace is dumped, e.g. a literal.
+//
+ESTraceZone ESUTIL_API esTraceZoneBegin ( const char *name );
+
+//
+/// \brief End a trace zone and record it in the calling thread's ring buffer
+/// \param zone Zone returned by esTraceZoneBegin
+//
+void ESUTIL_API esTraceZoneEnd ( ESTraceZone *zone );
+
+//
+/// \brief Name the calling thread in the trace
+/// \param name Thread name.  Must stay valid until the trace is dumped.
+//
+void ESUTIL_API esTraceThreadName ( const char *name );
+
+//
+/// \brief Write the zones recorded so far by all threads as Chrome trace_event JSON.
+///        Also done at exit into $ES_TRACE_FILE, or trace.json if it is not set.
+/// \param fileName Name of the file to write
+/// \return Number of events written, -1 if the file could not be opened
+//
+int ESUTIL_API esTraceDump ( const char *fileName );
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,218 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// esUtil_internal.h
+//
+//   Functions shared between the Common source files that are not part of
+//   the public esUtil API.
+
+#ifndef ESUTIL_INTERNAL_H
+#define ESUTIL_INTERNAL_H
+
+///
+//  Includes
+//
+#include "esUtil.h"
+
+#ifdef __cplusplus
+
+extern "C" {
+#endif
+
+
+///
+//  Types
+//
+
+/// Mip levels a KTX file can store, enough for 32768 pixels
+#define KTX_MAX_LEVELS  16
+
+typedef struct
+{
+   /// glType and glFormat of the file, both 0 for compressed formats
+   GLenum         type;
+   GLenum         format;
+   GLenum         internalFormat;
+   GLsizei        width;
+   GLsizei        height;
+
+   /// 1 or 6
+   GLuint         faces;
+
+   /// Levels stored, at least 1, and whether the file asks for the rest to be generated
+   GLuint         levels;
+   GLboolean      generateMipmaps;
+
+   /// Every face of every level, inside the file, and the size of one face per level
+   const unsigned char *images[KTX_MAX_LEVELS][6];
+   GLuint         imageSize[KTX_MAX_LEVELS];
+} KTXImage;
+
+
+///
+//  Public Functions
+//
+
+///
+//  UpdateThreadStart()
+//
+//      Publishes the first snapshot and starts the update thread registered
+//      with esRegisterThreadedUpdateFunc
+//
+GLboolean UpdateThreadStart ( ESContext *esContext );
+
+///
+//  UpdateThreadBeginFrame()
+//
+//      Picks up the newest published snapshot for the frame about to be drawn
+//      and lets the update thread start on the next one
+//
+void UpdateThreadBeginFrame ( ESContext *esContext );
+
+///
+//  UpdateThreadLastUpdateTime()
+//
+//      Duration of the most recent update on the update thread, in milliseconds
+//
+float UpdateThreadLastUpdateTime ( ESContext *esContext );
+
+///
+//  UpdateThreadStop()
+//
+//      Stops and joins the update thread
+//
+void UpdateThreadStop ( ESContext *esContext );
+
+///
+//  LoaderPoll()
+//
+//      Runs the completion callbacks of the background loads that are ready,
+//      called by esMainLoop at the start of every frame
+//
+void LoaderPoll ( ESContext *esContext );
+
+///
+//  LoaderStop()
+//
+//      Stops the loader thread and deletes the objects it created that were
+//      not handed to the application yet
+//
+void LoaderStop ( ESContext *esContext );
+
+///
+//  TextureStreamUpdate()
+//
+//      Uploads the next slices of the streamed textures whose pixels are ready,
+//      within the per-frame budget, called by esMainLoop at the start of every frame
+//
+void TextureStreamUpdate ( ESContext *esContext );
+
+///
+//  TextureStreamStop()
+//
+//      Stops the stream workers and deletes the textures and placeholder the
+//      application was not handed yet
+//
+void TextureStreamStop ( ESContext *esContext );
+
+///
+//  DynamicResolutionBeginDraw()
+//
+//      Binds the offscreen framebuffer and sets the render size for the draw callback
+//
+void DynamicResolutionBeginDraw ( ESContext *esContext );
+
+///
+//  DynamicResolutionEndDraw()
+//
+//      Restores the window size and stretches the frame over the window
+//
+void DynamicResolutionEndDraw ( ESContext *esContext );
+
+///
+//  DynamicResolutionEndFrame()
+//
+//      Feeds the newest frame or GPU time to the controller to pick the next scale
+//
+void DynamicResolutionEndFrame ( ESContext *esContext );
+
+///
+//  LogQueueBegin()
+//
+//      Queues log messages for the background thread from here on, called by
+//      esMainLoop before the first frame; messages are otherwise written synchronously
+//
+void LogQueueBegin ( void );
+
+///
+//  LogQueueEnd()
+//
+//      Writes the queued log messages and goes back to synchronous logging,
+//      called by esMainLoop after the last frame
+//
+void LogQueueEnd ( void );
+
+///
+//  ChooseEGLConfig()
+//
+//      Picks the cheapest config that supports surfaceType and the buffers
+//      requested by the esCreateWindow flags, of the native visual visualId
+//      when it is not 0
+//
+EGLBoolean ChooseEGLConfig ( EGLDisplay display, EGLint surfaceType, EGLint visualId, GLuint flags,
+                             EGLConfig *config );
+
+///
+//  DescribeFramebuffer()
+//
+//      Fills in esContext->framebuffer from the framebuffer the context renders
+//      to and logs it with the memory traffic it implies per frame
+//
+void DescribeFramebuffer ( ESContext *esContext );
+
+///
+//  HasExtension()
+//
+//      Whether the current context exposes the GL extension of exactly that name
+//
+GLboolean HasExtension ( const char *name );
+
+///
+//  MapFile()
+//
+//      Maps a file copy-on-write, so pixels can be converted in place without
+//      touching the file, and tells the kernel it will be read front to back
+//
+unsigned char *MapFile ( const char *fileName, size_t *size );
+
+///
+//  ParseKTX()
+//
+//      Checks the header of a mapped KTX file and locates every image in it,
+//      swapping the components of uncompressed images in place if the file was
+//      written with the other endianness.  Sets error to the reason on failure.
+//
+GLboolean ParseKTX ( unsigned char *file, size_t size, KTXImage *ktx, const char **error );
+
+///
+//  NativeETC1()
+//
+//      Whether ETC1 textures should be handed to GL compressed, which needs a
+//      current context: GL_OES_compressed_ETC1_RGB8_texture is exposed and the
+//      renderer is not a software rasterizer, for which decompressing once on
+//      the CPU is far cheaper than decoding blocks on every texel fetch
+//
+GLboolean NativeETC1 ( void );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ESUTIL_INTERNAL_H
@@ -0,0 +1,249 @@
+//
+// Book:      OpenGL(R) ES 2.0 Programming Guide
+// Authors:   Aaftab Munshi, Dan Ginsburg, Dave Shreiner
+// ISBN-10:   0321502795
+// ISBN-13:   9780321502797
+// Publisher: Addison-Wesley Professional
+// URLs:      http://safari.informit.com/9780321563835
+//            http://www.opengles-book.com
+//
+
+// ETC1Encode.c
+//
+//    Offline ETC1 compressor.  Reads a TGA image, builds its mip chain with
+//    a 2x2 box filter and writes every level as ETC1 to a KTX file that
+//    esLoadKTX can load.  Rows of 4x4 blocks are handed out to a pool of
+//    threads, one per CPU by default.  The PSNR of the base level and the
+//    encoding time are printed at the end.
+//
+//    Usage: TL_ETC1Encode [-q quality] [-j threads] [-n] input.tga output.ktx
+//
+//       -q   0 (fast), 1 (default) or 2 (best)
+//       -j   number of encoding threads
+//       -n   write the base level only
+//
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "esUtil.h"
+#include <GLES2/gl2ext.h>
+
+#define MAX_THREADS  64
+#define MAX_LEVELS   16
+
+typedef struct
+{
+   const unsigned char *rgb;
+   unsigned char       *blocks;
+   int                  width;
+   int                  height;
+   int                  quality;
+
+   // Next row of blocks to encode
+   int                  nextRow;
+} EncodeJob;
+
+///
+// Encode rows of blocks until none are left
+//
+static void *EncodeThread ( void *arg )
+{
+   EncodeJob *job = arg;
+   int blockRows = ( job->height + 3 ) / 4;
+   size_t rowBytes = (size_t) ( ( job->width + 3 ) / 4 ) * 8;
+   int row;
+
+   while ( ( row = __sync_fetch_and_add ( &job->nextRow, 1 ) ) < blockRows )
+   {
+      int rows = job->height - row * 4 < 4 ? job->height - row * 4 : 4;
+
+      esEncodeETC1 ( job->rgb + (size_t) row * 4 * job->width * 3, job->width, rows, job->quality,
+                     job->blocks + row * rowBytes );
+   }
+
+   return NULL;
+}
+
+///
+// Encode one level with numThreads threads
+//
+static void EncodeLevel ( const unsigned char *rgb, int width, int height, int quality, int numThreads,
+                          unsigned char *blocks )
+{
+   pthread_t threads[MAX_THREADS];
+   EncodeJob job;
+   int i;
+
+   job.rgb = rgb;
+   job.blocks = blocks;
+   job.width = width;
+   job.height = height;
+   job.quality = quality;
+   job.nextRow = 0;
+
+   for ( i = 1; i < numThreads; i++ )
+   {
+      if ( pthread_create ( &threads[i], NULL, EncodeThread, &job ) != 0 )
+         break;
+   }
+   EncodeThread ( &job );
+
+   while ( --i > 0 )
+      pthread_join ( threads[i], NULL );
+}
+
+///
+// Halve an RGB image, averaging 2x2 pixels and repeating the last row or column of odd sizes
+//
+static void Downsample ( const unsigned char *src, int srcWidth, int srcHeight, unsigned char *dst )
+{
+   int dstWidth = srcWidth > 1 ? srcWidth / 2 : 1;
+   int dstHeight = srcHeight > 1 ? srcHeight / 2 : 1;
+   int x, y, c;
+
+   for ( y = 0; y < dstHeight; y++ )
+   {
+      const unsigned char *row0 = src + (size_t) ( y * 2 ) * srcWidth * 3;
+      const unsigned char *row1 = src + (size_t) ( y * 2 + 1 < srcHeight ? y * 2 + 1 : y * 2 ) * srcWidth * 3;
+
+      for ( x = 0; x < dstWidth; x++ )
+      {
+         int x0 = x * 2 * 3;
+         int x1 = ( x * 2 + 1 < srcWidth ? x * 2 + 1 : x * 2 ) * 3;
+
+         for ( c = 0; c < 3; c++ )
+            *dst++ = (unsigned char) ( ( row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2 ) / 4 );
+      }
+   }
+}
+
+///
+// Write a 32-bit KTX header field in the byte order of this machine
+//
+static void WriteWord ( FILE *file, unsigned int word )
+{
+   fwrite ( &word, sizeof ( word ), 1, file );
+}
+
+int main ( int argc, char *argv[] )
+{
+   static const unsigned char identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+   int quality = 1;
+   int numThreads = (int) sysconf ( _SC_NPROCESSORS_ONLN );
+   int mipmaps = 1;
+   int width, height, levels, level, opt;
+   unsigned char *rgb, *blocks, *decoded;
+   unsigned char *images[MAX_LEVELS];
+   double start, elapsed, squaredError = 0.0, psnr;
+   size_t i, baseBytes;
+   FILE *file;
+
+   while ( ( opt = getopt ( argc, argv, "q:j:n" ) ) != -1 )
+   {
+      switch ( opt )
+      {
+         case 'q': quality = atoi ( optarg ); break;
+         case 'j': numThreads = atoi ( optarg ); break;
+         case 'n': mipmaps = 0; break;
+         default: optind = argc + 1; break;
+      }
+   }
+
+   if ( optind + 2 != argc || quality < 0 || quality > 2 )
+   {
+      fprintf ( stderr, "Usage: %s [-q 0|1|2] [-j threads] [-n] input.tga output.ktx\n", argv[0] );
+      return 1;
+   }
+   numThreads = numThreads < 1 ? 1 : numThreads > MAX_THREADS ? MAX_THREADS : numThreads;
+
+   rgb = (unsigned char *) esLoadTGA ( argv[optind], &width, &height );
+   if ( rgb == NULL )
+   {
+      fprintf ( stderr, "Unable to read %s\n", argv[optind] );
+      return 1;
+   }
+
+   // Every level down to 1x1, each downsampled from the previous one
+   images[0] = rgb;
+   levels = 1;
+   while ( mipmaps && levels < MAX_LEVELS && ( ( width >> ( levels - 1 ) ) > 1 || ( height >> ( levels - 1 ) ) > 1 ) )
+   {
+      int w = width >> ( levels - 1 ) ? width >> ( levels - 1 ) : 1;
+      int h = height >> ( levels - 1 ) ? height >> ( levels - 1 ) : 1;
+
+      images[levels] = malloc ( (size_t) ( w > 1 ? w / 2 : 1 ) * ( h > 1 ? h / 2 : 1 ) * 3 );
+      Downsample ( images[levels - 1], w, h, images[levels] );
+      levels++;
+   }
+
+   file = fopen ( argv[optind + 1], "wb" );
+   if ( file == NULL )
+   {
+      fprintf ( stderr, "Unable to create %s\n", argv[optind + 1] );
+      return 1;
+   }
+
+   fwrite ( identifier, sizeof ( identifier ), 1, file );
+   WriteWord ( file, 0x04030201 );
+   WriteWord ( file, 0 );                    // glType, 0 for compressed textures
+   WriteWord ( file, 1 );                    // glTypeSize
+   WriteWord ( file, 0 );                    // glFormat
+   WriteWord ( file, GL_ETC1_RGB8_OES );     // glInternalFormat
+   WriteWord ( file, GL_RGB );               // glBaseInternalFormat
+   WriteWord ( file, width );
+   WriteWord ( file, height );
+   WriteWord ( file, 0 );                    // pixelDepth
+   WriteWord ( file, 0 );                    // numberOfArrayElements
+   WriteWord ( file, 1 );                    // numberOfFaces
+   WriteWord ( file, levels );
+   WriteWord ( file, 0 );                    // bytesOfKeyValueData
+
+   baseBytes = (size_t) ( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) * 8;
+   blocks = malloc ( baseBytes );
+
+   start = esGetTime ( );
+   for ( level = 0; level < levels; level++ )
+   {
+      int w = width >> level ? width >> level : 1;
+      int h = height >> level ? height >> level : 1;
+      unsigned int size = ( ( w + 3 ) / 4 ) * ( ( h + 3 ) / 4 ) * 8;
+
+      EncodeLevel ( images[level], w, h, quality, numThreads, blocks );
+
+      // Levels are a multiple of 8 bytes, so never need padding
+      WriteWord ( file, size );
+      fwrite ( blocks, size, 1, file );
+
+      if ( level == 0 )
+      {
+         elapsed = esGetTime ( ) - start;
+
+         decoded = malloc ( (size_t) width * height * 3 );
+         esDecodeETC1 ( blocks, width, height, decoded );
+         for ( i = 0; i < (size_t) width * height * 3; i++ )
+            squaredError += ( decoded[i] - rgb[i] ) * ( decoded[i] - rgb[i] );
+         free ( decoded );
+
+         start = esGetTime ( ) - elapsed;
+      }
+   }
+   elapsed = esGetTime ( ) - start;
+
+   if ( fclose ( file ) != 0 )
+   {
+      fprintf ( stderr, "Unable to write %s\n", argv[optind + 1] );
+      return 1;
+   }
+
+   psnr = squaredError > 0.0 ? 10.0 * log10 ( 255.0 * 255.0 * width * height * 3 / squaredError ) : INFINITY;
+   printf ( "%s: %dx%d, %d levels, quality %d, %d threads, %.1f ms, base level PSNR %.2f dB\n",
+            argv[optind + 1], width, height, levels, quality, numThreads, elapsed * 1000.0, psnr );
+
+   for ( level = 0; level < levels; level++ )
+      free ( images[level] );
+   free ( blocks );
+   return 0;
+}